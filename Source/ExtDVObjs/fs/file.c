@@ -22,12 +22,15 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#define _GNU_SOURCE
 #include "config.h"
 #include "private/instance.h"
 #include "private/errors.h"
 #include "private/dvobjs.h"
 #include "purc-variant.h"
 
+#include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <sys/stat.h>
 
@@ -177,140 +180,254 @@ static ssize_t find_line (FILE *fp, int line_num, ssize_t file_length)
 }
 #endif
 
-// Scan the file and tell me how many lines there will be.
-static size_t scan_lines (FILE *fp)
-{
-    char    buffer[BUFFER_SIZE];
-    size_t  read_size = 0;
-    size_t  total_line = 0;
-    bool    new_line_flag = false;
+/* The content of a text file, or the part of it at the head or the tail,
+   read into a buffer. The file is not mapped into memory: touching a page
+   beyond the end of a file truncated in the meantime would raise SIGBUS. */
+struct text_file {
+    char       *data;
+    size_t      size;
+};
+
+enum text_part {
+    TEXT_ALL,
+    TEXT_HEAD,      // at least the first `nr_lines` lines
+    TEXT_TAIL,      // at least the last `nr_lines` lines
+};
+
+#define TEXT_CHUNK_SIZE     (BUFFER_SIZE * 16)
 
-    fseek (fp, 0, SEEK_SET);
+static size_t head_offset (const char *data, size_t size, size_t nr_lines);
+static size_t tail_offset (const char *data, size_t size, size_t nr_lines);
+
+/* reads forward till the end of the file, or till the first `nr_lines`
+   lines are in the buffer if `nr_lines` is not 0 */
+static int read_text_forward (int fd, struct text_file *tf, size_t nr_lines)
+{
+    size_t buf_size = 0;
 
     while (1) {
-        read_size = fread (buffer, 1, BUFFER_SIZE, fp);
-        if (read_size == 0)
-            break;
+        if (tf->size == buf_size) {
+            if (nr_lines && head_offset (tf->data, tf->size, nr_lines) <
+                    tf->size)
+                break;
 
-        size_t i;
-        for (i = 0; i < read_size; i++) {
-            if (buffer[i] == '\n') {
-                total_line ++;
-                new_line_flag = false;
-            }
-            else {
-                new_line_flag = true;
+            buf_size = buf_size ? buf_size * 2 : TEXT_CHUNK_SIZE;
+            char *p = realloc (tf->data, buf_size);
+            if (p == NULL) {
+                errno = ENOMEM;
+                return -1;
             }
+            tf->data = p;
         }
 
-        if (read_size < BUFFER_SIZE) // No more content.
+        ssize_t n = read (fd, tf->data + tf->size, buf_size - tf->size);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        else if (n == 0)
             break;
-    }
 
-    if (new_line_flag)
-        total_line ++;
+        tf->size += n;
+    }
 
-    fseek (fp, 0, SEEK_SET);
-    return total_line;
+    return 0;
 }
 
-// line_num == 0: Read all lines.
-// line_num  > 0: Read the first line_num lines.
-// line_num  < 0: Skip the first line_num lines and read the remaining lines.
-static purc_variant_t read_lines (FILE *fp, ssize_t line_num)
+/* reads backward from the end of a regular file of `file_size` bytes, till
+   the last `nr_lines` lines are in the buffer; returns 1 if the file was
+   truncated in the meantime */
+static int read_text_backward (int fd, struct text_file *tf,
+        uint64_t file_size, size_t nr_lines)
 {
-    char    buffer[BUFFER_SIZE];
-    size_t  read_size = 0;
-    char   *content = NULL;
-    size_t  content_len = 0;
-    purc_variant_t val = PURC_VARIANT_INVALID;
-    purc_variant_t ret_var = purc_variant_make_array (0, PURC_VARIANT_INVALID);
+    size_t buf_size = 0;
 
-    while (1) {
-        read_size = fread (buffer, 1, BUFFER_SIZE, fp);
-        if (read_size == 0)
+    while (tf->size < file_size) {
+        if (tf->size > 0 && tail_offset (tf->data, tf->size, nr_lines) > 0)
             break;
 
-        size_t i;
-        size_t buffer_line_start = 0;
-        size_t buffer_line_end = 0;
-        for (i = 0; i < read_size; i++) {
-            if (buffer[i] == '\n')
-            {
-                if (line_num < 0) {
-                    // Skip the first line_num lines.
-                    line_num ++;
-                }
-                else {
-                    buffer_line_end = i - 1;
-                    
-                    if (content_len > 0) {
-                        content = realloc (content,
-                                content_len + buffer_line_end - buffer_line_start + 1);
-                        memcpy (content + content_len,
-                                buffer + buffer_line_start,
-                                buffer_line_end - buffer_line_start);
-                        content_len += (buffer_line_end - buffer_line_start);
-                        content[content_len] = 0x0;
-                        if (content[content_len - 1] == '\r')
-                            content[content_len - 1] = 0x0;
-
-                        val = purc_variant_make_string_ex (content, content_len, false);
-                        purc_variant_array_append (ret_var, val);
-                        purc_variant_unref (val);
-
-                        free (content);
-                        content = NULL;
-                        content_len = 0;
-                    }
-                    else {
-                        val = purc_variant_make_string_ex (buffer + buffer_line_start,
-                                buffer_line_end - buffer_line_start, false);
-                        purc_variant_array_append (ret_var, val);
-                        purc_variant_unref (val);
-                    }
+        size_t more = buf_size ? buf_size : TEXT_CHUNK_SIZE;
+        if (more > file_size - tf->size)
+            more = (size_t)(file_size - tf->size);
 
-                    if (line_num > 0) {
-                        // Read the first line_num lines.
-                        line_num --;
-                        if (line_num == 0)
-                            goto out;
-                    }
-                }
-
-                buffer_line_start = i + 1;
+        char *p = malloc (tf->size + more);
+        if (p == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+        if (tf->size)
+            memcpy (p + more, tf->data, tf->size);
+        free (tf->data);
+        tf->data = p;
+        buf_size = tf->size + more;
+
+        off_t off = (off_t)(file_size - tf->size - more);
+        size_t got = 0;
+        while (got < more) {
+            ssize_t n = pread (fd, p + got, more - got, off + got);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                return -1;
             }
+            else if (n == 0)
+                return 1;
+            got += n;
         }
+        tf->size = buf_size;
+    }
+
+    return 0;
+}
 
-        if (i > buffer_line_start) {
-            content = realloc (content,
-                    content_len + read_size - buffer_line_start + 1);
-            memcpy (content + content_len,
-                    buffer + buffer_line_start,
-                    read_size - buffer_line_start);
-            content_len += (read_size - buffer_line_start);
-            content[content_len] = 0x0;
+static int load_text_file (const char *filename, enum text_part part,
+        size_t nr_lines, struct text_file *tf)
+{
+    struct stat st;
+    int fd, r = -1;
+
+    tf->data = NULL;
+    tf->size = 0;
+
+    fd = open (filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    if (fstat (fd, &st) < 0)
+        goto done;
+
+    /* the size of the files under /proc, for example, is zero */
+    if (part == TEXT_TAIL && S_ISREG (st.st_mode) && st.st_size > 0) {
+        r = read_text_backward (fd, tf, (uint64_t)st.st_size, nr_lines);
+        if (r <= 0)
+            goto done;
+
+        /* truncated; read what is left from the start */
+        free (tf->data);
+        tf->data = NULL;
+        tf->size = 0;
+        if (lseek (fd, 0, SEEK_SET) < 0) {
+            r = -1;
+            goto done;
         }
+    }
 
-        if (read_size < BUFFER_SIZE) // No more content.
-        {
-            if (content && line_num >= 0) {
-                val = purc_variant_make_string_ex (content, content_len, false);
-                purc_variant_array_append (ret_var, val);
-                purc_variant_unref (val);
+    /* the other files, such as pipes, can only be read forward */
+    r = read_text_forward (fd, tf, (part == TEXT_HEAD) ? nr_lines : 0);
 
-                free (content);
-                content = NULL;
-                content_len = 0;
-            }
+done:
+    if (r) {
+        free (tf->data);
+        tf->data = NULL;
+        tf->size = 0;
+    }
+    close (fd);
+    return r ? -1 : 0;
+}
+
+static void close_text_file (struct text_file *tf)
+{
+    free (tf->data);
+}
+
+static inline const char *find_prev_newline (const char *data, size_t len)
+{
+#if OS(LINUX)
+    return memrchr (data, '\n', len);
+#else
+    while (len > 0) {
+        len--;
+        if (data[len] == '\n')
+            return data + len;
+    }
+    return NULL;
+#endif
+}
+
+// The offset of the line following the first `nr_lines` lines.
+static size_t head_offset (const char *data, size_t size, size_t nr_lines)
+{
+    size_t off = 0;
+
+    while (nr_lines > 0 && off < size) {
+        const char *nl = memchr (data + off, '\n', size - off);
+        if (nl == NULL)
+            return size;
+
+        off = nl - data + 1;
+        nr_lines--;
+    }
 
+    return off;
+}
+
+// The offset of the first one of the last `nr_lines` lines; scans backwards
+// so that only the tail of the file is touched.
+static size_t tail_offset (const char *data, size_t size, size_t nr_lines)
+{
+    size_t end = size;
+
+    if (nr_lines == 0)
+        return size;
+
+    // the newline terminating the last line does not start a new line.
+    if (end > 0 && data[end - 1] == '\n')
+        end--;
+
+    while (end > 0) {
+        const char *nl = find_prev_newline (data, end);
+        if (nl == NULL)
             break;
-        }
+
+        nr_lines--;
+        if (nr_lines == 0)
+            return nl - data + 1;
+
+        end = nl - data;
     }
 
-out:
-    if (content)
-        free (content);
+    return 0;
+}
+
+// Make an array of the lines in `data`; the line terminators ('\n' or "\r\n")
+// are not included, and the last line may have no terminator.
+static purc_variant_t make_lines (const char *data, size_t len)
+{
+    const char *end = data + len;
+    purc_variant_t ret_var = purc_variant_make_array (0, PURC_VARIANT_INVALID);
+    if (ret_var == PURC_VARIANT_INVALID)
+        return PURC_VARIANT_INVALID;
+
+    while (data < end) {
+        const char *nl = memchr (data, '\n', end - data);
+        const char *next;
+
+        if (nl) {
+            next = nl + 1;
+        }
+        else {
+            nl = end;
+            next = end;
+        }
+
+        size_t line_len = nl - data;
+        if (line_len > 0 && data[line_len - 1] == '\r')
+            line_len--;
+
+        purc_variant_t val = purc_variant_make_string_ex (data,
+                line_len, false);
+        if (val == PURC_VARIANT_INVALID ||
+                !purc_variant_array_append (ret_var, val)) {
+            if (val)
+                purc_variant_unref (val);
+            purc_variant_unref (ret_var);
+            return PURC_VARIANT_INVALID;
+        }
+        purc_variant_unref (val);
+
+        data = next;
+    }
 
     return ret_var;
 }
@@ -361,7 +478,8 @@ text_head_getter (purc_variant_t root, size_t nr_args, purc_variant_t *argv,
 
     ssize_t     line_num = 0;
     const char *filename = NULL;
-    FILE       *fp = NULL;
+    struct text_file tf;
+    size_t      len;
     //purc_variant_t val;
     purc_variant_t ret_var = PURC_VARIANT_INVALID;
 
@@ -384,32 +502,27 @@ text_head_getter (purc_variant_t root, size_t nr_args, purc_variant_t *argv,
         }
     }
 
-    fp = fopen (filename, "r");
-    if (fp == NULL) {
+    if (load_text_file (filename, (line_num > 0) ? TEXT_HEAD : TEXT_ALL,
+                (line_num > 0) ? (size_t)line_num : 0, &tf)) {
         purc_set_error (PURC_ERROR_BAD_SYSTEM_CALL);
         return PURC_VARIANT_INVALID;
     }
 
-    if (line_num >= 0) {
-        // ==0: Read all lines.
-        // > 0: Read the first line_num lines.
-        ret_var = read_lines (fp, line_num);
+    if (line_num == 0) {
+        // Read all lines.
+        len = tf.size;
+    }
+    else if (line_num > 0) {
+        // Read the first line_num lines; stop once they are found.
+        len = head_offset (tf.data, tf.size, (size_t)line_num);
     }
     else {
-        // line_num < 0: Read all but the last (-line_num) lines.
-
-        // Scan the file and tell me how many lines there will be.
-        size_t total_line = scan_lines (fp);
-
-        line_num = total_line + line_num;// line_num is NEGATIVE !
-
-        if (line_num <= 0)
-            ret_var = purc_variant_make_array (0, PURC_VARIANT_INVALID);
-        else
-            ret_var = read_lines (fp, line_num);
+        // Read all but the last (-line_num) lines.
+        len = tail_offset (tf.data, tf.size, (size_t)0 - (size_t)line_num);
     }
 
-    fclose (fp);
+    ret_var = make_lines (tf.data, len);
+    close_text_file (&tf);
     return ret_var;
 }
 
@@ -422,7 +535,8 @@ text_tail_getter (purc_variant_t root, size_t nr_args, purc_variant_t *argv,
 
     ssize_t     line_num = 0;
     const char *filename = NULL;
-    FILE       *fp = NULL;
+    struct text_file tf;
+    size_t      off;
     //purc_variant_t val;
     purc_variant_t ret_var = PURC_VARIANT_INVALID;
 
@@ -445,33 +559,27 @@ text_tail_getter (purc_variant_t root, size_t nr_args, purc_variant_t *argv,
         }
     }
 
-    fp = fopen (filename, "r");
-    if (fp == NULL) {
+    if (load_text_file (filename, (line_num > 0) ? TEXT_TAIL : TEXT_ALL,
+                (line_num > 0) ? (size_t)line_num : 0, &tf)) {
         purc_set_error (PURC_ERROR_BAD_SYSTEM_CALL);
         return PURC_VARIANT_INVALID;
     }
 
-    if (line_num <= 0) {
-        // ==0: Read all lines.
-        // < 0: Skip the first line_num lines and read the remaining lines.
-        ret_var = read_lines (fp, line_num);
+    if (line_num == 0) {
+        // Read all lines.
+        off = 0;
+    }
+    else if (line_num > 0) {
+        // Read the last line_num lines; only the tail of the file is read.
+        off = tail_offset (tf.data, tf.size, (size_t)line_num);
     }
     else {
-        // line_num > 0: Read the last line_num lines.
-
-        // Scan the file and tell me how many lines there will be.
-        size_t total_line = scan_lines (fp);
-
-        line_num = total_line - line_num;
-
-        if (line_num <= 0)
-            ret_var = purc_variant_make_array (0, PURC_VARIANT_INVALID);
-        else
-            // Skip line_num lines.
-            ret_var = read_lines (fp, -line_num);
+        // Skip the first (-line_num) lines and read the remaining lines.
+        off = head_offset (tf.data, tf.size, (size_t)0 - (size_t)line_num);
     }
 
-    fclose (fp);
+    ret_var = make_lines (tf.data + off, tf.size - off);
+    close_text_file (&tf);
     return ret_var;
 }
 
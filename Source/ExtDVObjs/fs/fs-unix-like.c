@@ -23,11 +23,15 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#define _GNU_SOURCE
 #include "config.h"
 #include "private/instance.h"
 #include "private/errors.h"
 #include "private/dvobjs.h"
+#include "private/interpreter.h"
+#include "private/list.h"
 #include "purc-variant.h"
+#include "purc-runloop.h"
 
 #if HAVE(SYS_SYSMACROS_H)
 #include <sys/sysmacros.h>
@@ -44,10 +48,16 @@
 #include <pwd.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <dlfcn.h>
 
 #if OS(LINUX)
 #include <mntent.h>
 #include <sys/vfs.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
 #endif
 
 #if USE(GLIB)
@@ -200,38 +210,152 @@ static inline int strcmp_len (const char *str1, const char *str2, size_t *real_l
     return 0;
 }
 
-static bool filecopy (const char *infile, const char *outfile)
+#define FLCPY_BFSZ      (64 * 1024)
+#define FLCPY_CHUNK     (8 * 1024 * 1024)
+
+typedef bool (*copy_progress_fn) (void *ctxt, uint64_t copied, uint64_t total);
+
+static int write_all (int fd, const char *buffer, size_t count)
 {
-    #define FLCPY_BFSZ  8192
+    while (count > 0) {
+        ssize_t n = write (fd, buffer, count);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        buffer += n;
+        count -= n;
+    }
+    return 0;
+}
 
-    char buffer[FLCPY_BFSZ];
-    size_t sz_read = 0;
-    FILE *in  = fopen (infile, "rb");
-    FILE *out = fopen (outfile,"wb");
+/*
+ * Copies the data from `fd_in` to `fd_out` in the kernel if possible:
+ * by copy_file_range(2), or by sendfile(2) across the file systems which
+ * copy_file_range(2) does not support. Calls `progress` (nullable) after
+ * every chunk and stops if it returns false.
+ * Returns 0 on success, or the error number.
+ */
+static int copy_file_data (int fd_in, int fd_out, off_t size,
+        copy_progress_fn progress, void *ctxt)
+{
+    enum { BY_COPY_RANGE, BY_SENDFILE, BY_READ_WRITE } by = BY_READ_WRITE;
+    char *buffer = NULL;
+    uint64_t copied = 0;
+    int err = 0;
 
-    if (NULL == in || NULL == out) {
-        if (in)
-            fclose (in);
-        if (out)
-            fclose (out);
-        return false;
+#if OS(LINUX)
+    /* some special files, e.g., those in /proc, report zero size */
+    if (size > 0) {
+#ifdef SYS_copy_file_range
+        by = BY_COPY_RANGE;
+#else
+        by = BY_SENDFILE;
+#endif
     }
+#endif
 
-    while ((sz_read = fread (buffer, 1, FLCPY_BFSZ, in)) == FLCPY_BFSZ) {
-        if (sz_read != fwrite (buffer, 1, sz_read, out)) {
-            fclose (out);
-            fclose (in);
-            return false;
+    for (;;) {
+        ssize_t n;
+
+#if OS(LINUX)
+        if (by == BY_COPY_RANGE) {
+#ifdef SYS_copy_file_range
+            n = syscall (SYS_copy_file_range, fd_in, NULL, fd_out, NULL,
+                    FLCPY_CHUNK, 0);
+#else
+            n = -1;
+            errno = ENOSYS;
+#endif
+            if (n < 0 && copied == 0 && (errno == EXDEV || errno == EINVAL ||
+                        errno == ENOSYS || errno == EOPNOTSUPP)) {
+                by = BY_SENDFILE;
+                continue;
+            }
+        }
+        else if (by == BY_SENDFILE) {
+            n = sendfile (fd_out, fd_in, NULL, FLCPY_CHUNK);
+            if (n < 0 && copied == 0 && (errno == EINVAL || errno == ENOSYS)) {
+                by = BY_READ_WRITE;
+                continue;
+            }
+        }
+        else
+#endif
+        {
+            if (buffer == NULL && (buffer = malloc (FLCPY_BFSZ)) == NULL) {
+                err = ENOMEM;
+                break;
+            }
+
+            n = read (fd_in, buffer, FLCPY_BFSZ);
+            if (n > 0 && write_all (fd_out, buffer, n)) {
+                err = errno;
+                break;
+            }
+        }
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            err = errno;
+            break;
+        }
+        else if (n == 0) {
+            break;
+        }
+
+        copied += n;
+        if (progress && !progress (ctxt, copied, (uint64_t)size)) {
+            err = ECANCELED;
+            break;
         }
     }
-    if (sz_read != fwrite (buffer, 1, sz_read, out)) {
-        fclose (out);
-        fclose (in);
-        return false;
+
+    free (buffer);
+    return err;
+}
+
+// returns 0 on success, or the error number
+static int copy_file (const char *infile, const char *outfile,
+        copy_progress_fn progress, void *ctxt)
+{
+    struct stat st;
+    int fd_in, fd_out;
+    int err = 0;
+
+    fd_in = open (infile, O_RDONLY | O_CLOEXEC);
+    if (fd_in < 0)
+        return errno;
+
+    if (fstat (fd_in, &st) < 0) {
+        err = errno;
+        close (fd_in);
+        return err;
+    }
+
+    fd_out = open (outfile, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd_out < 0) {
+        err = errno;
+        close (fd_in);
+        return err;
     }
 
-    fclose (out);
-    fclose (in);
+    err = copy_file_data (fd_in, fd_out, st.st_size, progress, ctxt);
+    if (close (fd_out) < 0 && err == 0)
+        err = errno;
+    close (fd_in);
+    return err;
+}
+
+static bool filecopy (const char *infile, const char *outfile)
+{
+    int err = copy_file (infile, outfile, NULL, NULL);
+    if (err) {
+        errno = err;
+        return false;
+    }
     return true;
 }
 
@@ -789,6 +913,221 @@ get_stat_result (int nr_fn_option, size_t nr_args, purc_variant_t *argv)
 }
 
 
+static void free_wildcard_list (struct wildcard_list *wildcard)
+{
+    struct wildcard_list *temp_wildcard;
+
+    while (wildcard) {
+        if (wildcard->wildcard)
+            free (wildcard->wildcard);
+        temp_wildcard = wildcard;
+        wildcard = wildcard->next;
+        free (temp_wildcard);
+    }
+}
+
+// split the filter separated by ';' into a list of wildcards
+static bool make_wildcard_list (const char *filter,
+        struct wildcard_list **list)
+{
+    struct wildcard_list *wildcard = NULL;
+    struct wildcard_list *temp_wildcard = NULL;
+    size_t length = 0;
+    const char *head = pcutils_get_next_token (filter, ";", &length);
+
+    while (head) {
+        if (wildcard == NULL) {
+            wildcard = malloc (sizeof(struct wildcard_list));
+            if (wildcard == NULL)
+                goto error;
+            temp_wildcard = wildcard;
+        }
+        else {
+            temp_wildcard->next = malloc (sizeof(struct wildcard_list));
+            if (temp_wildcard->next == NULL)
+                goto error;
+            temp_wildcard = temp_wildcard->next;
+        }
+        temp_wildcard->next = NULL;
+        temp_wildcard->wildcard = malloc (length + 1);
+        if (temp_wildcard->wildcard == NULL)
+            goto error;
+        strncpy(temp_wildcard->wildcard, head, length);
+        *(temp_wildcard->wildcard + length) = 0x00;
+        pcdvobjs_remove_space (temp_wildcard->wildcard);
+
+        // do not read beyond the terminating null byte
+        if (head[length] == 0x00)
+            break;
+        head = pcutils_get_next_token (head + length + 1, ";", &length);
+    }
+
+    *list = wildcard;
+    return true;
+
+error:
+    free_wildcard_list (wildcard);
+    return false;
+}
+
+static bool match_wildcard_list (const struct wildcard_list *wildcard,
+        const char *name)
+{
+    if (wildcard == NULL)
+        return true;
+
+    while (wildcard) {
+        if (wildcard_cmp (name, wildcard->wildcard))
+            return true;
+        wildcard = wildcard->next;
+    }
+    return false;
+}
+
+static const char *type_of_dirent (unsigned char d_type)
+{
+    switch (d_type) {
+        case DT_BLK:
+            return "b";
+        case DT_CHR:
+            return "c";
+        case DT_DIR:
+            return "d";
+        case DT_FIFO:
+            return "f";
+        case DT_LNK:
+            return "l";
+        case DT_REG:
+            return "r";
+        case DT_SOCK:
+            return "s";
+        case DT_UNKNOWN:
+            return "u";
+    }
+    return NULL;
+}
+
+// make the object describing an entry of a directory for `list`
+static purc_variant_t make_list_entry (const char *name, unsigned char d_type,
+        ino_t ino, const struct stat *file_stat)
+{
+    purc_variant_t obj_var = PURC_VARIANT_INVALID;
+    purc_variant_t val = PURC_VARIANT_INVALID;
+    const char *type;
+    char au[10] = {0};
+    int i = 0;
+
+    obj_var = purc_variant_make_object (0, PURC_VARIANT_INVALID,
+            PURC_VARIANT_INVALID);
+    if (obj_var == PURC_VARIANT_INVALID)
+        return PURC_VARIANT_INVALID;
+
+    // name
+    val = purc_variant_make_string (name, false);
+    purc_variant_object_set_by_static_ckey (obj_var, "name", val);
+    purc_variant_unref (val);
+
+    // dev
+    val = purc_variant_make_number (file_stat->st_dev);
+    purc_variant_object_set_by_static_ckey (obj_var, "dev", val);
+    purc_variant_unref (val);
+
+    // inode
+    val = purc_variant_make_number (ino);
+    purc_variant_object_set_by_static_ckey (obj_var, "inode", val);
+    purc_variant_unref (val);
+
+    // type
+    type = type_of_dirent (d_type);
+    if (type) {
+        val = purc_variant_make_string (type, false);
+        purc_variant_object_set_by_static_ckey (obj_var, "type", val);
+        purc_variant_unref (val);
+    }
+
+    // mode
+    val = purc_variant_make_byte_sequence (&(file_stat->st_mode),
+                                                sizeof(unsigned long));
+    purc_variant_object_set_by_static_ckey (obj_var, "mode", val);
+    purc_variant_unref (val);
+
+    // mode_str
+    for (i = 0; i < 3; i++) {
+        if ((0x01 << (8 - 3 * i)) & file_stat->st_mode)
+            au[i * 3 + 0] = 'r';
+        else
+            au[i * 3 + 0] = '-';
+        if ((0x01 << (7 - 3 * i)) & file_stat->st_mode)
+            au[i * 3 + 1] = 'w';
+        else
+            au[i * 3 + 1] = '-';
+        if ((0x01 << (6 - 3 * i)) & file_stat->st_mode)
+            au[i * 3 + 2] = 'x';
+        else
+            au[i * 3 + 2] = '-';
+    }
+    val = purc_variant_make_string (au, false);
+    purc_variant_object_set_by_static_ckey (obj_var, "mode_str", val);
+    purc_variant_unref (val);
+
+    // nlink
+    val = purc_variant_make_number (file_stat->st_nlink);
+    purc_variant_object_set_by_static_ckey (obj_var, "nlink", val);
+    purc_variant_unref (val);
+
+    // uid
+    val = purc_variant_make_number (file_stat->st_uid);
+    purc_variant_object_set_by_static_ckey (obj_var, "uid", val);
+    purc_variant_unref (val);
+
+    // gid
+    val = purc_variant_make_number (file_stat->st_gid);
+    purc_variant_object_set_by_static_ckey (obj_var, "gid", val);
+    purc_variant_unref (val);
+
+    // rdev_major 
+    val = purc_variant_make_number (major(file_stat->st_dev));
+    purc_variant_object_set_by_static_ckey (obj_var, "rdev_major", val);
+    purc_variant_unref (val);
+
+    // rdev_minor
+    val = purc_variant_make_number (minor(file_stat->st_dev));
+    purc_variant_object_set_by_static_ckey (obj_var, "rdev_minor", val);
+    purc_variant_unref (val);
+
+    // size
+    val = purc_variant_make_number (file_stat->st_size);
+    purc_variant_object_set_by_static_ckey (obj_var, "size", val);
+    purc_variant_unref (val);
+
+    // blksize
+    val = purc_variant_make_number (file_stat->st_blksize);
+    purc_variant_object_set_by_static_ckey (obj_var, "blksize", val);
+    purc_variant_unref (val);
+
+    // blocks
+    val = purc_variant_make_number (file_stat->st_blocks);
+    purc_variant_object_set_by_static_ckey (obj_var, "blocks", val);
+    purc_variant_unref (val);
+
+    // atime
+    val = purc_variant_make_string (ctime(&file_stat->st_atime), false);
+    purc_variant_object_set_by_static_ckey (obj_var, "atime", val);
+    purc_variant_unref (val);
+
+    // mtime
+    val = purc_variant_make_string (ctime(&file_stat->st_mtime), false);
+    purc_variant_object_set_by_static_ckey (obj_var, "mtime", val);
+    purc_variant_unref (val);
+
+    // ctime
+    val = purc_variant_make_string (ctime(&file_stat->st_ctime), false);
+    purc_variant_object_set_by_static_ckey (obj_var, "ctime", val);
+    purc_variant_unref (val);
+
+    return obj_var;
+}
+
 static purc_variant_t
 list_getter (purc_variant_t root, size_t nr_args, purc_variant_t *argv,
         bool silently)
@@ -800,12 +1139,8 @@ list_getter (purc_variant_t root, size_t nr_args, purc_variant_t *argv,
     char filename[PATH_MAX + NAME_MAX + 1];
     const char *string_filename = NULL;
     purc_variant_t ret_var = PURC_VARIANT_INVALID;
-    purc_variant_t val = PURC_VARIANT_INVALID;
     const char *filter = NULL;
     struct wildcard_list *wildcard = NULL;
-    struct wildcard_list *temp_wildcard = NULL;
-    char au[10] = {0};
-    int i = 0;
 
     if (nr_args < 1) {
         purc_set_error (PURC_ERROR_ARGUMENT_MISSED);
@@ -835,32 +1170,8 @@ list_getter (purc_variant_t root, size_t nr_args, purc_variant_t *argv,
         filter = purc_variant_get_string_const (argv[1]);
 
     // get filter array
-    if (filter) {
-        size_t length = 0;
-        const char *head = pcutils_get_next_token (filter, ";", &length);
-        while (head) {
-            if (wildcard == NULL) {
-                wildcard = malloc (sizeof(struct wildcard_list));
-                if (wildcard == NULL)
-                    goto error;
-                temp_wildcard = wildcard;
-            }
-            else {
-                temp_wildcard->next = malloc (sizeof(struct wildcard_list));
-                if (temp_wildcard->next == NULL)
-                    goto error;
-                temp_wildcard = temp_wildcard->next;
-            }
-            temp_wildcard->next = NULL;
-            temp_wildcard->wildcard = malloc (length + 1);
-            if (temp_wildcard->wildcard == NULL)
-                goto error;
-            strncpy(temp_wildcard->wildcard, head, length);
-            *(temp_wildcard->wildcard + length) = 0x00;
-            pcdvobjs_remove_space (temp_wildcard->wildcard);
-            head = pcutils_get_next_token (head + length + 1, ";", &length);
-        }
-    }
+    if (filter && !make_wildcard_list (filter, &wildcard))
+        return PURC_VARIANT_INVALID;
 
     // get the dirctory content
     DIR *dir = NULL;
@@ -880,18 +1191,9 @@ list_getter (purc_variant_t root, size_t nr_args, purc_variant_t *argv,
             continue;
 
         // use filter
-        temp_wildcard = wildcard;
-        while (temp_wildcard) {
-            if (wildcard_cmp (ptr->d_name, temp_wildcard->wildcard))
-                break;
-            temp_wildcard = temp_wildcard->next;
-        }
-        if (wildcard && (temp_wildcard == NULL))
+        if (!match_wildcard_list (wildcard, ptr->d_name))
             continue;
 
-        obj_var = purc_variant_make_object (0, PURC_VARIANT_INVALID,
-                PURC_VARIANT_INVALID);
-
         strncpy (filename, dir_name, sizeof(filename)-1);
         strcat (filename, "/");
         strcat (filename, ptr->d_name);
@@ -899,142 +1201,10 @@ list_getter (purc_variant_t root, size_t nr_args, purc_variant_t *argv,
         if (stat(filename, &file_stat) < 0)
             continue;
 
-        // name
-        val = purc_variant_make_string (ptr->d_name, false);
-        purc_variant_object_set_by_static_ckey (obj_var, "name", val);
-        purc_variant_unref (val);
-
-        // dev
-        val = purc_variant_make_number (file_stat.st_dev);
-        purc_variant_object_set_by_static_ckey (obj_var, "dev", val);
-        purc_variant_unref (val);
-
-        // inode
-        val = purc_variant_make_number (ptr->d_ino);
-        purc_variant_object_set_by_static_ckey (obj_var, "inode", val);
-        purc_variant_unref (val);
-
-        // type
-        if (ptr->d_type == DT_BLK) {
-            val = purc_variant_make_string ("b", false);
-            purc_variant_object_set_by_static_ckey (obj_var, "type", val);
-            purc_variant_unref (val);
-        }
-        else if(ptr->d_type == DT_CHR) {
-            val = purc_variant_make_string ("c", false);
-            purc_variant_object_set_by_static_ckey (obj_var, "type", val);
-            purc_variant_unref (val);
-        }
-        else if(ptr->d_type == DT_DIR) {
-            val = purc_variant_make_string ("d", false);
-            purc_variant_object_set_by_static_ckey (obj_var, "type", val);
-            purc_variant_unref (val);
-        }
-        else if(ptr->d_type == DT_FIFO) {
-            val = purc_variant_make_string ("f", false);
-            purc_variant_object_set_by_static_ckey (obj_var, "type", val);
-            purc_variant_unref (val);
-        }
-        else if(ptr->d_type == DT_LNK) {
-            val = purc_variant_make_string ("l", false);
-            purc_variant_object_set_by_static_ckey (obj_var, "type", val);
-            purc_variant_unref (val);
-        }
-        else if(ptr->d_type == DT_REG) {
-            val = purc_variant_make_string ("r", false);
-            purc_variant_object_set_by_static_ckey (obj_var, "type", val);
-            purc_variant_unref (val);
-        }
-        else if(ptr->d_type == DT_SOCK) {
-            val = purc_variant_make_string ("s", false);
-            purc_variant_object_set_by_static_ckey (obj_var, "type", val);
-            purc_variant_unref (val);
-        }
-        else if(ptr->d_type == DT_UNKNOWN) {
-            val = purc_variant_make_string ("u", false);
-            purc_variant_object_set_by_static_ckey (obj_var, "type", val);
-            purc_variant_unref (val);
-        }
-
-        // mode
-        val = purc_variant_make_byte_sequence (&(file_stat.st_mode),
-                                                    sizeof(unsigned long));
-        purc_variant_object_set_by_static_ckey (obj_var, "mode", val);
-        purc_variant_unref (val);
-
-        // mode_str
-        for (i = 0; i < 3; i++) {
-            if ((0x01 << (8 - 3 * i)) & file_stat.st_mode)
-                au[i * 3 + 0] = 'r';
-            else
-                au[i * 3 + 0] = '-';
-            if ((0x01 << (7 - 3 * i)) & file_stat.st_mode)
-                au[i * 3 + 1] = 'w';
-            else
-                au[i * 3 + 1] = '-';
-            if ((0x01 << (6 - 3 * i)) & file_stat.st_mode)
-                au[i * 3 + 2] = 'x';
-            else
-                au[i * 3 + 2] = '-';
-        }
-        val = purc_variant_make_string (au, false);
-        purc_variant_object_set_by_static_ckey (obj_var, "mode_str", val);
-        purc_variant_unref (val);
-
-        // nlink
-        val = purc_variant_make_number (file_stat.st_nlink);
-        purc_variant_object_set_by_static_ckey (obj_var, "nlink", val);
-        purc_variant_unref (val);
-
-        // uid
-        val = purc_variant_make_number (file_stat.st_uid);
-        purc_variant_object_set_by_static_ckey (obj_var, "uid", val);
-        purc_variant_unref (val);
-
-        // gid
-        val = purc_variant_make_number (file_stat.st_gid);
-        purc_variant_object_set_by_static_ckey (obj_var, "gid", val);
-        purc_variant_unref (val);
-
-        // rdev_major 
-        val = purc_variant_make_number (major(file_stat.st_dev));
-        purc_variant_object_set_by_static_ckey (obj_var, "rdev_major", val);
-        purc_variant_unref (val);
-
-        // rdev_minor
-        val = purc_variant_make_number (minor(file_stat.st_dev));
-        purc_variant_object_set_by_static_ckey (obj_var, "rdev_minor", val);
-        purc_variant_unref (val);
-
-        // size
-        val = purc_variant_make_number (file_stat.st_size);
-        purc_variant_object_set_by_static_ckey (obj_var, "size", val);
-        purc_variant_unref (val);
-
-        // blksize
-        val = purc_variant_make_number (file_stat.st_blksize);
-        purc_variant_object_set_by_static_ckey (obj_var, "blksize", val);
-        purc_variant_unref (val);
-
-        // blocks
-        val = purc_variant_make_number (file_stat.st_blocks);
-        purc_variant_object_set_by_static_ckey (obj_var, "blocks", val);
-        purc_variant_unref (val);
-
-        // atime
-        val = purc_variant_make_string (ctime(&file_stat.st_atime), false);
-        purc_variant_object_set_by_static_ckey (obj_var, "atime", val);
-        purc_variant_unref (val);
-
-        // mtime
-        val = purc_variant_make_string (ctime(&file_stat.st_mtime), false);
-        purc_variant_object_set_by_static_ckey (obj_var, "mtime", val);
-        purc_variant_unref (val);
-
-        // ctime
-        val = purc_variant_make_string (ctime(&file_stat.st_ctime), false);
-        purc_variant_object_set_by_static_ckey (obj_var, "ctime", val);
-        purc_variant_unref (val);
+        obj_var = make_list_entry (ptr->d_name, ptr->d_type, ptr->d_ino,
+                &file_stat);
+        if (obj_var == PURC_VARIANT_INVALID)
+            continue;
 
         purc_variant_array_append (ret_var, obj_var);
         purc_variant_unref (obj_var);
@@ -1043,13 +1213,7 @@ list_getter (purc_variant_t root, size_t nr_args, purc_variant_t *argv,
     closedir(dir);
 
 error:
-    while (wildcard) {
-        if (wildcard->wildcard)
-            free (wildcard->wildcard);
-        temp_wildcard = wildcard;
-        wildcard = wildcard->next;
-        free (temp_wildcard);
-    }
+    free_wildcard_list (wildcard);
     return ret_var;
 }
 
@@ -3202,16 +3366,740 @@ closedir_getter (purc_variant_t root, size_t nr_args, purc_variant_t *argv,
     return ret_var;
 }
 
+/*
+ * The asynchronous operations run on a small pool of worker threads shared
+ * by all instances. A worker only makes the system calls and keeps the
+ * results in plain C data; the variants are made on the thread of the
+ * instance: the worker dispatches the completion to the runloop of the
+ * instance, which posts it as an event to the coroutine which started
+ * the operation. The operation is represented by a native entity, which
+ * can be observed for `job:progress`, `job:done`, and `job:error`.
+ */
+#define FS_JOB_EVENT            "job"
+#define FS_JOB_SUB_PROGRESS     "progress"
+#define FS_JOB_SUB_DONE         "done"
+#define FS_JOB_SUB_ERROR        "error"
+
+#define FS_NR_WORKERS_MAX       4
+#define FS_SCAN_BUF_SIZE        (32 * 1024)
+
+enum fs_job_type {
+    FS_JOB_COPY,
+    FS_JOB_LIST,
+};
+
+enum fs_job_state {
+    FS_JOB_PENDING,
+    FS_JOB_RUNNING,
+    FS_JOB_FINISHED,
+};
+
+struct fs_dirent {
+    char           *name;
+    unsigned char   type;
+    ino_t           ino;
+    struct stat     st;
+};
+
+struct fs_job {
+    struct list_head        ln;         // in the queue of the pool
+    atomic_uint             refc;
+    atomic_bool             cancelled;
+    atomic_bool             progress_pending;
+
+    enum fs_job_type        type;
+    enum fs_job_state       state;      // protected by the lock of the pool
+
+    char                   *path;
+    char                   *dest;       // FS_JOB_COPY
+    struct wildcard_list   *wildcard;   // FS_JOB_LIST
+
+    // the runloop and the coroutine to report to; NULL and 0 if
+    // the job is not started by a coroutine.
+    purc_runloop_t          runloop;
+    purc_atom_t             cid;
+    // the native variant; not referenced and invalid after released.
+    purc_variant_t          observed;
+
+    // the results, which are valid after the job finished
+    int                     err;
+    _Atomic uint64_t        copied;     // FS_JOB_COPY
+    _Atomic uint64_t        total;
+    struct fs_dirent       *entries;    // FS_JOB_LIST
+    size_t                  nr_entries;
+    size_t                  sz_entries;
+};
+
+static struct fs_worker_pool {
+    pthread_mutex_t     lock;
+    pthread_cond_t      wakeup;     // for the idle workers
+    pthread_cond_t      finished;   // for the waiters of the jobs
+    struct list_head    jobs;
+
+    pthread_t           threads[FS_NR_WORKERS_MAX];
+    unsigned            nr_threads;
+    unsigned            nr_idle;
+    atomic_bool         stop;
+    bool                pinned;     // the module is kept loaded
+} worker_pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wakeup = PTHREAD_COND_INITIALIZER,
+    .finished = PTHREAD_COND_INITIALIZER,
+    .jobs = LIST_HEAD_INIT(worker_pool.jobs),
+};
+
+static struct fs_job *fs_job_new (enum fs_job_type type, const char *path)
+{
+    struct fs_job *job = calloc (1, sizeof(*job));
+    if (job == NULL)
+        goto failed;
+
+    job->path = strdup (path);
+    if (job->path == NULL) {
+        free (job);
+        goto failed;
+    }
+
+    list_head_init (&job->ln);
+    atomic_init (&job->refc, 1);
+    atomic_init (&job->cancelled, false);
+    atomic_init (&job->progress_pending, false);
+    atomic_init (&job->copied, 0);
+    atomic_init (&job->total, 0);
+    job->type = type;
+    job->state = FS_JOB_PENDING;
+    job->observed = PURC_VARIANT_INVALID;
+    return job;
+
+failed:
+    purc_set_error (PURC_ERROR_OUT_OF_MEMORY);
+    return NULL;
+}
+
+static struct fs_job *fs_job_ref (struct fs_job *job)
+{
+    atomic_fetch_add (&job->refc, 1);
+    return job;
+}
+
+static void fs_job_unref (struct fs_job *job)
+{
+    if (atomic_fetch_sub (&job->refc, 1) > 1)
+        return;
+
+    for (size_t i = 0; i < job->nr_entries; i++)
+        free (job->entries[i].name);
+    free (job->entries);
+    free_wildcard_list (job->wildcard);
+    free (job->dest);
+    free (job->path);
+    free (job);
+}
+
+static purc_variant_t make_job_result (struct fs_job *job)
+{
+    purc_variant_t ret_var = PURC_VARIANT_INVALID;
+
+    switch (job->type) {
+    case FS_JOB_COPY:
+        ret_var = purc_variant_make_ulongint (atomic_load (&job->copied));
+        break;
+
+    case FS_JOB_LIST:
+        ret_var = purc_variant_make_array (0, PURC_VARIANT_INVALID);
+        if (ret_var == PURC_VARIANT_INVALID)
+            break;
+
+        for (size_t i = 0; i < job->nr_entries; i++) {
+            struct fs_dirent *ent = job->entries + i;
+            purc_variant_t obj_var = make_list_entry (ent->name, ent->type,
+                    ent->ino, &ent->st);
+            if (obj_var == PURC_VARIANT_INVALID)
+                continue;
+
+            purc_variant_array_append (ret_var, obj_var);
+            purc_variant_unref (obj_var);
+        }
+        break;
+    }
+
+    return ret_var;
+}
+
+static purc_variant_t make_job_error (struct fs_job *job)
+{
+    purc_variant_t ret_var, val;
+
+    ret_var = purc_variant_make_object (0, PURC_VARIANT_INVALID,
+            PURC_VARIANT_INVALID);
+    if (ret_var == PURC_VARIANT_INVALID)
+        return PURC_VARIANT_INVALID;
+
+    val = purc_variant_make_longint (job->err);
+    purc_variant_object_set_by_static_ckey (ret_var, "errno", val);
+    purc_variant_unref (val);
+
+    val = purc_variant_make_string (strerror (job->err), false);
+    purc_variant_object_set_by_static_ckey (ret_var, "message", val);
+    purc_variant_unref (val);
+
+    return ret_var;
+}
+
+// called in the thread of the instance
+static void on_job_progress (void *ctxt)
+{
+    struct fs_job *job = ctxt;
+
+    atomic_store (&job->progress_pending, false);
+    if (job->observed != PURC_VARIANT_INVALID) {
+        purc_variant_t data, val;
+
+        data = purc_variant_make_object (0, PURC_VARIANT_INVALID,
+                PURC_VARIANT_INVALID);
+        if (data) {
+            val = purc_variant_make_ulongint (atomic_load (&job->copied));
+            purc_variant_object_set_by_static_ckey (data, "copied", val);
+            purc_variant_unref (val);
+
+            val = purc_variant_make_ulongint (atomic_load (&job->total));
+            purc_variant_object_set_by_static_ckey (data, "total", val);
+            purc_variant_unref (val);
+
+            // a later progress supersedes the one not handled yet
+            pcintr_coroutine_post_event (job->cid,
+                    PCRDR_MSG_EVENT_REDUCE_OPT_OVERLAY, job->observed,
+                    FS_JOB_EVENT, FS_JOB_SUB_PROGRESS,
+                    data, PURC_VARIANT_INVALID);
+            purc_variant_unref (data);
+        }
+    }
+
+    fs_job_unref (job);
+}
+
+// called in the thread of the instance
+static void on_job_done (void *ctxt)
+{
+    struct fs_job *job = ctxt;
+
+    if (job->observed != PURC_VARIANT_INVALID) {
+        purc_variant_t data;
+
+        if (job->err)
+            data = make_job_error (job);
+        else
+            data = make_job_result (job);
+
+        if (data) {
+            pcintr_coroutine_post_event (job->cid,
+                    PCRDR_MSG_EVENT_REDUCE_OPT_KEEP, job->observed,
+                    FS_JOB_EVENT, job->err ? FS_JOB_SUB_ERROR : FS_JOB_SUB_DONE,
+                    data, PURC_VARIANT_INVALID);
+            purc_variant_unref (data);
+        }
+    }
+
+    fs_job_unref (job);
+}
+
+static bool report_copy_progress (void *ctxt, uint64_t copied, uint64_t total)
+{
+    struct fs_job *job = ctxt;
+
+    atomic_store (&job->copied, copied);
+    atomic_store (&job->total, total);
+    if (atomic_load (&job->cancelled) || atomic_load (&worker_pool.stop))
+        return false;
+
+    // do not flood the runloop if the instance is busy
+    if (job->runloop && !atomic_exchange (&job->progress_pending, true)) {
+        purc_runloop_dispatch (job->runloop, on_job_progress,
+                fs_job_ref (job));
+    }
+    return true;
+}
+
+static int add_dirent (struct fs_job *job, const char *name,
+        unsigned char type, ino_t ino, const struct stat *st)
+{
+    if (job->nr_entries == job->sz_entries) {
+        size_t sz = job->sz_entries ? job->sz_entries * 2 : 64;
+        struct fs_dirent *entries;
+
+        entries = realloc (job->entries, sizeof(*entries) * sz);
+        if (entries == NULL)
+            return ENOMEM;
+        job->entries = entries;
+        job->sz_entries = sz;
+    }
+
+    struct fs_dirent *ent = job->entries + job->nr_entries;
+    ent->name = strdup (name);
+    if (ent->name == NULL)
+        return ENOMEM;
+    ent->type = type;
+    ent->ino = ino;
+    ent->st = *st;
+    job->nr_entries++;
+    return 0;
+}
+
+static int add_dirent_at (struct fs_job *job, int dir_fd, const char *name,
+        unsigned char type, ino_t ino)
+{
+    struct stat st;
+
+    if (strcmp (name, ".") == 0 || strcmp (name, "..") == 0)
+        return 0;
+
+    if (!match_wildcard_list (job->wildcard, name))
+        return 0;
+
+    // skip the entry which is gone, as `list` does
+    if (fstatat (dir_fd, name, &st, 0) < 0)
+        return 0;
+
+    return add_dirent (job, name, type, ino, &st);
+}
+
+#if OS(LINUX) && defined(SYS_getdents64)
+struct linux_dirent64 {
+    uint64_t        d_ino;
+    int64_t         d_off;
+    unsigned short  d_reclen;
+    unsigned char   d_type;
+    char            d_name[];
+};
+
+/* Reads the entries by getdents64(2) in large batches, and stats them
+   relative to the directory to save the lookups of the path. */
+static int scan_dir (struct fs_job *job)
+{
+    char *buf;
+    int fd, err = 0;
+
+    fd = open (job->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        return errno;
+
+    buf = malloc (FS_SCAN_BUF_SIZE);
+    if (buf == NULL) {
+        close (fd);
+        return ENOMEM;
+    }
+
+    while (err == 0) {
+        if (atomic_load (&job->cancelled) || atomic_load (&worker_pool.stop)) {
+            err = ECANCELED;
+            break;
+        }
+
+        long n = syscall (SYS_getdents64, fd, buf, FS_SCAN_BUF_SIZE);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            err = errno;
+            break;
+        }
+        else if (n == 0) {
+            break;
+        }
+
+        for (long off = 0; off < n && err == 0; ) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(buf + off);
+            off += d->d_reclen;
+            err = add_dirent_at (job, fd, d->d_name, d->d_type, d->d_ino);
+        }
+    }
+
+    free (buf);
+    close (fd);
+    return err;
+}
+#else
+static int scan_dir (struct fs_job *job)
+{
+    struct dirent *ptr;
+    DIR *dir;
+    int err = 0;
+
+    dir = opendir (job->path);
+    if (dir == NULL)
+        return errno;
+
+    while (err == 0) {
+        if (atomic_load (&job->cancelled) || atomic_load (&worker_pool.stop)) {
+            err = ECANCELED;
+            break;
+        }
+
+        errno = 0;
+        if ((ptr = readdir (dir)) == NULL) {
+            err = errno;
+            break;
+        }
+
+        err = add_dirent_at (job, dirfd (dir), ptr->d_name, ptr->d_type,
+                ptr->d_ino);
+    }
+
+    closedir (dir);
+    return err;
+}
+#endif
+
+static void run_job (struct fs_job *job)
+{
+    if (atomic_load (&job->cancelled)) {
+        job->err = ECANCELED;
+        return;
+    }
+
+    switch (job->type) {
+    case FS_JOB_COPY:
+        job->err = copy_file (job->path, job->dest,
+                report_copy_progress, job);
+        break;
+
+    case FS_JOB_LIST:
+        job->err = scan_dir (job);
+        break;
+    }
+}
+
+static void *worker_routine (void *arg)
+{
+    UNUSED_PARAM(arg);
+
+    /* leave the signals to the threads of the instances */
+    sigset_t set;
+    sigfillset (&set);
+    pthread_sigmask (SIG_BLOCK, &set, NULL);
+
+    pthread_mutex_lock (&worker_pool.lock);
+    for (;;) {
+        while (!atomic_load (&worker_pool.stop) &&
+                list_empty (&worker_pool.jobs)) {
+            worker_pool.nr_idle++;
+            pthread_cond_wait (&worker_pool.wakeup, &worker_pool.lock);
+            worker_pool.nr_idle--;
+        }
+
+        if (atomic_load (&worker_pool.stop))
+            break;
+
+        struct fs_job *job;
+        job = list_first_entry (&worker_pool.jobs, struct fs_job, ln);
+        list_del_init (&job->ln);
+        job->state = FS_JOB_RUNNING;
+        pthread_mutex_unlock (&worker_pool.lock);
+
+        run_job (job);
+
+        /* dispatch before the job is marked finished, so that the runloop
+           is still alive; see job_on_release() */
+        if (job->runloop && !atomic_load (&worker_pool.stop))
+            purc_runloop_dispatch (job->runloop, on_job_done, fs_job_ref (job));
+
+        pthread_mutex_lock (&worker_pool.lock);
+        job->state = FS_JOB_FINISHED;
+        pthread_cond_broadcast (&worker_pool.finished);
+        fs_job_unref (job);     // the reference held by the queue
+    }
+    pthread_mutex_unlock (&worker_pool.lock);
+
+    return NULL;
+}
+
+static void wait_for_job (struct fs_job *job)
+{
+    pthread_mutex_lock (&worker_pool.lock);
+    while (job->state != FS_JOB_FINISHED)
+        pthread_cond_wait (&worker_pool.finished, &worker_pool.lock);
+    pthread_mutex_unlock (&worker_pool.lock);
+}
+
+static purc_variant_t
+job_wait_getter (void *native_entity, size_t nr_args, purc_variant_t *argv,
+        bool silently)
+{
+    UNUSED_PARAM(nr_args);
+    UNUSED_PARAM(argv);
+    UNUSED_PARAM(silently);
+
+    struct fs_job *job = native_entity;
+
+    wait_for_job (job);
+    if (job->err) {
+        errno = job->err;
+        set_purc_error_by_errno ();
+        return purc_variant_make_boolean (false);
+    }
+
+    return make_job_result (job);
+}
+
+static purc_variant_t
+job_cancel_getter (void *native_entity, size_t nr_args, purc_variant_t *argv,
+        bool silently)
+{
+    UNUSED_PARAM(nr_args);
+    UNUSED_PARAM(argv);
+    UNUSED_PARAM(silently);
+
+    struct fs_job *job = native_entity;
+    atomic_store (&job->cancelled, true);
+    return purc_variant_make_boolean (true);
+}
+
+static purc_variant_t
+job_state_getter (void *native_entity, size_t nr_args, purc_variant_t *argv,
+        bool silently)
+{
+    UNUSED_PARAM(nr_args);
+    UNUSED_PARAM(argv);
+    UNUSED_PARAM(silently);
+
+    struct fs_job *job = native_entity;
+    const char *state = "pending";
+
+    pthread_mutex_lock (&worker_pool.lock);
+    if (job->state == FS_JOB_RUNNING)
+        state = "running";
+    else if (job->state == FS_JOB_FINISHED)
+        state = job->err ? "failed" : "done";
+    pthread_mutex_unlock (&worker_pool.lock);
+
+    return purc_variant_make_string_static (state, false);
+}
+
+static purc_nvariant_method job_property_getter (const char *name)
+{
+    if (strcmp (name, "wait") == 0)
+        return job_wait_getter;
+    else if (strcmp (name, "cancel") == 0)
+        return job_cancel_getter;
+    else if (strcmp (name, "state") == 0)
+        return job_state_getter;
+
+    purc_set_error (PURC_ERROR_NOT_SUPPORTED);
+    return NULL;
+}
+
+static bool job_on_observe (void *native_entity, const char *event_name,
+        const char *event_subname)
+{
+    UNUSED_PARAM(native_entity);
+    UNUSED_PARAM(event_subname);
+    return strcmp (event_name, FS_JOB_EVENT) == 0;
+}
+
+static void job_on_release (void *native_entity)
+{
+    struct fs_job *job = native_entity;
+
+    atomic_store (&job->cancelled, true);
+    job->observed = PURC_VARIANT_INVALID;
+
+    /* the worker must be done with the runloop before the instance
+       may go away */
+    pthread_mutex_lock (&worker_pool.lock);
+    if (job->state == FS_JOB_PENDING) {
+        list_del_init (&job->ln);
+        job->state = FS_JOB_FINISHED;
+        fs_job_unref (job);     // the reference held by the queue
+    }
+    while (job->state != FS_JOB_FINISHED)
+        pthread_cond_wait (&worker_pool.finished, &worker_pool.lock);
+    pthread_mutex_unlock (&worker_pool.lock);
+
+    fs_job_unref (job);
+}
+
+/* The completions dispatched to a runloop call back into this module,
+   and might be handled after the interpreter has unloaded the module.
+   Once a job reports to a runloop, keep the module mapped till exit. */
+static void pin_module (void)
+{
+    Dl_info info;
+
+    if (worker_pool.pinned)
+        return;
+
+    if (dladdr ((void *)pin_module, &info) && info.dli_fname &&
+            dlopen (info.dli_fname, RTLD_LAZY | RTLD_NOLOAD | RTLD_NODELETE))
+        worker_pool.pinned = true;
+}
+
+static purc_variant_t fs_job_submit (struct fs_job *job)
+{
+    static const struct purc_native_ops ops = {
+        .property_getter = job_property_getter,
+        .on_observe = job_on_observe,
+        .on_release = job_on_release,
+    };
+
+    pcintr_coroutine_t co = pcintr_get_coroutine ();
+    if (co) {
+        job->cid = co->cid;
+        job->runloop = purc_runloop_get_current ();
+    }
+
+    pthread_mutex_lock (&worker_pool.lock);
+    if (job->runloop)
+        pin_module ();
+
+    if (worker_pool.nr_idle == 0 &&
+            worker_pool.nr_threads < FS_NR_WORKERS_MAX) {
+        pthread_t *th = worker_pool.threads + worker_pool.nr_threads;
+        if (pthread_create (th, NULL, worker_routine, NULL) == 0)
+            worker_pool.nr_threads++;
+    }
+
+    if (worker_pool.nr_threads == 0) {
+        pthread_mutex_unlock (&worker_pool.lock);
+        fs_job_unref (job);
+        purc_set_error (PURC_ERROR_OUT_OF_MEMORY);
+        return PURC_VARIANT_INVALID;
+    }
+
+    purc_variant_t ret_var = purc_variant_make_native (job, &ops);
+    if (ret_var == PURC_VARIANT_INVALID) {
+        pthread_mutex_unlock (&worker_pool.lock);
+        fs_job_unref (job);
+        return PURC_VARIANT_INVALID;
+    }
+
+    job->observed = ret_var;
+    list_add_tail (&job->ln, &worker_pool.jobs);
+    fs_job_ref (job);           // for the queue
+    pthread_cond_signal (&worker_pool.wakeup);
+    pthread_mutex_unlock (&worker_pool.lock);
+
+    return ret_var;
+}
+
+static void __attribute__ ((destructor)) fs_worker_pool_fini (void)
+{
+    pthread_mutex_lock (&worker_pool.lock);
+    atomic_store (&worker_pool.stop, true);
+
+    /* cancel the jobs not started yet; the running ones see `stop`
+       and do not report to the runloops any more */
+    struct list_head *p, *n;
+    list_for_each_safe (p, n, &worker_pool.jobs) {
+        struct fs_job *job = list_entry (p, struct fs_job, ln);
+        list_del_init (&job->ln);
+        job->err = ECANCELED;
+        job->state = FS_JOB_FINISHED;
+        fs_job_unref (job);     // the reference held by the queue
+    }
+
+    pthread_cond_broadcast (&worker_pool.wakeup);
+    pthread_cond_broadcast (&worker_pool.finished);
+    pthread_mutex_unlock (&worker_pool.lock);
+
+    for (unsigned i = 0; i < worker_pool.nr_threads; i++)
+        pthread_join (worker_pool.threads[i], NULL);
+    worker_pool.nr_threads = 0;
+}
+
+static purc_variant_t
+copy_async_getter (purc_variant_t root, size_t nr_args, purc_variant_t *argv,
+        bool silently)
+{
+    UNUSED_PARAM(root);
+    UNUSED_PARAM(silently);
+
+    const char *filename_from = NULL;
+    const char *filename_to = NULL;
+    struct fs_job *job;
+
+    if (nr_args < 2) {
+        purc_set_error (PURC_ERROR_ARGUMENT_MISSED);
+        return PURC_VARIANT_INVALID;
+    }
+
+    // get the file name
+    filename_from = purc_variant_get_string_const (argv[0]);
+    filename_to   = purc_variant_get_string_const (argv[1]);
+    if (NULL == filename_from || NULL == filename_to) {
+        purc_set_error (PURC_ERROR_WRONG_DATA_TYPE);
+        return PURC_VARIANT_INVALID;
+    }
+
+    job = fs_job_new (FS_JOB_COPY, filename_from);
+    if (job == NULL)
+        return PURC_VARIANT_INVALID;
+
+    job->dest = strdup (filename_to);
+    if (job->dest == NULL) {
+        fs_job_unref (job);
+        purc_set_error (PURC_ERROR_OUT_OF_MEMORY);
+        return PURC_VARIANT_INVALID;
+    }
+
+    return fs_job_submit (job);
+}
+
+static purc_variant_t
+list_async_getter (purc_variant_t root, size_t nr_args, purc_variant_t *argv,
+        bool silently)
+{
+    UNUSED_PARAM(root);
+    UNUSED_PARAM(silently);
+
+    const char *string_filename = NULL;
+    const char *filter = NULL;
+    struct fs_job *job;
+
+    if (nr_args < 1) {
+        purc_set_error (PURC_ERROR_ARGUMENT_MISSED);
+        return PURC_VARIANT_INVALID;
+    }
+
+    // get the file name
+    string_filename = purc_variant_get_string_const (argv[0]);
+    if (NULL == string_filename) {
+        purc_set_error (PURC_ERROR_WRONG_DATA_TYPE);
+        return PURC_VARIANT_INVALID;
+    }
+
+    // get the filter
+    if ((nr_args > 1) && (argv[1] == NULL ||
+            (!purc_variant_is_string (argv[1])))) {
+        purc_set_error (PURC_ERROR_WRONG_DATA_TYPE);
+        return PURC_VARIANT_INVALID;
+    }
+    if ((nr_args > 1) && (argv[1] != NULL))
+        filter = purc_variant_get_string_const (argv[1]);
+
+    job = fs_job_new (FS_JOB_LIST, string_filename);
+    if (job == NULL)
+        return PURC_VARIANT_INVALID;
+
+    if (filter && !make_wildcard_list (filter, &job->wildcard)) {
+        fs_job_unref (job);
+        purc_set_error (PURC_ERROR_OUT_OF_MEMORY);
+        return PURC_VARIANT_INVALID;
+    }
+
+    return fs_job_submit (job);
+}
+
 static purc_variant_t pcdvobjs_create_fs(void)
 {
     static struct purc_dvobj_method method [] = {
         {"list",          list_getter, NULL},
         {"list_prt",      list_prt_getter, NULL},
+        {"list_async",    list_async_getter, NULL},
         {"basename",      basename_getter, NULL},
         {"chgrp",         chgrp_getter, NULL},
         {"chmod",         chmod_getter, NULL},
         {"chown",         chown_getter, NULL},
         {"copy",          copy_getter, NULL},
+        {"copy_async",    copy_async_getter, NULL},
         {"dirname",       dirname_getter, NULL},
         {"disk_usage",    disk_usage_getter, NULL},
         {"file_exists",   file_exists_getter, NULL},
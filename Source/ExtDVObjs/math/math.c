@@ -22,12 +22,14 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include "purc.h"
 #include "purc-errors.h"
 #include "purc-variant.h"
 #include "purc-version.h"
 #include "purc-dvobjs.h"
 
 #include "private/map.h"
+#include "private/list.h"
 #include "mathlib.h"
 
 #include <strings.h>
@@ -40,6 +42,7 @@
 #endif
 #include <math.h>
 #include <fenv.h>
+#include <pthread.h>
 
 #define UNUSED_PARAM (void)
 #define MATH_DVOBJ_VERSION  0
@@ -1458,6 +1461,141 @@ ceil_l_getter (purc_variant_t root, size_t nr_args, purc_variant_t *argv,
     return ret_var;
 }
 
+/* The compiled expressions are kept for the current thread (an instance
+   runs in its own thread) until there are too many of them. The caches are
+   owned by the module and released in math_fini(), so nothing outside of
+   the module calls back into it once it is unloaded. */
+#define MAX_CACHED_PROGS        64
+
+struct prog_cache {
+    struct list_head    ln;
+    pcutils_map        *progs;
+    pcutils_map        *progs_l;
+};
+
+static pthread_key_t    cache_key;
+static bool             cache_key_created;
+static pthread_mutex_t  caches_lock = PTHREAD_MUTEX_INITIALIZER;
+static LIST_HEAD(caches);
+
+static void free_prog(void *val)
+{
+    math_prog_delete((struct math_prog *)val);
+}
+
+static void free_prog_l(void *val)
+{
+    math_prog_delete_l((struct math_prog_l *)val);
+}
+
+static void destroy_prog_cache(struct prog_cache *cache)
+{
+    if (cache->progs)
+        pcutils_map_destroy(cache->progs);
+    if (cache->progs_l)
+        pcutils_map_destroy(cache->progs_l);
+    free(cache);
+}
+
+/* called when a thread which used the cache exits */
+static void cb_free_prog_cache(void *data)
+{
+    struct prog_cache *cache = (struct prog_cache *)data;
+
+    pthread_mutex_lock(&caches_lock);
+    list_del(&cache->ln);
+    pthread_mutex_unlock(&caches_lock);
+    destroy_prog_cache(cache);
+}
+
+static pcutils_map *
+get_progs(int is_long_double)
+{
+    struct prog_cache *cache;
+
+    if (!cache_key_created) {
+        purc_set_error(PURC_ERROR_NOT_SUPPORTED);
+        return NULL;
+    }
+
+    cache = (struct prog_cache *)pthread_getspecific(cache_key);
+    if (cache == NULL) {
+        cache = (struct prog_cache *)calloc(1, sizeof(*cache));
+        if (cache == NULL || pthread_setspecific(cache_key, cache)) {
+            free(cache);
+            purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return NULL;
+        }
+
+        pthread_mutex_lock(&caches_lock);
+        list_add_tail(&cache->ln, &caches);
+        pthread_mutex_unlock(&caches_lock);
+    }
+
+    pcutils_map **progs = is_long_double ? &cache->progs_l : &cache->progs;
+    if (*progs == NULL) {
+        *progs = pcutils_map_create(copy_key_string, free_key_string,
+                NULL, is_long_double ? free_prog_l : free_prog,
+                comp_key_string, false);
+        if (*progs == NULL) {
+            purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return NULL;
+        }
+    }
+
+    return *progs;
+}
+
+static void *
+get_prog(int is_long_double, const char *input)
+{
+    void (*free_fn)(void *) = is_long_double ? free_prog_l : free_prog;
+    pcutils_map *progs = get_progs(is_long_double);
+
+    if (progs == NULL)
+        return NULL;
+
+    pcutils_map_entry *entry = pcutils_map_find(progs, input);
+    if (entry)
+        return entry->val;
+
+    void *prog;
+    if (is_long_double)
+        prog = math_compile_l(input);
+    else
+        prog = math_compile(input);
+    if (prog == NULL)
+        return NULL;
+
+    if (pcutils_map_get_size(progs) >= MAX_CACHED_PROGS)
+        pcutils_map_clear(progs);
+
+    if (pcutils_map_insert(progs, input, prog)) {
+        free_fn(prog);
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    return prog;
+}
+
+static purc_variant_t
+exec_prog(int is_long_double, const void *prog, purc_variant_t param)
+{
+    if (!is_long_double) {
+        double v = 0;
+        if (math_exec((const struct math_prog *)prog, &v, param))
+            return PURC_VARIANT_INVALID;
+        return purc_variant_make_number(v);
+    }
+    else {
+        long double v = 0;
+        if (math_exec_l((const struct math_prog_l *)prog, &v, param))
+            return PURC_VARIANT_INVALID;
+        return purc_variant_make_longdouble(v);
+    }
+}
+
 static purc_variant_t
 internal_eval_getter (int is_long_double, purc_variant_t root,
     size_t nr_args, purc_variant_t *argv, bool silently)
@@ -1471,7 +1609,8 @@ internal_eval_getter (int is_long_double, purc_variant_t root,
     }
 
     if (nr_args >= 2 && (argv[1] == PURC_VARIANT_INVALID ||
-                !purc_variant_is_object(argv[1]))) {
+                !(purc_variant_is_object(argv[1]) ||
+                    purc_variant_is_array(argv[1])))) {
         purc_set_error (PURC_ERROR_ARGUMENT_MISSED);
         return PURC_VARIANT_INVALID;
     }
@@ -1484,20 +1623,49 @@ internal_eval_getter (int is_long_double, purc_variant_t root,
 
     purc_variant_t param = nr_args >=2 ? argv[1] : PURC_VARIANT_INVALID;
 
-    if (!is_long_double) {
-        double v = 0;
-        int r = math_eval(input, &v, param);
-        if (r)
+    /* evaluate the expression for every object in an array */
+    if (param != PURC_VARIANT_INVALID && purc_variant_is_array(param)) {
+        size_t sz = purc_variant_array_get_size(param);
+        for (size_t i = 0; i < sz; i++) {
+            if (!purc_variant_is_object(purc_variant_array_get(param, i))) {
+                purc_set_error (PURC_ERROR_WRONG_DATA_TYPE);
+                return PURC_VARIANT_INVALID;
+            }
+        }
+
+        void *prog = get_prog(is_long_double, input);
+        if (prog == NULL)
             return PURC_VARIANT_INVALID;
-        return purc_variant_make_number(v);
-    }
-    else {
-        long double v = 0;
-        int r = math_eval_l(input, &v, param);
-        if (r)
+
+        purc_variant_t results;
+        results = purc_variant_make_array(0, PURC_VARIANT_INVALID);
+        if (results == PURC_VARIANT_INVALID)
             return PURC_VARIANT_INVALID;
-        return purc_variant_make_longdouble(v);
+
+        for (size_t i = 0; i < sz; i++) {
+            purc_variant_t v = exec_prog(is_long_double, prog,
+                    purc_variant_array_get(param, i));
+            if (v == PURC_VARIANT_INVALID) {
+                purc_variant_unref(results);
+                return PURC_VARIANT_INVALID;
+            }
+
+            bool ok = purc_variant_array_append(results, v);
+            purc_variant_unref(v);
+            if (!ok) {
+                purc_variant_unref(results);
+                return PURC_VARIANT_INVALID;
+            }
+        }
+
+        return results;
     }
+
+    void *prog = get_prog(is_long_double, input);
+    if (prog == NULL)
+        return PURC_VARIANT_INVALID;
+
+    return exec_prog(is_long_double, prog, param);
 }
 
 static purc_variant_t
@@ -1541,12 +1709,34 @@ static void map_free_val(void *val)
     free(value);
 }
 
+void __attribute__ ((constructor)) math_init(void)
+{
+    cache_key_created =
+        (pthread_key_create(&cache_key, cb_free_prog_cache) == 0);
+}
+
 void __attribute__ ((destructor)) math_fini(void)
 {
     if (const_map) {
         pcutils_map_destroy (const_map);
         const_map = NULL;
     }
+
+    if (cache_key_created) {
+        struct list_head *p, *n;
+
+        pthread_key_delete(cache_key);
+        cache_key_created = false;
+
+        pthread_mutex_lock(&caches_lock);
+        list_for_each_safe(p, n, &caches) {
+            struct prog_cache *cache;
+            cache = list_entry(p, struct prog_cache, ln);
+            list_del(p);
+            destroy_prog_cache(cache);
+        }
+        pthread_mutex_unlock(&caches_lock);
+    }
 }
 
 // todo: release const_map
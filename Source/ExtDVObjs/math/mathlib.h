@@ -54,6 +54,36 @@ int
 math_eval_l(const char *input, long double *d, purc_variant_t param)
 __attribute__((visibility("hidden")));
 
+/* An expression compiled into a postfix program, which can be executed
+   many times with different parameter objects. */
+struct math_prog;
+struct math_prog_l;
+
+struct math_prog *
+math_compile(const char *input)
+__attribute__((visibility("hidden")));
+
+struct math_prog_l *
+math_compile_l(const char *input)
+__attribute__((visibility("hidden")));
+
+int
+math_exec(const struct math_prog *prog, double *d, purc_variant_t param)
+__attribute__((visibility("hidden")));
+
+int
+math_exec_l(const struct math_prog_l *prog, long double *d,
+        purc_variant_t param)
+__attribute__((visibility("hidden")));
+
+void
+math_prog_delete(struct math_prog *prog)
+__attribute__((visibility("hidden")));
+
+void
+math_prog_delete_l(struct math_prog_l *prog)
+__attribute__((visibility("hidden")));
+
 int
 math_voi(double *r, double (*f)(void))
 __attribute__((visibility("hidden")));
@@ -38,6 +38,10 @@
 
         #define VALUE_TYPE     double
         #define FUNC_NAME      math_eval
+        #define PROG_TYPE      math_prog
+        #define COMPILE_NAME   math_compile
+        #define EXEC_NAME      math_exec
+        #define DELETE_NAME    math_prog_delete
 
         #define STRTOD         strtod
         #define CAST_TO_NUMBER purc_variant_cast_to_number
@@ -89,6 +93,10 @@
 
         #define VALUE_TYPE     long double
         #define FUNC_NAME      math_eval_l
+        #define PROG_TYPE      math_prog_l
+        #define COMPILE_NAME   math_compile_l
+        #define EXEC_NAME      math_exec_l
+        #define DELETE_NAME    math_prog_delete_l
 
         #define STRTOD         strtold
         #define CAST_TO_NUMBER purc_variant_cast_to_longdouble
@@ -136,17 +144,6 @@
 
     #endif
 
-    struct internal_value {
-        VALUE_TYPE      d;
-    };
-
-    struct internal_param {
-        purc_variant_t param;
-        purc_variant_t variables;
-        VALUE_TYPE     d;
-        unsigned int   divide_by_zero:1;
-    };
-
     struct math_token {
         const char      *text;
         size_t           leng;
@@ -166,120 +163,123 @@
     // introduce yylex decl for later use
     #include <math.h>
 
-    #define SET(_r, _a) do {                           \
-            _r->d = _a.d;                              \
-    } while (0)
+    enum math_op {
+        MATH_OP_NUMBER,
+        MATH_OP_VAR,
+        MATH_OP_PRE_DEFINED,
+        MATH_OP_VOI_FUNC,
+        MATH_OP_NEG,
+        MATH_OP_UNI_FUNC,
+        MATH_OP_ADD,
+        MATH_OP_SUB,
+        MATH_OP_MUL,
+        MATH_OP_DIV,
+        MATH_OP_BIN_FUNC,
+    };
 
-    #define NEG(_r, _a) do {                           \
-            _r.d = -_a.d;                              \
-    } while (0)
+    struct math_instr {
+        enum math_op    op;
+        union {
+            VALUE_TYPE  d;                          // MATH_OP_NUMBER
+            enum math_pre_defined_var pre_defined;  // MATH_OP_PRE_DEFINED
+            VALUE_TYPE (*voi_func)(void);
+            VALUE_TYPE (*uni_func)(VALUE_TYPE a);
+            VALUE_TYPE (*bin_func)(VALUE_TYPE a, VALUE_TYPE b);
+        };
+        char           *name;   // MATH_OP_VAR and MATH_OP_PRE_DEFINED
+    };
 
-    #define ADD(_r, _a, _b) do {                       \
-            _r.d = _a.d + _b.d;                        \
-    } while (0)
+    /* The instructions in the postfix order, i.e., the order of
+       the reductions. */
+    struct PROG_TYPE {
+        struct math_instr  *instrs;
+        size_t              nr_instrs;
+        size_t              sz_instrs;
 
-    #define SUB(_r, _a, _b) do {                       \
-            _r.d = _a.d - _b.d;                        \
-    } while (0)
+        size_t              depth;
+        size_t              max_depth;
+    };
+
+    static struct math_instr *
+    emit(struct PROG_TYPE *prog, enum math_op op, const char *name,
+            size_t len)
+    {
+        if (prog->nr_instrs == prog->sz_instrs) {
+            size_t sz = prog->sz_instrs ? prog->sz_instrs * 2 : 8;
+            struct math_instr *instrs;
+            instrs = realloc(prog->instrs, sizeof(*instrs) * sz);
+            if (instrs == NULL)
+                return NULL;
+            prog->instrs = instrs;
+            prog->sz_instrs = sz;
+        }
 
-    #define MUL(_r, _a, _b) do {                       \
-            _r.d = _a.d * _b.d;                        \
+        struct math_instr *instr = prog->instrs + prog->nr_instrs;
+        memset(instr, 0, sizeof(*instr));
+        instr->op = op;
+        if (name) {
+            instr->name = strndup(name, len);
+            if (instr->name == NULL)
+                return NULL;
+        }
+        prog->nr_instrs++;
+
+        if (op <= MATH_OP_VOI_FUNC) {
+            if (++prog->depth > prog->max_depth)
+                prog->max_depth = prog->depth;
+        }
+        else if (op > MATH_OP_UNI_FUNC) {
+            prog->depth--;
+        }
+        return instr;
+    }
+
+    #define EMIT(_op) do {                                          \
+        if (emit(prog, _op, NULL, 0) == NULL)                       \
+            YYABORT;                                                \
     } while (0)
 
-    #define DIV(_r, _a, _b, _loc) do {                        \
-            int f = fpclassify(_b.d);                         \
-            if (f & FP_ZERO) {                                \
-                param->divide_by_zero = 1;                    \
-                yyerror(_loc,arg,param,"Divide by zero");     \
-                YYERROR;                                      \
-            }                                                 \
-            _r.d = _a.d / _b.d;                               \
+    #define EMIT_FUNC(_op, _member, _f) do {                        \
+        struct math_instr *_i = emit(prog, _op, NULL, 0);           \
+        if (_i == NULL)                                             \
+            YYABORT;                                                \
+        _i->_member = _f;                                           \
     } while (0)
 
-    #define SET_BY_NUM(_r, _a) do {                                 \
+    #define EMIT_NUM(_a) do {                                       \
             /* TODO: strtod sort of func */                         \
             char *_s = (char*)_a.text;                              \
             const char _c = _s[_a.leng];                            \
             char *endptr = NULL;                                    \
             _s[_a.leng] = '\0';                                     \
-            _r.d = STRTOD(_s, &endptr);                             \
+            VALUE_TYPE _d = STRTOD(_s, &endptr);                    \
             _s[_a.leng] = _c;                                       \
             if (endptr && *endptr)                                  \
                 YYABORT;                                            \
+            struct math_instr *_i;                                  \
+            _i = emit(prog, MATH_OP_NUMBER, NULL, 0);               \
+            if (_i == NULL)                                         \
+                YYABORT;                                            \
+            _i->d = _d;                                             \
     } while (0)
 
-    #define SET_BY_VAR(_r, _a) do {                                      \
-        purc_variant_t _v;                                               \
-        char *_s = (char*)_a.text;                                       \
-        const char _c = _s[_a.leng];                                     \
-        if (param->variables) {                                          \
-            _s[_a.leng] = '\0';                                          \
-            _v = purc_variant_object_get_by_ckey(param->variables, _s);  \
-            _s[_a.leng] = _c;                                            \
-            if (_v) {                                                    \
-                bool ok = CAST_TO_NUMBER(_v, &_r.d, false);              \
-                if (ok)                                                  \
-                    break;                                               \
-            }                                                            \
-        }                                                                \
-        if (param->param && purc_variant_is_object(param->param)) {      \
-            _s[_a.leng] = '\0';                                          \
-            _v = purc_variant_object_get_by_ckey(param->param, _s);      \
-            _s[_a.leng] = _c;                                            \
-            if (_v) {                                                    \
-                bool ok = CAST_TO_NUMBER(_v, &_r.d, false);              \
-                if (ok)                                                  \
-                    break;                                               \
-            }                                                            \
-        }                                                                \
-        YYABORT;                                                         \
-    } while (0)
-
-    #define SET_BY_PRE_DEFINED(_r, _a, _s) do {                          \
-        purc_variant_t _v;                                               \
-        if (param->variables) {                                          \
-            _v = purc_variant_object_get_by_ckey(param->variables, _s);  \
-            if (_v) {                                                    \
-                bool ok = CAST_TO_NUMBER(_v, &_r.d, false);              \
-                if (ok)                                                  \
-                    break;                                               \
-            }                                                            \
-        }                                                                \
-        if (param->param && purc_variant_is_object(param->param)) {      \
-            _v = purc_variant_object_get_by_ckey(param->param, _s);      \
-            if (_v) {                                                    \
-                bool ok = CAST_TO_NUMBER(_v, &_r.d, false);              \
-                fprintf(stderr, "_s: %s; ok: %d\n", _s, ok); \
-                if (ok)                                                  \
-                    break;                                               \
-            }                                                            \
-        }                                                                \
-        _r.d = PRE_DEFINED(_a);                                          \
-        purc_clr_error();                                                \
-    } while (0)
-
-    #define EVAL_BY_VOI_FUNC(_r, _f) do {                                \
-        int r = VOI_FUNC(&_r.d, _f);                                     \
-        if (r)                                                           \
-            YYABORT;                                                     \
-    } while (0)
-
-    #define EVAL_BY_UNI_FUNC(_r, _f, _a) do {                            \
-        int r = UNI_FUNC(&_r.d, _f, _a.d);                               \
-        if (r)                                                           \
+    #define EMIT_VAR(_a) do {                                            \
+        if (emit(prog, MATH_OP_VAR, _a.text, _a.leng) == NULL)           \
             YYABORT;                                                     \
     } while (0)
 
-    #define EVAL_BY_BIN_FUNC(_r, _f, _a, _b) do {                        \
-        int r = BIN_FUNC(&_r.d, _f, _a.d, _b.d);                         \
-        if (r)                                                           \
+    #define EMIT_PRE_DEFINED(_a, _s) do {                                \
+        struct math_instr *_i;                                           \
+        _i = emit(prog, MATH_OP_PRE_DEFINED, _s, strlen(_s));            \
+        if (_i == NULL)                                                  \
             YYABORT;                                                     \
+        _i->pre_defined = _a;                                            \
     } while (0)
 
     static void yyerror(
         YYLTYPE *yylloc,                   // match %define locations
         yyscan_t arg,                      // match %param
-        struct internal_param *param,      // match %parse-param
+        struct PROG_TYPE *prog,            // match %parse-param
         const char *errsg
     );
 
@@ -296,10 +296,9 @@
 %verbose
 
 %param { yyscan_t arg }
-%parse-param { struct internal_param *param }
+%parse-param { struct PROG_TYPE *prog }
 
 %union { struct math_token token; }
-%union { struct internal_value v; }
 %union { VALUE_TYPE (*voi_func)(void); }
 %union { VALUE_TYPE (*uni_func)(VALUE_TYPE a); }
 %union { VALUE_TYPE (*bin_func)(VALUE_TYPE a, VALUE_TYPE b); }
@@ -320,7 +319,6 @@
 %token PI E LN2 LN10 LOG2E LOG10E SQRT1_2 SQRT2
 
 %token <token> NUMBER VAR
-%nterm <v> exp term pre_defined
 %nterm <voi_func> voi_func
 %nterm <uni_func> uni_func
 %nterm <bin_func> bin_func
@@ -334,38 +332,38 @@ input:
 ;
 
 statement:
-  exp         { SET(param, $1); }
+  exp
 ;
 
 exp:
   term
-| exp '+' exp   { ADD($$, $1, $3); }
-| exp '-' exp   { SUB($$, $1, $3); }
-| exp '*' exp   { MUL($$, $1, $3); }
-| exp '/' exp   { DIV($$, $1, $3, &(@3)); }
-| exp '^' exp   { EVAL_BY_BIN_FUNC($$, POW, $1, $3); }
-| '-' exp %prec NEG { NEG($$, $2); }
+| exp '+' exp   { EMIT(MATH_OP_ADD); }
+| exp '-' exp   { EMIT(MATH_OP_SUB); }
+| exp '*' exp   { EMIT(MATH_OP_MUL); }
+| exp '/' exp   { EMIT(MATH_OP_DIV); }
+| exp '^' exp   { EMIT_FUNC(MATH_OP_BIN_FUNC, bin_func, POW); }
+| '-' exp %prec NEG { EMIT(MATH_OP_NEG); }
 ;
 
 term:
-  NUMBER      { SET_BY_NUM($$, $1); }
-| VAR         { SET_BY_VAR($$, $1); }
-| pre_defined { $$ = $1; }
-| voi_func '(' ')' { EVAL_BY_VOI_FUNC($$, $1); }
-| uni_func '(' exp ')' { EVAL_BY_UNI_FUNC($$, $1, $3); }
-| bin_func '(' exp ',' exp ')' { EVAL_BY_BIN_FUNC($$, $1, $3, $5); }
-| '(' exp ')' { $$ = $2; }
+  NUMBER      { EMIT_NUM($1); }
+| VAR         { EMIT_VAR($1); }
+| pre_defined
+| voi_func '(' ')' { EMIT_FUNC(MATH_OP_VOI_FUNC, voi_func, $1); }
+| uni_func '(' exp ')' { EMIT_FUNC(MATH_OP_UNI_FUNC, uni_func, $1); }
+| bin_func '(' exp ',' exp ')' { EMIT_FUNC(MATH_OP_BIN_FUNC, bin_func, $1); }
+| '(' exp ')'
 ;
 
 pre_defined:
-  PI          { SET_BY_PRE_DEFINED($$, MATH_PI,      "PI"); }
-| E           { SET_BY_PRE_DEFINED($$, MATH_E,       "E"); }
-| LN2         { SET_BY_PRE_DEFINED($$, MATH_LN2,     "LN2"); }
-| LN10        { SET_BY_PRE_DEFINED($$, MATH_LN10,    "LN10"); }
-| LOG2E       { SET_BY_PRE_DEFINED($$, MATH_LOG2E,   "LOG2E"); }
-| LOG10E      { SET_BY_PRE_DEFINED($$, MATH_LOG10E,  "LOG10E"); }
-| SQRT1_2     { SET_BY_PRE_DEFINED($$, MATH_SQRT1_2, "SQRT1_2"); }
-| SQRT2       { SET_BY_PRE_DEFINED($$, MATH_SQRT2,   "SQRT2"); }
+  PI          { EMIT_PRE_DEFINED(MATH_PI,      "PI"); }
+| E           { EMIT_PRE_DEFINED(MATH_E,       "E"); }
+| LN2         { EMIT_PRE_DEFINED(MATH_LN2,     "LN2"); }
+| LN10        { EMIT_PRE_DEFINED(MATH_LN10,    "LN10"); }
+| LOG2E       { EMIT_PRE_DEFINED(MATH_LOG2E,   "LOG2E"); }
+| LOG10E      { EMIT_PRE_DEFINED(MATH_LOG10E,  "LOG10E"); }
+| SQRT1_2     { EMIT_PRE_DEFINED(MATH_SQRT1_2, "SQRT1_2"); }
+| SQRT2       { EMIT_PRE_DEFINED(MATH_SQRT2,   "SQRT2"); }
 
 
 voi_func:
@@ -414,49 +412,160 @@ static void
 yyerror(
     YYLTYPE *yylloc,                   // match %define locations
     yyscan_t arg,                      // match %param
-    struct internal_param *param,      // match %parse-param
+    struct PROG_TYPE *prog,            // match %parse-param
     const char *errsg
 )
 {
     // to implement it here
     (void)yylloc;
     (void)arg;
-    (void)param;
+    (void)prog;
     fprintf(stderr, "(%d,%d)->(%d,%d): %s\n",
         yylloc->first_line, yylloc->first_column-1,
         yylloc->last_line,  yylloc->last_column-1,
         errsg);
 }
 
-int FUNC_NAME(const char *input, VALUE_TYPE *d, purc_variant_t param)
+void DELETE_NAME(struct PROG_TYPE *prog)
 {
-    struct internal_param ud = {0};
-    ud.param = param;
-    ud.variables = PURC_VARIANT_INVALID;
+    for (size_t i = 0; i < prog->nr_instrs; i++)
+        free(prog->instrs[i].name);
+    free(prog->instrs);
+    free(prog);
+}
+
+struct PROG_TYPE *COMPILE_NAME(const char *input)
+{
+    struct PROG_TYPE *prog = calloc(1, sizeof(*prog));
+    if (prog == NULL) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
 
     yyscan_t arg = {0};
     yylex_init(&arg);
     // yyset_in(in, arg);
     // yyset_debug(debug, arg);
-    yyset_extra(param, arg);
+    yyset_extra(prog, arg);
     yy_scan_string(input, arg);
-    int ret =yyparse(arg, &ud);
-    if (ud.variables) {
-        purc_variant_unref(ud.variables);
-        ud.variables = PURC_VARIANT_INVALID;
-    }
+    int ret =yyparse(arg, prog);
     yylex_destroy(arg);
-    if (ret==0 && d) {
-        *d = ud.d;
+
+    if (ret) {
+        DELETE_NAME(prog);
+        purc_set_error(PURC_ERROR_INTERNAL_FAILURE);
+        return NULL;
+    }
+
+    return prog;
+}
+
+static bool
+get_number(purc_variant_t param, const char *name, VALUE_TYPE *d)
+{
+    if (param && purc_variant_is_object(param)) {
+        purc_variant_t v = purc_variant_object_get_by_ckey(param, name);
+        if (v && CAST_TO_NUMBER(v, d, false))
+            return true;
     }
-    else {
-        if (ud.divide_by_zero) {
-            purc_set_error(PURC_ERROR_OVERFLOW);
+
+    return false;
+}
+
+int EXEC_NAME(const struct PROG_TYPE *prog, VALUE_TYPE *d,
+        purc_variant_t param)
+{
+    VALUE_TYPE buf[16];
+    VALUE_TYPE *stack = buf;
+    size_t top = 0;
+    int err = 0;
+
+    if (prog->max_depth > PCA_TABLESIZE(buf)) {
+        stack = malloc(sizeof(VALUE_TYPE) * prog->max_depth);
+        if (stack == NULL) {
+            purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return 1;
         }
-        else {
-            purc_set_error(PURC_ERROR_INTERNAL_FAILURE);
+    }
+
+    for (size_t i = 0; err == 0 && i < prog->nr_instrs; i++) {
+        const struct math_instr *instr = prog->instrs + i;
+        VALUE_TYPE *l = NULL, *r = NULL;
+        if (instr->op > MATH_OP_VOI_FUNC)
+            r = stack + top - 1;
+        if (instr->op > MATH_OP_UNI_FUNC)
+            l = stack + top - 2;
+
+        switch (instr->op) {
+        case MATH_OP_NUMBER:
+            stack[top++] = instr->d;
+            break;
+        case MATH_OP_VAR:
+            if (!get_number(param, instr->name, stack + top))
+                err = PURC_ERROR_INTERNAL_FAILURE;
+            top++;
+            break;
+        case MATH_OP_PRE_DEFINED:
+            if (!get_number(param, instr->name, stack + top)) {
+                stack[top] = PRE_DEFINED(instr->pre_defined);
+                purc_clr_error();
+            }
+            top++;
+            break;
+        case MATH_OP_VOI_FUNC:
+            if (VOI_FUNC(stack + top, instr->voi_func))
+                err = PURC_ERROR_INTERNAL_FAILURE;
+            top++;
+            break;
+        case MATH_OP_NEG:
+            *r = -*r;
+            break;
+        case MATH_OP_UNI_FUNC:
+            if (UNI_FUNC(r, instr->uni_func, *r))
+                err = PURC_ERROR_INTERNAL_FAILURE;
+            break;
+        case MATH_OP_ADD:
+            *l = *l + *r;
+            break;
+        case MATH_OP_SUB:
+            *l = *l - *r;
+            break;
+        case MATH_OP_MUL:
+            *l = *l * *r;
+            break;
+        case MATH_OP_DIV:
+            if (fpclassify(*r) & FP_ZERO)
+                err = PURC_ERROR_OVERFLOW;
+            else
+                *l = *l / *r;
+            break;
+        case MATH_OP_BIN_FUNC:
+            if (BIN_FUNC(l, instr->bin_func, *l, *r))
+                err = PURC_ERROR_INTERNAL_FAILURE;
+            break;
         }
+
+        if (instr->op > MATH_OP_UNI_FUNC)
+            top--;
     }
-    return ret ? 1 : 0;
+
+    if (err == 0 && d)
+        *d = prog->nr_instrs ? stack[0] : 0;
+    else if (err)
+        purc_set_error(err);
+
+    if (stack != buf)
+        free(stack);
+    return err ? 1 : 0;
 }
 
+int FUNC_NAME(const char *input, VALUE_TYPE *d, purc_variant_t param)
+{
+    struct PROG_TYPE *prog = COMPILE_NAME(input);
+    if (prog == NULL)
+        return 1;
+
+    int ret = EXEC_NAME(prog, d, param);
+    DELETE_NAME(prog);
+    return ret;
+}
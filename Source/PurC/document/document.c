@@ -92,6 +92,53 @@ purc_document_load(purc_document_type type, const char *content, size_t len)
     return ops->create(content, len);
 }
 
+purc_document_t
+purc_document_load_begin(purc_document_type type)
+{
+    struct purc_document_ops *ops = doc_types[type].ops;
+    if (ops == NULL) {
+        PC_WARN("document type %d is not implemented\n", type);
+        purc_set_error(PURC_ERROR_NOT_IMPLEMENTED);
+        return NULL;
+    }
+
+    if (ops->load_begin == NULL) {
+        purc_set_error(PURC_ERROR_NOT_SUPPORTED);
+        return NULL;
+    }
+
+    purc_document_t doc = ops->load_begin();
+    if (doc)
+        doc->loading = 1;
+    return doc;
+}
+
+int
+purc_document_load_feed(purc_document_t doc, const char *chunk, size_t len)
+{
+    if (!doc->loading) {
+        purc_set_error(PURC_ERROR_INVALID_OPERAND);
+        return -1;
+    }
+
+    if (len == 0)
+        return 0;
+
+    return doc->ops->load_feed(doc, chunk, len);
+}
+
+int
+purc_document_load_end(purc_document_t doc)
+{
+    if (!doc->loading) {
+        purc_set_error(PURC_ERROR_INVALID_OPERAND);
+        return -1;
+    }
+
+    doc->loading = 0;
+    return doc->ops->load_end(doc);
+}
+
 unsigned int
 purc_document_get_refc(purc_document_t doc)
 {
@@ -180,6 +227,21 @@ pcdoc_element_new_content(purc_document_t doc,
     return doc->ops->new_content(doc, elem, op, content, len);
 }
 
+pcdoc_node
+pcdoc_element_new_content_from_template(purc_document_t doc,
+        pcdoc_element_t elem, pcdoc_operation op,
+        const struct pcdoc_template *tpl)
+{
+    if (doc->ops->new_content_from_template)
+        return doc->ops->new_content_from_template(doc, elem, op, tpl);
+
+    pcdoc_node node;
+    node.type = PCDOC_NODE_VOID;
+    node.elem = NULL;
+    purc_set_error(PURC_ERROR_NOT_SUPPORTED);
+    return node;
+}
+
 int
 pcdoc_element_set_attribute(purc_document_t doc,
         pcdoc_element_t elem, pcdoc_operation op,
@@ -387,6 +449,65 @@ pcdoc_travel_descendant_elements(purc_document_t doc,
     return 0;
 }
 
+struct attr_match_info {
+    pcdoc_special_attr  which;
+    const char         *value;
+
+    pcdoc_element_cb    cb;
+    void               *ctxt;
+    size_t              nr;
+};
+
+static int
+attr_matcher(purc_document_t doc, pcdoc_element_t elem, void *ctxt)
+{
+    struct attr_match_info *info = ctxt;
+    bool found = false;
+
+    if (info->which == PCDOC_ATTR_ID) {
+        const char *s;
+        size_t len;
+        s = pcdoc_element_id(doc, elem, &len);
+        found = s && len == strlen(info->value) &&
+            strncmp(s, info->value, len) == 0;
+    }
+    else {
+        pcdoc_element_has_class(doc, elem, info->value, &found);
+    }
+
+    if (found) {
+        info->nr++;
+        return info->cb(doc, elem, info->ctxt);
+    }
+    return 0;
+}
+
+int
+pcdoc_travel_descendant_elements_by_special_attr(purc_document_t doc,
+        pcdoc_element_t ancestor, pcdoc_special_attr which, const char *value,
+        pcdoc_element_cb cb, void *ctxt, size_t *n)
+{
+    if (ancestor == NULL)
+        ancestor = doc->ops->special_elem(doc, PCDOC_SPECIAL_ELEM_ROOT);
+
+    if (doc->ops->travel_by_special_attr) {
+        struct pcdoc_travel_info info = { PCDOC_NODE_ELEMENT, 0, ctxt };
+        int r = doc->ops->travel_by_special_attr(doc, ancestor, which, value,
+                (pcdoc_node_cb)cb, &info);
+        if (n)
+            *n = info.nr;
+        return r;
+    }
+
+    // fall back to checking all descendants
+    struct attr_match_info info = { which, value, cb, ctxt, 0 };
+    int r = pcdoc_travel_descendant_elements(doc, ancestor, attr_matcher,
+            &info, NULL);
+    if (n)
+        *n = info.nr;
+    return r;
+}
+
 int
 pcdoc_travel_descendant_text_nodes(purc_document_t doc,
         pcdoc_element_t ancestor, pcdoc_text_node_cb cb, void *ctxt, size_t *n)
@@ -517,11 +638,26 @@ static pcdoc_elem_coll_t
 element_collection_new(const char *selector)
 {
     pcdoc_elem_coll_t coll = calloc(1, sizeof(*coll));
+    if (coll == NULL)
+        goto failed;
+
     coll->selector = selector ? strdup(selector) : NULL;
     coll->refc = 1;
     coll->elems = pcutils_arrlist_new_ex(NULL, 4);
+    if ((selector && coll->selector == NULL) || coll->elems == NULL)
+        goto failed;
 
     return coll;
+
+failed:
+    if (coll) {
+        if (coll->elems)
+            pcutils_arrlist_free(coll->elems);
+        free(coll->selector);
+        free(coll);
+    }
+    purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+    return NULL;
 }
 
 pcdoc_elem_coll_t
@@ -529,6 +665,8 @@ pcdoc_elem_coll_new_from_descendants(purc_document_t doc,
         pcdoc_element_t ancestor, const char *selector)
 {
     pcdoc_elem_coll_t coll = element_collection_new(selector);
+    if (coll == NULL)
+        return NULL;
 
     if (doc->ops->elem_coll_select) {
         if (ancestor == NULL) {
@@ -536,7 +674,7 @@ pcdoc_elem_coll_new_from_descendants(purc_document_t doc,
                     PCDOC_SPECIAL_ELEM_ROOT);
         }
 
-        if (!doc->ops->elem_coll_select(doc, coll, ancestor, selector)) {
+        if (doc->ops->elem_coll_select(doc, coll, ancestor, selector)) {
             pcdoc_elem_coll_delete(doc, coll);
             coll = NULL;
         }
@@ -550,9 +688,11 @@ pcdoc_elem_coll_filter(purc_document_t doc,
         pcdoc_elem_coll_t elem_coll, const char *selector)
 {
     pcdoc_elem_coll_t dst_coll = element_collection_new(selector);
+    if (dst_coll == NULL)
+        return NULL;
 
     if (doc->ops->elem_coll_filter) {
-        if (!doc->ops->elem_coll_filter(doc, dst_coll,
+        if (doc->ops->elem_coll_filter(doc, dst_coll,
                 elem_coll, selector)) {
             pcdoc_elem_coll_delete(doc, dst_coll);
             dst_coll = NULL;
@@ -569,6 +709,7 @@ pcdoc_elem_coll_delete(purc_document_t doc,
     UNUSED_PARAM(doc);
 
     pcutils_arrlist_free(elem_coll->elems);
+    free(elem_coll->selector);
     return free(elem_coll);
 }
 
@@ -29,7 +29,34 @@
 #include "purc-html.h"
 
 #include "private/document.h"
+#include "private/selector.h"
 #include "private/debug.h"
+#include "private/dom.h"
+#include "private/utils.h"
+
+static purc_document_t wrap_html_doc(pchtml_html_document_t *html_doc)
+{
+    purc_document_t doc = calloc(1, sizeof(*doc));
+    if (doc == NULL) {
+        pchtml_html_document_destroy(html_doc);
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    doc->type = PCDOC_K_TYPE_HTML;
+    doc->def_text_type = PCRDR_MSG_DATA_TYPE_HTML;
+    doc->need_rdr = 1;
+    doc->data_content = 0;
+    doc->have_head = 1;
+    doc->have_body = 1;
+
+    doc->refc = 1;
+
+    doc->ops = &_pcdoc_html_ops;
+    doc->impl = html_doc;
+
+    return doc;
+}
 
 static purc_document_t create(const char *content, size_t length)
 {
@@ -56,29 +83,241 @@ static purc_document_t create(const char *content, size_t length)
         PC_WARN("bad content\n");
     }
 
-    purc_document_t doc = calloc(1, sizeof(*doc));
-    doc->type = PCDOC_K_TYPE_HTML;
-    doc->def_text_type = PCRDR_MSG_DATA_TYPE_HTML;
-    doc->need_rdr = 1;
-    doc->data_content = 0;
-    doc->have_head = 1;
-    doc->have_body = 1;
-
-    doc->refc = 1;
-
-    doc->ops = &_pcdoc_html_ops;
-    doc->impl = html_doc;
-
-    return doc;
+    return wrap_html_doc(html_doc);
 }
 
+static void drop_elem_order(purc_document_t doc);
+static void remove_elem_order(struct pcdoc_elem_order *order,
+        pcdom_node_t *node);
+
 static void destroy(purc_document_t doc)
 {
     assert(doc->impl);
+    drop_elem_order(doc);
+    if (doc->id_index)
+        pcutils_map_destroy(doc->id_index);
+    if (doc->class_index)
+        pcutils_map_destroy(doc->class_index);
+    if (doc->selectors)
+        pcutils_map_destroy(doc->selectors);
+    if (doc->templates)
+        pcutils_map_destroy(doc->templates);
     pchtml_html_document_destroy(doc->impl);
     free(doc);
 }
 
+/*
+ * The indexes map an id or a class name to the set of elements having it.
+ * Both are pcutils_map (red-black trees), so a lookup takes O(log n).
+ * They are built on the first query, then kept up to date by the operations
+ * below which change the attributes or the subtrees.
+ */
+static int comp_elem(const void *key1, const void *key2)
+{
+    uintptr_t a = (uintptr_t)key1;
+    uintptr_t b = (uintptr_t)key2;
+    return (a < b) ? -1 : (a > b);
+}
+
+static void free_elem_set(void *val)
+{
+    pcutils_map_destroy((pcutils_map *)val);
+}
+
+static void
+index_key(pcutils_map *index, const char *key, size_t len,
+        pcdom_element_t *elem, bool add)
+{
+    char buf[64];
+    char *k = (len < sizeof(buf)) ? buf : malloc(len + 1);
+    if (k == NULL)
+        return;
+
+    memcpy(k, key, len);
+    k[len] = 0;
+
+    pcutils_map_entry *entry = pcutils_map_find(index, k);
+    if (add) {
+        if (entry == NULL) {
+            pcutils_map *set = pcutils_map_create(NULL, NULL, NULL, NULL,
+                    comp_elem, false);
+            if (set && pcutils_map_insert(index, k, set))
+                pcutils_map_destroy(set);
+            entry = pcutils_map_find(index, k);
+        }
+
+        if (entry)
+            pcutils_map_insert(entry->val, elem, NULL);
+    }
+    else if (entry) {
+        pcutils_map_erase(entry->val, elem);
+        if (pcutils_map_get_size(entry->val) == 0)
+            pcutils_map_erase(index, k);
+    }
+
+    if (k != buf)
+        free(k);
+}
+
+static void
+index_element(purc_document_t doc, pcdom_element_t *elem, bool add)
+{
+    const char *s;
+    size_t len;
+
+    if (elem->attr_id) {
+        s = (const char *)pcdom_attr_value(elem->attr_id, &len);
+        if (s && len > 0)
+            index_key(doc->id_index, s, len, elem, add);
+    }
+
+    if (elem->attr_class) {
+        s = (const char *)pcdom_attr_value(elem->attr_class, &len);
+        const char *end = s + (s ? len : 0);
+        while (s < end) {
+            while (s < end && purc_isspace(*s))
+                s++;
+
+            const char *token = s;
+            while (s < end && !purc_isspace(*s))
+                s++;
+
+            if (s > token)
+                index_key(doc->class_index, token, s - token, elem, add);
+        }
+    }
+}
+
+/* (un)index the descendant elements of `node`, and `node` itself if `self` */
+static void
+index_subtree(purc_document_t doc, pcdom_node_t *node, bool self, bool add)
+{
+    if (doc->id_index == NULL)
+        return;
+
+    // the subtree is about to be removed: take its elements out of the
+    // order table; the inserted ones are placed when looked up
+    struct pcdoc_elem_order *order = add ? NULL : doc->elem_order;
+
+    if (self && node->type == PCDOM_NODE_TYPE_ELEMENT) {
+        index_element(doc, pcdom_interface_element(node), add);
+        if (order)
+            remove_elem_order(order, node);
+    }
+
+    pcdom_node_t *curr = node->first_child;
+    while (curr) {
+        if (curr->type == PCDOM_NODE_TYPE_ELEMENT) {
+            index_element(doc, pcdom_interface_element(curr), add);
+            if (order)
+                remove_elem_order(order, curr);
+        }
+
+        if (curr->first_child) {
+            curr = curr->first_child;
+            continue;
+        }
+
+        while (curr != node && curr->next == NULL)
+            curr = curr->parent;
+
+        if (curr == node)
+            break;
+        curr = curr->next;
+    }
+}
+
+static int
+build_index(purc_document_t doc)
+{
+    if (doc->id_index)
+        return 0;
+
+    doc->id_index = pcutils_map_create(copy_key_string, free_key_string,
+            NULL, free_elem_set, comp_key_string, false);
+    doc->class_index = pcutils_map_create(copy_key_string, free_key_string,
+            NULL, free_elem_set, comp_key_string, false);
+    if (doc->id_index == NULL || doc->class_index == NULL) {
+        if (doc->id_index)
+            pcutils_map_destroy(doc->id_index);
+        if (doc->class_index)
+            pcutils_map_destroy(doc->class_index);
+        doc->id_index = NULL;
+        doc->class_index = NULL;
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+
+    index_subtree(doc, pcdom_interface_node(doc->impl), false, true);
+    return 0;
+}
+
+static void
+drop_index(purc_document_t doc)
+{
+    drop_elem_order(doc);
+    if (doc->id_index) {
+        pcutils_map_destroy(doc->id_index);
+        pcutils_map_destroy(doc->class_index);
+        doc->id_index = NULL;
+        doc->class_index = NULL;
+    }
+}
+
+/*
+ * The incremental loading drives the chunk interface of the HTML parser,
+ * which keeps the tokenizer and the tree builder states between the chunks;
+ * the elements are attached to the tree as soon as they are parsed.
+ */
+static purc_document_t load_begin(void)
+{
+    pchtml_html_document_t *html_doc;
+    html_doc = pchtml_html_document_create();
+    if (!html_doc) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    if (pchtml_html_document_parse_chunk_begin(html_doc)) {
+        pchtml_html_document_destroy(html_doc);
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    return wrap_html_doc(html_doc);
+}
+
+static int load_feed(purc_document_t doc, const char *chunk, size_t len)
+{
+    /* the parser changes the tree behind the indexes */
+    drop_index(doc);
+
+    unsigned int r;
+    r = pchtml_html_document_parse_chunk(doc->impl,
+            (const unsigned char*)chunk, len);
+    if (r) {
+        // NOTE: the parser fails only if it is out of memory.
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int load_end(purc_document_t doc)
+{
+    drop_index(doc);
+
+    unsigned int r;
+    r = pchtml_html_document_parse_chunk_end(doc->impl);
+    if (r) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+
+    return 0;
+}
+
 static void
 dom_append_node_to_element(pcdom_element_t *element,
         pcdom_node_t *node)
@@ -158,10 +397,12 @@ static pcdoc_element_t operate_element(purc_document_t doc,
     UNUSED_PARAM(self_close);
 
     if (op == PCDOC_OP_ERASE) {
+        index_subtree(doc, pcdom_interface_node(elem), true, false);
         dom_erase_element(pcdom_interface_element(elem));
         return NULL;
     }
     else if (op == PCDOC_OP_CLEAR) {
+        index_subtree(doc, pcdom_interface_node(elem), false, false);
         dom_clear_element(pcdom_interface_element(elem));
         return elem;
     }
@@ -171,6 +412,9 @@ static pcdoc_element_t operate_element(purc_document_t doc,
         return NULL;
     }
 
+    if (op == PCDOC_OP_DISPLACE)
+        index_subtree(doc, pcdom_interface_node(elem), false, false);
+
     pcdom_element_t *dom_elem = pcdom_interface_element(elem);
     pcdom_document_t *dom_doc = pcdom_interface_document(doc->impl);
     pcdom_element_t *new_elem;
@@ -203,6 +447,8 @@ static pcdoc_text_node_t new_text_content(purc_document_t doc,
     text_node = pcdom_document_create_text_node(dom_doc,
             (const unsigned char *)text, length ? length : strlen(text));
     if (text_node) {
+        if (op == PCDOC_OP_DISPLACE)
+            index_subtree(doc, pcdom_interface_node(elem), false, false);
         dom_node_ops[op](dom_elem, pcdom_interface_node(text_node));
     }
     else {
@@ -246,93 +492,67 @@ failed:
     return root;
 }
 
+/* the operations move the children of `holder` (nullable) to the places */
 static void
 dom_append_subtree_to_element(pcdom_element_t *element,
-        pcdom_node_t *subtree)
+        pcdom_node_t *holder)
 {
     pcdom_node_t *parent = pcdom_interface_node(element);
 
-    if (subtree && subtree->first_child) {
-        pcdom_node_t *div;
-        div = subtree->first_child;
-
-        while (div->first_child) {
-            pcdom_node_t *child = div->first_child;
-            pcdom_node_remove(child);
-            pcdom_node_append_child(parent, child);
-        }
+    while (holder && holder->first_child) {
+        pcdom_node_t *child = holder->first_child;
+        pcdom_node_remove(child);
+        pcdom_node_append_child(parent, child);
     }
-
-    if (subtree)
-        pcdom_node_destroy_deep(subtree);
 }
 
 static void
 dom_prepend_subtree_to_element(pcdom_element_t *element,
-        pcdom_node_t *subtree)
+        pcdom_node_t *holder)
 {
     pcdom_node_t *parent = pcdom_interface_node(element);
 
-    if (subtree && subtree->first_child) {
-        pcdom_node_t *div;
-        div = subtree->first_child;
-
-        while (div->last_child) {
-            pcdom_node_t *child = div->last_child;
-            pcdom_node_remove(child);
-            pcdom_node_prepend_child(parent, child);
-        }
+    while (holder && holder->last_child) {
+        pcdom_node_t *child = holder->last_child;
+        pcdom_node_remove(child);
+        pcdom_node_prepend_child(parent, child);
     }
-
-    if (subtree)
-        pcdom_node_destroy_deep(subtree);
 }
 
 static void
 dom_insert_subtree_before_element(pcdom_element_t *element,
-        pcdom_node_t *subtree)
+        pcdom_node_t *holder)
 {
     pcdom_node_t *to = pcdom_interface_node(element);
 
-    if (subtree && subtree->first_child) {
-        pcdom_node_t *div;
-        div = subtree->first_child;
-
-        while (div->last_child) {
-            pcdom_node_t *child = div->last_child;
-            pcdom_node_remove(child);
-            pcdom_node_insert_before(to, child);
-        }
+    /* Every child goes right before `to`, i.e. after the ones moved
+       before it, so the children are taken from the first one to keep
+       their order; taking them from the last one reversed it. */
+    while (holder && holder->first_child) {
+        pcdom_node_t *child = holder->first_child;
+        pcdom_node_remove(child);
+        pcdom_node_insert_before(to, child);
     }
-
-    if (subtree)
-        pcdom_node_destroy_deep(subtree);
 }
 
 static void
 dom_insert_subtree_after_element(pcdom_element_t *element,
-        pcdom_node_t *subtree)
+        pcdom_node_t *holder)
 {
     pcdom_node_t *to = pcdom_interface_node(element);
 
-    if (subtree && subtree->first_child) {
-        pcdom_node_t *div;
-        div = subtree->first_child;
-
-        while (div->first_child) {
-            pcdom_node_t *child = div->first_child;
-            pcdom_node_remove(child);
-            pcdom_node_insert_after(to, child);
-        }
+    /* Every child goes right after `to`, i.e. before the ones moved
+       after it, so the children are taken from the last one. */
+    while (holder && holder->last_child) {
+        pcdom_node_t *child = holder->last_child;
+        pcdom_node_remove(child);
+        pcdom_node_insert_after(to, child);
     }
-
-    if (subtree)
-        pcdom_node_destroy_deep(subtree);
 }
 
 static void
 dom_displace_content_by_subtree(pcdom_element_t *element,
-        pcdom_node_t *subtree)
+        pcdom_node_t *holder)
 {
     pcdom_node_t *parent = pcdom_interface_node(element);
 
@@ -340,23 +560,11 @@ dom_displace_content_by_subtree(pcdom_element_t *element,
         pcdom_node_destroy_deep(parent->first_child);
     }
 
-    if (subtree && subtree->first_child) {
-        pcdom_node_t *div;
-        div = subtree->first_child;
-
-        while (div->first_child) {
-            pcdom_node_t *child = div->first_child;
-            pcdom_node_remove(child);
-            pcdom_node_append_child(parent, child);
-        }
-    }
-
-    if (subtree)
-        pcdom_node_destroy_deep(subtree);
+    dom_append_subtree_to_element(element, holder);
 }
 
 typedef void (*dom_subtree_op)(pcdom_element_t *element,
-        pcdom_node_t *subtree);
+        pcdom_node_t *holder);
 
 static const dom_subtree_op dom_subtree_ops[] = {
     dom_append_subtree_to_element,
@@ -385,7 +593,13 @@ static pcdoc_node new_content(purc_document_t doc,
             content, length ? length : strlen(content));
 
     if (subtree) {
-        dom_subtree_ops[op](dom_elem, subtree);
+        if (op == PCDOC_OP_DISPLACE)
+            index_subtree(doc, pcdom_interface_node(elem), false, false);
+        // the new elements are the descendants of the wrapping <div>
+        if (subtree->first_child)
+            index_subtree(doc, subtree->first_child, false, true);
+        dom_subtree_ops[op](dom_elem, subtree->first_child);
+        pcdom_node_destroy_deep(subtree);
     }
     else {
         purc_set_error(PURC_ERROR_INVALID_VALUE);
@@ -398,119 +612,667 @@ done:
     return node;
 }
 
-static inline int
-dom_set_element_attribute(pcdom_element_t *element,
-        const char* name, const char* value, size_t length)
+/*
+ * A template of markup is parsed once for a document, with a marker in place
+ * of every text. The markers are only allowed in the texts, the comments and
+ * the attribute values; such a node or an attribute gets a pattern (`user`),
+ * which is filled with the texts when the parsed nodes are copied for every
+ * instance of the template.
+ *
+ * A marker is `t`, U+FDD0 (a noncharacter), the index of the text, and
+ * U+FDD1; it begins with a letter to make a tag name after `<`.
+ */
+#define TPL_MARKER_LEAD         't'
+#define TPL_MARKER_OPEN         "\xEF\xB7\x90"
+#define TPL_MARKER_CLOSE        "\xEF\xB7\x91"
+#define TPL_MARKER_LEN          3
+
+/* the parsed templates are kept until there are too many of them */
+#define MAX_CACHED_TEMPLATES    64
+
+struct tpl_segment {
+    const char             *literal;
+    size_t                  len;
+    /* the index of the text following the literal; -1 for none */
+    ssize_t                 text;
+};
+
+struct tpl_pattern {
+    struct tpl_pattern     *next;
+    size_t                  nr_segs;
+    struct tpl_segment      segs[];
+};
+
+struct parsed_template {
+    /* the root returned by the fragment parser and the wrapping <div> */
+    pcdom_node_t           *root;
+    pcdom_node_t           *holder;
+    /* the tag of the context element when parsed */
+    uintptr_t               context;
+    /* the template can not be handled by copying the parsed nodes */
+    bool                    unsupported;
+    struct tpl_pattern     *patterns;
+};
+
+/* finds the U+FDD0 of a marker */
+static const char *
+find_marker(const char *data, const char *end)
 {
-    pcdom_attr_t *attr;
-    attr = pcdom_element_set_attribute(element,
-            (const unsigned char*)name, strlen(name),
-            (const unsigned char*)value, length);
-    return attr ? 0 : -1;
+    while ((data = memchr(data, TPL_MARKER_OPEN[0], end - data))) {
+        if ((size_t)(end - data) < TPL_MARKER_LEN)
+            break;
+        if (memcmp(data, TPL_MARKER_OPEN, TPL_MARKER_LEN) == 0)
+            return data;
+        data++;
+    }
+
+    return NULL;
 }
 
-static inline int
-dom_remove_element_attr(pcdom_element_t *element, const char* name)
+static void
+release_parsed_template(struct parsed_template *parsed)
 {
-    int retv = -1;
-
-    if (pcdom_element_remove_attribute(element,
-                (const unsigned char*)name, strlen(name)) == PURC_ERROR_OK)
-        retv = 0;
+    while (parsed->patterns) {
+        struct tpl_pattern *next = parsed->patterns->next;
+        free(parsed->patterns);
+        parsed->patterns = next;
+    }
 
-    return retv;
+    if (parsed->root)
+        pcdom_node_destroy_deep(parsed->root);
+    parsed->root = NULL;
+    parsed->holder = NULL;
 }
 
-static int set_attribute(purc_document_t doc,
-            pcdoc_element_t elem, pcdoc_operation op,
-            const char *name, const char *val, size_t len)
+static void free_parsed_template(void *val)
 {
-    UNUSED_PARAM(doc);
+    struct parsed_template *parsed = val;
+    release_parsed_template(parsed);
+    free(parsed);
+}
 
-    pcdom_element_t *dom_elem = pcdom_interface_element(elem);
-    if (op == PCDOC_OP_ERASE) {
-        return dom_remove_element_attr(dom_elem, name);
-    }
-    else if (op == PCDOC_OP_CLEAR) {
-        return dom_set_element_attribute(dom_elem, name, "", 0);
-    }
-    else if (op == PCDOC_OP_DISPLACE) {
-        return dom_set_element_attribute(dom_elem, name,
-                val, len ? len : strlen(val));
-    }
-    else {
-        purc_set_error(PURC_ERROR_INVALID_VALUE);
+/* returns NULL if the markers in `data` are malformed or repeated */
+static struct tpl_pattern *
+make_pattern(const char *data, size_t len, size_t nr_texts, bool *seen)
+{
+    size_t nr_segs = 1;
+    const char *end = data + len;
+    const char *p = data;
+    while ((p = find_marker(p, end))) {
+        nr_segs++;
+        p += TPL_MARKER_LEN;
     }
 
-    return -1;
-}
+    struct tpl_pattern *pattern = malloc(sizeof(*pattern) +
+            sizeof(struct tpl_segment) * nr_segs);
+    if (pattern == NULL)
+        return NULL;
 
-static pcdoc_element_t special_elem(purc_document_t doc,
-            pcdoc_special_elem which)
-{
-    pchtml_html_document_t *html_doc = (pchtml_html_document_t *)doc->impl;
+    pattern->nr_segs = 0;
+    p = data;
+    while (p <= end) {
+        struct tpl_segment *seg = pattern->segs + pattern->nr_segs++;
+        const char *marker = find_marker(p, end);
 
-    switch (which) {
-    case PCDOC_SPECIAL_ELEM_ROOT:
-        return (pcdoc_element_t)pchtml_doc_get_document(html_doc)->element;
+        seg->literal = p;
+        seg->text = -1;
+        if (marker == NULL) {
+            seg->len = end - p;
+            break;
+        }
 
-    case PCDOC_SPECIAL_ELEM_HEAD:
-        return (pcdoc_element_t)pchtml_doc_get_head(html_doc);
+        if (marker == p || marker[-1] != TPL_MARKER_LEAD)
+            goto failed;
+        seg->len = marker - 1 - p;
+
+        size_t idx = 0;
+        p = marker + TPL_MARKER_LEN;
+        if (p == end || !purc_isdigit(*p))
+            goto failed;
+        while (p < end && purc_isdigit(*p)) {
+            idx = idx * 10 + (*p - '0');
+            if (idx >= nr_texts)
+                goto failed;
+            p++;
+        }
 
-    case PCDOC_SPECIAL_ELEM_BODY:
-        return (pcdoc_element_t)pchtml_doc_get_body(html_doc);
+        if (seen[idx] || (size_t)(end - p) < TPL_MARKER_LEN ||
+                memcmp(p, TPL_MARKER_CLOSE, TPL_MARKER_LEN))
+            goto failed;
+
+        seen[idx] = true;
+        seg->text = idx;
+        p += TPL_MARKER_LEN;
     }
 
+    return pattern;
+
+failed:
+    free(pattern);
     return NULL;
 }
 
-static pcdoc_element_t get_parent(purc_document_t doc, pcdoc_node node)
+static bool
+hang_pattern(struct parsed_template *parsed, pcdom_node_t *node,
+        const unsigned char *data, size_t len, size_t nr_texts, bool *seen)
 {
-    UNUSED_PARAM(doc);
-
-    assert(node.type != PCDOC_NODE_VOID && node.type != PCDOC_NODE_OTHERS);
-
-    pcdom_node_t *dom_node = pcdom_interface_node(node.elem);
+    if (data == NULL ||
+            find_marker((const char *)data, (const char *)data + len) == NULL) {
+        node->user = NULL;
+        return true;
+    }
 
-    assert(dom_node->parent->type == PCDOM_NODE_TYPE_ELEMENT);
+    struct tpl_pattern *pattern;
+    pattern = make_pattern((const char *)data, len, nr_texts, seen);
+    if (pattern == NULL)
+        return false;
 
-    return (pcdoc_element_t)dom_node->parent;
+    pattern->next = parsed->patterns;
+    parsed->patterns = pattern;
+    node->user = pattern;
+    return true;
 }
 
-static int children_count(purc_document_t doc, pcdoc_element_t elem,
-        size_t *nrs)
+static bool
+hang_patterns(struct parsed_template *parsed, size_t nr_texts, bool *seen)
 {
-    UNUSED_PARAM(doc);
-
-    pcdom_node_t *dom_node = pcdom_interface_node(elem);
-    pcdom_node_t *child = dom_node->first_child;
-    while (child) {
-        if (child->type == PCDOM_NODE_TYPE_ELEMENT) {
-            nrs[PCDOC_NODE_ELEMENT]++;
-        }
-        else if (child->type == PCDOM_NODE_TYPE_TEXT) {
-            nrs[PCDOC_NODE_TEXT]++;
+    pcdom_node_t *node = parsed->holder->first_child;
+    while (node) {
+        if (node->type == PCDOM_NODE_TYPE_ELEMENT) {
+            // the contents of a <template> are not the children
+            if (node->local_name == PCHTML_TAG_TEMPLATE)
+                return false;
+
+            pcdom_attr_t *attr;
+            attr = pcdom_interface_element(node)->first_attr;
+            for (; attr; attr = attr->next) {
+                if (!hang_pattern(parsed, pcdom_interface_node(attr),
+                            attr->value ? attr->value->data : NULL,
+                            attr->value ? attr->value->length : 0,
+                            nr_texts, seen))
+                    return false;
+            }
         }
-        else if (child->type == PCDOM_NODE_TYPE_CDATA_SECTION) {
-            nrs[PCDOC_NODE_CDATA_SECTION]++;
+        else if (node->type == PCDOM_NODE_TYPE_TEXT ||
+                node->type == PCDOM_NODE_TYPE_COMMENT) {
+            pcdom_character_data_t *char_data;
+            char_data = pcdom_interface_character_data(node);
+            if (!hang_pattern(parsed, node, char_data->data.data,
+                        char_data->data.length, nr_texts, seen))
+                return false;
         }
         else {
-            nrs[PCDOC_NODE_OTHERS]++;
+            return false;
         }
 
-        child = child->next;
+        if (node->first_child) {
+            node = node->first_child;
+            continue;
+        }
+
+        while (node != parsed->holder && node->next == NULL)
+            node = node->parent;
+
+        if (node == parsed->holder)
+            break;
+        node = node->next;
     }
 
-    return 0;
+    for (size_t i = 0; i < nr_texts; i++) {
+        // a marker in a tag name or an attribute name
+        if (!seen[i])
+            return false;
+    }
+
+    return true;
 }
 
-static inline pcdoc_node_type
-node_type(pcdom_node_type_t type)
+static int
+parse_template(pcdom_element_t *context, const struct pcdoc_template *tpl,
+        const char *marked, size_t len, struct parsed_template *parsed)
 {
-    switch (type) {
-        case PCDOM_NODE_TYPE_ELEMENT:
-            return PCDOC_NODE_ELEMENT;
-        case PCDOM_NODE_TYPE_TEXT:
+    pcdom_document_t *dom_doc = pcdom_interface_node(context)->owner_document;
+
+    parsed->context = pcdom_interface_node(context)->local_name;
+    parsed->unsupported = true;
+    parsed->patterns = NULL;
+    parsed->root = dom_parse_fragment(dom_doc, context, marked, len);
+    if (parsed->root == NULL) {
+        purc_set_error(PURC_ERROR_INVALID_VALUE);
+        return -1;
+    }
+
+    parsed->holder = parsed->root->first_child;
+    if (parsed->holder == NULL ||
+            parsed->holder->type != PCDOM_NODE_TYPE_ELEMENT) {
+        release_parsed_template(parsed);
+        return 0;
+    }
+
+    bool *seen = calloc(tpl->nr_texts + 1, sizeof(bool));
+    if (seen == NULL) {
+        release_parsed_template(parsed);
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+
+    if (hang_patterns(parsed, tpl->nr_texts, seen))
+        parsed->unsupported = false;
+    else
+        release_parsed_template(parsed);
+    free(seen);
+    return 0;
+}
+
+static char *
+mark_template(const struct pcdoc_template *tpl, size_t *len)
+{
+    struct pcutils_mystring marked;
+    pcutils_mystring_init(&marked);
+
+    size_t start = 0;
+    for (size_t i = 0; i <= tpl->nr_texts; i++) {
+        size_t end = tpl->piece_ends[i];
+        if (pcutils_mystring_append_mchar(&marked,
+                    (const unsigned char *)tpl->markup + start, end - start))
+            goto failed;
+        start = end;
+
+        if (i < tpl->nr_texts) {
+            char buf[TPL_MARKER_LEN * 2 + 24];
+            int n = snprintf(buf, sizeof(buf), "%c%s%u%s", TPL_MARKER_LEAD,
+                    TPL_MARKER_OPEN, (unsigned)i, TPL_MARKER_CLOSE);
+            if (pcutils_mystring_append_mchar(&marked,
+                        (const unsigned char *)buf, n))
+                goto failed;
+        }
+    }
+
+    if (pcutils_mystring_done(&marked))
+        goto failed;
+
+    *len = marked.nr_bytes;
+    return marked.buff;
+
+failed:
+    pcutils_mystring_free(&marked);
+    purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+    return NULL;
+}
+
+static struct parsed_template *
+get_parsed_template(purc_document_t doc, pcdom_element_t *context,
+        const struct pcdoc_template *tpl)
+{
+    size_t total = tpl->piece_ends[tpl->nr_texts];
+    if (find_marker(tpl->markup, tpl->markup + total)) {
+        purc_set_error(PURC_ERROR_NOT_SUPPORTED);
+        return NULL;
+    }
+
+    if (doc->templates == NULL) {
+        doc->templates = pcutils_map_create(copy_key_string, free_key_string,
+                NULL, free_parsed_template, comp_key_string, false);
+        if (doc->templates == NULL) {
+            purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return NULL;
+        }
+    }
+
+    size_t len;
+    char *marked = mark_template(tpl, &len);
+    if (marked == NULL)
+        return NULL;
+
+    struct parsed_template *parsed = NULL;
+    pcutils_map_entry *entry = pcutils_map_find(doc->templates, marked);
+    if (entry) {
+        parsed = entry->val;
+        // the fragment parser depends on the context element
+        if (parsed->context != pcdom_interface_node(context)->local_name) {
+            release_parsed_template(parsed);
+            if (parse_template(context, tpl, marked, len, parsed))
+                parsed = NULL;
+        }
+    }
+    else {
+        parsed = malloc(sizeof(*parsed));
+        if (parsed == NULL) {
+            purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            goto done;
+        }
+
+        if (parse_template(context, tpl, marked, len, parsed)) {
+            free(parsed);
+            parsed = NULL;
+            goto done;
+        }
+
+        if (pcutils_map_get_size(doc->templates) >= MAX_CACHED_TEMPLATES)
+            pcutils_map_clear(doc->templates);
+
+        if (pcutils_map_insert(doc->templates, marked, parsed)) {
+            free_parsed_template(parsed);
+            parsed = NULL;
+            purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        }
+    }
+
+done:
+    free(marked);
+    if (parsed && parsed->unsupported) {
+        purc_set_error(PURC_ERROR_NOT_SUPPORTED);
+        parsed = NULL;
+    }
+    return parsed;
+}
+
+static const unsigned char *
+fill_pattern(const struct tpl_pattern *pattern,
+        const struct pcdoc_template *tpl,
+        struct pcutils_mystring *buf, size_t *len)
+{
+    buf->nr_bytes = 0;
+    for (size_t i = 0; i < pattern->nr_segs; i++) {
+        const struct tpl_segment *seg = pattern->segs + i;
+        if (pcutils_mystring_append_mchar(buf,
+                    (const unsigned char *)seg->literal, seg->len))
+            return NULL;
+
+        if (seg->text >= 0 && pcutils_mystring_append_mchar(buf,
+                    (const unsigned char *)tpl->texts[seg->text],
+                    tpl->text_lens[seg->text]))
+            return NULL;
+    }
+
+    *len = buf->nr_bytes;
+    return buf->buff ? (const unsigned char *)buf->buff :
+        (const unsigned char *)"";
+}
+
+static pcdom_attr_t *
+copy_attr(pcdom_document_t *dom_doc, pcdom_attr_t *from,
+        const struct pcdoc_template *tpl, struct pcutils_mystring *buf)
+{
+    pcdom_attr_t *attr = pcdom_attr_interface_create(dom_doc);
+    if (attr == NULL)
+        return NULL;
+
+    pcdom_attr_clone_name_value(from, attr);
+    attr->upper_name = from->upper_name;
+    attr->node.ns = from->node.ns;
+    attr->node.prefix = from->node.prefix;
+
+    const unsigned char *value = NULL;
+    size_t len = 0;
+    if (from->node.user) {
+        value = fill_pattern(from->node.user, tpl, buf, &len);
+        if (value == NULL)
+            goto failed;
+    }
+    else if (from->value) {
+        value = from->value->data;
+        len = from->value->length;
+    }
+
+    if (value && pcdom_attr_set_value(attr, value, len))
+        goto failed;
+
+    return attr;
+
+failed:
+    pcdom_attr_interface_destroy(attr);
+    return NULL;
+}
+
+static pcdom_node_t *
+copy_element(pcdom_document_t *dom_doc, pcdom_element_t *from,
+        const struct pcdoc_template *tpl, struct pcutils_mystring *buf)
+{
+    pcdom_node_t *from_node = pcdom_interface_node(from);
+    pcdom_element_t *elem = pcdom_document_create_interface(dom_doc,
+            from_node->local_name, from_node->ns);
+    if (elem == NULL)
+        return NULL;
+
+    elem->node.prefix = from_node->prefix;
+    elem->upper_name = from->upper_name;
+    elem->qualified_name = from->qualified_name;
+    elem->custom_state = from->custom_state;
+    if (from->is_value && pcdom_element_is_set(elem,
+                from->is_value->data, from->is_value->length))
+        goto failed;
+
+    for (pcdom_attr_t *attr = from->first_attr; attr; attr = attr->next) {
+        pcdom_attr_t *copied = copy_attr(dom_doc, attr, tpl, buf);
+        if (copied == NULL)
+            goto failed;
+
+        copied->owner = elem;
+        pcdom_element_attr_append(elem, copied);
+    }
+
+    return pcdom_interface_node(elem);
+
+failed:
+    pcdom_node_destroy(pcdom_interface_node(elem));
+    return NULL;
+}
+
+/* copies the children of `from` to `to`; returns false on failure */
+static bool
+copy_children(pcdom_document_t *dom_doc, pcdom_node_t *from, pcdom_node_t *to,
+        const struct pcdoc_template *tpl, struct pcutils_mystring *buf)
+{
+    for (pcdom_node_t *child = from->first_child; child; child = child->next) {
+        pcdom_node_t *copied = NULL;
+
+        if (child->type == PCDOM_NODE_TYPE_ELEMENT) {
+            copied = copy_element(dom_doc, pcdom_interface_element(child),
+                    tpl, buf);
+        }
+        else {
+            pcdom_character_data_t *char_data;
+            char_data = pcdom_interface_character_data(child);
+
+            const unsigned char *data = char_data->data.data;
+            size_t len = char_data->data.length;
+            if (child->user) {
+                data = fill_pattern(child->user, tpl, buf, &len);
+                if (data == NULL)
+                    return false;
+                // the parser never makes an empty text node either
+                if (len == 0 && child->type == PCDOM_NODE_TYPE_TEXT)
+                    continue;
+            }
+
+            if (child->type == PCDOM_NODE_TYPE_TEXT)
+                copied = pcdom_interface_node(
+                        pcdom_document_create_text_node(dom_doc, data, len));
+            else
+                copied = pcdom_interface_node(
+                        pcdom_document_create_comment(dom_doc, data, len));
+        }
+
+        if (copied == NULL)
+            return false;
+
+        pcdom_node_append_child(to, copied);
+        if (child->first_child &&
+                !copy_children(dom_doc, child, copied, tpl, buf))
+            return false;
+    }
+
+    return true;
+}
+
+static pcdoc_node new_content_from_template(purc_document_t doc,
+            pcdoc_element_t elem, pcdoc_operation op,
+            const struct pcdoc_template *tpl)
+{
+    pcdoc_node node = { PCDOC_NODE_VOID, { NULL } };
+    if (UNLIKELY(op >= PCA_TABLESIZE(dom_subtree_ops))) {
+        purc_set_error(PURC_ERROR_INVALID_VALUE);
+        return node;
+    }
+
+    pcdom_document_t *dom_doc = pcdom_interface_document(doc->impl);
+    pcdom_element_t *dom_elem = pcdom_interface_element(elem);
+    struct parsed_template *parsed;
+    parsed = get_parsed_template(doc, dom_elem, tpl);
+    if (parsed == NULL)
+        return node;
+
+    pcdom_element_t *holder = pcdom_document_create_element(dom_doc,
+            (const unsigned char *)"div", 3, NULL);
+    if (holder == NULL) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return node;
+    }
+
+    struct pcutils_mystring buf;
+    pcutils_mystring_init(&buf);
+    if (!copy_children(dom_doc, parsed->holder, pcdom_interface_node(holder),
+                tpl, &buf)) {
+        pcutils_mystring_free(&buf);
+        pcdom_node_destroy_deep(pcdom_interface_node(holder));
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return node;
+    }
+    pcutils_mystring_free(&buf);
+
+    if (op == PCDOC_OP_DISPLACE)
+        index_subtree(doc, pcdom_interface_node(elem), false, false);
+    index_subtree(doc, pcdom_interface_node(holder), false, true);
+    dom_subtree_ops[op](dom_elem, pcdom_interface_node(holder));
+    pcdom_node_destroy_deep(pcdom_interface_node(holder));
+
+    node.type = PCDOC_NODE_ELEMENT;
+    node.elem = (pcdoc_element_t)doc;
+    return node;
+}
+
+static inline int
+dom_set_element_attribute(pcdom_element_t *element,
+        const char* name, const char* value, size_t length)
+{
+    pcdom_attr_t *attr;
+    attr = pcdom_element_set_attribute(element,
+            (const unsigned char*)name, strlen(name),
+            (const unsigned char*)value, length);
+    return attr ? 0 : -1;
+}
+
+static inline int
+dom_remove_element_attr(pcdom_element_t *element, const char* name)
+{
+    int retv = -1;
+
+    if (pcdom_element_remove_attribute(element,
+                (const unsigned char*)name, strlen(name)) == PURC_ERROR_OK)
+        retv = 0;
+
+    return retv;
+}
+
+static int set_attribute(purc_document_t doc,
+            pcdoc_element_t elem, pcdoc_operation op,
+            const char *name, const char *val, size_t len)
+{
+    pcdom_element_t *dom_elem = pcdom_interface_element(elem);
+    bool indexed = doc->id_index &&
+        (strcasecmp(name, "id") == 0 || strcasecmp(name, "class") == 0);
+    int retv = -1;
+
+    if (indexed)
+        index_element(doc, dom_elem, false);
+
+    if (op == PCDOC_OP_ERASE) {
+        retv = dom_remove_element_attr(dom_elem, name);
+    }
+    else if (op == PCDOC_OP_CLEAR) {
+        retv = dom_set_element_attribute(dom_elem, name, "", 0);
+    }
+    else if (op == PCDOC_OP_DISPLACE) {
+        retv = dom_set_element_attribute(dom_elem, name,
+                val, len ? len : strlen(val));
+    }
+    else {
+        purc_set_error(PURC_ERROR_INVALID_VALUE);
+    }
+
+    if (indexed)
+        index_element(doc, dom_elem, true);
+
+    return retv;
+}
+
+static pcdoc_element_t special_elem(purc_document_t doc,
+            pcdoc_special_elem which)
+{
+    pchtml_html_document_t *html_doc = (pchtml_html_document_t *)doc->impl;
+
+    switch (which) {
+    case PCDOC_SPECIAL_ELEM_ROOT:
+        return (pcdoc_element_t)pchtml_doc_get_document(html_doc)->element;
+
+    case PCDOC_SPECIAL_ELEM_HEAD:
+        return (pcdoc_element_t)pchtml_doc_get_head(html_doc);
+
+    case PCDOC_SPECIAL_ELEM_BODY:
+        return (pcdoc_element_t)pchtml_doc_get_body(html_doc);
+    }
+
+    return NULL;
+}
+
+static pcdoc_element_t get_parent(purc_document_t doc, pcdoc_node node)
+{
+    UNUSED_PARAM(doc);
+
+    assert(node.type != PCDOC_NODE_VOID && node.type != PCDOC_NODE_OTHERS);
+
+    pcdom_node_t *dom_node = pcdom_interface_node(node.elem);
+
+    assert(dom_node->parent->type == PCDOM_NODE_TYPE_ELEMENT);
+
+    return (pcdoc_element_t)dom_node->parent;
+}
+
+static int children_count(purc_document_t doc, pcdoc_element_t elem,
+        size_t *nrs)
+{
+    UNUSED_PARAM(doc);
+
+    pcdom_node_t *dom_node = pcdom_interface_node(elem);
+    pcdom_node_t *child = dom_node->first_child;
+    while (child) {
+        if (child->type == PCDOM_NODE_TYPE_ELEMENT) {
+            nrs[PCDOC_NODE_ELEMENT]++;
+        }
+        else if (child->type == PCDOM_NODE_TYPE_TEXT) {
+            nrs[PCDOC_NODE_TEXT]++;
+        }
+        else if (child->type == PCDOM_NODE_TYPE_CDATA_SECTION) {
+            nrs[PCDOC_NODE_CDATA_SECTION]++;
+        }
+        else {
+            nrs[PCDOC_NODE_OTHERS]++;
+        }
+
+        child = child->next;
+    }
+
+    return 0;
+}
+
+static inline pcdoc_node_type
+node_type(pcdom_node_type_t type)
+{
+    switch (type) {
+        case PCDOM_NODE_TYPE_ELEMENT:
+            return PCDOC_NODE_ELEMENT;
+        case PCDOM_NODE_TYPE_TEXT:
             return PCDOC_NODE_TEXT;
         case PCDOM_NODE_TYPE_CDATA_SECTION:
             return PCDOC_NODE_CDATA_SECTION;
@@ -656,6 +1418,523 @@ travel(purc_document_t doc, pcdoc_element_t ancestor,
     return 0;
 }
 
+static bool
+is_in_subtree(pcdom_node_t *node, pcdom_node_t *ancestor)
+{
+    for (; node; node = node->parent) {
+        if (node == ancestor)
+            return true;
+    }
+
+    return false;
+}
+
+/*
+ * The positions of the elements in the document order, kept in a table
+ * hashed on the element addresses. It is built by one pre-order walk when
+ * the elements found in the indexes have to be sorted, with a gap between
+ * the positions. The elements of a removed subtree are taken out of the
+ * table, which keeps the order of the others. The elements inserted later
+ * are not found in the table: the run of them around the one looked up is
+ * placed in the gap between the nearest elements in the table, and only
+ * when the gap is too small is the table built again.
+ */
+#define ELEM_ORDER_GAP      ((uint64_t)1 << 24)
+
+struct elem_order_slot {
+    pcdom_node_t   *node;
+    uint64_t        pos;
+};
+
+struct pcdoc_elem_order {
+    size_t                  mask;
+    size_t                  nr;
+    struct elem_order_slot  slots[];
+};
+
+static inline size_t
+elem_order_hash(pcdom_node_t *node)
+{
+    uint64_t h = (uint64_t)(uintptr_t)node * 0x9E3779B97F4A7C15ULL;
+    return (size_t)(h ^ (h >> 32));
+}
+
+static void
+drop_elem_order(purc_document_t doc)
+{
+    free(doc->elem_order);
+    doc->elem_order = NULL;
+}
+
+/* the node after `node` in the document order, within `root` */
+static pcdom_node_t *
+next_in_order(pcdom_node_t *node, pcdom_node_t *root)
+{
+    if (node->first_child)
+        return node->first_child;
+
+    while (node != root && node->next == NULL)
+        node = node->parent;
+    return (node == root) ? NULL : node->next;
+}
+
+/* the node before `node` in the document order */
+static pcdom_node_t *
+prev_in_order(pcdom_node_t *node)
+{
+    if (node->prev == NULL)
+        return node->parent;
+
+    node = node->prev;
+    while (node->last_child)
+        node = node->last_child;
+    return node;
+}
+
+static struct pcdoc_elem_order *
+new_elem_order(size_t nr)
+{
+    size_t sz = 16;
+    while (sz < nr * 2)
+        sz <<= 1;
+
+    struct pcdoc_elem_order *order;
+    order = calloc(1, sizeof(*order) + sizeof(order->slots[0]) * sz);
+    if (order == NULL) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+    order->mask = sz - 1;
+    return order;
+}
+
+static void
+put_elem_order(struct pcdoc_elem_order *order, pcdom_node_t *node,
+        uint64_t pos)
+{
+    size_t i = elem_order_hash(node) & order->mask;
+    while (order->slots[i].node)
+        i = (i + 1) & order->mask;
+    order->slots[i].node = node;
+    order->slots[i].pos = pos;
+    order->nr++;
+}
+
+static int
+build_elem_order(purc_document_t doc)
+{
+    pcdom_node_t *root = pcdom_interface_node(doc->impl);
+    pcdom_node_t *curr;
+    size_t nr = 0;
+
+    for (curr = root->first_child; curr; curr = next_in_order(curr, root)) {
+        if (curr->type == PCDOM_NODE_TYPE_ELEMENT)
+            nr++;
+    }
+
+    struct pcdoc_elem_order *order = new_elem_order(nr);
+    if (order == NULL)
+        return -1;
+
+    uint64_t pos = 0;
+    for (curr = root->first_child; curr; curr = next_in_order(curr, root)) {
+        if (curr->type == PCDOM_NODE_TYPE_ELEMENT) {
+            pos += ELEM_ORDER_GAP;
+            put_elem_order(order, curr, pos);
+        }
+    }
+
+    drop_elem_order(doc);
+    doc->elem_order = order;
+    return 0;
+}
+
+static bool
+find_elem_order(struct pcdoc_elem_order *order, pcdom_node_t *node,
+        uint64_t *pos)
+{
+    size_t i = elem_order_hash(node) & order->mask;
+    for (; order->slots[i].node; i = (i + 1) & order->mask) {
+        if (order->slots[i].node == node) {
+            *pos = order->slots[i].pos;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void
+remove_elem_order(struct pcdoc_elem_order *order, pcdom_node_t *node)
+{
+    size_t i = elem_order_hash(node) & order->mask;
+    for (; order->slots[i].node; i = (i + 1) & order->mask) {
+        if (order->slots[i].node == node)
+            break;
+    }
+    if (order->slots[i].node == NULL)
+        return;
+
+    // shift the following slots of the cluster back to keep them reachable
+    size_t j = i;
+    for (;;) {
+        order->slots[i].node = NULL;
+        for (;;) {
+            j = (j + 1) & order->mask;
+            if (order->slots[j].node == NULL) {
+                order->nr--;
+                return;
+            }
+
+            size_t home = elem_order_hash(order->slots[j].node) & order->mask;
+            if (((j - home) & order->mask) >= ((j - i) & order->mask))
+                break;
+        }
+        order->slots[i] = order->slots[j];
+        i = j;
+    }
+}
+
+/* makes room for `nr` more elements */
+static int
+grow_elem_order(purc_document_t doc, size_t nr)
+{
+    struct pcdoc_elem_order *order = doc->elem_order;
+    if ((order->nr + nr) * 2 <= order->mask + 1)
+        return 0;
+
+    struct pcdoc_elem_order *grown = new_elem_order(order->nr + nr);
+    if (grown == NULL)
+        return -1;
+
+    for (size_t i = 0; i <= order->mask; i++) {
+        if (order->slots[i].node)
+            put_elem_order(grown, order->slots[i].node, order->slots[i].pos);
+    }
+
+    drop_elem_order(doc);
+    doc->elem_order = grown;
+    return 0;
+}
+
+/* places the elements not in the table around `node`, which is not either,
+   between the nearest elements in the table; -1 if there is no room */
+static int
+place_new_elems(purc_document_t doc, pcdom_node_t *node)
+{
+    struct pcdoc_elem_order *order = doc->elem_order;
+    pcdom_node_t *root = pcdom_interface_node(doc->impl);
+    pcdom_node_t *curr;
+    uint64_t low = 0, high = UINT64_MAX, pos;
+
+    pcdom_node_t *first = node;
+    for (curr = prev_in_order(node); curr && curr != root;
+            curr = prev_in_order(curr)) {
+        if (curr->type != PCDOM_NODE_TYPE_ELEMENT)
+            continue;
+        if (find_elem_order(order, curr, &low))
+            break;
+        first = curr;
+    }
+
+    // not in the document
+    if (curr == NULL)
+        return -1;
+
+    size_t nr = 0;
+    for (curr = first; curr; curr = next_in_order(curr, root)) {
+        if (curr->type != PCDOM_NODE_TYPE_ELEMENT)
+            continue;
+        if (find_elem_order(order, curr, &high))
+            break;
+        nr++;
+    }
+
+    uint64_t step;
+    if (high == UINT64_MAX) {
+        // appended after the last one
+        if ((high - low) / ELEM_ORDER_GAP <= nr)
+            return -1;
+        step = ELEM_ORDER_GAP;
+    }
+    else {
+        step = (high - low) / (nr + 1);
+        if (step == 0)
+            return -1;
+    }
+
+    if (grow_elem_order(doc, nr))
+        return -1;
+
+    order = doc->elem_order;
+    pos = low;
+    for (curr = first; nr > 0; curr = next_in_order(curr, root)) {
+        if (curr->type != PCDOM_NODE_TYPE_ELEMENT)
+            continue;
+        pos += step;
+        put_elem_order(order, curr, pos);
+        nr--;
+    }
+
+    return 0;
+}
+
+static int
+elem_position(purc_document_t doc, pcdom_node_t *node, uint64_t *pos)
+{
+    if (doc->elem_order) {
+        if (find_elem_order(doc->elem_order, node, pos))
+            return 0;
+
+        if (place_new_elems(doc, node) == 0 &&
+                find_elem_order(doc->elem_order, node, pos))
+            return 0;
+        purc_clr_error();
+    }
+
+    if (build_elem_order(doc))
+        return -1;
+
+    if (!find_elem_order(doc->elem_order, node, pos))
+        *pos = UINT64_MAX;
+    return 0;
+}
+
+static int
+comp_elem_order(const void *v1, const void *v2)
+{
+    const struct elem_order_slot *a = v1;
+    const struct elem_order_slot *b = v2;
+    return (a->pos < b->pos) ? -1 : (a->pos > b->pos);
+}
+
+static int
+travel_by_special_attr(purc_document_t doc, pcdoc_element_t ancestor,
+        pcdoc_special_attr which, const char *value,
+        pcdoc_node_cb cb, struct pcdoc_travel_info *info)
+{
+    if (build_index(doc))
+        return -1;
+
+    pcutils_map *index;
+    index = (which == PCDOC_ATTR_ID) ? doc->id_index : doc->class_index;
+
+    pcutils_map_entry *entry = pcutils_map_find(index, value);
+    if (entry == NULL)
+        return 0;
+
+    pcutils_map *set = entry->val;
+    struct elem_order_slot *nodes;
+    nodes = malloc(sizeof(*nodes) * pcutils_map_get_size(set));
+    if (nodes == NULL) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+
+    // NOTE: collect the matched elements first; `cb` might change the index
+    size_t nr = 0;
+    pcdom_node_t *root = pcdom_interface_node(ancestor);
+    struct pcutils_map_iterator it = pcutils_map_it_begin_first(set);
+    for (; (entry = pcutils_map_it_value(&it)); pcutils_map_it_next(&it)) {
+        pcdom_node_t *node = entry->key;
+        if (is_in_subtree(node, root))
+            nodes[nr++].node = node;
+    }
+    pcutils_map_it_end(&it);
+
+    if (nr > 1) {
+        for (size_t i = 0; i < nr; i++) {
+            if (elem_position(doc, nodes[i].node, &nodes[i].pos)) {
+                free(nodes);
+                return -1;
+            }
+        }
+        qsort(nodes, nr, sizeof(*nodes), comp_elem_order);
+    }
+
+    int r = 0;
+    for (size_t i = 0; i < nr; i++) {
+        r = cb(doc, nodes[i].node, info->ctxt);
+        if (r) {
+            r = -1;
+            break;
+        }
+        info->nr++;
+    }
+
+    free(nodes);
+    return r;
+}
+
+/* the compiled selectors are kept until there are too many of them */
+#define MAX_CACHED_SELECTORS    64
+
+static void free_selector(void *val)
+{
+    pcdoc_selector_delete((struct pcdoc_selector *)val);
+}
+
+static struct pcdoc_selector *
+get_selector(purc_document_t doc, const char *selector)
+{
+    if (doc->selectors == NULL) {
+        doc->selectors = pcutils_map_create(copy_key_string, free_key_string,
+                NULL, free_selector, comp_key_string, false);
+        if (doc->selectors == NULL) {
+            purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return NULL;
+        }
+    }
+
+    struct pcdoc_selector *sel;
+    pcutils_map_entry *entry = pcutils_map_find(doc->selectors, selector);
+    if (entry) {
+        sel = entry->val;
+    }
+    else {
+        sel = pcdoc_selector_new(selector);
+        if (sel == NULL)
+            return NULL;
+
+        if (pcutils_map_get_size(doc->selectors) >= MAX_CACHED_SELECTORS)
+            pcutils_map_clear(doc->selectors);
+
+        if (pcutils_map_insert(doc->selectors, selector, sel)) {
+            pcdoc_selector_delete(sel);
+            purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return NULL;
+        }
+    }
+
+    pcdoc_selector_bind(sel, pcdom_interface_document(doc->impl));
+    return sel;
+}
+
+/* returns 0 to continue, 1 to stop, or -1 on failure */
+typedef int (*select_cb)(pcdom_element_t *elem, void *ctxt);
+
+struct select_info {
+    struct pcdoc_selector  *sel;
+    select_cb               cb;
+    void                   *ctxt;
+    int                     r;
+};
+
+static int
+select_visit(purc_document_t doc, void *node, void *ctxt)
+{
+    UNUSED_PARAM(doc);
+
+    struct select_info *info = ctxt;
+    if (!pcdoc_selector_match(info->sel, node))
+        return 0;
+
+    info->r = info->cb(node, info->ctxt);
+    return info->r;
+}
+
+/* calls `cb` for the elements in the subtree of `scope` (including `scope`)
+   which match `sel`, in the document order */
+static int
+select_elements(purc_document_t doc, pcdoc_element_t scope,
+        struct pcdoc_selector *sel, select_cb cb, void *ctxt)
+{
+    struct select_info info = { sel, cb, ctxt, 0 };
+
+    pcdoc_special_attr which;
+    const char *value;
+    if (pcdoc_selector_subject_key(sel, &which, &value)) {
+        struct pcdoc_travel_info travel_info = {
+            PCDOC_NODE_ELEMENT, 0, &info };
+        if (travel_by_special_attr(doc, scope, which, value,
+                    select_visit, &travel_info))
+            return (info.r > 0) ? 0 : -1;
+        return 0;
+    }
+
+    pcdom_node_t *root = pcdom_interface_node(scope);
+    pcdom_node_t *curr = root;
+    while (curr) {
+        if (curr->type == PCDOM_NODE_TYPE_ELEMENT &&
+                select_visit(doc, curr, &info))
+            return (info.r > 0) ? 0 : -1;
+
+        if (curr->first_child) {
+            curr = curr->first_child;
+            continue;
+        }
+
+        while (curr != root && curr->next == NULL)
+            curr = curr->parent;
+
+        if (curr == root)
+            break;
+        curr = curr->next;
+    }
+
+    return 0;
+}
+
+static int
+found_first(pcdom_element_t *elem, void *ctxt)
+{
+    *(pcdom_element_t **)ctxt = elem;
+    return 1;
+}
+
+static int
+append_elem(pcdom_element_t *elem, void *ctxt)
+{
+    if (pcutils_arrlist_append((struct pcutils_arrlist *)ctxt, elem)) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+
+    return 0;
+}
+
+static pcdoc_element_t
+find_elem(purc_document_t doc, pcdoc_element_t scope, const char *selector)
+{
+    struct pcdoc_selector *sel = get_selector(doc, selector);
+    if (sel == NULL)
+        return NULL;
+
+    pcdom_element_t *found = NULL;
+    select_elements(doc, scope, sel, found_first, &found);
+    return (pcdoc_element_t)found;
+}
+
+static int
+elem_coll_select(purc_document_t doc, pcdoc_elem_coll_t coll,
+        pcdoc_element_t scope, const char *selector)
+{
+    struct pcdoc_selector *sel = get_selector(doc, selector);
+    if (sel == NULL)
+        return -1;
+
+    return select_elements(doc, scope, sel, append_elem, coll->elems);
+}
+
+static int
+elem_coll_filter(purc_document_t doc, pcdoc_elem_coll_t dst_coll,
+        pcdoc_elem_coll_t src_coll, const char *selector)
+{
+    struct pcdoc_selector *sel = get_selector(doc, selector);
+    if (sel == NULL)
+        return -1;
+
+    size_t n = pcutils_arrlist_length(src_coll->elems);
+    for (size_t i = 0; i < n; i++) {
+        pcdom_element_t *elem = pcutils_arrlist_get_idx(src_coll->elems, i);
+        if (pcdoc_selector_match(sel, elem) &&
+                append_elem(elem, dst_coll->elems))
+            return -1;
+    }
+
+    return 0;
+}
+
 static int serialize(purc_document_t doc, pcdoc_node node,
             unsigned opts, purc_rwstream_t stm)
 {
@@ -670,10 +1949,14 @@ static int serialize(purc_document_t doc, pcdoc_node node,
 struct purc_document_ops _pcdoc_html_ops = {
     .create = create,
     .destroy = destroy,
+    .load_begin = load_begin,
+    .load_feed = load_feed,
+    .load_end = load_end,
     .operate_element = operate_element,
     .new_text_content = new_text_content,
     .new_data_content = NULL,
     .new_content = new_content,
+    .new_content_from_template = new_content_from_template,
     .set_attribute = set_attribute,
     .special_elem = special_elem,
     .get_parent = get_parent,
@@ -684,8 +1967,10 @@ struct purc_document_ops _pcdoc_html_ops = {
     .get_text = get_text,
     .get_data = NULL,
     .travel = travel,
+    .travel_by_special_attr = travel_by_special_attr,
     .serialize = serialize,
-    .elem_coll_select = NULL,
-    .elem_coll_filter = NULL,
+    .find_elem = find_elem,
+    .elem_coll_select = elem_coll_select,
+    .elem_coll_filter = elem_coll_filter,
 };
 
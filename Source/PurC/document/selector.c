@@ -0,0 +1,1363 @@
+/**
+ * @file selector.c
+ * @date 2022/10/18
+ * @brief The implementation of CSS selectors (Level 3) for eDOM.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "purc-errors.h"
+
+#include "private/selector.h"
+#include "private/dom.h"
+#include "private/errors.h"
+#include "private/debug.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* the simple selectors; sorted by the cost to test them */
+enum sel_op {
+    SEL_TAG = 0,
+    SEL_ID,
+    SEL_CLASS,
+    SEL_ATTR_EXISTS,
+    SEL_ATTR_EQUAL,         /* [a=v] */
+    SEL_ATTR_INCLUDES,      /* [a~=v] */
+    SEL_ATTR_DASH,          /* [a|=v] */
+    SEL_ATTR_PREFIX,        /* [a^=v] */
+    SEL_ATTR_SUFFIX,        /* [a$=v] */
+    SEL_ATTR_SUBSTR,        /* [a*=v] */
+    SEL_ANY,                /* only used for :not(*) */
+    SEL_ROOT,
+    SEL_EMPTY,
+    SEL_LINK,
+    SEL_CHECKED,
+    SEL_ENABLED,
+    SEL_DISABLED,
+    SEL_NTH_CHILD,
+    SEL_NTH_LAST_CHILD,
+    SEL_NTH_OF_TYPE,
+    SEL_NTH_LAST_OF_TYPE,
+    SEL_ONLY_CHILD,
+    SEL_ONLY_OF_TYPE,
+    SEL_LANG,
+    /* the dynamic pseudo-classes and the pseudo-elements */
+    SEL_NEVER,
+};
+
+enum sel_combinator {
+    COMB_NONE = 0,
+    COMB_DESCENDANT,        /* A B */
+    COMB_CHILD,             /* A > B */
+    COMB_ADJACENT,          /* A + B */
+    COMB_SIBLING,           /* A ~ B */
+};
+
+struct sel_simple {
+    uint8_t             op;
+    uint8_t             negated;
+    uint8_t             icase;
+
+    /* the tag or attribute name in lowercase, and its identifier
+       in the bound document; 0 if not resolved */
+    char               *name;
+    size_t              name_len;
+    uintptr_t           id;
+
+    /* the id, the class, the attribute value, or the language */
+    char               *value;
+    size_t              value_len;
+
+    /* for :nth-*(an+b) */
+    int                 a, b;
+};
+
+struct sel_compound {
+    /* the relation to the next compound, which is on the left */
+    enum sel_combinator comb;
+
+    size_t              first;
+    size_t              nr;
+};
+
+struct sel_complex {
+    /* compounds[first] is the subject */
+    size_t              first;
+    size_t              nr;
+};
+
+struct pcdoc_selector {
+    struct sel_simple  *simples;
+    size_t              nr_simples;
+    size_t              sz_simples;
+
+    struct sel_compound *compounds;
+    size_t              nr_compounds;
+    size_t              sz_compounds;
+
+    struct sel_complex *complexes;
+    size_t              nr_complexes;
+    size_t              sz_complexes;
+
+    pcdom_document_t   *bound;
+};
+
+/* a growing buffer for the identifiers and the strings being parsed */
+struct sbuf {
+    char               *s;
+    size_t              len;
+    size_t              sz;
+};
+
+struct parser {
+    const char         *p;
+    struct pcdoc_selector *sel;
+    int                 err;
+};
+
+#define GROW_ARRAY(arr, nr, sz)                                         \
+    ((nr) < (sz) ? 0 : grow_array((void **)&(arr), &(sz), sizeof(*(arr))))
+
+static int
+grow_array(void **arr, size_t *sz, size_t unit)
+{
+    size_t new_sz = *sz ? *sz * 2 : 4;
+    void *p = realloc(*arr, new_sz * unit);
+    if (p == NULL)
+        return -1;
+
+    *arr = p;
+    *sz = new_sz;
+    return 0;
+}
+
+static int
+sbuf_append(struct sbuf *buf, const char *s, size_t len)
+{
+    if (buf->len + len + 1 > buf->sz) {
+        size_t sz = buf->sz ? buf->sz : 32;
+        while (sz < buf->len + len + 1)
+            sz *= 2;
+
+        char *p = realloc(buf->s, sz);
+        if (p == NULL)
+            return -1;
+        buf->s = p;
+        buf->sz = sz;
+    }
+
+    memcpy(buf->s + buf->len, s, len);
+    buf->len += len;
+    buf->s[buf->len] = 0;
+    return 0;
+}
+
+static int
+sbuf_append_uchar(struct sbuf *buf, uint32_t uc)
+{
+    char utf8[4];
+    size_t len;
+
+    if (uc == 0 || uc > 0x10FFFF || (uc >= 0xD800 && uc <= 0xDFFF))
+        uc = 0xFFFD;
+
+    if (uc < 0x80) {
+        utf8[0] = (char)uc;
+        len = 1;
+    }
+    else if (uc < 0x800) {
+        utf8[0] = (char)(0xC0 | (uc >> 6));
+        utf8[1] = (char)(0x80 | (uc & 0x3F));
+        len = 2;
+    }
+    else if (uc < 0x10000) {
+        utf8[0] = (char)(0xE0 | (uc >> 12));
+        utf8[1] = (char)(0x80 | ((uc >> 6) & 0x3F));
+        utf8[2] = (char)(0x80 | (uc & 0x3F));
+        len = 3;
+    }
+    else {
+        utf8[0] = (char)(0xF0 | (uc >> 18));
+        utf8[1] = (char)(0x80 | ((uc >> 12) & 0x3F));
+        utf8[2] = (char)(0x80 | ((uc >> 6) & 0x3F));
+        utf8[3] = (char)(0x80 | (uc & 0x3F));
+        len = 4;
+    }
+
+    return sbuf_append(buf, utf8, len);
+}
+
+static inline bool
+is_ws(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+static inline bool
+is_hex(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') ||
+        (c >= 'A' && c <= 'F');
+}
+
+static inline bool
+is_name_start(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' ||
+        (unsigned char)c >= 0x80;
+}
+
+static inline bool
+is_name_char(char c)
+{
+    return is_name_start(c) || (c >= '0' && c <= '9') || c == '-';
+}
+
+static inline char
+to_lower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (char)(c + 0x20) : c;
+}
+
+static inline void
+skip_ws(struct parser *ps)
+{
+    while (is_ws(*ps->p))
+        ps->p++;
+}
+
+static bool
+ci_equal(const char *a, const char *b, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (to_lower(a[i]) != to_lower(b[i]))
+            return false;
+    }
+    return true;
+}
+
+static bool
+keyword_is(const char *s, size_t len, const char *keyword)
+{
+    return strlen(keyword) == len && ci_equal(s, keyword, len);
+}
+
+/* consumes an escape sequence after the backslash */
+static int
+parse_escape(struct parser *ps, struct sbuf *buf)
+{
+    const char *p = ps->p;
+
+    if (*p == 0 || *p == '\n' || *p == '\r' || *p == '\f')
+        return -1;
+
+    if (is_hex(*p)) {
+        uint32_t uc = 0;
+        for (int i = 0; i < 6 && is_hex(*p); i++, p++) {
+            uc = uc * 16 + ((*p <= '9') ? (uint32_t)(*p - '0') :
+                    (uint32_t)(to_lower(*p) - 'a' + 10));
+        }
+        if (is_ws(*p))
+            p++;
+
+        ps->p = p;
+        return sbuf_append_uchar(buf, uc);
+    }
+
+    ps->p = p + 1;
+    return sbuf_append(buf, p, 1);
+}
+
+/* parses a name (`hash` is true) or an identifier */
+static int
+parse_name(struct parser *ps, struct sbuf *buf, bool hash, bool lower)
+{
+    const char *p = ps->p;
+
+    buf->len = 0;
+    if (!hash) {
+        const char *q = p;
+        if (*q == '-')
+            q++;
+        if (!(is_name_start(*q) || *q == '-' || *q == '\\'))
+            return -1;
+    }
+
+    while (*ps->p) {
+        char c = *ps->p;
+        if (c == '\\') {
+            ps->p++;
+            if (parse_escape(ps, buf))
+                return -1;
+        }
+        else if (is_name_char(c)) {
+            if (lower)
+                c = to_lower(c);
+            if (sbuf_append(buf, &c, 1))
+                return -1;
+            ps->p++;
+        }
+        else {
+            break;
+        }
+    }
+
+    return buf->len > 0 ? 0 : -1;
+}
+
+static int
+parse_string(struct parser *ps, struct sbuf *buf)
+{
+    char quote = *ps->p++;
+
+    buf->len = 0;
+    if (sbuf_append(buf, "", 0))
+        return -1;
+
+    while (*ps->p != quote) {
+        char c = *ps->p;
+        if (c == 0 || c == '\n' || c == '\r' || c == '\f')
+            return -1;
+
+        if (c == '\\') {
+            ps->p++;
+            /* an escaped newline is nothing */
+            if (*ps->p == '\n') {
+                ps->p++;
+                continue;
+            }
+            if (parse_escape(ps, buf))
+                return -1;
+        }
+        else {
+            if (sbuf_append(buf, &c, 1))
+                return -1;
+            ps->p++;
+        }
+    }
+
+    ps->p++;
+    return 0;
+}
+
+static struct sel_simple *
+add_simple(struct parser *ps, enum sel_op op)
+{
+    struct pcdoc_selector *sel = ps->sel;
+    if (GROW_ARRAY(sel->simples, sel->nr_simples, sel->sz_simples)) {
+        ps->err = PURC_ERROR_OUT_OF_MEMORY;
+        return NULL;
+    }
+
+    struct sel_simple *simple = sel->simples + sel->nr_simples++;
+    memset(simple, 0, sizeof(*simple));
+    simple->op = op;
+    return simple;
+}
+
+static int
+take_string(struct parser *ps, struct sbuf *buf, char **s, size_t *len)
+{
+    *s = malloc(buf->len + 1);
+    if (*s == NULL) {
+        ps->err = PURC_ERROR_OUT_OF_MEMORY;
+        return -1;
+    }
+
+    memcpy(*s, buf->s ? buf->s : "", buf->len);
+    (*s)[buf->len] = 0;
+    *len = buf->len;
+    return 0;
+}
+
+/* an+b; see https://www.w3.org/TR/css-syntax-3/#anb-microsyntax */
+static int
+parse_nth(struct parser *ps, int *a, int *b)
+{
+    const char *p = ps->p;
+    const char *start;
+
+    while (is_ws(*p))
+        p++;
+
+    start = p;
+    while (is_name_char(*p))
+        p++;
+    if (keyword_is(start, p - start, "odd")) {
+        *a = 2;
+        *b = 1;
+        goto done;
+    }
+    else if (keyword_is(start, p - start, "even")) {
+        *a = 2;
+        *b = 0;
+        goto done;
+    }
+
+    p = start;
+    int sign = 1;
+    if (*p == '+' || *p == '-') {
+        sign = (*p == '-') ? -1 : 1;
+        p++;
+    }
+
+    bool has_digits = false;
+    long n = 0;
+    while (*p >= '0' && *p <= '9') {
+        n = n * 10 + (*p - '0');
+        if (n > 0xFFFFFF)
+            return -1;
+        has_digits = true;
+        p++;
+    }
+
+    if (*p == 'n' || *p == 'N') {
+        *a = sign * (has_digits ? (int)n : 1);
+        p++;
+
+        while (is_ws(*p))
+            p++;
+
+        *b = 0;
+        if (*p == '+' || *p == '-') {
+            sign = (*p == '-') ? -1 : 1;
+            p++;
+            while (is_ws(*p))
+                p++;
+
+            if (!(*p >= '0' && *p <= '9'))
+                return -1;
+
+            n = 0;
+            while (*p >= '0' && *p <= '9') {
+                n = n * 10 + (*p - '0');
+                if (n > 0xFFFFFF)
+                    return -1;
+                p++;
+            }
+            *b = sign * (int)n;
+        }
+    }
+    else if (has_digits) {
+        *a = 0;
+        *b = sign * (int)n;
+    }
+    else {
+        return -1;
+    }
+
+done:
+    while (is_ws(*p))
+        p++;
+    if (*p != ')')
+        return -1;
+
+    ps->p = p + 1;
+    return 0;
+}
+
+static int
+parse_attribute(struct parser *ps, struct sbuf *buf, bool negated)
+{
+    struct sel_simple *simple;
+
+    /* skip '[' */
+    ps->p++;
+    skip_ws(ps);
+    if (parse_name(ps, buf, false, true))
+        return -1;
+    skip_ws(ps);
+
+    enum sel_op op;
+    switch (*ps->p) {
+    case ']':
+        op = SEL_ATTR_EXISTS;
+        break;
+    case '=':
+        op = SEL_ATTR_EQUAL;
+        break;
+    case '~':
+        op = SEL_ATTR_INCLUDES;
+        break;
+    case '|':
+        op = SEL_ATTR_DASH;
+        break;
+    case '^':
+        op = SEL_ATTR_PREFIX;
+        break;
+    case '$':
+        op = SEL_ATTR_SUFFIX;
+        break;
+    case '*':
+        op = SEL_ATTR_SUBSTR;
+        break;
+    default:
+        return -1;
+    }
+
+    simple = add_simple(ps, op);
+    if (simple == NULL)
+        return -1;
+    simple->negated = negated;
+    if (take_string(ps, buf, &simple->name, &simple->name_len))
+        return -1;
+
+    if (op == SEL_ATTR_EXISTS) {
+        ps->p++;
+        return 0;
+    }
+
+    if (op != SEL_ATTR_EQUAL) {
+        ps->p++;
+        if (*ps->p != '=')
+            return -1;
+    }
+    ps->p++;
+    skip_ws(ps);
+
+    if (*ps->p == '"' || *ps->p == '\'') {
+        if (parse_string(ps, buf))
+            return -1;
+    }
+    else if (parse_name(ps, buf, false, false)) {
+        return -1;
+    }
+
+    if (take_string(ps, buf, &simple->value, &simple->value_len))
+        return -1;
+
+    skip_ws(ps);
+    /* the case-insensitive flag from Selectors Level 4 */
+    if (*ps->p == 'i' || *ps->p == 'I') {
+        simple->icase = 1;
+        ps->p++;
+        skip_ws(ps);
+    }
+    else if (*ps->p == 's' || *ps->p == 'S') {
+        ps->p++;
+        skip_ws(ps);
+    }
+
+    if (*ps->p != ']')
+        return -1;
+    ps->p++;
+    return 0;
+}
+
+static const struct pseudo_class {
+    const char     *name;
+    enum sel_op     op;
+    int             a, b;
+} pseudo_classes[] = {
+    { "root",               SEL_ROOT,               0, 0 },
+    { "empty",              SEL_EMPTY,              0, 0 },
+    { "link",               SEL_LINK,               0, 0 },
+    { "checked",            SEL_CHECKED,            0, 0 },
+    { "enabled",            SEL_ENABLED,            0, 0 },
+    { "disabled",           SEL_DISABLED,           0, 0 },
+    { "first-child",        SEL_NTH_CHILD,          0, 1 },
+    { "last-child",         SEL_NTH_LAST_CHILD,     0, 1 },
+    { "first-of-type",      SEL_NTH_OF_TYPE,        0, 1 },
+    { "last-of-type",       SEL_NTH_LAST_OF_TYPE,   0, 1 },
+    { "only-child",         SEL_ONLY_CHILD,         0, 0 },
+    { "only-of-type",       SEL_ONLY_OF_TYPE,       0, 0 },
+    /* the states of the user agent, which a document here never has */
+    { "visited",            SEL_NEVER,              0, 0 },
+    { "hover",              SEL_NEVER,              0, 0 },
+    { "active",             SEL_NEVER,              0, 0 },
+    { "focus",              SEL_NEVER,              0, 0 },
+    { "target",             SEL_NEVER,              0, 0 },
+    { "indeterminate",      SEL_NEVER,              0, 0 },
+};
+
+static const struct pseudo_func {
+    const char     *name;
+    enum sel_op     op;
+} pseudo_funcs[] = {
+    { "nth-child",          SEL_NTH_CHILD },
+    { "nth-last-child",     SEL_NTH_LAST_CHILD },
+    { "nth-of-type",        SEL_NTH_OF_TYPE },
+    { "nth-last-of-type",   SEL_NTH_LAST_OF_TYPE },
+    { "lang",               SEL_LANG },
+};
+
+/* the pseudo-elements which can be written with a single colon */
+static const char *legacy_pseudo_elements[] = {
+    "before", "after", "first-line", "first-letter",
+};
+
+static int parse_simple(struct parser *ps, struct sbuf *buf, bool negated,
+        bool *pseudo_element);
+
+static int
+parse_pseudo(struct parser *ps, struct sbuf *buf, bool negated,
+        bool *pseudo_element)
+{
+    struct sel_simple *simple;
+
+    /* skip ':' */
+    ps->p++;
+    if (*ps->p == ':') {
+        ps->p++;
+        if (negated || parse_name(ps, buf, false, true))
+            return -1;
+
+        *pseudo_element = true;
+        return add_simple(ps, SEL_NEVER) ? 0 : -1;
+    }
+
+    if (parse_name(ps, buf, false, true))
+        return -1;
+
+    if (*ps->p == '(') {
+        ps->p++;
+
+        if (keyword_is(buf->s, buf->len, "not")) {
+            if (negated)
+                return -1;
+
+            skip_ws(ps);
+            if (parse_simple(ps, buf, true, pseudo_element))
+                return -1;
+            skip_ws(ps);
+            if (*ps->p != ')')
+                return -1;
+            ps->p++;
+            return 0;
+        }
+
+        for (size_t i = 0; i < PCA_TABLESIZE(pseudo_funcs); i++) {
+            if (!keyword_is(buf->s, buf->len, pseudo_funcs[i].name))
+                continue;
+
+            simple = add_simple(ps, pseudo_funcs[i].op);
+            if (simple == NULL)
+                return -1;
+            simple->negated = negated;
+
+            if (pseudo_funcs[i].op == SEL_LANG) {
+                skip_ws(ps);
+                if (parse_name(ps, buf, false, true))
+                    return -1;
+                if (take_string(ps, buf, &simple->value, &simple->value_len))
+                    return -1;
+                skip_ws(ps);
+                if (*ps->p != ')')
+                    return -1;
+                ps->p++;
+                return 0;
+            }
+
+            return parse_nth(ps, &simple->a, &simple->b);
+        }
+
+        return -1;
+    }
+
+    for (size_t i = 0; i < PCA_TABLESIZE(pseudo_classes); i++) {
+        if (keyword_is(buf->s, buf->len, pseudo_classes[i].name)) {
+            simple = add_simple(ps, pseudo_classes[i].op);
+            if (simple == NULL)
+                return -1;
+            simple->negated = negated;
+            simple->a = pseudo_classes[i].a;
+            simple->b = pseudo_classes[i].b;
+            return 0;
+        }
+    }
+
+    for (size_t i = 0; i < PCA_TABLESIZE(legacy_pseudo_elements); i++) {
+        if (keyword_is(buf->s, buf->len, legacy_pseudo_elements[i])) {
+            if (negated)
+                return -1;
+            *pseudo_element = true;
+            return add_simple(ps, SEL_NEVER) ? 0 : -1;
+        }
+    }
+
+    return -1;
+}
+
+/* parses a simple selector other than the type selector */
+static int
+parse_simple(struct parser *ps, struct sbuf *buf, bool negated,
+        bool *pseudo_element)
+{
+    struct sel_simple *simple;
+
+    switch (*ps->p) {
+    case '#':
+    case '.':
+    {
+        enum sel_op op = (*ps->p == '#') ? SEL_ID : SEL_CLASS;
+        ps->p++;
+        if (parse_name(ps, buf, op == SEL_ID, false))
+            return -1;
+        simple = add_simple(ps, op);
+        if (simple == NULL)
+            return -1;
+        simple->negated = negated;
+        return take_string(ps, buf, &simple->value, &simple->value_len);
+    }
+
+    case '[':
+        return parse_attribute(ps, buf, negated);
+
+    case ':':
+        return parse_pseudo(ps, buf, negated, pseudo_element);
+
+    case '*':
+        if (!negated)
+            return -1;
+        ps->p++;
+        simple = add_simple(ps, SEL_ANY);
+        if (simple == NULL)
+            return -1;
+        simple->negated = 1;
+        return 0;
+
+    default:
+        if (!negated || parse_name(ps, buf, false, true))
+            return -1;
+        simple = add_simple(ps, SEL_TAG);
+        if (simple == NULL)
+            return -1;
+        simple->negated = 1;
+        return take_string(ps, buf, &simple->name, &simple->name_len);
+    }
+}
+
+static int
+comp_simple(const void *v1, const void *v2)
+{
+    const struct sel_simple *a = v1;
+    const struct sel_simple *b = v2;
+    return (int)a->op - (int)b->op;
+}
+
+static int
+parse_compound(struct parser *ps, struct sbuf *buf, enum sel_combinator comb,
+        bool *pseudo_element)
+{
+    struct pcdoc_selector *sel = ps->sel;
+    size_t first = sel->nr_simples;
+    bool empty = true;
+
+    if (*ps->p == '*') {
+        ps->p++;
+        empty = false;
+    }
+    else if (*ps->p == '|') {
+        /* namespaces are not supported */
+        return -1;
+    }
+    else if (is_name_start(*ps->p) || *ps->p == '-' || *ps->p == '\\') {
+        if (parse_name(ps, buf, false, true))
+            return -1;
+
+        struct sel_simple *simple = add_simple(ps, SEL_TAG);
+        if (simple == NULL ||
+                take_string(ps, buf, &simple->name, &simple->name_len))
+            return -1;
+        empty = false;
+    }
+    if (*ps->p == '|')
+        return -1;
+
+    while (!*pseudo_element &&
+            (*ps->p == '#' || *ps->p == '.' || *ps->p == '[' ||
+             *ps->p == ':')) {
+        if (parse_simple(ps, buf, false, pseudo_element))
+            return -1;
+        empty = false;
+    }
+
+    if (empty)
+        return -1;
+
+    if (GROW_ARRAY(sel->compounds, sel->nr_compounds, sel->sz_compounds)) {
+        ps->err = PURC_ERROR_OUT_OF_MEMORY;
+        return -1;
+    }
+
+    struct sel_compound *compound = sel->compounds + sel->nr_compounds++;
+    compound->comb = comb;
+    compound->first = first;
+    compound->nr = sel->nr_simples - first;
+
+    /* test the cheap ones first */
+    if (compound->nr > 1) {
+        qsort(sel->simples + first, compound->nr, sizeof(*sel->simples),
+                comp_simple);
+    }
+
+    return 0;
+}
+
+static int
+parse_complex(struct parser *ps, struct sbuf *buf)
+{
+    struct pcdoc_selector *sel = ps->sel;
+    size_t first = sel->nr_compounds;
+    enum sel_combinator comb = COMB_NONE;
+    bool pseudo_element = false;
+
+    skip_ws(ps);
+    while (1) {
+        if (parse_compound(ps, buf, comb, &pseudo_element))
+            return -1;
+
+        bool ws = is_ws(*ps->p);
+        skip_ws(ps);
+
+        char c = *ps->p;
+        if (c == 0 || c == ',')
+            break;
+
+        if (pseudo_element)
+            return -1;
+
+        if (c == '>' || c == '+' || c == '~') {
+            comb = (c == '>') ? COMB_CHILD :
+                ((c == '+') ? COMB_ADJACENT : COMB_SIBLING);
+            ps->p++;
+            skip_ws(ps);
+        }
+        else if (ws) {
+            comb = COMB_DESCENDANT;
+        }
+        else {
+            return -1;
+        }
+    }
+
+    /*
+     * Reverse the compounds for matching from the right to the left.
+     * A compound keeps the combinator between it and the compound on its
+     * left, which is the next one after reversing.
+     */
+    struct sel_compound *compounds = sel->compounds + first;
+    size_t nr = sel->nr_compounds - first;
+    for (size_t i = 0; i < nr / 2; i++) {
+        struct sel_compound tmp = compounds[i];
+        compounds[i] = compounds[nr - 1 - i];
+        compounds[nr - 1 - i] = tmp;
+    }
+
+    if (GROW_ARRAY(sel->complexes, sel->nr_complexes, sel->sz_complexes)) {
+        ps->err = PURC_ERROR_OUT_OF_MEMORY;
+        return -1;
+    }
+
+    struct sel_complex *complex = sel->complexes + sel->nr_complexes++;
+    complex->first = first;
+    complex->nr = nr;
+    return 0;
+}
+
+void
+pcdoc_selector_delete(struct pcdoc_selector *sel)
+{
+    for (size_t i = 0; i < sel->nr_simples; i++) {
+        free(sel->simples[i].name);
+        free(sel->simples[i].value);
+    }
+
+    free(sel->simples);
+    free(sel->compounds);
+    free(sel->complexes);
+    free(sel);
+}
+
+struct pcdoc_selector *
+pcdoc_selector_new(const char *selector)
+{
+    struct pcdoc_selector *sel = calloc(1, sizeof(*sel));
+    if (sel == NULL) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    struct sbuf buf = { NULL, 0, 0 };
+    struct parser ps = { selector, sel, PURC_ERROR_INVALID_VALUE };
+
+    while (1) {
+        if (parse_complex(&ps, &buf))
+            goto failed;
+
+        if (*ps.p == 0)
+            break;
+
+        /* skip ',' */
+        ps.p++;
+    }
+
+    free(buf.s);
+    return sel;
+
+failed:
+    free(buf.s);
+    pcdoc_selector_delete(sel);
+    purc_set_error(ps.err);
+    return NULL;
+}
+
+void
+pcdoc_selector_bind(struct pcdoc_selector *sel, pcdom_document_t *doc)
+{
+    bool rebind = (sel->bound != doc);
+    sel->bound = doc;
+
+    for (size_t i = 0; i < sel->nr_simples; i++) {
+        struct sel_simple *simple = sel->simples + i;
+        if (simple->name == NULL || (simple->id && !rebind))
+            continue;
+
+        /* NOTE: the names not used by the document yet are resolved again
+           next time, because the document may have changed */
+        if (simple->op == SEL_TAG) {
+            simple->id = pchtml_tag_id_by_name(doc->tags,
+                    (const unsigned char *)simple->name, simple->name_len);
+        }
+        else {
+            const pcdom_attr_data_t *data;
+            data = pcdom_attr_data_by_local_name(doc->attrs,
+                    (const unsigned char *)simple->name, simple->name_len);
+            simple->id = data ? data->attr_id : 0;
+        }
+    }
+}
+
+static inline pcdom_element_t *
+parent_element(pcdom_element_t *elem)
+{
+    pcdom_node_t *parent = elem->node.parent;
+    if (parent && parent->type == PCDOM_NODE_TYPE_ELEMENT)
+        return pcdom_interface_element(parent);
+    return NULL;
+}
+
+static inline pcdom_element_t *
+prev_element(pcdom_element_t *elem)
+{
+    pcdom_node_t *node = elem->node.prev;
+    while (node && node->type != PCDOM_NODE_TYPE_ELEMENT)
+        node = node->prev;
+    return pcdom_interface_element(node);
+}
+
+static pcdom_attr_t *
+find_attr(pcdom_element_t *elem, uintptr_t id)
+{
+    pcdom_attr_t *attr = elem->first_attr;
+    while (attr) {
+        if (attr->node.local_name == id)
+            return attr;
+        attr = attr->next;
+    }
+
+    return NULL;
+}
+
+static const char *
+attr_value(pcdom_attr_t *attr, size_t *len)
+{
+    const unsigned char *value = pcdom_attr_value(attr, len);
+    if (value == NULL) {
+        *len = 0;
+        return "";
+    }
+    return (const char *)value;
+}
+
+static inline bool
+bytes_equal(const char *a, const char *b, size_t len, bool icase)
+{
+    return icase ? ci_equal(a, b, len) : memcmp(a, b, len) == 0;
+}
+
+static bool
+has_token(const char *s, size_t len, const char *token, size_t token_len,
+        bool icase)
+{
+    const char *end = s + len;
+    while (s < end) {
+        while (s < end && is_ws(*s))
+            s++;
+
+        const char *start = s;
+        while (s < end && !is_ws(*s))
+            s++;
+
+        if ((size_t)(s - start) == token_len &&
+                bytes_equal(start, token, token_len, icase))
+            return true;
+    }
+
+    return false;
+}
+
+static bool
+has_substr(const char *s, size_t len, const char *sub, size_t sub_len,
+        bool icase)
+{
+    for (size_t i = 0; i + sub_len <= len; i++) {
+        if (bytes_equal(s + i, sub, sub_len, icase))
+            return true;
+    }
+    return false;
+}
+
+static bool
+match_attr_value(const struct sel_simple *simple, const char *v, size_t len)
+{
+    const char *s = simple->value;
+    size_t n = simple->value_len;
+    bool icase = simple->icase;
+
+    switch (simple->op) {
+    case SEL_ATTR_EQUAL:
+        return len == n && bytes_equal(v, s, n, icase);
+
+    case SEL_ATTR_INCLUDES:
+        if (n == 0 || has_substr(s, n, " ", 1, false))
+            return false;
+        return has_token(v, len, s, n, icase);
+
+    case SEL_ATTR_DASH:
+        return (len == n || (len > n && v[n] == '-')) &&
+            bytes_equal(v, s, n, icase);
+
+    case SEL_ATTR_PREFIX:
+        return n > 0 && len >= n && bytes_equal(v, s, n, icase);
+
+    case SEL_ATTR_SUFFIX:
+        return n > 0 && len >= n && bytes_equal(v + len - n, s, n, icase);
+
+    case SEL_ATTR_SUBSTR:
+        return n > 0 && has_substr(v, len, s, n, icase);
+    }
+
+    return false;
+}
+
+/* the position of the element among its siblings, starting from 1 */
+static long
+element_position(pcdom_element_t *elem, bool from_last, bool of_type)
+{
+    pcdom_node_t *self = pcdom_interface_node(elem);
+    pcdom_node_t *node = from_last ? self->next : self->prev;
+    long pos = 1;
+
+    for (; node; node = from_last ? node->next : node->prev) {
+        if (node->type != PCDOM_NODE_TYPE_ELEMENT)
+            continue;
+
+        if (!of_type || (node->local_name == self->local_name &&
+                    node->ns == self->ns))
+            pos++;
+    }
+
+    return pos;
+}
+
+static inline bool
+nth_match(int a, int b, long pos)
+{
+    if (a == 0)
+        return pos == b;
+
+    long diff = pos - b;
+    return (diff % a) == 0 && (diff / a) >= 0;
+}
+
+static bool
+is_empty(pcdom_element_t *elem)
+{
+    pcdom_node_t *child = elem->node.first_child;
+    for (; child; child = child->next) {
+        if (child->type == PCDOM_NODE_TYPE_ELEMENT)
+            return false;
+
+        if ((child->type == PCDOM_NODE_TYPE_TEXT ||
+                child->type == PCDOM_NODE_TYPE_CDATA_SECTION) &&
+                pcdom_interface_character_data(child)->data.length > 0)
+            return false;
+    }
+
+    return true;
+}
+
+static inline bool
+is_form_control(pcdom_element_t *elem)
+{
+    switch (elem->node.local_name) {
+    case PCHTML_TAG_BUTTON:
+    case PCHTML_TAG_INPUT:
+    case PCHTML_TAG_SELECT:
+    case PCHTML_TAG_TEXTAREA:
+    case PCHTML_TAG_OPTGROUP:
+    case PCHTML_TAG_OPTION:
+    case PCHTML_TAG_FIELDSET:
+        return true;
+    }
+
+    return false;
+}
+
+static bool
+is_checked(pcdom_element_t *elem)
+{
+    if (elem->node.local_name == PCHTML_TAG_INPUT) {
+        pcdom_attr_t *type = find_attr(elem, PCDOM_ATTR_TYPE);
+        if (type == NULL || find_attr(elem, PCDOM_ATTR_CHECKED) == NULL)
+            return false;
+
+        size_t len;
+        const char *v = attr_value(type, &len);
+        return (len == 8 && ci_equal(v, "checkbox", 8)) ||
+            (len == 5 && ci_equal(v, "radio", 5));
+    }
+
+    if (elem->node.local_name == PCHTML_TAG_OPTION) {
+        return pcdom_element_attr_by_name(elem,
+                (const unsigned char *)"selected", 8) != NULL;
+    }
+
+    return false;
+}
+
+static bool
+match_lang(const struct sel_simple *simple, pcdom_element_t *elem)
+{
+    for (; elem; elem = parent_element(elem)) {
+        pcdom_attr_t *attr = pcdom_element_attr_by_name(elem,
+                (const unsigned char *)"lang", 4);
+        if (attr == NULL)
+            continue;
+
+        size_t len;
+        const char *v = attr_value(attr, &len);
+        size_t n = simple->value_len;
+        return (len == n || (len > n && v[n] == '-')) &&
+            ci_equal(v, simple->value, n);
+    }
+
+    return false;
+}
+
+static bool
+match_simple(const struct sel_simple *simple, pcdom_element_t *elem)
+{
+    pcdom_attr_t *attr;
+    const char *v;
+    size_t len;
+
+    switch (simple->op) {
+    case SEL_TAG:
+        return simple->id && elem->node.local_name == simple->id;
+
+    case SEL_ID:
+        if (elem->attr_id == NULL)
+            return false;
+        v = attr_value(elem->attr_id, &len);
+        return len == simple->value_len &&
+            memcmp(v, simple->value, len) == 0;
+
+    case SEL_CLASS:
+        if (elem->attr_class == NULL)
+            return false;
+        v = attr_value(elem->attr_class, &len);
+        return has_token(v, len, simple->value, simple->value_len, false);
+
+    case SEL_ATTR_EXISTS:
+        return simple->id && find_attr(elem, simple->id);
+
+    case SEL_ATTR_EQUAL:
+    case SEL_ATTR_INCLUDES:
+    case SEL_ATTR_DASH:
+    case SEL_ATTR_PREFIX:
+    case SEL_ATTR_SUFFIX:
+    case SEL_ATTR_SUBSTR:
+        attr = simple->id ? find_attr(elem, simple->id) : NULL;
+        if (attr == NULL)
+            return false;
+        v = attr_value(attr, &len);
+        return match_attr_value(simple, v, len);
+
+    case SEL_ANY:
+        return true;
+
+    case SEL_ROOT:
+        return elem->node.parent &&
+            elem->node.parent->type == PCDOM_NODE_TYPE_DOCUMENT;
+
+    case SEL_EMPTY:
+        return is_empty(elem);
+
+    case SEL_LINK:
+        return (elem->node.local_name == PCHTML_TAG_A ||
+                elem->node.local_name == PCHTML_TAG_AREA ||
+                elem->node.local_name == PCHTML_TAG_LINK) &&
+            find_attr(elem, PCDOM_ATTR_HREF) != NULL;
+
+    case SEL_CHECKED:
+        return is_checked(elem);
+
+    case SEL_ENABLED:
+        return is_form_control(elem) &&
+            find_attr(elem, PCDOM_ATTR_DISABLED) == NULL;
+
+    case SEL_DISABLED:
+        return is_form_control(elem) &&
+            find_attr(elem, PCDOM_ATTR_DISABLED) != NULL;
+
+    case SEL_NTH_CHILD:
+        return nth_match(simple->a, simple->b,
+                element_position(elem, false, false));
+
+    case SEL_NTH_LAST_CHILD:
+        return nth_match(simple->a, simple->b,
+                element_position(elem, true, false));
+
+    case SEL_NTH_OF_TYPE:
+        return nth_match(simple->a, simple->b,
+                element_position(elem, false, true));
+
+    case SEL_NTH_LAST_OF_TYPE:
+        return nth_match(simple->a, simple->b,
+                element_position(elem, true, true));
+
+    case SEL_ONLY_CHILD:
+        return element_position(elem, false, false) == 1 &&
+            element_position(elem, true, false) == 1;
+
+    case SEL_ONLY_OF_TYPE:
+        return element_position(elem, false, true) == 1 &&
+            element_position(elem, true, true) == 1;
+
+    case SEL_LANG:
+        return match_lang(simple, elem);
+
+    case SEL_NEVER:
+        break;
+    }
+
+    return false;
+}
+
+static inline bool
+match_compound(struct pcdoc_selector *sel,
+        const struct sel_compound *compound, pcdom_element_t *elem)
+{
+    const struct sel_simple *simple = sel->simples + compound->first;
+    for (size_t i = 0; i < compound->nr; i++, simple++) {
+        if (match_simple(simple, elem) == (bool)simple->negated)
+            return false;
+    }
+
+    return true;
+}
+
+/* matches compounds[k] against `elem`, then the ones on its left */
+static bool
+match_from(struct pcdoc_selector *sel, const struct sel_compound *compounds,
+        size_t nr, size_t k, pcdom_element_t *elem)
+{
+    const struct sel_compound *compound = compounds + k;
+    if (!match_compound(sel, compound, elem))
+        return false;
+
+    if (k + 1 == nr)
+        return true;
+
+    pcdom_element_t *other;
+    switch (compound->comb) {
+    case COMB_CHILD:
+        other = parent_element(elem);
+        return other && match_from(sel, compounds, nr, k + 1, other);
+
+    case COMB_DESCENDANT:
+        for (other = parent_element(elem); other;
+                other = parent_element(other)) {
+            if (match_from(sel, compounds, nr, k + 1, other))
+                return true;
+        }
+        break;
+
+    case COMB_ADJACENT:
+        other = prev_element(elem);
+        return other && match_from(sel, compounds, nr, k + 1, other);
+
+    case COMB_SIBLING:
+        for (other = prev_element(elem); other;
+                other = prev_element(other)) {
+            if (match_from(sel, compounds, nr, k + 1, other))
+                return true;
+        }
+        break;
+
+    case COMB_NONE:
+        PC_ASSERT(0);
+        break;
+    }
+
+    return false;
+}
+
+bool
+pcdoc_selector_match(struct pcdoc_selector *sel, pcdom_element_t *elem)
+{
+    PC_ASSERT(sel->bound == elem->node.owner_document);
+
+    for (size_t i = 0; i < sel->nr_complexes; i++) {
+        const struct sel_complex *complex = sel->complexes + i;
+        if (match_from(sel, sel->compounds + complex->first, complex->nr,
+                    0, elem))
+            return true;
+    }
+
+    return false;
+}
+
+bool
+pcdoc_selector_subject_key(struct pcdoc_selector *sel,
+        pcdoc_special_attr *which, const char **value)
+{
+    if (sel->nr_complexes != 1)
+        return false;
+
+    const struct sel_compound *subject;
+    subject = sel->compounds + sel->complexes[0].first;
+
+    /* NOTE: the simples are sorted; an id comes before the classes */
+    const struct sel_simple *simple = sel->simples + subject->first;
+    for (size_t i = 0; i < subject->nr; i++, simple++) {
+        if (simple->negated)
+            continue;
+
+        if (simple->op == SEL_ID || simple->op == SEL_CLASS) {
+            *which = (simple->op == SEL_ID) ? PCDOC_ATTR_ID : PCDOC_ATTR_CLASS;
+            *value = simple->value;
+            return true;
+        }
+    }
+
+    return false;
+}
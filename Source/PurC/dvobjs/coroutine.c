@@ -469,6 +469,21 @@ curator_getter(purc_variant_t root,
     return purc_variant_make_ulongint(cor->curator);
 }
 
+static purc_variant_t
+profile_getter(purc_variant_t root,
+        size_t nr_args, purc_variant_t *argv, bool silently)
+{
+    UNUSED_PARAM(nr_args);
+    UNUSED_PARAM(argv);
+    UNUSED_PARAM(silently);
+
+    pcintr_coroutine_t cor = hvml_ctrl_coroutine(root);
+    if (cor->profiler == NULL)
+        return purc_variant_make_null();
+
+    return pcintr_profiler_make_object(cor->profiler);
+}
+
 purc_variant_t
 purc_dvobj_coroutine_new(pcintr_coroutine_t cor)
 {
@@ -489,6 +504,7 @@ purc_dvobj_coroutine_new(pcintr_coroutine_t cor)
         { "uri",     uri_getter,     NULL },
         { "token",   token_getter,   NULL },
         { "curator", curator_getter, NULL },
+        { "profile", profile_getter, NULL },
     };
 
     retv = purc_dvobj_make_from_methods(method, PCA_TABLESIZE(method));
@@ -27,6 +27,8 @@
 #include "private/instance.h"
 #include "private/errors.h"
 #include "private/dvobjs.h"
+#include "private/variant.h"
+#include "private/atom-buckets.h"
 #include "purc-variant.h"
 #include "helper.h"
 
@@ -133,8 +135,12 @@ purc_dvobj_make_from_methods(const struct purc_dvobj_method *methods,
             goto error;
         }
 
-        if (!purc_variant_object_set_by_static_ckey(ret_var,
-                    methods[i].name, val)) {
+        // NOTE: intern the method names for the lookups by atom in VCM;
+        // copy them, for the names of a dynamic object are unmapped when
+        // the module is unloaded.
+        purc_atom_t atom = purc_atom_from_string_ex(ATOM_BUCKET_DVOBJ,
+                methods[i].name);
+        if (!pcvariant_object_set_by_atom(ret_var, atom, val)) {
             goto error;
         }
 
@@ -39,7 +39,6 @@ struct pcdvobjs_logical_param {
     int result;
 
     purc_variant_t v;
-    purc_variant_t variables;
 };
 
 bool pcdvobjs_wildcard_cmp (const char *str1,
@@ -50,6 +49,21 @@ const char *pcdvobjs_remove_space (char * buffer) WTF_INTERNAL;
 int pcdvobjs_logical_parse(const char *input,
         struct pcdvobjs_logical_param *param) WTF_INTERNAL;
 
+/* A logical expression compiled into a postfix program, which can be
+   evaluated many times against different parameter objects. */
+struct pcdvobjs_logical_prog;
+
+/* Returns NULL if the expression is malformed. */
+struct pcdvobjs_logical_prog *pcdvobjs_logical_compile(
+        const char *input) WTF_INTERNAL;
+
+/* Returns -1 if a variable is not defined in `v`. */
+int pcdvobjs_logical_eval(const struct pcdvobjs_logical_prog *prog,
+        purc_variant_t v, int *result) WTF_INTERNAL;
+
+void pcdvobjs_logical_prog_delete(
+        struct pcdvobjs_logical_prog *prog) WTF_INTERNAL;
+
 #ifdef __cplusplus
 }
 #endif  /* __cplusplus */
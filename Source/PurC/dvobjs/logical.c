@@ -786,6 +786,74 @@ fatal:
     return PURC_VARIANT_INVALID;
 }
 
+/* the compiled expressions are kept for the current instance until
+   there are too many of them */
+#define LDNAME_LOGICAL_PROGS    "logical-programs"
+#define MAX_CACHED_PROGS        64
+
+static void free_prog(void *val)
+{
+    pcdvobjs_logical_prog_delete((struct pcdvobjs_logical_prog *)val);
+}
+
+static void cb_free_progs(void *key, void *local_data)
+{
+    UNUSED_PARAM(key);
+    pcutils_map_destroy((pcutils_map *)local_data);
+}
+
+static struct pcdvobjs_logical_prog *
+get_prog(const char *exp)
+{
+    pcutils_map *progs = NULL;
+
+    if (purc_get_local_data(LDNAME_LOGICAL_PROGS,
+                (uintptr_t *)&progs, NULL) <= 0) {
+        progs = pcutils_map_create(copy_key_string, free_key_string,
+                NULL, free_prog, comp_key_string, false);
+        if (progs == NULL) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return NULL;
+        }
+
+        if (!purc_set_local_data(LDNAME_LOGICAL_PROGS, (uintptr_t)progs,
+                    cb_free_progs)) {
+            pcutils_map_destroy(progs);
+            return NULL;
+        }
+    }
+
+    pcutils_map_entry *entry = pcutils_map_find(progs, exp);
+    if (entry)
+        return entry->val;
+
+    struct pcdvobjs_logical_prog *prog = pcdvobjs_logical_compile(exp);
+    if (prog == NULL)
+        return NULL;
+
+    if (pcutils_map_get_size(progs) >= MAX_CACHED_PROGS)
+        pcutils_map_clear(progs);
+
+    if (pcutils_map_insert(progs, exp, prog)) {
+        pcdvobjs_logical_prog_delete(prog);
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    return prog;
+}
+
+static bool
+eval_prog(const struct pcdvobjs_logical_prog *prog, purc_variant_t v)
+{
+    int result = 0;
+
+    /* a malformed expression or an undefined variable makes false */
+    if (prog == NULL || pcdvobjs_logical_eval(prog, v, &result))
+        return false;
+    return result;
+}
+
 static purc_variant_t
 eval_getter(purc_variant_t root, size_t nr_args, purc_variant_t *argv,
         bool silently)
@@ -803,24 +871,50 @@ eval_getter(purc_variant_t root, size_t nr_args, purc_variant_t *argv,
         goto failed;
     }
 
+    /* evaluate the expression for every object in an array */
+    if (nr_args > 1 && purc_variant_is_array(argv[1])) {
+        size_t sz = purc_variant_array_get_size(argv[1]);
+        for (size_t i = 0; i < sz; i++) {
+            if (!purc_variant_is_object(purc_variant_array_get(argv[1], i))) {
+                pcinst_set_error(PURC_ERROR_WRONG_DATA_TYPE);
+                goto failed;
+            }
+        }
+
+        purc_variant_t results;
+        results = purc_variant_make_array(0, PURC_VARIANT_INVALID);
+        if (results == PURC_VARIANT_INVALID)
+            goto fatal;
+
+        struct pcdvobjs_logical_prog *prog = get_prog(exp);
+        for (size_t i = 0; i < sz; i++) {
+            bool result = eval_prog(prog, purc_variant_array_get(argv[1], i));
+            purc_variant_t v = purc_variant_make_boolean(result);
+            bool ok = purc_variant_array_append(results, v);
+            purc_variant_unref(v);
+            if (!ok) {
+                purc_variant_unref(results);
+                goto fatal;
+            }
+        }
+
+        return results;
+    }
+
     if (nr_args > 1 && !purc_variant_is_object(argv[1])) {
         pcinst_set_error(PURC_ERROR_WRONG_DATA_TYPE);
         goto failed;
     }
 
-    struct pcdvobjs_logical_param myparam = {
-        0,
-        (nr_args > 1) ? argv[1] : PURC_VARIANT_INVALID,
-        PURC_VARIANT_INVALID
-    };
-    pcdvobjs_logical_parse(exp, &myparam);
-
-    return purc_variant_make_boolean(myparam.result);
+    bool result = eval_prog(get_prog(exp),
+            (nr_args > 1) ? argv[1] : PURC_VARIANT_INVALID);
+    return purc_variant_make_boolean(result);
 
 failed:
     if (silently)
         return purc_variant_make_undefined();
 
+fatal:
     return PURC_VARIANT_INVALID;
 }
 
@@ -48,7 +48,7 @@
     static void yyerror(
         YYLTYPE *yylloc,                   // match %define locations
         yyscan_t arg,                      // match %param
-        struct pcdvobjs_logical_param *param, // match %parse-param
+        struct pcdvobjs_logical_prog *prog, // match %parse-param
         const char *errsg
     );
 
@@ -116,61 +116,102 @@
         return (FP_ZERO == fpclassify(d)) ? false : true;
     }
 
-    #define EVAL_FREE(v) do {            \
-    } while (0)
-
-    #define EVAL_SET(_a) do {                          \
-        param->result = eval_boolean(_a);              \
-    } while (0)
-
-    #define EVAL_APPLY_1(_f, _r, _a) do {                            \
-        _r = _f(_a);                                                 \
-    } while (0)
+    enum logical_op {
+        LOGICAL_OP_NUM,
+        LOGICAL_OP_VAR,
+        LOGICAL_OP_NOT,
+        LOGICAL_OP_GE,
+        LOGICAL_OP_LE,
+        LOGICAL_OP_EQ,
+        LOGICAL_OP_NE,
+        LOGICAL_OP_AND,
+        LOGICAL_OP_OR,
+        LOGICAL_OP_GT,
+        LOGICAL_OP_LT,
+    };
+
+    struct logical_instr {
+        enum logical_op op;
+        double          d;      // LOGICAL_OP_NUM
+        char           *name;   // LOGICAL_OP_VAR
+    };
+
+    /* The instructions in the postfix order, i.e., the order of
+       the reductions. */
+    struct pcdvobjs_logical_prog {
+        struct logical_instr   *instrs;
+        size_t                  nr_instrs;
+        size_t                  sz_instrs;
+
+        size_t                  depth;
+        size_t                  max_depth;
+    };
+
+    static int
+    emit(struct pcdvobjs_logical_prog *prog, enum logical_op op, double d,
+            const char *name, size_t len)
+    {
+        if (prog->nr_instrs == prog->sz_instrs) {
+            size_t sz = prog->sz_instrs ? prog->sz_instrs * 2 : 8;
+            struct logical_instr *instrs;
+            instrs = realloc(prog->instrs, sizeof(*instrs) * sz);
+            if (instrs == NULL)
+                return -1;
+            prog->instrs = instrs;
+            prog->sz_instrs = sz;
+        }
+
+        struct logical_instr *instr = prog->instrs + prog->nr_instrs;
+        instr->op = op;
+        instr->d = d;
+        instr->name = NULL;
+        if (name) {
+            instr->name = strndup(name, len);
+            if (instr->name == NULL)
+                return -1;
+        }
+        prog->nr_instrs++;
+
+        if (op == LOGICAL_OP_NUM || op == LOGICAL_OP_VAR) {
+            if (++prog->depth > prog->max_depth)
+                prog->max_depth = prog->depth;
+        }
+        else if (op != LOGICAL_OP_NOT) {
+            prog->depth--;
+        }
+        return 0;
+    }
 
-    #define EVAL_APPLY_2(_f, _r, _a, _b) do {                        \
-        _r = _f(_a, _b);                                             \
+    #define EMIT(_op) do {                                           \
+        if (emit(prog, _op, 0, NULL, 0))                             \
+            YYABORT;                                                 \
     } while (0)
 
-    #define EVAL_INT(_r, _a) do {                                    \
+    #define EMIT_INT(_a) do {                                        \
         char   *ptr = (char*)_a[1];                                  \
         size_t  sz  = _a[0];                                         \
         char c  = ptr[sz];                                           \
         ptr[sz] = '\0';                                              \
         long long ll = atoll(ptr);                                   \
         ptr[sz] = c;                                                 \
-        _r = ll;                                                     \
+        if (emit(prog, LOGICAL_OP_NUM, ll, NULL, 0))                 \
+            YYABORT;                                                 \
     } while (0)
 
-    #define EVAL_NUM(_r, _a) do {                                    \
+    #define EMIT_NUM(_a) do {                                        \
         char   *ptr = (char*)_a[1];                                  \
         size_t  sz  = _a[0];                                         \
         char c  = ptr[sz];                                           \
         ptr[sz] = '\0';                                              \
         double d = atof(ptr);                                        \
         ptr[sz] = c;                                                 \
-        _r = d;                                                      \
+        if (emit(prog, LOGICAL_OP_NUM, d, NULL, 0))                  \
+            YYABORT;                                                 \
     } while (0)
 
-    #define EVAL_VAR(_r, _a) do {                                    \
-        if (!param->variables)                                       \
+    #define EMIT_VAR(_a) do {                                        \
+        if (emit(prog, LOGICAL_OP_VAR, 0, (const char *)_a[1], _a[0])) \
             YYABORT;                                                 \
-        char   *ptr = (char*)_a[1];                                  \
-        size_t  sz  = _a[0];                                         \
-        char c  = ptr[sz];                                           \
-        ptr[sz] = '\0';                                              \
-        purc_variant_t _v;                                           \
-        _v = purc_variant_object_get_by_ckey(param->variables, ptr); \
-        ptr[sz] = c;                                                 \
-        if (_v == PURC_VARIANT_INVALID) {                            \
-            if (!param->v && !purc_variant_is_object(param->v))      \
-                YYABORT;                                             \
-            ptr[sz] = '\0';                                          \
-            _v = purc_variant_object_get_by_ckey(param->v, ptr);     \
-            ptr[sz] = c;                                             \
-            if (_v == PURC_VARIANT_INVALID)                          \
-                YYABORT;                                             \
-        }                                                            \
-        _r = purc_variant_numberify(_v);                             \
     } while (0)
 }
 
@@ -184,12 +225,9 @@
 %verbose
 
 %param { yyscan_t arg }
-%parse-param { struct pcdvobjs_logical_param *param }
+%parse-param { struct pcdvobjs_logical_prog *prog }
 
 %union { uintptr_t  sz_ptr[2]; }
-%union { double v; }
-
-%destructor { EVAL_FREE($$); } <v>
 
 /* declare tokens */
 /*
@@ -211,8 +249,6 @@
 %precedence NEG               /* ! */
 %left GE LE EQ NE '>' '<'     /* relational operators */
 
-%nterm <v> term exp
-
 %% /* The grammar follows. */
 
 
@@ -222,27 +258,27 @@ input:
 ;
 
 statement:
-  exp                { EVAL_SET($1); }
+  exp
 ;
 
 exp:
   term
-| exp GE exp         { EVAL_APPLY_2(ge, $$, $1, $3); }
-| exp LE exp         { EVAL_APPLY_2(le, $$, $1, $3); }
-| exp EQ exp         { EVAL_APPLY_2(eq, $$, $1, $3); }
-| exp NE exp         { EVAL_APPLY_2(ne, $$, $1, $3); }
-| exp AND exp        { EVAL_APPLY_2(and, $$, $1, $3); }
-| exp OR exp         { EVAL_APPLY_2(or, $$, $1, $3); }
-| exp '>' exp        { EVAL_APPLY_2(gt, $$, $1, $3); }
-| exp '<' exp        { EVAL_APPLY_2(lt, $$, $1, $3); }
-| '!' exp %prec NEG  { EVAL_APPLY_1(not, $$, $2); }
+| exp GE exp         { EMIT(LOGICAL_OP_GE); }
+| exp LE exp         { EMIT(LOGICAL_OP_LE); }
+| exp EQ exp         { EMIT(LOGICAL_OP_EQ); }
+| exp NE exp         { EMIT(LOGICAL_OP_NE); }
+| exp AND exp        { EMIT(LOGICAL_OP_AND); }
+| exp OR exp         { EMIT(LOGICAL_OP_OR); }
+| exp '>' exp        { EMIT(LOGICAL_OP_GT); }
+| exp '<' exp        { EMIT(LOGICAL_OP_LT); }
+| '!' exp %prec NEG  { EMIT(LOGICAL_OP_NOT); }
 ;
 
 term:
-  INT                { EVAL_INT($$, $1); }
-| NUM                { EVAL_NUM($$, $1); }
-| VAR                { EVAL_VAR($$, $1); }
-| '(' exp ')'        { $$ = $2; }
+  INT                { EMIT_INT($1); }
+| NUM                { EMIT_NUM($1); }
+| VAR                { EMIT_VAR($1); }
+| '(' exp ')'
 ;
 
 %%
@@ -252,37 +288,156 @@ static void
 yyerror(
     YYLTYPE *yylloc,                   // match %define locations
     yyscan_t arg,                      // match %param
-    struct pcdvobjs_logical_param *param, // match %parse-param
+    struct pcdvobjs_logical_prog *prog, // match %parse-param
     const char *errsg
 )
 {
     // to implement it here
     (void)yylloc;
     (void)arg;
-    (void)param;
+    (void)prog;
     fprintf(stderr, "(%d,%d)->(%d,%d): %s\n",
         yylloc->first_line, yylloc->first_column,
         yylloc->last_line, yylloc->last_column,
         errsg);
 }
 
-int pcdvobjs_logical_parse(const char *input,
-        struct pcdvobjs_logical_param *param)
+void pcdvobjs_logical_prog_delete(struct pcdvobjs_logical_prog *prog)
+{
+    for (size_t i = 0; i < prog->nr_instrs; i++)
+        free(prog->instrs[i].name);
+    free(prog->instrs);
+    free(prog);
+}
+
+struct pcdvobjs_logical_prog *pcdvobjs_logical_compile(const char *input)
 {
+    struct pcdvobjs_logical_prog *prog = calloc(1, sizeof(*prog));
+    if (prog == NULL) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
     yyscan_t arg = {0};
 
     yylex_init(&arg);
     // yyset_in(in, arg);
     // yyset_debug(debug, arg);
-    yyset_extra(param, arg);
+    yyset_extra(prog, arg);
     yy_scan_string(input, arg);
-    int ret =yyparse(arg, param);
+    int ret =yyparse(arg, prog);
     yylex_destroy(arg);
-    if (param->variables) {
-        purc_variant_unref(param->variables);
-        param->variables = NULL;
+
+    if (ret) {
+        pcdvobjs_logical_prog_delete(prog);
+        return NULL;
+    }
+
+    return prog;
+}
+
+static double
+logical_value(purc_variant_t v, const char *name, bool *ok)
+{
+    purc_variant_t val = PURC_VARIANT_INVALID;
+    if (v && purc_variant_is_object(v))
+        val = purc_variant_object_get_by_ckey(v, name);
+
+    if (val == PURC_VARIANT_INVALID) {
+        *ok = false;
+        return 0;
+    }
+
+    return purc_variant_numberify(val);
+}
+
+int pcdvobjs_logical_eval(const struct pcdvobjs_logical_prog *prog,
+        purc_variant_t v, int *result)
+{
+    double buf[16];
+    double *stack = buf;
+    size_t top = 0;
+    bool ok = true;
+
+    if (prog->nr_instrs == 0) {
+        *result = false;
+        return 0;
     }
 
-    return ret ? 1 : 0;
+    if (prog->max_depth > PCA_TABLESIZE(buf)) {
+        stack = malloc(sizeof(double) * prog->max_depth);
+        if (stack == NULL) {
+            purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return -1;
+        }
+    }
+
+    for (size_t i = 0; ok && i < prog->nr_instrs; i++) {
+        const struct logical_instr *instr = prog->instrs + i;
+        double *l = NULL, r = 0;
+        if (instr->op >= LOGICAL_OP_NOT)
+            r = stack[top - 1];
+        if (instr->op > LOGICAL_OP_NOT)
+            l = stack + top - 2;
+
+        switch (instr->op) {
+        case LOGICAL_OP_NUM:
+            stack[top++] = instr->d;
+            break;
+        case LOGICAL_OP_VAR:
+            stack[top++] = logical_value(v, instr->name, &ok);
+            break;
+        case LOGICAL_OP_NOT:
+            stack[top - 1] = not(r);
+            break;
+        case LOGICAL_OP_GE:
+            *l = ge(*l, r);
+            break;
+        case LOGICAL_OP_LE:
+            *l = le(*l, r);
+            break;
+        case LOGICAL_OP_EQ:
+            *l = eq(*l, r);
+            break;
+        case LOGICAL_OP_NE:
+            *l = ne(*l, r);
+            break;
+        case LOGICAL_OP_AND:
+            *l = and(*l, r);
+            break;
+        case LOGICAL_OP_OR:
+            *l = or(*l, r);
+            break;
+        case LOGICAL_OP_GT:
+            *l = gt(*l, r);
+            break;
+        case LOGICAL_OP_LT:
+            *l = lt(*l, r);
+            break;
+        }
+
+        if (instr->op > LOGICAL_OP_NOT)
+            top--;
+    }
+
+    if (ok)
+        *result = eval_boolean(stack[0]);
+
+    if (stack != buf)
+        free(stack);
+    return ok ? 0 : -1;
 }
 
+int pcdvobjs_logical_parse(const char *input,
+        struct pcdvobjs_logical_param *param)
+{
+    struct pcdvobjs_logical_prog *prog = pcdvobjs_logical_compile(input);
+    int ret = 1;
+
+    if (prog) {
+        ret = pcdvobjs_logical_eval(prog, param->v, &param->result) ? 1 : 0;
+        pcdvobjs_logical_prog_delete(prog);
+    }
+
+    return ret;
+}
@@ -32,6 +32,7 @@
 #include "private/dvobjs.h"
 #include "private/atom-buckets.h"
 #include "private/interpreter.h"
+#include "private/rwstream.h"
 
 #include <errno.h>
 
@@ -44,7 +45,7 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 
-#define BUFFER_SIZE                 1024
+#define MAX_LINE_LENGTH             (1024 * 1024 * 16)
 
 #define ENDIAN_PLATFORM             0
 #define ENDIAN_LITTLE               1
@@ -176,6 +177,7 @@ struct pcdvobjs_stream {
     struct purc_broken_down_url *url;
     purc_rwstream_t stm4r;      /* stream for read */
     purc_rwstream_t stm4w;      /* stream for write */
+    struct pcutils_line_reader *lines4r;    /* created by readlines */
     purc_variant_t option;
     purc_variant_t observed;    /* not inc ref */
     uintptr_t monitor4r, monitor4w;
@@ -209,6 +211,11 @@ struct pcdvobjs_stream *dvobjs_stream_create(enum pcdvobjs_stream_type type,
 
 static void native_stream_close(struct pcdvobjs_stream *stream)
 {
+    if (stream->lines4r) {
+        pcutils_line_reader_delete(stream->lines4r);
+        stream->lines4r = NULL;
+    }
+
     if (stream->stm4r) {
         purc_rwstream_destroy(stream->stm4r);
     }
@@ -290,6 +297,23 @@ struct pcdvobjs_stream *get_stream(void *native_entity)
     return (struct pcdvobjs_stream*)native_entity;
 }
 
+/* Gives the bytes read ahead by readlines back to the stream before
+   `rwstream` is used directly. The bytes are kept for readlines if
+   the stream is not seekable. */
+static void sync_line_reader(struct pcdvobjs_stream *stream,
+        purc_rwstream_t rwstream)
+{
+    if (stream->lines4r && rwstream == stream->stm4r &&
+            pcutils_line_reader_sync(stream->lines4r))
+        purc_clr_error();
+}
+
+static ssize_t cb_read_lines4r(void *ctxt, void *buf, size_t count)
+{
+    return pcutils_line_reader_read((struct pcutils_line_reader *)ctxt,
+            buf, count);
+}
+
 static purc_variant_t
 readstruct_getter(void *native_entity, size_t nr_args, purc_variant_t *argv,
                 bool silently)
@@ -334,6 +358,22 @@ readstruct_getter(void *native_entity, size_t nr_args, purc_variant_t *argv,
         goto out;
     }
 
+    sync_line_reader(stream, rwstream);
+    if (stream->lines4r && pcutils_line_reader_buffered(stream->lines4r)) {
+        /* the stream is not seekable: consume the bytes kept by
+           readlines first, as readbytes does */
+        purc_rwstream_t lines_rws;
+        lines_rws = purc_rwstream_new_for_read(stream->lines4r,
+                cb_read_lines4r);
+        if (lines_rws == NULL)
+            goto out;
+
+        purc_variant_t ret = purc_dvobj_read_struct(lines_rws,
+                formats, formats_left, silently);
+        purc_rwstream_destroy(lines_rws);
+        return ret;
+    }
+
     return purc_dvobj_read_struct(rwstream, formats, formats_left, silently);
 
 out:
@@ -404,6 +444,7 @@ writestruct_getter(void *native_entity, size_t nr_args, purc_variant_t *argv,
 failed:
     if (silently) {
         if (bf.bytes) {
+            sync_line_reader(stream, rwstream);
             write_length = purc_rwstream_write(rwstream, bf.bytes, bf.nr_bytes);
             free(bf.bytes);
             bf.bytes = NULL;
@@ -420,49 +461,27 @@ out:
     return PURC_VARIANT_INVALID;
 }
 
-#define LINE_FLAG           "\n"
-static int read_lines(purc_rwstream_t stream, int line_num,
+static int read_lines(struct pcutils_line_reader *reader, int64_t line_num,
         purc_variant_t array)
 {
-    unsigned char buffer[BUFFER_SIZE];
-    ssize_t read_size = 0;
-    size_t length = 0;
-    const char *head = NULL;
-    const char *end = NULL;
-
-    while (line_num) {
-        read_size = purc_rwstream_read(stream, buffer, BUFFER_SIZE);
-        if (read_size < 0)
-            break;
+    const char *line;
+    size_t length;
 
-        end = (const char*)(buffer + read_size);
+    while (line_num > 0) {
+        int ret = pcutils_line_reader_next(reader, &line, &length);
+        if (ret <= 0)           // to the end, or an error
+            break;
 
-        head = pcutils_get_next_token_len((const char*)buffer, read_size,
-                LINE_FLAG, &length);
-        while (head && head < end) {
-            purc_variant_t var = purc_variant_make_string_ex(head, length,
-                    false);
-            if (!var) {
-                return -1;
-            }
-            if (!purc_variant_array_append(array, var)) {
-                purc_variant_unref(var);
-                return -1;
-            }
+        purc_variant_t var = purc_variant_make_string_ex(line, length, false);
+        if (!var) {
+            return -1;
+        }
+        if (!purc_variant_array_append(array, var)) {
             purc_variant_unref(var);
-            line_num --;
-
-            if (line_num == 0)
-                break;
-
-            head = pcutils_get_next_token_len(head + length, end - head - length,
-                LINE_FLAG, &length);
+            return -1;
         }
-        if (read_size < BUFFER_SIZE)           // to the end
-            break;
-
-        if (line_num == 0)
-            break;
+        purc_variant_unref(var);
+        line_num--;
     }
 
     return 0;
@@ -504,8 +523,15 @@ readlines_getter(void *native_entity, size_t nr_args, purc_variant_t *argv,
         goto out;
     }
 
+    if (line_num > 0 && stream->lines4r == NULL) {
+        stream->lines4r = pcutils_line_reader_new(rwstream, MAX_LINE_LENGTH);
+        if (stream->lines4r == NULL) {
+            goto out;
+        }
+    }
+
     if (line_num > 0) {
-        int ret = read_lines(rwstream, line_num, ret_var);
+        int ret = read_lines(stream->lines4r, line_num, ret_var);
         if (ret != 0) {
             goto out;
         }
@@ -578,6 +604,8 @@ writelines_getter(void *native_entity, size_t nr_args, purc_variant_t *argv,
         goto out;
     }
 
+    sync_line_reader(stream, rwstream);
+
     const char *buffer = NULL;
     ssize_t buffer_size = 0;
     if (purc_variant_is_string(data)) {
@@ -653,7 +681,10 @@ readbytes_getter(void *native_entity, size_t nr_args, purc_variant_t *argv,
             goto out;
         }
 
-        size = purc_rwstream_read(rwstream, content, byte_num);
+        if (stream->lines4r)
+            size = pcutils_line_reader_read(stream->lines4r, content, byte_num);
+        else
+            size = purc_rwstream_read(rwstream, content, byte_num);
         if (size > 0) {
             ret_var = purc_variant_make_byte_sequence_reuse_buff(content,
                     size, size);
@@ -718,6 +749,7 @@ writebytes_getter(void *native_entity, size_t nr_args, purc_variant_t *argv,
         bsize = strlen((const char*)buffer) + 1;
     }
     if (buffer && bsize) {
+        sync_line_reader(stream, rwstream);
         ssize_t nr_write = purc_rwstream_write (rwstream, buffer, bsize);
         return purc_variant_make_ulongint(nr_write);
     }
@@ -901,6 +933,7 @@ seek_getter(void *native_entity, size_t nr_args, purc_variant_t *argv,
         whence = SEEK_END;
     }
 
+    sync_line_reader(stream, rwstream);
     off = purc_rwstream_seek(rwstream, byte_num, (int)whence);
     if (off == -1) {
         goto out;
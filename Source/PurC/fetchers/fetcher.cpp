@@ -26,6 +26,7 @@
 
 #include "private/fetcher.h"
 #include "private/instance.h"
+#include "private/trace.h"
 
 #include "fetcher-internal.h"
 
@@ -123,8 +124,13 @@ void pcfetcher_cancel_async(purc_variant_t request)
 
 struct pcfetcher_callback_info *pcfetcher_create_callback_info()
 {
-    return (struct pcfetcher_callback_info*) calloc(1,
-            sizeof(struct pcfetcher_callback_info));
+    struct pcfetcher_callback_info *info = (struct pcfetcher_callback_info*)
+        calloc(1, sizeof(struct pcfetcher_callback_info));
+
+    // the request lasts until its callback info is destroyed
+    if (info)
+        PCTRACE_ASYNC_BEGIN(PCTRACE_CAT_FETCHER, "fetch", info);
+    return info;
 }
 
 void pcfetcher_destroy_callback_info(struct pcfetcher_callback_info *info)
@@ -132,6 +138,8 @@ void pcfetcher_destroy_callback_info(struct pcfetcher_callback_info *info)
     if (!info) {
         return;
     }
+
+    PCTRACE_ASYNC_END(PCTRACE_CAT_FETCHER, "fetch", info);
     if (info->header.mime_type) {
         free(info->header.mime_type);
     }
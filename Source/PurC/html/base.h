@@ -37,6 +37,7 @@
 #include "config.h"
 
 #include "purc-errors.h"
+#include "purc-rwstream.h"
 
 #include "html/def.h"
 #include "html/types.h"
@@ -57,10 +58,39 @@ typedef struct pchtml_html_tokenizer pchtml_html_tokenizer_t;
 typedef unsigned int pchtml_html_tokenizer_opt_t;
 typedef struct pchtml_html_tree pchtml_html_tree_t;
 
+/* the range of the sizes of the chunks read from a stream */
+#define PCHTML_READ_CHUNK_MIN       4096
+#define PCHTML_READ_CHUNK_MAX       65536
+
+/*
+ * The buffer to read a stream for parsing. It starts with
+ * PCHTML_READ_CHUNK_MIN bytes, and is doubled up to PCHTML_READ_CHUNK_MAX
+ * every time a read fills it up, so that a small stream costs a small
+ * buffer while a large one takes fewer trips through the parser.
+ */
+typedef struct pchtml_read_buffer {
+    unsigned char      *data;
+    size_t              size;
+    size_t              last;
+} pchtml_read_buffer_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* returns the number of bytes read into `rb->data`, 0 on EOF,
+   or -1 on failure */
+ssize_t
+pchtml_read_buffer_fill(pchtml_read_buffer_t *rb,
+        purc_rwstream_t stm) WTF_INTERNAL;
+
+static inline void
+pchtml_read_buffer_release(pchtml_read_buffer_t *rb)
+{
+    free(rb->data);
+    rb->data = NULL;
+    rb->size = rb->last = 0;
+}
 
 #ifdef __cplusplus
 }       /* __cplusplus */
@@ -37,12 +37,37 @@
 #include "private/atom-buckets.h"
 #include "private/html.h"
 
+#include "html/base.h"
+
 static int html_init_once(void)
 {
     // initialize others
     return 0;
 }
 
+ssize_t
+pchtml_read_buffer_fill(pchtml_read_buffer_t *rb, purc_rwstream_t stm)
+{
+    if (rb->data == NULL ||
+            (rb->last == rb->size && rb->size < PCHTML_READ_CHUNK_MAX)) {
+        size_t size = rb->data ? rb->size * 2 : PCHTML_READ_CHUNK_MIN;
+        unsigned char *data = realloc(rb->data, size);
+        if (data) {
+            rb->data = data;
+            rb->size = size;
+        }
+        else if (rb->data == NULL) {
+            purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return -1;
+        }
+        /* NOTE: keep going with the old buffer if failed to grow it */
+    }
+
+    ssize_t sz = purc_rwstream_read(stm, rb->data, rb->size);
+    rb->last = (sz > 0) ? (size_t)sz : 0;
+    return sz;
+}
+
 struct pcmodule _module_html = {
     .id              = PURC_HAVE_HTML,
     .module_inited   = 0,
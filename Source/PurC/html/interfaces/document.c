@@ -162,19 +162,16 @@ pchtml_html_document_parse(pchtml_html_document_t *document,
         goto failed;
     }
 
+    pchtml_read_buffer_t rb = { NULL, 0, 0 };
     ssize_t sz;
-    while (1) {
-        char buf[1024];
-        sz = purc_rwstream_read(html, buf, sizeof(buf));
-        if (sz <= 0)
-            break;
-
-        status = pchtml_html_parse_chunk_process(doc->parser,
-                (unsigned char*)buf, sz);
+    while ((sz = pchtml_read_buffer_fill(&rb, html)) > 0) {
+        status = pchtml_html_parse_chunk_process(doc->parser, rb.data, sz);
         if (status != PCHTML_STATUS_OK) {
+            pchtml_read_buffer_release(&rb);
             goto failed;
         }
     }
+    pchtml_read_buffer_release(&rb);
 
     document->opt = opt;
 
@@ -242,19 +239,17 @@ pchtml_html_document_parse_fragment(pchtml_html_document_t *document,
         goto failed;
     }
 
+    pchtml_read_buffer_t rb = { NULL, 0, 0 };
     ssize_t sz;
-    while (1) {
-        char buf[1024];
-        sz = purc_rwstream_read(html, buf, sizeof(buf));
-        if (sz <= 0)
-            break;
-
+    while ((sz = pchtml_read_buffer_fill(&rb, html)) > 0) {
         status = pchtml_html_parse_fragment_chunk_process(parser,
-                (unsigned char*)buf, sz);
+                rb.data, sz);
         if (status != PCHTML_STATUS_OK) {
+            pchtml_read_buffer_release(&rb);
             goto failed;
         }
     }
+    pchtml_read_buffer_release(&rb);
 
     document->opt = opt;
 
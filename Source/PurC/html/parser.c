@@ -159,18 +159,16 @@ pchtml_html_parse(pchtml_html_parser_t *parser,
         return NULL;
     }
 
+    pchtml_read_buffer_t rb = { NULL, 0, 0 };
     ssize_t sz;
-    while (1) {
-        char buf[1024];
-        sz = purc_rwstream_read(html, buf, sizeof(buf));
-        if (sz <= 0)
-            break;
-
-        pchtml_html_parse_chunk_process(parser, (unsigned char*)buf, sz);
+    while ((sz = pchtml_read_buffer_fill(&rb, html)) > 0) {
+        pchtml_html_parse_chunk_process(parser, rb.data, sz);
         if (parser->status != PCHTML_STATUS_OK) {
+            pchtml_read_buffer_release(&rb);
             goto failed;
         }
     }
+    pchtml_read_buffer_release(&rb);
 
     pchtml_html_parse_chunk_end(parser);
     if (parser->status != PCHTML_STATUS_OK) {
@@ -208,19 +206,16 @@ pchtml_html_parse_fragment_by_tag_id(pchtml_html_parser_t *parser,
         return NULL;
     }
 
+    pchtml_read_buffer_t rb = { NULL, 0, 0 };
     ssize_t sz;
-    while (1) {
-        char buf[1024];
-        sz = purc_rwstream_read(html, buf, sizeof(buf));
-        if (sz <= 0)
-            break;
-
-        pchtml_html_parse_fragment_chunk_process(parser,
-                (unsigned char*)buf, sz);
+    while ((sz = pchtml_read_buffer_fill(&rb, html)) > 0) {
+        pchtml_html_parse_fragment_chunk_process(parser, rb.data, sz);
         if (parser->status != PCHTML_STATUS_OK) {
+            pchtml_read_buffer_release(&rb);
             return NULL;
         }
     }
+    pchtml_read_buffer_release(&rb);
 
     return pchtml_html_parse_fragment_chunk_end(parser);
 }
@@ -0,0 +1,126 @@
+/**
+ * @file scan.h
+ * @date 2022/10/18
+ * @brief The scanners to skip the ordinary characters in bulk.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PCHTML_HTML_TOKENIZER_SCAN_H
+#define PCHTML_HTML_TOKENIZER_SCAN_H
+
+#include "config.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if (CPU(X86_64) || CPU(X86)) && defined(__SSE2__) && COMPILER(GCC_COMPATIBLE)
+#include <emmintrin.h>
+#define HAVE_HTML_SCAN_SSE2     1
+#elif CPU(ARM64) && defined(__ARM_NEON) && COMPILER(GCC_COMPATIBLE)
+#include <arm_neon.h>
+#define HAVE_HTML_SCAN_NEON     1
+#endif
+
+#define PCHTML_SCAN_ONES        0x0101010101010101ULL
+#define PCHTML_SCAN_HIGHS       0x8080808080808080ULL
+
+/* non-zero if any byte of `w` equals to `c` */
+#define PCHTML_SCAN_HAS_BYTE(w, c)                                      \
+    ((((w) ^ ((c) * PCHTML_SCAN_ONES)) - PCHTML_SCAN_ONES) &            \
+        ~((w) ^ ((c) * PCHTML_SCAN_ONES)) & PCHTML_SCAN_HIGHS)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Returns the first byte in [data, end) which is one of c0, c1, c2, and c3,
+ * or `end` if there is none. The tokenizer states call it to skip the runs
+ * of characters which do not change the state, instead of switching on
+ * every byte. Pass a character more than once if less than four are needed.
+ */
+static inline const unsigned char *
+pchtml_html_tokenizer_scan(const unsigned char *data, const unsigned char *end,
+        unsigned char c0, unsigned char c1, unsigned char c2, unsigned char c3)
+{
+#if HAVE(HTML_SCAN_SSE2)
+    const __m128i v0 = _mm_set1_epi8((char)c0);
+    const __m128i v1 = _mm_set1_epi8((char)c1);
+    const __m128i v2 = _mm_set1_epi8((char)c2);
+    const __m128i v3 = _mm_set1_epi8((char)c3);
+
+    while (end - data >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)data);
+        __m128i hits = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, v0),
+                    _mm_cmpeq_epi8(chunk, v1)),
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, v2),
+                    _mm_cmpeq_epi8(chunk, v3)));
+
+        int mask = _mm_movemask_epi8(hits);
+        if (mask)
+            return data + __builtin_ctz(mask);
+        data += 16;
+    }
+#elif HAVE(HTML_SCAN_NEON)
+    const uint8x16_t v0 = vdupq_n_u8(c0);
+    const uint8x16_t v1 = vdupq_n_u8(c1);
+    const uint8x16_t v2 = vdupq_n_u8(c2);
+    const uint8x16_t v3 = vdupq_n_u8(c3);
+
+    while (end - data >= 16) {
+        uint8x16_t chunk = vld1q_u8(data);
+        uint8x16_t hits = vorrq_u8(
+                vorrq_u8(vceqq_u8(chunk, v0), vceqq_u8(chunk, v1)),
+                vorrq_u8(vceqq_u8(chunk, v2), vceqq_u8(chunk, v3)));
+
+        /* narrow every byte to a nibble to get a 64-bit mask */
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(
+                    vshrn_n_u16(vreinterpretq_u16_u8(hits), 4)), 0);
+        if (mask)
+            return data + (__builtin_ctzll(mask) >> 2);
+        data += 16;
+    }
+#else
+    /* test eight bytes a time; the hit is located by the loop below */
+    while (end - data >= 8) {
+        uint64_t w;
+        memcpy(&w, data, sizeof(w));
+
+        if (PCHTML_SCAN_HAS_BYTE(w, c0) | PCHTML_SCAN_HAS_BYTE(w, c1) |
+                PCHTML_SCAN_HAS_BYTE(w, c2) | PCHTML_SCAN_HAS_BYTE(w, c3))
+            break;
+        data += 8;
+    }
+#endif
+
+    while (data < end && *data != c0 && *data != c1 &&
+            *data != c2 && *data != c3) {
+        data++;
+    }
+
+    return data;
+}
+
+#ifdef __cplusplus
+}       /* extern "C" */
+#endif
+
+#endif  /* PCHTML_HTML_TOKENIZER_SCAN_H */
+
@@ -38,6 +38,7 @@
 #include "html/tokenizer/state.h"
 #include "html/tokenizer/state_comment.h"
 #include "html/tokenizer/state_doctype.h"
+#include "html/tokenizer/scan.h"
 
 #define PCHTML_STR_RES_ANSI_REPLACEMENT_CHARACTER
 #define PCHTML_STR_RES_ALPHANUMERIC_CHARACTER
@@ -260,6 +261,11 @@ pchtml_html_tokenizer_state_data(pchtml_html_tokenizer_t *tkz,
     pchtml_html_tokenizer_state_begin_set(tkz, data);
 
     while (data < end) {
+        data = pchtml_html_tokenizer_scan(data, end, 0x3C, 0x26, 0x0D, 0x00);
+        if (data == end) {
+            break;
+        }
+
         switch (*data) {
             /* U+003C LESS-THAN SIGN (<) */
             case 0x3C:
@@ -943,6 +949,11 @@ pchtml_html_tokenizer_state_attribute_value_double_quoted(pchtml_html_tokenizer_
     pchtml_html_tokenizer_state_begin_set(tkz, data);
 
     while (data != end) {
+        data = pchtml_html_tokenizer_scan(data, end, 0x22, 0x26, 0x0D, 0x00);
+        if (data == end) {
+            break;
+        }
+
         switch (*data) {
             /* U+0022 QUOTATION MARK (") */
             case 0x22:
@@ -1037,6 +1048,11 @@ pchtml_html_tokenizer_state_attribute_value_single_quoted(pchtml_html_tokenizer_
     pchtml_html_tokenizer_state_begin_set(tkz, data);
 
     while (data != end) {
+        data = pchtml_html_tokenizer_scan(data, end, 0x27, 0x26, 0x0D, 0x00);
+        if (data == end) {
+            break;
+        }
+
         switch (*data) {
             /* U+0027 APOSTROPHE (') */
             case 0x27:
@@ -37,6 +37,7 @@
 
 #include "html/tokenizer/state_rawtext.h"
 #include "html/tokenizer/state.h"
+#include "html/tokenizer/scan.h"
 
 #define PCHTML_STR_RES_ANSI_REPLACEMENT_CHARACTER
 #define PCHTML_STR_RES_ALPHA_CHARACTER
@@ -99,6 +100,11 @@ pchtml_html_tokenizer_state_rawtext(pchtml_html_tokenizer_t *tkz,
     pchtml_html_tokenizer_state_begin_set(tkz, data);
 
     while (data != end) {
+        data = pchtml_html_tokenizer_scan(data, end, 0x3C, 0x0D, 0x00, 0x00);
+        if (data == end) {
+            break;
+        }
+
         switch (*data) {
             /* U+003C LESS-THAN SIGN (<) */
             case 0x3C:
@@ -282,18 +282,16 @@ pchtml_html_tree_build(pchtml_html_tree_t *tree, pchtml_html_document_t *documen
         return tree->status;
     }
 
+    pchtml_read_buffer_t rb = { NULL, 0, 0 };
     ssize_t sz;
-    while (1) {
-        char buf[1024];
-        sz = purc_rwstream_read(html, buf, sizeof(buf));
-        if (sz <= 0)
-            break;
-
-        tree->status = pchtml_html_tree_chunk(tree, (unsigned char*)buf, sz);
+    while ((sz = pchtml_read_buffer_fill(&rb, html)) > 0) {
+        tree->status = pchtml_html_tree_chunk(tree, rb.data, sz);
         if (tree->status != PCHTML_STATUS_OK) {
+            pchtml_read_buffer_release(&rb);
             return tree->status;
         }
     }
+    pchtml_read_buffer_release(&rb);
 
     return pchtml_html_tree_end(tree);
 }
@@ -254,6 +254,8 @@ create_element(struct pcvdom_gen *gen, struct pchvml_token *token)
     if (!elem)
         goto end;
 
+    pchvml_token_get_position(token, &elem->line, &elem->col);
+
     for (size_t i=0; i<nr_attrs; ++i) {
         // TODO: how to traverse attr
         struct pchvml_token_attr *attr;
@@ -412,6 +414,10 @@ pcvdom_gen_end(struct pcvdom_gen *gen)
 
     gen->parser = NULL;
 
+    // the lookups by id fall back to walking the tree without the index.
+    if (doc)
+        pcvdom_document_build_id_index(doc);
+
     return doc;
 }
 
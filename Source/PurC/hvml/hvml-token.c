@@ -68,6 +68,10 @@ struct pchvml_token {
     bool whitespace;
     bool has_raw_attr;
 
+    /* the position of the token in the source, for start tags */
+    int line;
+    int column;
+
     struct tkz_buffer* name;
     struct pcutils_arrlist* attr_list;
 
@@ -386,6 +390,20 @@ bool pchvml_token_is_self_closing(struct pchvml_token* token)
     return token->self_closing;
 }
 
+void pchvml_token_set_position(struct pchvml_token* token,
+        int line, int column)
+{
+    token->line = line;
+    token->column = column;
+}
+
+void pchvml_token_get_position(struct pchvml_token* token,
+        int *line, int *column)
+{
+    *line = token->line;
+    *column = token->column;
+}
+
 void pchvml_token_set_force_quirks(struct pchvml_token* token, bool b)
 {
     token->force_quirks = b;
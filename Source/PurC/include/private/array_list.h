@@ -30,18 +30,29 @@
 #include "private/list.h"
 
 struct pcutils_array_list_node {
-    struct list_head             node;
+    // NOTE: use pcutils_array_list_node_idx() to read the index of a node
+    // which might have been shifted by insertion or removal
     size_t                       idx;
 };
 
 typedef struct pcutils_array_list       pcutils_array_list;
 
+/*
+ * The nodes are kept in a gap buffer: nodes[0, gap) hold the leading
+ * elements and nodes[gap + sz - nr, sz) hold the trailing ones, thus
+ * consecutive insertions/removals around the same position only move
+ * the gap instead of the whole tail.
+ *
+ * The cached `idx` of nodes at or after `dirty` might be stale, and will
+ * be renumbered lazily on next access.
+ */
 struct pcutils_array_list {
     struct pcutils_array_list_node          **nodes;
     size_t                                    sz;
     size_t                                    nr;
 
-    struct list_head                          list;
+    size_t                                    gap;
+    size_t                                    dirty;
 };
 
 #define safe_container_of(_ptr, _type, _member)                 \
@@ -55,13 +66,13 @@ struct pcutils_array_list {
 #define array_list_for_each(_al, _p)                       \
     for(_p = pcutils_array_list_get_first(_al);            \
         _p;                                                \
-        _p = pcutils_array_list_get(_al, _p->idx+1))
+        _p = pcutils_array_list_next(_al, _p))
 
 // struct pcutils_array_list *_al;
 // struct pcutils_array_list_node *_p, *_n;
 #define array_list_for_each_safe(_al, _p, _n)              \
     for(_p = pcutils_array_list_get_first(_al);            \
-        ({_n = _p ? pcutils_array_list_get(_al, _p->idx+1) \
+        ({_n = _p ? pcutils_array_list_next(_al, _p)       \
                   : NULL; _p; });                          \
         _p = _n)
 
@@ -70,13 +81,13 @@ struct pcutils_array_list {
 #define array_list_for_each_reverse(_al, _p)               \
     for(_p = pcutils_array_list_get_last(_al);             \
         _p;                                                \
-        _p = pcutils_array_list_get(_al, _p->idx-1))
+        _p = pcutils_array_list_prev(_al, _p))
 
 // struct pcutils_array_list *_al;
 // struct pcutils_array_list_node *_p, *_n;
 #define array_list_for_each_reverse_safe(_al, _p, _n)      \
     for(_p = pcutils_array_list_get_last(_al);             \
-        ({_n = _p ? pcutils_array_list_get(_al, _p->idx-1) \
+        ({_n = _p ? pcutils_array_list_prev(_al, _p)       \
                   : NULL; _p; });                          \
         _p = _n)
 
@@ -84,15 +95,15 @@ struct pcutils_array_list {
     for(_p = safe_container_of(pcutils_array_list_get_first(_al),   \
                     __typeof__(*_p), field);                        \
         _p;                                                         \
-        _p = safe_container_of(pcutils_array_list_get(_al,          \
-                                   _p->field.idx+1),                \
+        _p = safe_container_of(pcutils_array_list_next(_al,         \
+                                   &_p->field),                     \
                     __typeof__(*_p), field))
 
 #define array_list_for_each_entry_safe(_al, _p, _n, field)          \
     for(_p = safe_container_of(pcutils_array_list_get_first(_al),   \
                     __typeof__(*_p), field);                        \
-        ({ _n = _p ? safe_container_of(pcutils_array_list_get(_al,  \
-                                   _p->field.idx+1),                \
+        ({ _n = _p ? safe_container_of(pcutils_array_list_next(_al, \
+                                   &_p->field),                     \
                     __typeof__(*_p), field) : NULL; _p; });         \
         _p = _n)
 
@@ -100,15 +111,15 @@ struct pcutils_array_list {
     for(_p = safe_container_of(pcutils_array_list_get_last(_al),    \
                     __typeof__(*_p), field);                        \
         _p;                                                         \
-        _p = safe_container_of(pcutils_array_list_get(_al,          \
-                                   _p->field.idx-1),                \
+        _p = safe_container_of(pcutils_array_list_prev(_al,         \
+                                   &_p->field),                     \
                     __typeof__(*_p), field))
 
 #define array_list_for_each_entry_reverse_safe(_al, _p, _n, field)  \
     for(_p = safe_container_of(pcutils_array_list_get_last(_al),    \
                     __typeof__(*_p), field);                        \
-        ({ _n = _p ? safe_container_of(pcutils_array_list_get(_al,  \
-                                   _p->field.idx-1),                \
+        ({ _n = _p ? safe_container_of(pcutils_array_list_prev(_al, \
+                                   &_p->field),                     \
                     __typeof__(*_p), field) : NULL; _p; });         \
         _p = _n)
 
@@ -173,9 +184,70 @@ pcutils_array_list_remove(struct pcutils_array_list *al,
         size_t idx,
         struct pcutils_array_list_node **old);
 
-struct pcutils_array_list_node*
+void
+pcutils_array_list_refresh(struct pcutils_array_list *al);
+
+static inline struct pcutils_array_list_node*
 pcutils_array_list_get(struct pcutils_array_list *al,
-        size_t idx);
+        size_t idx)
+{
+    if (idx >= al->nr)
+        return NULL;
+
+    if (idx >= al->dirty)
+        pcutils_array_list_refresh(al);
+
+    if (idx >= al->gap)
+        idx += al->sz - al->nr;
+
+    return al->nodes[idx];
+}
+
+/*
+ * Same as pcutils_array_list_get() but leaves the cached indices alone,
+ * for callers which only need the node at a position, e.g. when doing
+ * a binary search between edits.
+ */
+static inline struct pcutils_array_list_node*
+pcutils_array_list_peek(struct pcutils_array_list *al,
+        size_t idx)
+{
+    if (idx >= al->nr)
+        return NULL;
+
+    if (idx >= al->gap)
+        idx += al->sz - al->nr;
+
+    return al->nodes[idx];
+}
+
+static inline size_t
+pcutils_array_list_node_idx(struct pcutils_array_list *al,
+        struct pcutils_array_list_node *node)
+{
+    // NOTE: a stale index is never less than `dirty`
+    if (node->idx != (size_t)-1 && node->idx >= al->dirty)
+        pcutils_array_list_refresh(al);
+
+    return node->idx;
+}
+
+static inline struct pcutils_array_list_node*
+pcutils_array_list_next(struct pcutils_array_list *al,
+        struct pcutils_array_list_node *node)
+{
+    return pcutils_array_list_get(al,
+            pcutils_array_list_node_idx(al, node) + 1);
+}
+
+static inline struct pcutils_array_list_node*
+pcutils_array_list_prev(struct pcutils_array_list *al,
+        struct pcutils_array_list_node *node)
+{
+    // NOTE: let pcutils_array_list_get to take care idx - 1
+    return pcutils_array_list_get(al,
+            pcutils_array_list_node_idx(al, node) - 1);
+}
 
 static inline struct pcutils_array_list_node*
 pcutils_array_list_get_first(struct pcutils_array_list *al)
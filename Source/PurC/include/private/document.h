@@ -35,6 +35,7 @@
 
 #include "private/debug.h"
 #include "private/errors.h"
+#include "private/map.h"
 
 struct pcdoc_travel_info {
     pcdoc_node_type type;
@@ -44,10 +45,28 @@ struct pcdoc_travel_info {
 
 typedef int (*pcdoc_node_cb)(purc_document_t doc, void *node, void *ctxt);
 
+/* A template of markup: the pieces of the markup with a text between every
+   two consecutive pieces. The texts are never parsed as markup. */
+struct pcdoc_template {
+    /* the pieces one after another, and the end of every piece in it */
+    const char         *markup;
+    const size_t       *piece_ends;
+
+    /* the number of the pieces minus one */
+    size_t              nr_texts;
+    const char * const *texts;
+    const size_t       *text_lens;
+};
+
 struct purc_document_ops {
     purc_document_t (*create)(const char *content, size_t length);
     void (*destroy)(purc_document_t doc);
 
+    // nullable; load the document incrementally
+    purc_document_t (*load_begin)(void);
+    int (*load_feed)(purc_document_t doc, const char *chunk, size_t len);
+    int (*load_end)(purc_document_t doc);
+
     pcdoc_element_t (*operate_element)(purc_document_t doc,
             pcdoc_element_t elem, pcdoc_operation op,
             const char *tag, bool self_close);
@@ -64,6 +83,11 @@ struct purc_document_ops {
             pcdoc_element_t elem, pcdoc_operation op,
             const char *content, size_t length);
 
+    // nullable; see pcdoc_element_new_content_from_template()
+    pcdoc_node (*new_content_from_template)(purc_document_t doc,
+            pcdoc_element_t elem, pcdoc_operation op,
+            const struct pcdoc_template *tpl);
+
     int (*set_attribute)(purc_document_t doc,
             pcdoc_element_t elem, pcdoc_operation op,
             const char *name, const char *val, size_t len);
@@ -93,9 +117,19 @@ struct purc_document_ops {
     int (*travel)(purc_document_t doc, pcdoc_element_t ancestor,
             pcdoc_node_cb cb, struct pcdoc_travel_info *info);
 
+    // nullable; travel the elements in the subtree (including `ancestor`)
+    // whose id is `value` or whose class list contains `value`,
+    // in the document order.
+    int (*travel_by_special_attr)(purc_document_t doc,
+            pcdoc_element_t ancestor, pcdoc_special_attr which,
+            const char *value, pcdoc_node_cb cb,
+            struct pcdoc_travel_info *info);
+
     int (*serialize)(purc_document_t doc, pcdoc_node node,
             unsigned opts, purc_rwstream_t stm);
 
+    // nullable; the selector is a group of CSS Selectors Level 3.
+    // `elem_coll_select` and `elem_coll_filter` return 0 for success.
     pcdoc_element_t (*find_elem)(purc_document_t doc, pcdoc_element_t scope,
             const char *selector);
 
@@ -116,11 +150,27 @@ struct purc_document {
     unsigned data_content:1;
     unsigned have_head:1;
     unsigned have_body:1;
+    /* between purc_document_load_begin() and purc_document_load_end() */
+    unsigned loading:1;
     unsigned refc;
 
     struct purc_document_ops *ops;
 
     void *impl;
+
+    /* id or class -> the set of elements; NULL until the first query */
+    pcutils_map *id_index;
+    pcutils_map *class_index;
+
+    /* element -> its position in the document order; built for sorting
+       the elements found in the indexes, dropped when the tree changes */
+    struct pcdoc_elem_order *elem_order;
+
+    /* selector -> the compiled one; NULL until the first query */
+    pcutils_map *selectors;
+
+    /* markup of a template -> the parsed one; NULL until the first use */
+    pcutils_map *templates;
 };
 
 struct pcdoc_elem_coll {
@@ -140,6 +190,25 @@ extern struct purc_document_ops _pcdoc_void_ops WTF_INTERNAL;
 extern struct purc_document_ops _pcdoc_plain_ops WTF_INTERNAL;
 extern struct purc_document_ops _pcdoc_html_ops WTF_INTERNAL;
 
+/* Travel the elements in the subtree of `ancestor` (the root element if NULL)
+   whose id is `value` (PCDOC_ATTR_ID) or whose class list contains `value`
+   (PCDOC_ATTR_CLASS), in the document order. */
+int
+pcdoc_travel_descendant_elements_by_special_attr(purc_document_t doc,
+        pcdoc_element_t ancestor, pcdoc_special_attr which, const char *value,
+        pcdoc_element_cb cb, void *ctxt, size_t *n) WTF_INTERNAL;
+
+/* Create the content of `elem` from a template of markup without building
+   and parsing the markup every time; the markup is parsed once for
+   a document. Returns a void node and sets PURC_ERROR_NOT_SUPPORTED if
+   the template can not be handled this way, e.g., a text is placed in
+   a tag name; expand the template to markup for
+   pcdoc_element_new_content() then. */
+pcdoc_node
+pcdoc_element_new_content_from_template(purc_document_t doc,
+        pcdoc_element_t elem, pcdoc_operation op,
+        const struct pcdoc_template *tpl) WTF_INTERNAL;
+
 #ifdef __cplusplus
 }
 #endif  /* __cplusplus */
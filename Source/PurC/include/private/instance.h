@@ -45,6 +45,7 @@ typedef struct pcmodule pcmodule;
 typedef struct pcmodule *pcmodule_t;
 
 struct pcinst_msg_queue;
+struct pclog_writer;
 
 typedef int (*module_init_once_f)(void);
 typedef int (*module_init_instance_f)(struct pcinst *curr_inst,
@@ -86,6 +87,11 @@ struct pcinst {
 #define LOG_FILE_SYSLOG     ((FILE *)-1)
     /* the FILE object for logging (-1: use syslog; NULL: disabled) */
     FILE                   *fp_log;
+    /* the background writer of the log records; NULL if log is disabled */
+    struct pclog_writer    *log_writer;
+    purc_log_level_k        log_level;
+    purc_log_overflow_k     log_overflow;
+    size_t                  nr_log_filtered;
 
     /* data bounden to the current session, e.g, the statbuf of the random
        number generator */
@@ -131,6 +137,9 @@ pcinst_broadcast_event(pcrdr_msg_event_reduce_opt reduce_op,
 
 void pcinst_clear_error(struct pcinst *inst) WTF_INTERNAL;
 
+/* flushes the pending log records, stops the writer, and closes the log */
+void pcinst_log_cleanup(struct pcinst *inst) WTF_INTERNAL;
+
 purc_atom_t
 pcinst_endpoint_get(char *endpoint_name, size_t sz,
         const char *app_name, const char *runner_name) WTF_INTERNAL;
@@ -117,9 +117,19 @@ struct pcintr_heap {
 
     purc_cond_handler    cond_handler;
     unsigned int         keep_alive:1;
+    // create the coroutines with a profiler
+    unsigned int         profiling:1;
     double               timestamp;
+
+    // the budget of a ready coroutine in one scheduling tick;
+    // `max_steps` is never zero.
+    unsigned int         max_steps;
+    unsigned int         max_usecs;
 };
 
+struct pcintr_profiler;
+struct pcintr_prof_elem;
+
 struct pcintr_stack_frame;
 typedef struct pcintr_stack_frame pcintr_stack_frame;
 typedef struct pcintr_stack_frame *pcintr_stack_frame_t;
@@ -213,6 +223,11 @@ struct pcintr_stack {
 
     // key: vdom_node  val: pcvarmgr_t
     struct rb_root                scoped_variables;
+
+    // the chunks of normal frames, which are pushed and popped in LIFO order
+    struct pcintr_frame_chunk    *frame_chunks;
+    // the last emptied chunk, kept to avoid thrashing at a chunk boundary
+    struct pcintr_frame_chunk    *spare_chunk;
 };
 
 enum pcintr_coroutine_stage {
@@ -313,6 +328,9 @@ struct pcintr_coroutine {
 
     void                       *user_data;
     unsigned long               run_idx;
+
+    // NULL if the coroutine is not being profiled
+    struct pcintr_profiler     *profiler;
 };
 
 enum purc_symbol_var {
@@ -370,9 +388,6 @@ struct pcintr_stack_frame {
     // the symbolized variables for this frame, $0?/$0@/...
     purc_variant_t symbol_vars[PURC_SYMBOL_VAR_MAX];
 
-    // all attribute variants are managed by a map (attribute name -> variant).
-    purc_variant_t attr_vars;
-
     // the evaluated content variant
     purc_variant_t ctnt_var;
 
@@ -396,6 +411,10 @@ struct pcintr_stack_frame {
     purc_variant_t     error_templates;
 
     unsigned int       silently:1;
+
+    // managed by the profiler
+    struct pcintr_prof_elem *prof_elem;
+    uint64_t           prof_ns;
 };
 
 struct pcintr_stack_frame_normal {
@@ -694,6 +713,40 @@ pcintr_coroutine_get_result(pcintr_coroutine_t co);
 bool
 pcintr_is_variable_token(const char *str);
 
+/* the profiler of coroutines, see interpreter/profiler.c */
+struct pcintr_profiler *
+pcintr_profiler_create(void);
+
+void
+pcintr_profiler_destroy(struct pcintr_profiler *prof);
+
+uint64_t
+pcintr_profiler_now(void);
+
+void
+pcintr_profiler_step_begin(struct pcintr_profiler *prof,
+        struct pcintr_stack_frame *frame);
+
+void
+pcintr_profiler_step_end(struct pcintr_profiler *prof);
+
+void
+pcintr_profiler_frame_popped(struct pcintr_profiler *prof,
+        struct pcintr_stack_frame *frame, struct pcintr_stack_frame *parent);
+
+uint64_t
+pcintr_profiler_eval_begin(struct pcintr_profiler *prof);
+
+void
+pcintr_profiler_eval_end(struct pcintr_profiler *prof, uint64_t begin);
+
+void
+pcintr_profiler_add_method(struct pcintr_profiler *prof, const char *name,
+        uint64_t begin);
+
+purc_variant_t
+pcintr_profiler_make_object(struct pcintr_profiler *prof);
+
 
 PCA_EXTERN_C_END
 
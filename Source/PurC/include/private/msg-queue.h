@@ -29,7 +29,12 @@
 
 #include "config.h"
 
+#ifdef __cplusplus
+#include <atomic>
+using std::atomic_uint;
+#else
 #include <stdatomic.h>
+#endif
 
 #include "private/list.h"
 #include "purc-pcrdr.h"
@@ -44,6 +49,8 @@ struct pcinst_msg_hdr {
     struct list_head        ln;
 };
 
+struct pcinst_event_slot;
+
 struct pcinst_msg_queue {
     struct purc_rwlock  lock;
     struct list_head    req_msgs;
@@ -51,6 +58,11 @@ struct pcinst_msg_queue {
     struct list_head    event_msgs;
     struct list_head    void_msgs;
 
+    /* the events in `event_msgs` indexed by their reduce keys */
+    struct pcinst_event_slot  **event_buckets;
+    size_t              nr_event_buckets;
+    size_t              nr_event_slots;
+
     uint64_t            state;
     size_t              nr_msgs;
 };
@@ -25,5 +25,55 @@
 #ifndef PURC_PRIVATE_RWSTREAM_H
 #define PURC_PRIVATE_RWSTREAM_H
 
+#include "config.h"
+#include "purc-rwstream.h"
+
+/*
+ * A buffered reader which splits the data read from a stream into lines.
+ * A line ends with LF or CRLF; the line terminator is not returned.
+ * The partial line at the end of the data read is kept for the next read.
+ */
+struct pcutils_line_reader;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Lines longer than `max_len` bytes (0 for no limit) are split at
+   a character boundary. */
+struct pcutils_line_reader *
+pcutils_line_reader_new(purc_rwstream_t stm, size_t max_len);
+
+void
+pcutils_line_reader_delete(struct pcutils_line_reader *reader);
+
+/* Returns 1 and the next line in `line` and `len`, which is valid until
+   the next call. Returns 0 at the end of the stream, or if no more data is
+   available for a non-blocking stream; the bytes left without a line
+   terminator at the end of the stream make the last line.
+   Returns -1 on error. */
+int
+pcutils_line_reader_next(struct pcutils_line_reader *reader,
+        const char **line, size_t *len);
+
+/* Reads the raw bytes; the bytes buffered are read first. */
+ssize_t
+pcutils_line_reader_read(struct pcutils_line_reader *reader,
+        void *buf, size_t count);
+
+/* The number of the bytes read from the stream but not consumed yet. */
+size_t
+pcutils_line_reader_buffered(struct pcutils_line_reader *reader);
+
+/* Seeks the stream back to the first byte not consumed and drops
+   the buffered bytes, so that the stream can be used directly.
+   Returns -1 and keeps the bytes if the stream is not seekable. */
+int
+pcutils_line_reader_sync(struct pcutils_line_reader *reader);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* not defined PURC_PRIVATE_RWSTREAM_H */
 
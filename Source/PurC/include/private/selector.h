@@ -0,0 +1,75 @@
+/**
+ * @file selector.h
+ * @date 2022/10/18
+ * @brief The internal interfaces for the CSS selector engine.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PURC_PRIVATE_SELECTOR_H
+#define PURC_PRIVATE_SELECTOR_H
+
+#include "config.h"
+
+#include "purc-document.h"
+#include "purc-dom.h"
+
+#include <stdbool.h>
+
+/*
+ * A selector group (CSS Selectors Level 3) compiled into the programs which
+ * match an element from the right to the left: the subject compound first,
+ * then its ancestors or previous siblings according to the combinators.
+ */
+struct pcdoc_selector;
+
+#ifdef __cplusplus
+extern "C" {
+#endif  /* __cplusplus */
+
+/* Compiles a selector group. Returns NULL and sets PURC_ERROR_INVALID_VALUE
+   if `selector` is malformed or uses a feature not supported. */
+struct pcdoc_selector *
+pcdoc_selector_new(const char *selector) WTF_INTERNAL;
+
+void
+pcdoc_selector_delete(struct pcdoc_selector *sel) WTF_INTERNAL;
+
+/* Resolves the tag and attribute names to the identifiers used by
+   `doc`; call it before matching the elements of `doc`. */
+void
+pcdoc_selector_bind(struct pcdoc_selector *sel,
+        pcdom_document_t *doc) WTF_INTERNAL;
+
+bool
+pcdoc_selector_match(struct pcdoc_selector *sel,
+        pcdom_element_t *elem) WTF_INTERNAL;
+
+/* Returns true if an element must have the id (PCDOC_ATTR_ID) or the class
+   (PCDOC_ATTR_CLASS) returned in `value` to match the selector, so that
+   the candidates can be taken from the index of the document. */
+bool
+pcdoc_selector_subject_key(struct pcdoc_selector *sel,
+        pcdoc_special_attr *which, const char **value) WTF_INTERNAL;
+
+#ifdef __cplusplus
+}
+#endif  /* __cplusplus */
+
+#endif  /* PURC_PRIVATE_SELECTOR_H */
+
@@ -58,6 +58,9 @@ pcintr_timer_start_oneshot(pcintr_timer_t timer);
 void
 pcintr_timer_stop(pcintr_timer_t timer);
 
+bool
+pcintr_timer_is_active(pcintr_timer_t timer);
+
 void
 pcintr_timer_destroy(pcintr_timer_t timer);
 
@@ -0,0 +1,96 @@
+/*
+ * @file trace.h
+ * @date 2022/10/18
+ * @brief The internal interfaces for the static trace points.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PURC_PRIVATE_TRACE_H
+#define PURC_PRIVATE_TRACE_H
+
+#include "config.h"
+
+#include <stdint.h>
+
+/* the phases of the events, as defined by the Chrome trace event format */
+#define PCTRACE_PH_BEGIN            'B'
+#define PCTRACE_PH_END              'E'
+#define PCTRACE_PH_INSTANT          'i'
+#define PCTRACE_PH_ASYNC_BEGIN      'b'
+#define PCTRACE_PH_ASYNC_END        'e'
+
+/* the categories of the trace points */
+#define PCTRACE_CAT_SCHED           "sched"
+#define PCTRACE_CAT_MSG             "msg"
+#define PCTRACE_CAT_RDR             "rdr"
+#define PCTRACE_CAT_FETCHER         "fetcher"
+#define PCTRACE_CAT_VARIANT         "variant"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* NOTE: do not change it directly; call purc_enable_trace() instead */
+extern int pctrace_enabled WTF_INTERNAL;
+
+/*
+ * Records an event into the ring buffer of the calling thread.
+ * Both `cat` and `name` must be string literals, because only the pointers
+ * are kept until the events are dumped.
+ */
+void pctrace_record(char ph, const char *cat, const char *name,
+        uint64_t arg) WTF_INTERNAL;
+
+void pctrace_init_once(void) WTF_INTERNAL;
+
+#ifdef __cplusplus
+}
+#endif
+
+static inline int pctrace_is_enabled(void)
+{
+    return __atomic_load_n(&pctrace_enabled, __ATOMIC_RELAXED);
+}
+
+/* A trace point costs only one branch when tracing is disabled. */
+#define PCTRACE_EVENT(ph, cat, name, arg)                           \
+    do {                                                            \
+        if (UNLIKELY(pctrace_is_enabled()))                         \
+            pctrace_record((ph), (cat), (name), (uint64_t)(arg));   \
+    } while (0)
+
+#define PCTRACE_BEGIN(cat, name)                                    \
+    PCTRACE_EVENT(PCTRACE_PH_BEGIN, cat, name, 0)
+
+#define PCTRACE_END(cat, name)                                      \
+    PCTRACE_EVENT(PCTRACE_PH_END, cat, name, 0)
+
+#define PCTRACE_INSTANT(cat, name, value)                           \
+    PCTRACE_EVENT(PCTRACE_PH_INSTANT, cat, name, value)
+
+/* the async events are matched by `cat`, `name`, and `id` */
+#define PCTRACE_ASYNC_BEGIN(cat, name, id)                          \
+    PCTRACE_EVENT(PCTRACE_PH_ASYNC_BEGIN, cat, name, (uintptr_t)(id))
+
+#define PCTRACE_ASYNC_END(cat, name, id)                            \
+    PCTRACE_EVENT(PCTRACE_PH_ASYNC_END, cat, name, (uintptr_t)(id))
+
+#endif /* PURC_PRIVATE_TRACE_H */
+
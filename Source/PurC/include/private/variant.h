@@ -41,6 +41,10 @@ PCA_EXTERN_C_BEGIN
 #define PCVARIANT_FLAG_EXTRA_SIZE      (0x01 << 1)  // when use extra space
 #define PCVARIANT_FLAG_STRING_STATIC   (0x01 << 2)  // make_string_static
 
+// the value of `extra_size` for a string whose length in characters
+// has not been calculated yet.
+#define PCVARIANT_NR_CHARS_UNKNOWN     ((size_t)-1)
+
 #define PVT(t)          (PURC_VARIANT_TYPE##t)
 #define IS_CONTAINER(t) (t == PURC_VARIANT_TYPE_OBJECT || \
                         t == PURC_VARIANT_TYPE_ARRAY || \
@@ -241,7 +245,6 @@ struct set_node {
     struct rb_node                       rbnode;
     struct pcutils_array_list_node       alnode;
     purc_variant_t   val;  // actual variant-element
-    char             md5[33];
 };
 
 struct variant_set {
@@ -252,6 +255,10 @@ struct variant_set {
     struct rb_root          elems;  // multiple-variant-elements stored in set
     struct pcutils_array_list al;    // struct set_node
 
+    // times the members were re-indexed (re-linked in `elems`, which is
+    // ordered by comparing the unique keys) after their unique keys changed
+    size_t                  nr_reindexes;
+
     // key: arr_node/obj_node/set_node
     // val: parent
     pcutils_map                     *rev_update_chain;
@@ -261,14 +268,26 @@ struct variant_set {
 typedef struct variant_obj      *variant_obj_t;
 
 struct obj_node {
-    struct rb_node   node;
+    struct pcutils_array_list_node       alnode;
+    uint32_t         hash; // hash of the key string
+    purc_atom_t      atom; // the atom of the key if interned, or 0
     purc_variant_t   key;
     purc_variant_t   val;
 };
 
+// objects with at most this number of properties are looked up linearly
+#define PCVAR_OBJ_LINEAR_MAX    8
+
+/*
+ * The properties are kept in an array list sorted by key, thus the
+ * iteration order stays stable for comparing and serializing objects.
+ * Once the object grows beyond PCVAR_OBJ_LINEAR_MAX properties, an
+ * open-addressed hash index is built for looking up keys.
+ */
 struct variant_obj {
-    struct rb_root          kvs;  // struct obj_node*
-    size_t                  size;
+    struct pcutils_array_list kvs;  // struct obj_node*
+    struct obj_node       **index;  // NULL or `index_sz` slots
+    size_t                  index_sz;
 
     // key: arr_node/obj_node/set_node
     // val: parent
@@ -394,6 +413,22 @@ pcvariant_object_shallow_copy(purc_variant_t obj);
 bool
 pcvariant_object_clear(purc_variant_t object, bool silently);
 
+// set the property whose key is interned as `atom`
+bool
+pcvariant_object_set_by_atom(purc_variant_t obj, purc_atom_t atom,
+        purc_variant_t value);
+
+// the hash of `key` as a key of objects, for pcvariant_object_get_by_atom()
+uint32_t
+pcvariant_object_key_hash(const char *key);
+
+// get the property by the atom of the key and the string of the atom;
+// the keys which were not interned as the same atom are compared as strings.
+// `hash` must be the value pcvariant_object_key_hash() gives for `key`.
+purc_variant_t
+pcvariant_object_get_by_atom(purc_variant_t obj, purc_atom_t atom,
+        const char *key, uint32_t hash);
+
 bool
 pcvariant_array_clear(purc_variant_t array, bool silently);
 
@@ -515,13 +550,16 @@ PCA_EXTERN_C_END
 #define foreach_value_in_variant_object(_obj, _val)                 \
     do {                                                            \
         variant_obj_t _data;                                        \
+        struct pcutils_array_list *_al;                             \
         _data = (variant_obj_t)_obj->sz_ptr[1];                     \
-        struct rb_root *_root = &_data->kvs;                        \
-        struct rb_node *_p = pcutils_rbtree_first(_root);           \
-        for (; _p; _p = pcutils_rbtree_next(_p))                    \
+        _al = &_data->kvs;                                          \
+        struct pcutils_array_list_node *_p;                         \
+        for (_p = pcutils_array_list_get_first(_al);                \
+             _p;                                                    \
+             _p = pcutils_array_list_next(_al, _p))                 \
         {                                                           \
             struct obj_node *_node;                                 \
-            _node = container_of(_p, struct obj_node, node);        \
+            _node = container_of(_p, struct obj_node, alnode);      \
             _val = _node->val;                                      \
      /* } */                                                        \
  /* } while (0) */
@@ -529,13 +567,16 @@ PCA_EXTERN_C_END
 #define foreach_key_value_in_variant_object(_obj, _key, _val)       \
     do {                                                            \
         variant_obj_t _data;                                        \
+        struct pcutils_array_list *_al;                             \
         _data = (variant_obj_t)_obj->sz_ptr[1];                     \
-        struct rb_root *_root = &_data->kvs;                        \
-        struct rb_node *_p = pcutils_rbtree_first(_root);           \
-        for (; _p; _p = pcutils_rbtree_next(_p))                    \
+        _al = &_data->kvs;                                          \
+        struct pcutils_array_list_node *_p;                         \
+        for (_p = pcutils_array_list_get_first(_al);                \
+             _p;                                                    \
+             _p = pcutils_array_list_next(_al, _p))                 \
         {                                                           \
             struct obj_node *_node;                                 \
-            _node = container_of(_p, struct obj_node, node);        \
+            _node = container_of(_p, struct obj_node, alnode);      \
             _key = _node->key;                                      \
             _val = _node->val;                                      \
      /* } */                                                        \
@@ -544,15 +585,17 @@ PCA_EXTERN_C_END
 #define foreach_in_variant_object_safe_x(_obj, _key, _val)          \
     do {                                                            \
         variant_obj_t _data;                                        \
+        struct pcutils_array_list *_al;                             \
         _data = (variant_obj_t)_obj->sz_ptr[1];                     \
-        struct rb_root *_root = &_data->kvs;                        \
-        struct rb_node *_p, *_next;                                 \
-        for (_p = pcutils_rbtree_first(_root);                      \
-            ({_next = _p ? pcutils_rbtree_next(_p) : NULL; _p;});   \
+        _al = &_data->kvs;                                          \
+        struct pcutils_array_list_node *_p, *_next;                 \
+        for (_p = pcutils_array_list_get_first(_al);                \
+            ({_next = _p ? pcutils_array_list_next(_al, _p)         \
+                         : NULL; _p;});                             \
             _p = _next)                                             \
         {                                                           \
             struct obj_node *_node;                                 \
-            _node = container_of(_p, struct obj_node, node);        \
+            _node = container_of(_p, struct obj_node, alnode);      \
             _key = _node->key;                                      \
             _val = _node->val;                                      \
      /* } */                                                        \
@@ -567,7 +610,7 @@ PCA_EXTERN_C_END
         struct pcutils_array_list_node *_p;                             \
         for (_p = pcutils_array_list_get_first(_al);                    \
              _p;                                                        \
-             _p = pcutils_array_list_get(_al,  _p->idx+1))              \
+             _p = pcutils_array_list_next(_al, _p))                      \
         {                                                               \
             struct set_node *_sn;                                       \
             _sn = container_of(_p, struct set_node, alnode);            \
@@ -584,7 +627,7 @@ PCA_EXTERN_C_END
         struct pcutils_array_list_node *_p;                             \
         for (_p = pcutils_array_list_get_last(_al);                     \
              _p;                                                        \
-             _p = pcutils_array_list_get(_al,  _p->idx-1))              \
+             _p = pcutils_array_list_prev(_al, _p))                      \
         {                                                               \
             struct set_node *_sn;                                       \
             _sn = container_of(_p, struct set_node, alnode);            \
@@ -600,7 +643,7 @@ PCA_EXTERN_C_END
         _al = &_data->al;                                                     \
         struct pcutils_array_list_node *_p, *_n;                              \
         for (_p = pcutils_array_list_get_first(_al);                          \
-             ({ _n = _p ? pcutils_array_list_get(_al,  _p->idx+1) : NULL;     \
+             ({ _n = _p ? pcutils_array_list_next(_al, _p) : NULL;           \
               _p; });                                                         \
              _p = _n)                                                         \
         {                                                                     \
@@ -618,7 +661,7 @@ PCA_EXTERN_C_END
         _al = &_data->al;                                                     \
         struct pcutils_array_list_node *_p, *_n;                              \
         for (_p = pcutils_array_list_get_last(_al);                           \
-             ({ _n = _p ? pcutils_array_list_get(_al,  _p->idx-1) : NULL;     \
+             ({ _n = _p ? pcutils_array_list_prev(_al, _p) : NULL;           \
               _p; });                                                         \
              _p = _n)                                                         \
         {                                                                     \
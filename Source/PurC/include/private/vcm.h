@@ -72,6 +72,11 @@ struct pcvcm_node {
     uint32_t extra;
     uintptr_t attach;
     bool is_closed;
+    // for a string node: the atom of the string among the atoms of DVObjs
+    // (0 if not interned yet) and its hash as a key of objects; both are
+    // resolved when the node is made, since the node is shared by runners
+    purc_atom_t atom;
+    uint32_t hash;
     union {
         bool        b;
         double      d;
@@ -253,6 +253,46 @@ typedef int (*vdom_element_traverse_f)(struct pcvdom_element *top,
 int pcvdom_element_traverse(struct pcvdom_element *elem, void *ctx,
         vdom_element_traverse_f cb);
 
+// the id of `element` if it is given literally; NULL if the element has no
+// id, or its id is an expression (`*dynamic` is set to true then).
+const char*
+pcvdom_element_get_static_id(struct pcvdom_element *element, bool *dynamic);
+
+// build the index of the static ids of the elements in `doc`;
+// called once the document has been generated.
+int
+pcvdom_document_build_id_index(struct pcvdom_document *doc);
+
+// returns true if the id of `elem` evaluates to `id`.
+typedef bool (*pcvdom_match_id_f)(struct pcvdom_element *elem,
+        const char *id, void *ctxt);
+
+// find the nearest one of `elem` and its ancestors whose id is `id`.
+// The static ids are looked up in the index of `doc`; `match_dynamic` is
+// only called for the elements whose id is an expression.
+struct pcvdom_element*
+pcvdom_document_find_ancestor_by_id(struct pcvdom_document *doc,
+        struct pcvdom_element *elem, const char *id,
+        pcvdom_match_id_f match_dynamic, void *ctxt);
+
+// the document derived from `elem` of `doc` for `name`, which is owned by
+// `doc`; NULL if there is no such document. The caller gets a reference
+// of its own.
+struct pcvdom_document*
+pcvdom_document_find_derived(struct pcvdom_document *doc,
+        struct pcvdom_element *elem, const char *name);
+
+// let `doc` own `derived` as the document derived from `elem` for `name`.
+// Returns a reference of the document owned by `doc` then, which is not
+// `derived` if another thread has added one in the meantime (`derived` is
+// released); returns NULL if failed, and `derived` is left to the caller.
+// The derived documents no longer used by others are dropped once `doc`
+// has many.
+struct pcvdom_document*
+pcvdom_document_add_derived(struct pcvdom_document *doc,
+        struct pcvdom_element *elem, const char *name,
+        struct pcvdom_document *derived);
+
 #define pcvdom_document_create_with_doctype(name, doctype) ({     \
     struct pcvdom_document *doc = pcvdom_document_create();       \
     if (doc) {                                                    \
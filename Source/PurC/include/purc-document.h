@@ -183,6 +183,69 @@ purc_document_unref(purc_document_t doc);
 PCA_EXPORT purc_document_t
 purc_document_load(purc_document_type type, const char *content, size_t len);
 
+/**
+ * Begin to load a document incrementally.
+ *
+ * @param type: the type of the document.
+ *
+ * This function creates a new document in the specific type, which will be
+ * built by the chunks of the content fed by calling
+ * purc_document_load_feed(). Call purc_document_load_end() after the last
+ * chunk was fed to complete the document.
+ *
+ * Unlike purc_document_load(), the content needs not to be in the memory
+ * as a whole, and the caller can do other things between the chunks,
+ * e.g., feed the chunks as they arrive from the network.
+ *
+ * Returns: a pointer to the document, or %NULL on failure. The possible
+ *  error codes:
+ *  - @PURC_ERROR_NOT_IMPLEMENTED: The document type is not implemented.
+ *  - @PURC_ERROR_NOT_SUPPORTED: The document type can not be loaded
+ *      incrementally.
+ *  - @PURC_ERROR_OUT_OF_MEMORY: Out of memory.
+ *
+ * Since: 0.2.0
+ */
+PCA_EXPORT purc_document_t
+purc_document_load_begin(purc_document_type type);
+
+/**
+ * Feed a chunk of content to a document being loaded.
+ *
+ * @param doc: the document returned by purc_document_load_begin().
+ * @param chunk: the pointer to the chunk.
+ * @param len: the length of the chunk in bytes.
+ *
+ * A chunk can end at any byte, even in the middle of a tag or
+ * a multi-byte character.
+ *
+ * Returns: 0 for success, -1 for failure. The possible error codes:
+ *  - @PURC_ERROR_INVALID_OPERAND: The document is not being loaded.
+ *  - @PURC_ERROR_OUT_OF_MEMORY: Out of memory.
+ *
+ * Since: 0.2.0
+ */
+PCA_EXPORT int
+purc_document_load_feed(purc_document_t doc, const char *chunk, size_t len);
+
+/**
+ * Complete loading a document.
+ *
+ * @param doc: the document returned by purc_document_load_begin().
+ *
+ * This function flushes the content pending in the parser, and closes
+ * the elements which are still open. The document can be used as one
+ * returned by purc_document_load() after this call, even if it fails.
+ *
+ * Returns: 0 for success, -1 for failure. The possible error codes:
+ *  - @PURC_ERROR_INVALID_OPERAND: The document is not being loaded.
+ *  - @PURC_ERROR_OUT_OF_MEMORY: Out of memory.
+ *
+ * Since: 0.2.0
+ */
+PCA_EXPORT int
+purc_document_load_end(purc_document_t doc);
+
 /**
  * Delete a document.
  *
@@ -700,6 +763,12 @@ pcdoc_find_element_in_document(purc_document_t doc, const char *selector)
  * Create an element collection by selecting the elements from the descendants
  * of the specified element according to the CSS selector.
  *
+ * The selector is a group of selectors defined by CSS Selectors Level 3,
+ * e.g., `div.item > span[data-x], #main li:nth-child(2n+1)`; the namespaces
+ * are not supported, and the dynamic pseudo-classes (`:hover` and so on)
+ * and the pseudo-elements never match. The specified element is one of
+ * the candidates.
+ *
  * Returns: A pointer to the element collection; @NULL on failure.
  */
 PCA_EXPORT pcdoc_elem_coll_t
@@ -726,7 +795,7 @@ pcdoc_elem_coll_new_from_document(purc_document_t doc,
  * Returns: A pointer to the new element collection; @NULL on failure.
  */
 PCA_EXPORT pcdoc_elem_coll_t
-pcdoc_elem_coll_select(purc_document_t doc,
+pcdoc_elem_coll_filter(purc_document_t doc,
         pcdoc_elem_coll_t elem_coll, const char *selector);
 
 /**
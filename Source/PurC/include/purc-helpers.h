@@ -309,6 +309,8 @@ char *purc_load_file_contents(const char *file, size_t *length);
 
 #define PURC_ENVV_LOG_ENABLE        "PURC_LOG_ENABLE"
 #define PURC_ENVV_LOG_SYSLOG        "PURC_LOG_SYSLOG"
+#define PURC_ENVV_LOG_LEVEL         "PURC_LOG_LEVEL"
+#define PURC_ENVV_LOG_OVERWRITE     "PURC_LOG_OVERWRITE"
 
 #define PURC_LOG_FILE_PATH_FORMAT   "/var/tmp/purc-%s-%s.log"
 
@@ -328,6 +330,109 @@ char *purc_load_file_contents(const char *file, size_t *length);
 PCA_EXPORT bool
 purc_enable_log(bool enable, bool use_syslog);
 
+typedef enum purc_log_level {
+    PURC_LOG_LEVEL_DEBUG = 0,
+    PURC_LOG_LEVEL_INFO,
+    PURC_LOG_LEVEL_WARN,
+    PURC_LOG_LEVEL_ERROR,
+} purc_log_level_k;
+
+typedef enum purc_log_overflow {
+    /* discard the new record if the log buffer is full */
+    PURC_LOG_OVERFLOW_DROP = 0,
+    /* discard the oldest records not written yet */
+    PURC_LOG_OVERFLOW_OVERWRITE,
+} purc_log_overflow_k;
+
+/**
+ * Configure the log facility for the current PurC instance.
+ *
+ * @param min_level: the messages with a level lower than this one will be
+ *      ignored before they are formatted.
+ * @param overflow: the policy to apply when the log buffer is full.
+ *
+ * The messages are formatted by the caller, queued in a per-instance
+ * ring buffer, and written to the log file or syslog by a background
+ * writer thread. An error message is written before the call returns.
+ *
+ * The initial values can be specified by the environment variables
+ * `PURC_LOG_LEVEL` (`debug`, `info`, `warn`, or `error`) and
+ * `PURC_LOG_OVERWRITE`.
+ *
+ * The policy can be changed while the writer is running. Right after
+ * switching to overwriting, a new record may still be dropped if the
+ * oldest records are being written out under the previous policy.
+ *
+ * Returns: @true for success, otherwise @false.
+ *
+ * Since: 0.2.0
+ */
+PCA_EXPORT bool
+purc_log_configure(purc_log_level_k min_level, purc_log_overflow_k overflow);
+
+struct purc_log_stats {
+    /* the number of records queued */
+    size_t nr_queued;
+    /* the number of records written out */
+    size_t nr_written;
+    /* the number of records discarded because the buffer was full */
+    size_t nr_dropped;
+    /* the number of records overwritten before they were written */
+    size_t nr_overwritten;
+    /* the number of messages filtered out by level */
+    size_t nr_filtered;
+};
+
+/**
+ * Get the statistics of the log facility of the current PurC instance.
+ *
+ * @param stats: the buffer to return the statistics.
+ *
+ * Returns: @true for success, otherwise @false.
+ *
+ * Since: 0.2.0
+ */
+PCA_EXPORT bool
+purc_log_get_stats(struct purc_log_stats *stats);
+
+#define PURC_ENVV_TRACE             "PURC_TRACE"
+
+/**
+ * Enable or disable the trace points in all threads of the process.
+ *
+ * @param enable: @true to enable, @false to disable.
+ *
+ * The trace points at the boundaries of the scheduler, the message queues,
+ * the renderer requests, the fetchers, and the variant heap record events
+ * into per-thread ring buffers with monotonic timestamps; the oldest events
+ * are overwritten when a buffer is full.
+ *
+ * If the environment variable `PURC_TRACE` is set to a file path when
+ * the first instance is initialized, tracing is enabled and the events are
+ * dumped to that file on receiving `SIGUSR2` and on exit.
+ *
+ * Returns: @true for success, otherwise @false.
+ *
+ * Since: 0.2.0
+ */
+PCA_EXPORT bool
+purc_enable_trace(bool enable);
+
+/**
+ * Dump the recorded events of all threads in the Chrome trace event format.
+ *
+ * @param file: the path of the file to write the JSON document to.
+ *
+ * The output can be loaded by `chrome://tracing` or Perfetto UI to show
+ * the events of all runner threads in one timeline.
+ *
+ * Returns: @true for success, otherwise @false.
+ *
+ * Since: 0.2.0
+ */
+PCA_EXPORT bool
+purc_dump_trace(const char *file);
+
 /**
  * Log a message with tag.
  *
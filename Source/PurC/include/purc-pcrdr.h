@@ -1155,6 +1155,8 @@ pcrdr_purcmc_connect(const char* renderer_uri,
  * Note that use this function only if you know the length of
  * the next packet, and have a long enough buffer to save the
  * contents of the packet.
+ * For a WebSocket connection, \a sz_packet should contain
+ * the size of the buffer when calling this function.
  *
  * Also note that if the length of the packet is 0, there is no data in
  * the packet. You should ignore the packet in this case.
@@ -495,6 +495,8 @@ typedef struct pcintr_coroutine *purc_coroutine_t;
  *
  * Creates a new coroutine to run the specified vDOM.
  * If success, the new coroutine will be in READY state.
+ * The new coroutine takes its own reference of @vdom; the reference of
+ * the caller is not released, even on failure.
  *
  * Returns: The pointer to the new coroutine, 0 for error.
  *
@@ -783,6 +785,83 @@ purc_set_cond_handler(purc_cond_handler handler);
 PCA_EXPORT int
 purc_run(purc_cond_handler handler);
 
+#define PURC_ENVV_SCHED_MAX_STEPS   "PURC_SCHED_MAX_STEPS"
+#define PURC_ENVV_SCHED_MAX_USECS   "PURC_SCHED_MAX_USECS"
+
+#define PURC_DEF_SCHED_MAX_STEPS    64
+#define PURC_DEF_SCHED_MAX_USECS    2000
+
+/**
+ * purc_set_schedule_budget:
+ *
+ * @max_steps: The maximal number of steps a ready coroutine runs in one
+ *      scheduling tick; zero for the default value.
+ * @max_usecs: The maximal time in microseconds a ready coroutine runs in
+ *      one scheduling tick; zero for no time limit.
+ *
+ * Sets the time slice of the coroutines in the current PurC instance.
+ * A ready coroutine keeps running until it reaches one of the limits,
+ * or it stops being ready, before the scheduler dispatches the events and
+ * turns to the next coroutine. The initial values can also be specified by
+ * the environment variables `PURC_SCHED_MAX_STEPS` and
+ * `PURC_SCHED_MAX_USECS`, in which zero has the same meaning as here.
+ *
+ * Returns: @true for success; @false if the interpreter is not initialized.
+ *
+ * Since 0.2.0
+ */
+PCA_EXPORT bool
+purc_set_schedule_budget(unsigned int max_steps, unsigned int max_usecs);
+
+/**
+ * purc_enable_profiler:
+ *
+ * @enable: @true to enable, @false to disable.
+ *
+ * Enables or disables the profiler for the coroutines which will be created
+ * in the current PurC instance. The profiler collects the time spent in
+ * the steps of every element, the evaluations of expressions, and the
+ * calls to the methods of dynamic and native variants.
+ *
+ * Returns: @true for success; @false if the interpreter is not initialized.
+ *
+ * Since 0.2.0
+ */
+PCA_EXPORT bool
+purc_enable_profiler(bool enable);
+
+/**
+ * purc_coroutine_get_profile:
+ *
+ * @cor: The coroutine.
+ *
+ * Gets the profiling data of a coroutine as an object, which is also
+ * available as `$CRTN.profile` in the HVML program.
+ *
+ * Returns: an object, or %PURC_VARIANT_INVALID if the coroutine is not
+ * being profiled.
+ *
+ * Since 0.2.0
+ */
+PCA_EXPORT purc_variant_t
+purc_coroutine_get_profile(purc_coroutine_t cor);
+
+/**
+ * purc_coroutine_dump_profile:
+ *
+ * @cor: The coroutine.
+ * @stm: The stream to write the report to.
+ *
+ * Writes the flat and the hierarchical report of the profiling data of
+ * a coroutine to the stream.
+ *
+ * Returns: @true for success; @false if the coroutine is not being profiled.
+ *
+ * Since 0.2.0
+ */
+PCA_EXPORT bool
+purc_coroutine_dump_profile(purc_coroutine_t cor, purc_rwstream_t stm);
+
 /**
  * purc_get_rid_by_cid:
  *
@@ -872,6 +951,8 @@ purc_inst_ask_to_shutdown(purc_atom_t inst);
  *
  * Creates a new coroutine to run the specified vDOM in the specific instances.
  * If success, the new coroutine will be in READY state.
+ * A reference of @vdom is held for the request until the target instance
+ * has handled it; the reference of the caller is not released.
  *
  * Returns: The atom representing the new coroutine in the PurC instance,
  *      0 for error.
@@ -43,6 +43,7 @@
 #include "private/pcrdr.h"
 #include "private/msg-queue.h"
 #include "private/runners.h"
+#include "private/trace.h"
 #include "purc-runloop.h"
 
 #include "../interpreter/internal.h"
@@ -51,7 +52,6 @@
 #if USE(PTHREADS)          /* { */
 #include <pthread.h>
 #endif                     /* } */
-#include <stdio.h>  // fclose on inst->fp_log
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -290,6 +290,7 @@ static void _init_once(void)
         m->module_inited = 1;
     }
 
+    pctrace_init_once();
     _init_ok = true;
 }
 
@@ -325,8 +326,29 @@ struct pcinst* pcinst_current(void)
 
 static void enable_log_on_demand(void)
 {
+    static const char *level_names[] = {
+        "debug", "info", "warn", "error",
+    };
     const char *env_value;
 
+    purc_log_level_k level = PURC_LOG_LEVEL_DEBUG;
+    if ((env_value = getenv(PURC_ENVV_LOG_LEVEL))) {
+        for (size_t i = 0; i < PCA_TABLESIZE(level_names); i++) {
+            if (pcutils_strcasecmp(env_value, level_names[i]) == 0) {
+                level = (purc_log_level_k)i;
+                break;
+            }
+        }
+    }
+
+    purc_log_overflow_k overflow = PURC_LOG_OVERFLOW_DROP;
+    if ((env_value = getenv(PURC_ENVV_LOG_OVERWRITE))) {
+        if (*env_value == '1' || pcutils_strcasecmp(env_value, "true") == 0)
+            overflow = PURC_LOG_OVERFLOW_OVERWRITE;
+    }
+
+    purc_log_configure(level, overflow);
+
     env_value = getenv(PURC_ENVV_LOG_ENABLE);
     if (env_value == NULL)
         return;
@@ -396,10 +418,7 @@ static void cleanup_instance(struct pcinst *curr_inst)
         curr_inst->local_data_map = NULL;
     }
 
-    if (curr_inst->fp_log && curr_inst->fp_log != LOG_FILE_SYSLOG) {
-        fclose(curr_inst->fp_log);
-        curr_inst->fp_log = NULL;
-    }
+    pcinst_log_cleanup(curr_inst);
 
     if (curr_inst->bt) {
         pcdebug_backtrace_unref(curr_inst->bt);
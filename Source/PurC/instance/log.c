@@ -36,6 +36,507 @@
 #include "private/ports.h"
 
 #include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* the asynchronous writer needs C11 (stdatomic.h) and pthreads */
+#if HAVE(STDATOMIC_H) && USE(PTHREADS)
+#define USE_LOG_WRITER  1
+#else
+#define USE_LOG_WRITER  0
+#endif
+
+#if USE_LOG_WRITER
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#define LOG_RING_SIZE           (256 * 1024)    /* must be a power of 2 */
+#define LOG_RING_MASK           (LOG_RING_SIZE - 1)
+#define LOG_RECORD_ALIGN        16
+#define LOG_MAX_RECORD_SIZE     (LOG_RING_SIZE / 8)
+#define LOG_FORMAT_BUFF_SIZE    1024
+#define LOG_NR_IOVECS           64
+
+/* the writer wakes up periodically even if nobody kicks it */
+#define LOG_WRITER_PERIOD_MS    20
+/* the longest time to wait for an error record to be written out */
+#define LOG_FLUSH_TIMEOUT_MS    500
+
+#define LOG_LEVEL_PADDING       0xFFFF
+
+/*
+ * A record in the ring buffer; the text (`TAG >> message`) follows the
+ * header immediately. A record never wraps around the end of the ring:
+ * the remaining space is filled with a padding record instead.
+ */
+struct log_record {
+    uint32_t    size;       /* the size of the whole record, aligned */
+    uint16_t    level;      /* the level or LOG_LEVEL_PADDING */
+    uint16_t    msg_off;    /* the offset of the message in the text */
+    uint32_t    len;        /* the length of the text */
+    uint32_t    reserved;
+};
+
+/*
+ * The ring buffer has a single producer (the thread owning the instance)
+ * and a single consumer (the writer thread). `head` is only advanced by
+ * the producer; `tail` is advanced by the writer after the records are
+ * written, or by the producer with CAS when it overwrites the oldest
+ * records. Both are byte positions which never wrap.
+ */
+struct pclog_writer {
+    unsigned char      *ring;
+    /* the copy of records for the overwrite policy */
+    unsigned char      *batch;
+
+    _Atomic uint64_t    head;
+    _Atomic uint64_t    tail;
+    /* the position before which all records have been written out */
+    _Atomic uint64_t    done;
+    atomic_bool         overwrite;
+    /* the writer is writing the records from the ring directly */
+    atomic_bool         direct;
+    atomic_bool         stop;
+    atomic_size_t       nr_written;
+
+    /* the following counters are only touched by the producer */
+    size_t              nr_queued;
+    size_t              nr_dropped;
+    size_t              nr_overwritten;
+
+    FILE               *fp;     /* LOG_FILE_SYSLOG to use syslog */
+    int                 fd;
+    char               *ident;
+
+    pthread_t           thread;
+    pthread_mutex_t     lock;
+    pthread_cond_t      wakeup;
+    pthread_cond_t      drained;
+};
+
+static void
+deadline_after(struct timespec *ts, unsigned int ms)
+{
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+#if HAVE(VSYSLOG)
+static int
+syslog_priority(unsigned level)
+{
+    switch (level) {
+    case PURC_LOG_LEVEL_DEBUG:
+        return LOG_DEBUG;
+    case PURC_LOG_LEVEL_WARN:
+        return LOG_WARNING;
+    case PURC_LOG_LEVEL_ERROR:
+        return LOG_ERR;
+    default:
+        return LOG_INFO;
+    }
+}
+#endif
+
+static void
+write_iovecs(int fd, struct iovec *iov, int nr)
+{
+    while (nr > 0) {
+        ssize_t n = writev(fd, iov, nr);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            /* nowhere to report the error */
+            return;
+        }
+
+        while (nr > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            nr--;
+        }
+
+        if (nr > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+}
+
+/* writes out the records in [buf, buf + size); returns the number of them */
+static size_t
+emit_records(struct pclog_writer *w, const unsigned char *buf, size_t size)
+{
+    struct iovec iov[LOG_NR_IOVECS];
+    int nr_iov = 0;
+    size_t nr_records = 0;
+    size_t off = 0;
+
+    while (off < size) {
+        const struct log_record *rec = (const struct log_record *)(buf + off);
+        const char *text = (const char *)(rec + 1);
+        off += rec->size;
+
+        if (rec->level == LOG_LEVEL_PADDING)
+            continue;
+
+        nr_records++;
+#if HAVE(VSYSLOG)
+        if (w->fp == LOG_FILE_SYSLOG) {
+            syslog(syslog_priority(rec->level), "%.*s",
+                    (int)(rec->len - rec->msg_off), text + rec->msg_off);
+            continue;
+        }
+#endif
+
+        iov[nr_iov].iov_base = (void *)text;
+        iov[nr_iov].iov_len = rec->len;
+        if (++nr_iov == LOG_NR_IOVECS) {
+            write_iovecs(w->fd, iov, nr_iov);
+            nr_iov = 0;
+        }
+    }
+
+    if (nr_iov > 0)
+        write_iovecs(w->fd, iov, nr_iov);
+
+    return nr_records;
+}
+
+/* writes out all records queued so far */
+static void
+drain_records(struct pclog_writer *w)
+{
+    for (;;) {
+        uint64_t tail = atomic_load_explicit(&w->tail, memory_order_acquire);
+        uint64_t head = atomic_load_explicit(&w->head, memory_order_acquire);
+        if (tail == head)
+            break;
+
+        size_t off = tail & LOG_RING_MASK;
+        size_t size = head - tail;
+        size_t first = LOG_RING_SIZE - off;
+        if (first > size)
+            first = size;
+
+        size_t nr;
+        /* announce the direct write before checking the policy, which may
+           be changed by the producer at any time; see ring_reserve() */
+        atomic_store(&w->direct, true);
+        if (atomic_load(&w->overwrite)) {
+            atomic_store_explicit(&w->direct, false, memory_order_release);
+
+            /* the producer may reuse the space at any time; take a copy and
+               claim it, or try again if some records have been
+               overwritten meanwhile. */
+            memcpy(w->batch, w->ring + off, first);
+            memcpy(w->batch + first, w->ring, size - first);
+            if (!atomic_compare_exchange_strong(&w->tail, &tail, head))
+                continue;
+
+            nr = emit_records(w, w->batch, first);
+            nr += emit_records(w, w->batch + first, size - first);
+        }
+        else {
+            /* the space is not released until the records are written, so
+               we write them from the ring directly. */
+            nr = emit_records(w, w->ring + off, first);
+            nr += emit_records(w, w->ring, size - first);
+            atomic_compare_exchange_strong(&w->tail, &tail, head);
+            atomic_store_explicit(&w->direct, false, memory_order_release);
+        }
+
+        atomic_fetch_add_explicit(&w->nr_written, nr, memory_order_relaxed);
+        atomic_store_explicit(&w->done, head, memory_order_release);
+    }
+}
+
+static void *
+writer_routine(void *arg)
+{
+    struct pclog_writer *w = arg;
+
+    /* leave the signals to the other threads */
+    sigset_t set;
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+#if HAVE(VSYSLOG)
+    if (w->fp == LOG_FILE_SYSLOG)
+        openlog(w->ident, LOG_PID, LOG_USER);
+#endif
+
+    pthread_mutex_lock(&w->lock);
+    while (!atomic_load(&w->stop)) {
+        pthread_mutex_unlock(&w->lock);
+        drain_records(w);
+        pthread_mutex_lock(&w->lock);
+
+        pthread_cond_broadcast(&w->drained);
+        if (atomic_load(&w->stop) ||
+                atomic_load(&w->head) != atomic_load(&w->tail))
+            continue;
+
+        struct timespec ts;
+        deadline_after(&ts, LOG_WRITER_PERIOD_MS);
+        pthread_cond_timedwait(&w->wakeup, &w->lock, &ts);
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    drain_records(w);
+
+#if HAVE(VSYSLOG)
+    if (w->fp == LOG_FILE_SYSLOG)
+        closelog();
+#endif
+    return NULL;
+}
+
+static void
+writer_destroy(struct pclog_writer *w)
+{
+    pthread_cond_destroy(&w->drained);
+    pthread_cond_destroy(&w->wakeup);
+    pthread_mutex_destroy(&w->lock);
+    free(w->ident);
+    free(w->batch);
+    free(w->ring);
+    free(w);
+}
+
+static struct pclog_writer *
+writer_start(struct pcinst *inst)
+{
+    struct pclog_writer *w = calloc(1, sizeof(*w));
+    if (w == NULL)
+        return NULL;
+
+    w->ring = malloc(LOG_RING_SIZE);
+    w->batch = malloc(LOG_RING_SIZE);
+    if (w->ring == NULL || w->batch == NULL)
+        goto failed;
+
+    w->fp = inst->fp_log;
+    if (w->fp == LOG_FILE_SYSLOG) {
+        w->fd = -1;
+        w->ident = strdup(purc_atom_to_string(inst->endpoint_atom));
+        if (w->ident == NULL)
+            goto failed;
+    }
+    else {
+        /* the records bypass the buffer of the FILE object */
+        fflush(w->fp);
+        w->fd = fileno(w->fp);
+    }
+
+    atomic_init(&w->head, 0);
+    atomic_init(&w->tail, 0);
+    atomic_init(&w->done, 0);
+    atomic_init(&w->overwrite,
+            inst->log_overflow == PURC_LOG_OVERFLOW_OVERWRITE);
+    atomic_init(&w->direct, false);
+    atomic_init(&w->stop, false);
+    atomic_init(&w->nr_written, 0);
+
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->wakeup, NULL);
+    pthread_cond_init(&w->drained, NULL);
+
+    if (pthread_create(&w->thread, NULL, writer_routine, w)) {
+        writer_destroy(w);
+        return NULL;
+    }
+
+    return w;
+
+failed:
+    free(w->batch);
+    free(w->ring);
+    free(w);
+    return NULL;
+}
+
+static void
+writer_stop(struct pclog_writer *w)
+{
+    pthread_mutex_lock(&w->lock);
+    atomic_store(&w->stop, true);
+    pthread_cond_signal(&w->wakeup);
+    pthread_mutex_unlock(&w->lock);
+
+    pthread_join(w->thread, NULL);
+    writer_destroy(w);
+}
+
+static void
+writer_kick(struct pclog_writer *w)
+{
+    pthread_mutex_lock(&w->lock);
+    pthread_cond_signal(&w->wakeup);
+    pthread_mutex_unlock(&w->lock);
+}
+
+/* waits until the records before `pos` have been written out */
+static void
+writer_flush(struct pclog_writer *w, uint64_t pos)
+{
+    struct timespec ts;
+    deadline_after(&ts, LOG_FLUSH_TIMEOUT_MS);
+
+    pthread_mutex_lock(&w->lock);
+    pthread_cond_signal(&w->wakeup);
+    while (atomic_load(&w->done) < pos) {
+        if (pthread_cond_timedwait(&w->drained, &w->lock, &ts) == ETIMEDOUT)
+            break;
+    }
+    pthread_mutex_unlock(&w->lock);
+}
+
+/*
+ * Reserves `size` contiguous bytes in the ring for a record. Returns NULL
+ * if there is no enough space and the policy is to drop the new record.
+ */
+static unsigned char *
+ring_reserve(struct pclog_writer *w, size_t size)
+{
+    uint64_t head = atomic_load_explicit(&w->head, memory_order_relaxed);
+    size_t off = head & LOG_RING_MASK;
+    size_t room = LOG_RING_SIZE - off;
+    size_t need = (room < size) ? (room + size) : size;
+
+    for (;;) {
+        uint64_t tail = atomic_load_explicit(&w->tail, memory_order_acquire);
+        if (head + need - tail <= LOG_RING_SIZE)
+            break;
+
+        if (!atomic_load_explicit(&w->overwrite, memory_order_relaxed))
+            return NULL;
+
+        /* the policy was changed while the writer is writing the records
+           from the ring directly: they can not be overwritten. Pairs with
+           the sequentially consistent accesses in drain_records(). */
+        if (atomic_load(&w->direct))
+            return NULL;
+
+        /* discard the oldest record; the writer may be racing with us */
+        const struct log_record *rec;
+        rec = (const struct log_record *)(w->ring + (tail & LOG_RING_MASK));
+        bool padding = (rec->level == LOG_LEVEL_PADDING);
+        if (atomic_compare_exchange_weak(&w->tail, &tail, tail + rec->size)
+                && !padding)
+            w->nr_overwritten++;
+    }
+
+    if (room < size) {
+        struct log_record *pad = (struct log_record *)(w->ring + off);
+        pad->size = room;
+        pad->level = LOG_LEVEL_PADDING;
+        pad->msg_off = 0;
+        pad->len = 0;
+        atomic_store_explicit(&w->head, head + room, memory_order_release);
+        off = 0;
+    }
+
+    return w->ring + off;
+}
+
+static void
+queue_record(struct pcinst *inst, purc_log_level_k level,
+        const char *tag, const char *msg, va_list ap)
+{
+    struct pclog_writer *w = inst->log_writer;
+    char buf[LOG_FORMAT_BUFF_SIZE];
+
+    int tag_len = snprintf(buf, sizeof(buf), "%s >> ", tag);
+    if (tag_len < 0 || (size_t)tag_len >= sizeof(buf) / 2)
+        tag_len = 0;
+
+    va_list aq;
+    va_copy(aq, ap);
+    int n = vsnprintf(buf + tag_len, sizeof(buf) - tag_len, msg, aq);
+    va_end(aq);
+    if (n < 0)
+        return;
+
+    size_t len = tag_len + n;
+    size_t max_len = LOG_MAX_RECORD_SIZE - sizeof(struct log_record) - 1;
+    if (len > max_len)
+        len = max_len;
+
+    size_t size = sizeof(struct log_record) + len + 1;
+    size = (size + LOG_RECORD_ALIGN - 1) & ~(size_t)(LOG_RECORD_ALIGN - 1);
+
+    unsigned char *p = ring_reserve(w, size);
+    if (p == NULL) {
+        w->nr_dropped++;
+        return;
+    }
+
+    struct log_record *rec = (struct log_record *)p;
+    char *text = (char *)(rec + 1);
+    rec->size = size;
+    rec->level = level;
+    rec->msg_off = tag_len;
+    rec->len = len;
+
+    if (len < sizeof(buf)) {
+        memcpy(text, buf, len);
+    }
+    else {
+        /* too long for the local buffer; format it in place */
+        memcpy(text, buf, tag_len);
+        vsnprintf(text + tag_len, len - tag_len + 1, msg, ap);
+    }
+
+    uint64_t head = atomic_load_explicit(&w->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&w->tail, memory_order_relaxed);
+    atomic_store_explicit(&w->head, head + size, memory_order_release);
+    w->nr_queued++;
+
+    if (level >= PURC_LOG_LEVEL_ERROR) {
+        /* make sure an error (maybe followed by an abort) is written out */
+        writer_flush(w, head + size);
+    }
+    else if (head + size - tail >= LOG_RING_SIZE / 2) {
+        writer_kick(w);
+    }
+}
+
+#endif /* USE_LOG_WRITER */
+
+static void
+close_log(struct pcinst *inst)
+{
+#if USE_LOG_WRITER
+    if (inst->log_writer) {
+        writer_stop(inst->log_writer);
+        inst->log_writer = NULL;
+    }
+#endif
+
+    if (inst->fp_log && inst->fp_log != LOG_FILE_SYSLOG) {
+        fclose(inst->fp_log);
+    }
+    inst->fp_log = NULL;
+}
+
+void
+pcinst_log_cleanup(struct pcinst *inst)
+{
+    close_log(inst);
+}
 
 bool purc_enable_log(bool enable, bool use_syslog)
 {
@@ -46,8 +547,8 @@ bool purc_enable_log(bool enable, bool use_syslog)
     if (enable) {
 #if HAVE(VSYSLOG)
         if (use_syslog) {
-            if (inst->fp_log && inst->fp_log != LOG_FILE_SYSLOG) {
-                fclose(inst->fp_log);
+            if (inst->fp_log != LOG_FILE_SYSLOG) {
+                close_log(inst);
             }
             inst->fp_log = LOG_FILE_SYSLOG;
         }
@@ -74,22 +575,101 @@ bool purc_enable_log(bool enable, bool use_syslog)
                 return false;
             }
         }
+
+#if USE_LOG_WRITER
+        /* NOTE: fall back to the synchronous way if failed to start the
+           writer */
+        if (inst->log_writer == NULL)
+            inst->log_writer = writer_start(inst);
+#endif
     }
-    else if (inst->fp_log && inst->fp_log != LOG_FILE_SYSLOG) {
-        fclose(inst->fp_log);
-        inst->fp_log = NULL;
+    else {
+        close_log(inst);
+    }
+
+    return true;
+}
+
+bool purc_log_configure(purc_log_level_k min_level,
+        purc_log_overflow_k overflow)
+{
+    struct pcinst* inst = pcinst_current();
+    if (inst == NULL)
+        return false;
+
+    if (min_level > PURC_LOG_LEVEL_ERROR ||
+            overflow > PURC_LOG_OVERFLOW_OVERWRITE) {
+        purc_set_error(PURC_ERROR_INVALID_VALUE);
+        return false;
+    }
+
+    inst->log_level = min_level;
+    inst->log_overflow = overflow;
+#if USE_LOG_WRITER
+    if (inst->log_writer) {
+        atomic_store(&inst->log_writer->overwrite,
+                overflow == PURC_LOG_OVERFLOW_OVERWRITE);
     }
+#endif
 
     return true;
 }
 
+bool purc_log_get_stats(struct purc_log_stats *stats)
+{
+    struct pcinst* inst = pcinst_current();
+    if (inst == NULL)
+        return false;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->nr_filtered = inst->nr_log_filtered;
+#if USE_LOG_WRITER
+    struct pclog_writer *w = inst->log_writer;
+    if (w) {
+        stats->nr_queued = w->nr_queued;
+        stats->nr_written = atomic_load(&w->nr_written);
+        stats->nr_dropped = w->nr_dropped;
+        stats->nr_overwritten = w->nr_overwritten;
+    }
+#endif
+
+    return true;
+}
+
+static purc_log_level_k
+level_of_tag(const char *tag)
+{
+    if (strcmp(tag, "DEBUG") == 0)
+        return PURC_LOG_LEVEL_DEBUG;
+    else if (strcmp(tag, "WARN") == 0)
+        return PURC_LOG_LEVEL_WARN;
+    else if (strcmp(tag, "ERROR") == 0)
+        return PURC_LOG_LEVEL_ERROR;
+
+    return PURC_LOG_LEVEL_INFO;
+}
+
 void purc_log_with_tag(const char *tag, const char *msg, va_list ap)
 {
     FILE *fp = NULL;
     struct pcinst* inst = pcinst_current();
+    purc_log_level_k level = level_of_tag(tag);
 
-    if (inst)
+    if (inst) {
+        /* filter out the message before formatting it */
+        if (level < inst->log_level) {
+            inst->nr_log_filtered++;
+            return;
+        }
+
+#if USE_LOG_WRITER
+        if (inst->log_writer) {
+            queue_record(inst, level, tag, msg, ap);
+            return;
+        }
+#endif
         fp = inst->fp_log;
+    }
 
 #if HAVE(VSYSLOG)
     if (fp) {
@@ -120,4 +700,3 @@ void purc_log_with_tag(const char *tag, const char *msg, va_list ap)
 #endif
     }
 }
-
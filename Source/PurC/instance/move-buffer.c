@@ -37,6 +37,7 @@
 #include "private/utils.h"
 #include "private/ports.h"
 #include "private/debug.h"
+#include "private/trace.h"
 
 #include <stdatomic.h>
 #include <assert.h>
@@ -390,6 +391,7 @@ purc_inst_move_message(purc_atom_t inst_to, pcrdr_msg *msg)
         }
 
         do_move_message(inst, msg);
+        PCTRACE_ASYNC_BEGIN(PCTRACE_CAT_MSG, "move_message", msg);
 
         purc_rwlock_writer_lock(&mb->lock);
         struct pcrdr_msg_hdr *hdr = (struct pcrdr_msg_hdr *)msg;
@@ -429,6 +431,8 @@ purc_inst_move_message(purc_atom_t inst_to, pcrdr_msg *msg)
                     }
                 }
 
+                PCTRACE_ASYNC_BEGIN(PCTRACE_CAT_MSG, "move_message", my_msg);
+
                 purc_rwlock_writer_lock(&mb->lock);
                 struct pcrdr_msg_hdr *hdr = (struct pcrdr_msg_hdr *)my_msg;
                 list_add_tail(&hdr->ln, &mb->msgs);
@@ -579,8 +583,10 @@ purc_inst_take_away_message(size_t index)
     }
     purc_rwlock_writer_unlock(&mb->lock);
 
-    if (msg)
+    if (msg) {
+        PCTRACE_ASYNC_END(PCTRACE_CAT_MSG, "move_message", msg);
         do_take_message(inst, msg);
+    }
 
 done:
     purc_rwlock_reader_unlock(&mb_lock);
@@ -29,12 +29,28 @@
 #include "private/instance.h"
 #include "private/utils.h"
 #include "private/variant.h"
+#include "private/hashtable.h"
 #include "private/msg-queue.h"
+#include "private/trace.h"
 
 #if HAVE(GLIB)
     #include <gmodule.h>
 #endif
 
+#define EVENT_BUCKETS_MIN       16
+
+/* The events having the same reduce key (the target, the event name with
+   its sub-type and the element), kept in queue order. */
+struct pcinst_event_slot {
+    struct pcinst_event_slot   *next;
+    uint64_t                    hash;
+
+    size_t                      nr_msgs;
+    size_t                      sz_msgs;
+    pcrdr_msg                 **msgs;
+    pcrdr_msg                  *msg;    // storage for the first message
+};
+
 struct pcinst_msg_queue *
 pcinst_msg_queue_create(void)
 {
@@ -52,6 +68,9 @@ pcinst_msg_queue_create(void)
         goto done;
     }
 
+    queue->event_buckets = NULL;
+    queue->nr_event_buckets = 0;
+    queue->nr_event_slots = 0;
     queue->state = 0;
     queue->nr_msgs = 0;
     list_head_init(&queue->req_msgs);
@@ -91,6 +110,33 @@ grind_msg_list(struct list_head *msgs)
     return nr;
 }
 
+static void
+free_event_slot(struct pcinst_event_slot *slot)
+{
+    if (slot->msgs != &slot->msg) {
+        free(slot->msgs);
+    }
+    free(slot);
+}
+
+static void
+clear_event_index(struct pcinst_msg_queue *queue)
+{
+    for (size_t i = 0; i < queue->nr_event_buckets; i++) {
+        struct pcinst_event_slot *slot = queue->event_buckets[i];
+        while (slot) {
+            struct pcinst_event_slot *next = slot->next;
+            free_event_slot(slot);
+            slot = next;
+        }
+    }
+
+    free(queue->event_buckets);
+    queue->event_buckets = NULL;
+    queue->nr_event_buckets = 0;
+    queue->nr_event_slots = 0;
+}
+
 ssize_t
 pcinst_msg_queue_destroy(struct pcinst_msg_queue *queue)
 {
@@ -102,6 +148,7 @@ pcinst_msg_queue_destroy(struct pcinst_msg_queue *queue)
     nr += grind_msg_list(&queue->event_msgs);
     nr += grind_msg_list(&queue->void_msgs);
     queue->nr_msgs -= nr;
+    clear_event_index(queue);
 
     purc_rwlock_writer_unlock(&queue->lock);
 
@@ -124,32 +171,231 @@ is_event_match(pcrdr_msg *left, pcrdr_msg *right)
     return false;
 }
 
-int
-reduce_event(struct pcinst_msg_queue *queue, pcrdr_msg *msg, bool tail)
+static inline uint64_t
+hash_mix(uint64_t h, uint64_t v)
 {
-    struct pcinst_msg_hdr *hdr;
-    struct list_head *p, *n;
-    list_for_each_safe(p, n, &queue->event_msgs) {
-        hdr = list_entry(p, struct pcinst_msg_hdr, ln);
-        pcrdr_msg *orig = (pcrdr_msg*) hdr;
-        if (is_event_match(orig, msg)) {
-            if (msg->reduceOpt == PCRDR_MSG_EVENT_REDUCE_OPT_IGNORE) {
-                return 0;
+    h = (h ^ v) * 0x9E3779B97F4A7C15ULL;
+    return h ^ (h >> 32);
+}
+
+/* The hash must agree with purc_variant_is_equal_to(). The numbers are
+   compared with a tolerance, and the containers by their members which may
+   change while the event is queued, so only their types are hashed. */
+static uint64_t
+hash_variant(purc_variant_t v)
+{
+    const unsigned char *bytes;
+    size_t nr_bytes;
+
+    if (v == PURC_VARIANT_INVALID)
+        return 0;
+
+    uint64_t h = v->type + 1;
+    switch (v->type) {
+    case PURC_VARIANT_TYPE_BOOLEAN:
+        h = hash_mix(h, v->b);
+        break;
+
+    case PURC_VARIANT_TYPE_EXCEPTION:
+        h = hash_mix(h, v->atom);
+        break;
+
+    case PURC_VARIANT_TYPE_LONGINT:
+        h = hash_mix(h, (uint64_t)v->i64);
+        break;
+
+    case PURC_VARIANT_TYPE_ULONGINT:
+        h = hash_mix(h, v->u64);
+        break;
+
+    case PURC_VARIANT_TYPE_ATOMSTRING:
+        h = hash_mix(h,
+                pchash_perllike_str_hash(purc_atom_to_string(v->atom)));
+        break;
+
+    case PURC_VARIANT_TYPE_STRING:
+        h = hash_mix(h,
+                pchash_perllike_str_hash(purc_variant_get_string_const(v)));
+        break;
+
+    case PURC_VARIANT_TYPE_BSEQUENCE:
+        bytes = purc_variant_get_bytes_const(v, &nr_bytes);
+        for (size_t i = 0; i < nr_bytes; i++) {
+            h = (h ^ bytes[i]) * 0x100000001B3ULL;
+        }
+        break;
+
+    case PURC_VARIANT_TYPE_DYNAMIC:
+    case PURC_VARIANT_TYPE_NATIVE:
+        h = hash_mix(h, (uintptr_t)v->ptr_ptr[0]);
+        h = hash_mix(h, (uintptr_t)v->ptr_ptr[1]);
+        break;
+
+    default:
+        break;
+    }
+
+    return h;
+}
+
+static uint64_t
+hash_event(pcrdr_msg *msg)
+{
+    uint64_t h = hash_mix(msg->target, msg->targetValue);
+    h = hash_mix(h, hash_variant(msg->eventName));
+    return hash_mix(h, hash_variant(msg->elementValue));
+}
+
+static struct pcinst_event_slot *
+find_event_slot(struct pcinst_msg_queue *queue, pcrdr_msg *msg, uint64_t hash)
+{
+    if (queue->nr_event_buckets == 0) {
+        return NULL;
+    }
+
+    struct pcinst_event_slot *slot;
+    slot = queue->event_buckets[hash & (queue->nr_event_buckets - 1)];
+    for (; slot; slot = slot->next) {
+        if (slot->hash == hash && is_event_match(slot->msgs[0], msg)) {
+            return slot;
+        }
+    }
+
+    return NULL;
+}
+
+static int
+grow_event_buckets(struct pcinst_msg_queue *queue)
+{
+    size_t nr_buckets = queue->nr_event_buckets ?
+        queue->nr_event_buckets * 2 : EVENT_BUCKETS_MIN;
+    struct pcinst_event_slot **buckets;
+
+    buckets = calloc(nr_buckets, sizeof(buckets[0]));
+    if (buckets == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < queue->nr_event_buckets; i++) {
+        struct pcinst_event_slot *slot = queue->event_buckets[i];
+        while (slot) {
+            struct pcinst_event_slot *next = slot->next;
+            size_t n = slot->hash & (nr_buckets - 1);
+            slot->next = buckets[n];
+            buckets[n] = slot;
+            slot = next;
+        }
+    }
+
+    free(queue->event_buckets);
+    queue->event_buckets = buckets;
+    queue->nr_event_buckets = nr_buckets;
+    return 0;
+}
+
+static int
+index_event(struct pcinst_msg_queue *queue, struct pcinst_event_slot *slot,
+        pcrdr_msg *msg, uint64_t hash, bool tail)
+{
+    if (slot == NULL) {
+        if (queue->nr_event_slots >= queue->nr_event_buckets) {
+            // keep on the current buckets if failed to grow them
+            if (grow_event_buckets(queue) && queue->nr_event_buckets == 0) {
+                return -1;
+            }
+        }
+
+        if ((slot = malloc(sizeof(*slot))) == NULL) {
+            return -1;
+        }
+
+        size_t n = hash & (queue->nr_event_buckets - 1);
+        slot->next = queue->event_buckets[n];
+        slot->hash = hash;
+        slot->nr_msgs = 0;
+        slot->sz_msgs = 1;
+        slot->msgs = &slot->msg;
+        queue->event_buckets[n] = slot;
+        queue->nr_event_slots++;
+    }
+    else if (slot->nr_msgs == slot->sz_msgs) {
+        size_t sz_msgs = slot->sz_msgs * 2;
+        pcrdr_msg **msgs;
+
+        if (slot->msgs == &slot->msg) {
+            msgs = malloc(sizeof(msgs[0]) * sz_msgs);
+            if (msgs) {
+                msgs[0] = slot->msg;
             }
-            // OVERLAY : data
-            if (orig->data) {
-                purc_variant_unref(orig->data);
-                orig->data = PURC_VARIANT_INVALID;
+        }
+        else {
+            msgs = realloc(slot->msgs, sizeof(msgs[0]) * sz_msgs);
+        }
+
+        if (msgs == NULL) {
+            return -1;
+        }
+
+        slot->msgs = msgs;
+        slot->sz_msgs = sz_msgs;
+    }
+
+    if (!tail) {
+        memmove(slot->msgs + 1, slot->msgs,
+                sizeof(slot->msgs[0]) * slot->nr_msgs);
+        slot->msgs[0] = msg;
+    }
+    else {
+        slot->msgs[slot->nr_msgs] = msg;
+    }
+    slot->nr_msgs++;
+    return 0;
+}
+
+/* Removes the message from the index. The message is looked up by address:
+   the hash of its key does not change while it is queued. */
+static void
+unindex_event(struct pcinst_msg_queue *queue, pcrdr_msg *msg)
+{
+    if (queue->nr_event_buckets == 0) {
+        return;
+    }
+
+    uint64_t hash = hash_event(msg);
+    struct pcinst_event_slot **pprev, *slot;
+    pprev = queue->event_buckets + (hash & (queue->nr_event_buckets - 1));
+    for (; (slot = *pprev); pprev = &slot->next) {
+        if (slot->hash != hash) {
+            continue;
+        }
+
+        for (size_t i = 0; i < slot->nr_msgs; i++) {
+            if (slot->msgs[i] != msg) {
+                continue;
             }
-            if (msg->data) {
-                orig->data = msg->data;
-                purc_variant_ref(orig->data);
+
+            slot->nr_msgs--;
+            memmove(slot->msgs + i, slot->msgs + i + 1,
+                    sizeof(slot->msgs[0]) * (slot->nr_msgs - i));
+            if (slot->nr_msgs == 0) {
+                *pprev = slot->next;
+                free_event_slot(slot);
+                queue->nr_event_slots--;
             }
-            return 0;
+            return;
         }
     }
+}
+
+static void
+add_event(struct pcinst_msg_queue *queue, struct pcinst_event_slot *slot,
+        pcrdr_msg *msg, uint64_t hash, bool tail)
+{
+    struct pcinst_msg_hdr *hdr = (struct pcinst_msg_hdr *)msg;
+
+    // an event failed to be indexed is only missed by the later reductions
+    index_event(queue, slot, msg, hash, tail);
 
-    hdr = (struct pcinst_msg_hdr *)msg;
     if (tail) {
         list_add_tail(&hdr->ln, &queue->event_msgs);
     }
@@ -158,15 +404,50 @@ reduce_event(struct pcinst_msg_queue *queue, pcrdr_msg *msg, bool tail)
     }
     queue->state |= MSG_QS_EVENT;
     queue->nr_msgs++;
+}
+
+int
+reduce_event(struct pcinst_msg_queue *queue, pcrdr_msg *msg, bool tail)
+{
+    uint64_t hash = hash_event(msg);
+    struct pcinst_event_slot *slot = find_event_slot(queue, msg, hash);
 
+    if (slot) {
+        // the earliest queued event of the same key
+        pcrdr_msg *orig = slot->msgs[0];
+        if (msg->reduceOpt == PCRDR_MSG_EVENT_REDUCE_OPT_IGNORE) {
+            return 0;
+        }
+        // OVERLAY : data
+        if (orig->data) {
+            purc_variant_unref(orig->data);
+            orig->data = PURC_VARIANT_INVALID;
+        }
+        if (msg->data) {
+            orig->data = msg->data;
+            purc_variant_ref(orig->data);
+        }
+        return 0;
+    }
+
+    add_event(queue, NULL, msg, hash, tail);
     return 0;
 }
 
+static void
+keep_event(struct pcinst_msg_queue *queue, pcrdr_msg *msg, bool tail)
+{
+    uint64_t hash = hash_event(msg);
+    add_event(queue, find_event_slot(queue, msg, hash), msg, hash, tail);
+}
+
 int
 pcinst_msg_queue_append(struct pcinst_msg_queue *queue, pcrdr_msg *msg)
 {
     struct pcinst_msg_hdr *hdr = (struct pcinst_msg_hdr *)msg;
 
+    PCTRACE_INSTANT(PCTRACE_CAT_MSG, "queue_append", msg->type);
+
     purc_rwlock_writer_lock(&queue->lock);
 
     switch (msg->type) {
@@ -191,9 +472,7 @@ pcinst_msg_queue_append(struct pcinst_msg_queue *queue, pcrdr_msg *msg)
     case PCRDR_MSG_TYPE_EVENT:
         queue->state |= MSG_QS_EVENT;
         if (msg->reduceOpt == PCRDR_MSG_EVENT_REDUCE_OPT_KEEP) {
-            list_add_tail(&hdr->ln, &queue->event_msgs);
-            queue->state |= MSG_QS_EVENT;
-            queue->nr_msgs++;
+            keep_event(queue, msg, true);
         }
         else {
             reduce_event(queue, msg, true);
@@ -240,9 +519,7 @@ pcinst_msg_queue_prepend(struct pcinst_msg_queue *queue, pcrdr_msg *msg)
     case PCRDR_MSG_TYPE_EVENT:
         queue->state |= MSG_QS_EVENT;
         if (msg->reduceOpt == PCRDR_MSG_EVENT_REDUCE_OPT_KEEP) {
-            list_add(&hdr->ln, &queue->event_msgs);
-            queue->state |= MSG_QS_EVENT;
-            queue->nr_msgs++;
+            keep_event(queue, msg, false);
         }
         else {
             reduce_event(queue, msg, false);
@@ -271,6 +548,9 @@ get_msg(struct pcinst_msg_queue *queue, struct list_head *msgs)
     pcrdr_msg *msg = (pcrdr_msg *)hdr;
     list_del(&hdr->ln);
     queue->nr_msgs--;
+    if (msgs == &queue->event_msgs) {
+        unindex_event(queue, msg);
+    }
     if (list_empty(msgs)) {
         queue->state &= ~MSG_QS_RES;
     }
@@ -312,6 +592,9 @@ pcinst_msg_queue_get_msg(struct pcinst_msg_queue *queue)
 
 done:
     purc_rwlock_writer_unlock(&queue->lock);
+
+    if (msg)
+        PCTRACE_INSTANT(PCTRACE_CAT_MSG, "queue_get_msg", msg->type);
     return msg;
 }
 
@@ -334,6 +617,7 @@ pcinst_msg_queue_get_event_by_element(struct pcinst_msg_queue *queue,
                 purc_variant_is_equal_to(m->eventName, event_name)) {
             msg = m;
             list_del(&hdr->ln);
+            unindex_event(queue, msg);
             break;
         }
     }
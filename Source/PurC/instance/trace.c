@@ -0,0 +1,419 @@
+/*
+ * trace.c - The implementation of the static trace points.
+ * Date: 2022/10/18
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "purc-helpers.h"
+#include "purc-errors.h"
+
+#include "private/instance.h"
+#include "private/trace.h"
+#include "private/list.h"
+#include "private/tls.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int pctrace_enabled;
+
+/* the per-thread buffers need C11 (stdatomic.h) and pthreads */
+#if HAVE(STDATOMIC_H) && USE(PTHREADS)
+
+#include <stdatomic.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TRACE_NR_EVENTS         (1 << 15)   /* must be a power of 2 */
+#define TRACE_EVENTS_MASK       (TRACE_NR_EVENTS - 1)
+
+/* the signal to dump the events when `PURC_TRACE` is set */
+#define TRACE_DUMP_SIGNAL       SIGUSR2
+
+struct trace_event {
+    uint64_t            ts;     /* CLOCK_MONOTONIC in nanoseconds */
+    const char         *cat;
+    const char         *name;
+    uint64_t            arg;    /* the id of an async event or the value */
+    char                ph;
+};
+
+/*
+ * The ring buffer of a thread. Only the owner thread writes the events;
+ * the oldest ones are overwritten silently when the buffer is full.
+ *
+ * The dumper copies the events without stopping the owner, and then drops
+ * the copied ones which might have been overwritten meanwhile: the owner
+ * bumps `claimed` before writing a slot, and `head` after the slot is
+ * written completely.
+ */
+struct trace_buffer {
+    struct list_head    ln;
+    unsigned            tid;
+    /* the owner thread has exited; protected by buffers_lock */
+    bool                retired;
+    /* the endpoint name of the instance; protected by buffers_lock */
+    char                name[PURC_LEN_ENDPOINT_NAME + 1];
+
+    atomic_uint_fast64_t    claimed;
+    atomic_uint_fast64_t    head;
+
+    struct trace_event  events[TRACE_NR_EVENTS];
+};
+
+static pthread_mutex_t buffers_lock = PTHREAD_MUTEX_INITIALIZER;
+static LIST_HEAD(buffers);
+static unsigned nr_buffers;
+
+/* serializes the dumpers */
+static pthread_mutex_t dump_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t buffer_key;
+
+PURC_DEFINE_THREAD_LOCAL(struct trace_buffer *, my_buffer);
+
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* called when the owner thread exits; the buffer is freed by next dump */
+static void retire_buffer(void *data)
+{
+    struct trace_buffer *buf = data;
+
+    /* a trace point called by other destructors attaches a new buffer */
+    struct trace_buffer **my = PURC_GET_THREAD_LOCAL(my_buffer);
+    if (my)
+        *my = NULL;
+
+    pthread_mutex_lock(&buffers_lock);
+    buf->retired = true;
+    pthread_mutex_unlock(&buffers_lock);
+}
+
+static void create_key(void)
+{
+    pthread_key_create(&buffer_key, retire_buffer);
+}
+
+static struct trace_buffer *attach_buffer(void)
+{
+    struct trace_buffer *buf = malloc(sizeof(*buf));
+    if (buf == NULL)
+        return NULL;
+
+    buf->retired = false;
+    buf->name[0] = '\0';
+    atomic_init(&buf->claimed, 0);
+    atomic_init(&buf->head, 0);
+
+    pthread_once(&key_once, create_key);
+    pthread_setspecific(buffer_key, buf);
+
+    pthread_mutex_lock(&buffers_lock);
+    buf->tid = ++nr_buffers;
+    list_add_tail(&buf->ln, &buffers);
+    pthread_mutex_unlock(&buffers_lock);
+
+    return buf;
+}
+
+void pctrace_record(char ph, const char *cat, const char *name, uint64_t arg)
+{
+    struct trace_buffer **my = PURC_GET_THREAD_LOCAL(my_buffer);
+    if (UNLIKELY(my == NULL))
+        return;
+
+    struct trace_buffer *buf = *my;
+    if (UNLIKELY(buf == NULL)) {
+        if ((buf = attach_buffer()) == NULL)
+            return;
+        *my = buf;
+    }
+
+    /* the thread is named after the first instance created in it */
+    if (UNLIKELY(buf->name[0] == '\0')) {
+        struct pcinst *inst = pcinst_current();
+        if (inst) {
+            pthread_mutex_lock(&buffers_lock);
+            strcpy(buf->name, inst->endpoint_name);
+            pthread_mutex_unlock(&buffers_lock);
+        }
+    }
+
+    uint64_t pos = atomic_load_explicit(&buf->head, memory_order_relaxed);
+    atomic_store_explicit(&buf->claimed, pos + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    struct trace_event *ev = buf->events + (pos & TRACE_EVENTS_MASK);
+    ev->ts = now_ns();
+    ev->cat = cat;
+    ev->name = name;
+    ev->arg = arg;
+    ev->ph = ph;
+
+    atomic_store_explicit(&buf->head, pos + 1, memory_order_release);
+}
+
+/* copies the valid events of a buffer and returns the number of them */
+static size_t copy_events(struct trace_buffer *buf, struct trace_event *to)
+{
+    uint64_t head = atomic_load_explicit(&buf->head, memory_order_acquire);
+    uint64_t start = head > TRACE_NR_EVENTS ? head - TRACE_NR_EVENTS : 0;
+
+    for (uint64_t pos = start; pos < head; pos++) {
+        to[pos - start] = buf->events[pos & TRACE_EVENTS_MASK];
+    }
+
+    /* the events before `claimed - TRACE_NR_EVENTS` might be overwritten */
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t claimed = atomic_load_explicit(&buf->claimed,
+            memory_order_relaxed);
+    uint64_t valid = claimed > TRACE_NR_EVENTS ?
+        claimed - TRACE_NR_EVENTS : 0;
+
+    if (valid > start) {
+        if (valid >= head)
+            return 0;
+        memmove(to, to + (valid - start),
+                (head - valid) * sizeof(struct trace_event));
+        start = valid;
+    }
+
+    return head - start;
+}
+
+static void write_event(FILE *fp, int pid, unsigned tid,
+        const struct trace_event *ev)
+{
+    fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\","
+            "\"ts\":%" PRIu64 ".%03u,\"pid\":%d,\"tid\":%u",
+            ev->name, ev->cat, ev->ph,
+            ev->ts / 1000, (unsigned)(ev->ts % 1000), pid, tid);
+
+    switch (ev->ph) {
+    case PCTRACE_PH_ASYNC_BEGIN:
+    case PCTRACE_PH_ASYNC_END:
+        fprintf(fp, ",\"id\":\"0x%" PRIx64 "\"}", ev->arg);
+        break;
+
+    case PCTRACE_PH_INSTANT:
+        fprintf(fp, ",\"s\":\"t\",\"args\":{\"value\":%" PRIu64 "}}",
+                ev->arg);
+        break;
+
+    default:
+        fputs("}", fp);
+        break;
+    }
+}
+
+bool purc_dump_trace(const char *file)
+{
+    FILE *fp = fopen(file, "w");
+    if (fp == NULL) {
+        purc_set_error(purc_error_from_errno(errno));
+        return false;
+    }
+
+    struct trace_event *events;
+    events = malloc(sizeof(struct trace_event) * TRACE_NR_EVENTS);
+    if (events == NULL) {
+        fclose(fp);
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return false;
+    }
+
+    pthread_mutex_lock(&dump_lock);
+
+    /* take the retired buffers off the list; they will be freed below */
+    LIST_HEAD(retired);
+    struct list_head *p, *n;
+    pthread_mutex_lock(&buffers_lock);
+    list_for_each_safe(p, n, &buffers) {
+        struct trace_buffer *buf = list_entry(p, struct trace_buffer, ln);
+        if (buf->retired) {
+            list_del(&buf->ln);
+            list_add_tail(&buf->ln, &retired);
+        }
+    }
+    pthread_mutex_unlock(&buffers_lock);
+
+    int pid = (int)getpid();
+    fprintf(fp, "{\"traceEvents\":[\n"
+            "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,"
+            "\"args\":{\"name\":\"purc\"}}", pid);
+
+    for (int pass = 0; pass < 2; pass++) {
+        /* the live buffers are never freed while dump_lock is held */
+        p = pass ? retired.next : buffers.next;
+        for (; p != (pass ? &retired : &buffers); ) {
+            struct trace_buffer *buf = list_entry(p, struct trace_buffer, ln);
+            char name[PURC_LEN_ENDPOINT_NAME + 16];
+
+            pthread_mutex_lock(&buffers_lock);
+            if (buf->name[0])
+                strcpy(name, buf->name);
+            else
+                sprintf(name, "thread-%u", buf->tid);
+            p = p->next;
+            pthread_mutex_unlock(&buffers_lock);
+
+            fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\","
+                    "\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                    pid, buf->tid, name);
+
+            size_t nr_events = copy_events(buf, events);
+            for (size_t i = 0; i < nr_events; i++) {
+                write_event(fp, pid, buf->tid, events + i);
+            }
+        }
+    }
+
+    fputs("\n],\"displayTimeUnit\":\"ns\"}\n", fp);
+
+    list_for_each_safe(p, n, &retired) {
+        struct trace_buffer *buf = list_entry(p, struct trace_buffer, ln);
+        list_del(&buf->ln);
+        free(buf);
+    }
+
+    pthread_mutex_unlock(&dump_lock);
+    free(events);
+
+    if (fclose(fp)) {
+        purc_set_error(purc_error_from_errno(errno));
+        return false;
+    }
+
+    return true;
+}
+
+static char *dump_file;
+static sem_t dump_sem;
+
+static void dump_signal_handler(int sig)
+{
+    UNUSED_PARAM(sig);
+
+    /* NOTE: sem_post() is async-signal-safe, while writing the file is not */
+    sem_post(&dump_sem);
+}
+
+static void *dumper_main(void *arg)
+{
+    UNUSED_PARAM(arg);
+
+    sigset_t set;
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    for (;;) {
+        if (sem_wait(&dump_sem) == 0)
+            purc_dump_trace(dump_file);
+        else if (errno != EINTR)
+            break;
+    }
+
+    return NULL;
+}
+
+static void dump_at_exit(void)
+{
+    purc_dump_trace(dump_file);
+}
+
+void pctrace_init_once(void)
+{
+    const char *env_value = getenv(PURC_ENVV_TRACE);
+    if (env_value == NULL || env_value[0] == '\0')
+        return;
+
+    if ((dump_file = strdup(env_value)) == NULL)
+        return;
+
+    if (sem_init(&dump_sem, 0, 0) == 0) {
+        pthread_t th;
+        if (pthread_create(&th, NULL, dumper_main, NULL) == 0) {
+            pthread_detach(th);
+
+            struct sigaction sa;
+            memset(&sa, 0, sizeof(sa));
+            sa.sa_handler = dump_signal_handler;
+            sa.sa_flags = SA_RESTART;
+            sigemptyset(&sa.sa_mask);
+            sigaction(TRACE_DUMP_SIGNAL, &sa, NULL);
+        }
+    }
+
+    atexit(dump_at_exit);
+    purc_enable_trace(true);
+}
+
+bool purc_enable_trace(bool enable)
+{
+    __atomic_store_n(&pctrace_enabled, enable ? 1 : 0, __ATOMIC_RELAXED);
+    return true;
+}
+
+#else   /* HAVE(STDATOMIC_H) && USE(PTHREADS) */
+
+void pctrace_record(char ph, const char *cat, const char *name, uint64_t arg)
+{
+    UNUSED_PARAM(ph);
+    UNUSED_PARAM(cat);
+    UNUSED_PARAM(name);
+    UNUSED_PARAM(arg);
+}
+
+void pctrace_init_once(void)
+{
+}
+
+bool purc_enable_trace(bool enable)
+{
+    if (enable) {
+        purc_set_error(PURC_ERROR_NOT_SUPPORTED);
+        return false;
+    }
+
+    return true;
+}
+
+bool purc_dump_trace(const char *file)
+{
+    UNUSED_PARAM(file);
+    purc_set_error(PURC_ERROR_NOT_SUPPORTED);
+    return false;
+}
+
+#endif  /* !(HAVE(STDATOMIC_H) && USE(PTHREADS)) */
+
@@ -239,7 +239,12 @@ pcintr_schedule_child_co_from_string(const char *hvml, purc_atom_t curator,
         return 0;
     }
 
-    return pcintr_schedule_child_co(vdom, curator, runner, rdr_target,
-            request, body_id, create_runner);
+    // the vdom is owned by the cache of the loader, which may drop it
+    // at any time; hold a reference until it is scheduled or failed
+    pcvdom_document_ref(vdom);
+    purc_atom_t cid = pcintr_schedule_child_co(vdom, curator, runner,
+            rdr_target, request, body_id, create_runner);
+    pcvdom_document_unref(vdom);
+    return cid;
 }
 
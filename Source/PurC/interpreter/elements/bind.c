@@ -200,39 +200,6 @@ post_process_val_by_level(pcintr_coroutine_t co,
     }
 }
 
-static bool
-match_id(pcintr_coroutine_t co,
-        struct pcvdom_element *elem, const char *id)
-{
-    struct pcvdom_attr *attr;
-    attr = pcvdom_element_find_attr(elem, "id");
-    if (!attr)
-        return false;
-
-    bool silently = false;
-    purc_variant_t v = pcvcm_eval(attr->val, &co->stack, silently);
-    purc_clr_error();
-    if (v == PURC_VARIANT_INVALID)
-        return false;
-
-    bool matched = false;
-
-    do {
-        if (purc_variant_is_string(v) == false)
-            break;
-        const char *sv = purc_variant_get_string_const(v);
-        if (!sv)
-            break;
-
-        if (strcmp(sv, id) == 0)
-            matched = true;
-    } while (0);
-
-    purc_variant_unref(v);
-
-    return matched;
-}
-
 static int
 post_process_val_by_id(pcintr_coroutine_t co,
         struct pcintr_stack_frame *frame, purc_variant_t src, const char *id)
@@ -240,8 +207,6 @@ post_process_val_by_id(pcintr_coroutine_t co,
     struct ctxt_for_bind *ctxt;
     ctxt = (struct ctxt_for_bind*)frame->ctxt;
 
-    bool silently = frame->silently;
-
     if (ctxt->temporarily) {
         purc_set_error(PURC_ERROR_NOT_IMPLEMENTED);
         return -1;
@@ -257,25 +222,11 @@ post_process_val_by_id(pcintr_coroutine_t co,
                     "no vdom element exists");
             return -1;
         }
-        while (p) {
-            if (p == NULL)
-                break;
-            if (match_id(co, p, id))
-                break;
-            p = pcvdom_element_parent(p);
-        }
+        p = pcintr_find_element_by_id(&co->stack, p, id);
         if (p == NULL) {
-            if (!silently) {
-                purc_set_error_with_info(PURC_ERROR_ENTITY_NOT_FOUND,
-                        "no vdom element exists");
-                return -1;
-            }
-            p = parent;
-            if (match_id(co, p, id) == false) {
-                purc_set_error_with_info(PURC_ERROR_ENTITY_NOT_FOUND,
-                        "no vdom element exists");
-                return -1;
-            }
+            purc_set_error_with_info(PURC_ERROR_ENTITY_NOT_FOUND,
+                    "no vdom element exists");
+            return -1;
         }
         return post_process_bind_at_vdom(co, frame, p, src);
     }
@@ -200,6 +200,7 @@ post_process(pcintr_coroutine_t co, struct pcintr_stack_frame *frame)
 
     purc_atom_t child_cid = pcintr_schedule_child_co(vdom, co->cid,
             runner_name, NULL, request, NULL, true);
+    pcvdom_document_unref(vdom);
     purc_variant_unref(request);
 
     ctxt->request_id = purc_variant_make_ulongint(child_cid);
@@ -459,11 +460,6 @@ after_pushed(pcintr_stack_t stack, pcvdom_element_t pos)
 
     frame->pos = pos; // ATTENTION!!
 
-    frame->attr_vars = purc_variant_make_object(0,
-            PURC_VARIANT_INVALID, PURC_VARIANT_INVALID);
-    if (frame->attr_vars == PURC_VARIANT_INVALID)
-        return ctxt;
-
     struct pcvdom_element *element = frame->pos;
     PC_ASSERT(element);
 
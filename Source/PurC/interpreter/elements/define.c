@@ -145,39 +145,6 @@ post_process_src_by_level(pcintr_coroutine_t co,
 
     return post_process_bind_at_vdom(co, frame, p, src);
 }
-static bool
-match_id(pcintr_coroutine_t co,
-        struct pcvdom_element *elem, const char *id)
-{
-    struct pcvdom_attr *attr;
-    attr = pcvdom_element_find_attr(elem, "id");
-    if (!attr)
-        return false;
-
-    bool silently = false;
-    purc_variant_t v = pcvcm_eval(attr->val, &co->stack, silently);
-    purc_clr_error();
-    if (v == PURC_VARIANT_INVALID)
-        return false;
-
-    bool matched = false;
-
-    do {
-        if (purc_variant_is_string(v) == false)
-            break;
-        const char *sv = purc_variant_get_string_const(v);
-        if (!sv)
-            break;
-
-        if (strcmp(sv, id) == 0)
-            matched = true;
-    } while (0);
-
-    purc_variant_unref(v);
-
-    return matched;
-}
-
 
 static int
 post_process_src_by_id(pcintr_coroutine_t co,
@@ -193,13 +160,7 @@ post_process_src_by_id(pcintr_coroutine_t co,
                 "no vdom element exists");
         return -1;
     }
-    while (p) {
-        if (p == NULL)
-            break;
-        if (match_id(co, p, id))
-            break;
-        p = pcvdom_element_parent(p);
-    }
+    p = pcintr_find_element_by_id(&co->stack, p, id);
     if (p == NULL) {
         purc_set_error_with_info(PURC_ERROR_ENTITY_NOT_FOUND,
                 "no vdom element exists");
@@ -610,11 +571,6 @@ after_pushed(pcintr_stack_t stack, pcvdom_element_t pos)
 
     frame->pos = pos; // ATTENTION!!
 
-    frame->attr_vars = purc_variant_make_object(0,
-            PURC_VARIANT_INVALID, PURC_VARIANT_INVALID);
-    if (frame->attr_vars == PURC_VARIANT_INVALID)
-        return ctxt;
-
     struct pcvdom_element *element = frame->pos;
     PC_ASSERT(element);
 
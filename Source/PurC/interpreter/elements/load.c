@@ -169,8 +169,12 @@ post_process(pcintr_coroutine_t co, struct pcintr_stack_frame *frame)
     const char *as = ctxt->as ? purc_variant_get_string_const(ctxt->as) : NULL;
     const char *onto = ctxt->onto ?
         purc_variant_get_string_const(ctxt->onto) : NULL;
+    // hold a reference until the vdom is scheduled or failed; the one
+    // loaded from `on` is owned by the cache of the loader
+    pcvdom_document_ref(vdom);
     purc_atom_t child_cid = pcintr_schedule_child_co(vdom, co->cid,
             runner_name, onto, ctxt->with, body_id, false);
+    pcvdom_document_unref(vdom);
     free(body_id);
 
     if (!child_cid)
@@ -511,11 +515,6 @@ after_pushed(pcintr_stack_t stack, pcvdom_element_t pos)
 
     frame->pos = pos; // ATTENTION!!
 
-    frame->attr_vars = purc_variant_make_object(0,
-            PURC_VARIANT_INVALID, PURC_VARIANT_INVALID);
-    if (frame->attr_vars == PURC_VARIANT_INVALID)
-        return ctxt;
-
     struct pcvdom_element *element = frame->pos;
     PC_ASSERT(element);
 
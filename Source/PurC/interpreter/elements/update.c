@@ -355,12 +355,26 @@ static pcdoc_operation convert_operation(const char *to)
     return op;
 }
 
+/* `parts` (nullable) is the expansion of the template in `src` in parts */
 static int
 update_target_child(pcintr_stack_t stack, pcdoc_element_t target,
         const char *to, purc_variant_t src,
+        const struct pcintr_template_parts *parts,
         pcintr_attribute_op with_eval)
 {
-    UNUSED_PARAM(stack);
+    if (parts) {
+        pcdoc_operation op = convert_operation(to);
+        if (op != PCDOC_OP_UNKNOWN) {
+            pcdoc_node node = pcintr_util_new_content_from_template(
+                    stack->doc, target, op, parts);
+            // fall back to the markup if not supported
+            if (node.type != PCDOC_NODE_VOID ||
+                    purc_get_last_error() != PURC_ERROR_NOT_SUPPORTED)
+                return 0;
+            purc_clr_error();
+        }
+    }
+
     char *t = NULL;
     const char *s = "undefined";
     if (purc_variant_is_undefined(src)) {
@@ -496,6 +510,7 @@ update_target_attr(pcintr_stack_t stack, pcdoc_element_t target,
 static int
 update_target(pcintr_stack_t stack, pcdoc_element_t target,
         purc_variant_t at, purc_variant_t to, purc_variant_t src,
+        const struct pcintr_template_parts *parts,
         pcintr_attribute_op with_eval)
 {
     const char *s_to = "displace";
@@ -512,7 +527,8 @@ update_target(pcintr_stack_t stack, pcdoc_element_t target,
     }
 
     if (!s_at) {
-        return update_target_child(stack, target, s_to, src, with_eval);
+        return update_target_child(stack, target, s_to, src, parts,
+                with_eval);
     }
     if (strcmp(s_at, "textContent") == 0) {
         return update_target_content(stack, target, s_to, src, with_eval);
@@ -532,7 +548,7 @@ update_target(pcintr_stack_t stack, pcdoc_element_t target,
 static int
 update_elements(pcintr_stack_t stack,
         purc_variant_t elems, purc_variant_t at, purc_variant_t to,
-        purc_variant_t src,
+        purc_variant_t src, const struct pcintr_template_parts *parts,
         pcintr_attribute_op with_eval)
 {
     PC_ASSERT(purc_variant_is_native(elems));
@@ -542,7 +558,8 @@ update_elements(pcintr_stack_t stack,
         target = pcdvobjs_get_element_from_elements(elems, idx++);
         if (!target)
             break;
-        int r = update_target(stack, target, at, to, src, with_eval);
+        int r = update_target(stack, target, at, to, src, parts,
+                with_eval);
         if (r)
             return -1;
     }
@@ -552,7 +569,7 @@ update_elements(pcintr_stack_t stack,
 
 static int
 process(pcintr_coroutine_t co, struct pcintr_stack_frame *frame,
-        purc_variant_t src,
+        purc_variant_t src, const struct pcintr_template_parts *parts,
         pcintr_attribute_op with_eval)
 {
     UNUSED_PARAM(co);
@@ -569,7 +586,8 @@ process(pcintr_coroutine_t co, struct pcintr_stack_frame *frame,
     if (type == PURC_VARIANT_TYPE_NATIVE) {
         // const char *s = purc_variant_get_string_const(src);
         // PC_ASSERT(to != PURC_VARIANT_INVALID);
-        return update_elements(&co->stack, on, at, to, src, with_eval);
+        return update_elements(&co->stack, on, at, to, src, parts,
+                with_eval);
     }
     if (type == PURC_VARIANT_TYPE_OBJECT) {
         return update_object(&co->stack, on, at, to, src, with_eval);
@@ -590,7 +608,8 @@ process(pcintr_coroutine_t co, struct pcintr_stack_frame *frame,
         elem = pcdvobjs_get_element_from_elements(elems, 0);
         int r = 0;
         if (elem) {
-            r = update_elements(&co->stack, elems, at, to, src, with_eval);
+            r = update_elements(&co->stack, elems, at, to, src, parts,
+                    with_eval);
         }
         purc_variant_unref(elems);
         return r ? -1 : 0;
@@ -868,11 +887,6 @@ after_pushed(pcintr_stack_t stack, pcvdom_element_t pos)
 
     frame->pos = pos; // ATTENTION!!
 
-    frame->attr_vars = purc_variant_make_object(0,
-            PURC_VARIANT_INVALID, PURC_VARIANT_INVALID);
-    if (frame->attr_vars == PURC_VARIANT_INVALID)
-        return ctxt;
-
     struct pcvdom_element *element = frame->pos;
     PC_ASSERT(element);
 
@@ -1028,20 +1042,47 @@ on_child_finished(pcintr_coroutine_t co, struct pcintr_stack_frame *frame)
             frame->ctnt_var = ctxt->from_result;
             purc_variant_ref(ctxt->from_result);
 
-            return process(co, frame, ctxt->from_result, ctxt->with_eval);
+            return process(co, frame, ctxt->from_result, NULL,
+                    ctxt->with_eval);
         }
     }
     if (!ctxt->from && ctxt->with) {
+        /* a template is expanded in parts to build the content of
+           the elements directly, instead of parsing the expanded markup */
+        struct pcintr_template_parts parts;
+        bool by_parts = false;
+        if (purc_variant_is_native(ctxt->with)) {
+            if (pcintr_template_expand_parts(ctxt->with, &parts,
+                        frame->silently) == 0)
+                by_parts = true;
+            else if (purc_get_last_error() == PURC_ERROR_NOT_SUPPORTED)
+                purc_clr_error();
+            else
+                return -1;
+        }
+
         purc_variant_t src;
-        src = get_source_by_with(co, frame, ctxt->with);
-        PC_ASSERT(src != PURC_VARIANT_INVALID);
+        if (by_parts) {
+            src = pcintr_template_parts_join(&parts);
+            if (src == PURC_VARIANT_INVALID) {
+                pcintr_template_parts_release(&parts);
+                return -1;
+            }
+        }
+        else {
+            src = get_source_by_with(co, frame, ctxt->with);
+            PC_ASSERT(src != PURC_VARIANT_INVALID);
+        }
 
         PURC_VARIANT_SAFE_CLEAR(frame->ctnt_var);
         frame->ctnt_var = src;
         purc_variant_ref(src);
 
-        int r = process(co, frame, src, ctxt->with_eval);
+        int r = process(co, frame, src, by_parts ? &parts : NULL,
+                ctxt->with_eval);
         purc_variant_unref(src);
+        if (by_parts)
+            pcintr_template_parts_release(&parts);
         return r ? -1 : 0;
     }
     if (ctxt->literal != PURC_VARIANT_INVALID) {
@@ -1053,7 +1094,7 @@ on_child_finished(pcintr_coroutine_t co, struct pcintr_stack_frame *frame)
         }
         frame->ctnt_var = ctxt->literal;
         purc_variant_ref(ctxt->literal);
-        return process(co, frame, ctxt->literal, with_eval);
+        return process(co, frame, ctxt->literal, NULL, with_eval);
     }
 
     struct pcvdom_element *element = frame->pos;
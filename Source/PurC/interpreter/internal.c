@@ -102,11 +102,9 @@ bind_at_default(pcintr_stack_t stack, struct pcintr_stack_frame *frame,
 }
 
 static bool
-match_id(pcintr_stack_t stack, struct pcvdom_element *elem, const char *id)
+match_dynamic_id(struct pcvdom_element *elem, const char *id, void *ctxt)
 {
-    if (elem->node.type == PCVDOM_NODE_DOCUMENT) {
-        return false;
-    }
+    pcintr_stack_t stack = (pcintr_stack_t)ctxt;
     struct pcvdom_attr *attr = pcvdom_element_find_attr(elem, "id");
     if (!attr) {
         return false;
@@ -139,21 +137,26 @@ match_id(pcintr_stack_t stack, struct pcvdom_element *elem, const char *id)
     return matched;
 }
 
+struct pcvdom_element *
+pcintr_find_element_by_id(pcintr_stack_t stack,
+        struct pcvdom_element *elem, const char *id)
+{
+    /* the element may belong to another vDOM than the one of the stack,
+       e.g. one loaded by `load` or derived by `as`; use its own index */
+    struct pcvdom_document *doc = elem ?
+        pcvdom_document_from_node(&elem->node) : stack->vdom;
+    return pcvdom_document_find_ancestor_by_id(doc, elem, id,
+            match_dynamic_id, stack);
+}
+
 static int
 bind_by_elem_id(pcintr_stack_t stack, struct pcintr_stack_frame *frame,
         const char *id, const char *name, purc_variant_t val)
 {
-    struct pcvdom_element *p = frame->pos;
-    struct pcvdom_element *dest = NULL;
-    while (p) {
-        if (match_id(stack, p, id)) {
-            dest = p;
-            break;
-        }
-        p = pcvdom_element_parent(p);
-    }
+    struct pcvdom_element *dest;
+    dest = pcintr_find_element_by_id(stack, frame->pos, id);
 
-    if (dest && dest->node.type != PCVDOM_NODE_DOCUMENT) {
+    if (dest) {
         return bind_at_element(stack->co, dest, name, val);
     }
 
@@ -274,6 +277,8 @@ pcintr_build_concurrently_call_vdom(pcintr_stack_t stack,
     purc_vdom_t vdom = NULL;
     char *foot = NULL;
     purc_rwstream_t rws = NULL;
+    purc_rwstream_t in;
+    purc_vdom_t owner;
     const char *as;
     struct pcvdom_doctype  *doctype;
     size_t nr_hvml;
@@ -299,12 +304,21 @@ pcintr_build_concurrently_call_vdom(pcintr_stack_t stack,
         goto out;
     }
 
+    // the vdom is generated once for the <define> and the name, and shared
+    // by the coroutines of all concurrent calls; the document of the
+    // <define> owns it, and the caller gets a reference of its own.
+    as = purc_variant_get_string_const(as_var);
+    owner = pcvdom_document_from_node(&element->node);
+    vdom = pcvdom_document_find_derived(owner, element, as);
+    if (vdom) {
+        goto out;
+    }
+
     rws = purc_rwstream_new_buffer(MIN_BUFFER, 0);
     if (rws == NULL) {
         PC_WARN("create rwstream failed\n");
         goto out;
     }
-    as = purc_variant_get_string_const(as_var);
     foot = (char*)malloc(strlen(callTemplateFoot) + strlen(as) + 1);
     if (!foot) {
         purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
@@ -330,9 +344,20 @@ pcintr_build_concurrently_call_vdom(pcintr_stack_t stack,
     nr_hvml = 0;
     hvml = purc_rwstream_get_mem_buffer(rws, &nr_hvml);
 
-    vdom = purc_load_hvml_from_string(hvml);
+    in = purc_rwstream_new_from_mem((void *)hvml, nr_hvml);
+    if (in) {
+        vdom = purc_load_hvml_from_rwstream(in);
+        purc_rwstream_destroy(in);
+    }
     if (!vdom) {
         PC_WARN("create vdom for call concurrently failed! hvml is %s\n", hvml);
+        goto out;
+    }
+
+    purc_vdom_t owned = pcvdom_document_add_derived(owner, element, as,
+            vdom);
+    if (owned) {
+        vdom = owned;
     }
 out:
     if (rws) {
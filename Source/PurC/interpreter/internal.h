@@ -395,9 +395,46 @@ pcintr_bind_template(purc_variant_t templates,
 purc_variant_t
 pcintr_template_expansion(purc_variant_t val);
 
+/* A template expanded in parts: the literal markup and the stringified
+   values, so that the document can build the content from them directly. */
+struct pcintr_template_parts {
+    struct pcdoc_template       tpl;
+
+    char                       *markup;
+    size_t                     *piece_ends;
+    char                      **texts;
+    size_t                     *text_lens;
+};
+
+/* Returns -1 and sets PURC_ERROR_NOT_SUPPORTED if the template is not
+   a concatenation of markup and values; use pcintr_template_expansion()
+   then. The values are evaluated silently if `silently` is true. */
+int
+pcintr_template_expand_parts(purc_variant_t val,
+        struct pcintr_template_parts *parts, bool silently);
+
+void
+pcintr_template_parts_release(struct pcintr_template_parts *parts);
+
+/* Returns the markup of the template with the special characters of
+   the values escaped, the same as the markup sent to the renderer. */
+purc_variant_t
+pcintr_template_parts_join(const struct pcintr_template_parts *parts);
+
+pcdoc_node
+pcintr_util_new_content_from_template(purc_document_t doc,
+        pcdoc_element_t elem, pcdoc_operation op,
+        const struct pcintr_template_parts *parts);
+
 pcintr_coroutine_t
 pcintr_coroutine_get_by_id(purc_atom_t id);
 
+/* Returns the nearest one of `elem` and its ancestors whose id is `id`;
+   only the ids which are expressions are evaluated. */
+struct pcvdom_element *
+pcintr_find_element_by_id(pcintr_stack_t stack,
+        struct pcvdom_element *elem, const char *id);
+
 
 void
 pcintr_exception_copy(struct pcintr_exception *exception);
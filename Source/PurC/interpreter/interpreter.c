@@ -39,6 +39,7 @@
 #include "private/stringbuilder.h"
 #include "private/msg-queue.h"
 #include "private/runners.h"
+#include "private/trace.h"
 
 #include "ops.h"
 #include "../hvml/hvml-gen.h"
@@ -50,6 +51,7 @@
 #include <pthread.h>
 #include <stdarg.h>
 #include <libgen.h>
+#include <limits.h>
 
 #define EVENT_TIMER_INTRVAL  10
 
@@ -79,7 +81,6 @@ stack_frame_release(struct pcintr_stack_frame *frame)
         PURC_VARIANT_SAFE_CLEAR(frame->symbol_vars[i]);
     }
 
-    PURC_VARIANT_SAFE_CLEAR(frame->attr_vars);
     PURC_VARIANT_SAFE_CLEAR(frame->ctnt_var);
     PURC_VARIANT_SAFE_CLEAR(frame->result_from_child);
     PURC_VARIANT_SAFE_CLEAR(frame->except_templates);
@@ -114,14 +115,76 @@ stack_frame_normal_release(struct pcintr_stack_frame_normal *frame_normal)
     stack_frame_release(&frame_normal->frame);
 }
 
+#define NR_FRAMES_PER_CHUNK     32
+
+struct pcintr_frame_chunk {
+    struct pcintr_frame_chunk          *prev;
+    size_t                              used;
+    struct pcintr_stack_frame_normal    frames[NR_FRAMES_PER_CHUNK];
+};
+
+static struct pcintr_stack_frame_normal*
+frame_arena_alloc(pcintr_stack_t stack)
+{
+    struct pcintr_frame_chunk *chunk = stack->frame_chunks;
+
+    if (chunk == NULL || chunk->used == NR_FRAMES_PER_CHUNK) {
+        struct pcintr_frame_chunk *new_chunk = stack->spare_chunk;
+        if (new_chunk) {
+            stack->spare_chunk = NULL;
+        }
+        else {
+            new_chunk = (struct pcintr_frame_chunk*)malloc(sizeof(*new_chunk));
+            if (!new_chunk)
+                return NULL;
+        }
+
+        new_chunk->prev = chunk;
+        new_chunk->used = 0;
+        stack->frame_chunks = chunk = new_chunk;
+    }
+
+    struct pcintr_stack_frame_normal *frame_normal;
+    frame_normal = &chunk->frames[chunk->used++];
+    memset(frame_normal, 0, sizeof(*frame_normal));
+    return frame_normal;
+}
+
+static void
+frame_arena_free(pcintr_stack_t stack,
+        struct pcintr_stack_frame_normal *frame_normal)
+{
+    struct pcintr_frame_chunk *chunk = stack->frame_chunks;
+
+    // NOTE: the normal frames are always freed in LIFO order
+    PC_ASSERT(chunk && chunk->used > 0);
+    PC_ASSERT(frame_normal == &chunk->frames[chunk->used - 1]);
+
+    if (--chunk->used == 0) {
+        stack->frame_chunks = chunk->prev;
+        free(stack->spare_chunk);
+        stack->spare_chunk = chunk;
+    }
+}
+
+static void
+frame_arena_release(pcintr_stack_t stack)
+{
+    PC_ASSERT(stack->frame_chunks == NULL);
+
+    free(stack->spare_chunk);
+    stack->spare_chunk = NULL;
+}
+
 static void
-stack_frame_normal_destroy(struct pcintr_stack_frame_normal *frame_normal)
+stack_frame_normal_destroy(pcintr_stack_t stack,
+        struct pcintr_stack_frame_normal *frame_normal)
 {
     if (!frame_normal)
         return;
 
     stack_frame_normal_release(frame_normal);
-    free(frame_normal);
+    frame_arena_free(stack, frame_normal);
 }
 
 static int
@@ -265,7 +328,7 @@ release_scoped_variables(pcintr_stack_t stack)
 }
 
 static void
-destroy_stack_frame(struct pcintr_stack_frame *frame)
+destroy_stack_frame(pcintr_stack_t stack, struct pcintr_stack_frame *frame)
 {
     struct pcintr_stack_frame_normal *frame_normal = NULL;
 
@@ -273,7 +336,7 @@ destroy_stack_frame(struct pcintr_stack_frame *frame)
         case STACK_FRAME_TYPE_NORMAL:
             frame_normal = container_of(frame,
                     struct pcintr_stack_frame_normal, frame);
-            stack_frame_normal_destroy(frame_normal);
+            stack_frame_normal_destroy(stack, frame_normal);
             break;
         case STACK_FRAME_TYPE_PSEUDO:
             PC_ASSERT(0);
@@ -314,9 +377,10 @@ stack_release(pcintr_stack_t stack)
         PC_ASSERT(p->type == STACK_FRAME_TYPE_NORMAL);
         list_del(&p->node);
         --stack->nr_frames;
-        destroy_stack_frame(p);
+        destroy_stack_frame(stack, p);
     }
     PC_ASSERT(stack->nr_frames == 0);
+    frame_arena_release(stack);
 
     release_scoped_variables(stack);
 
@@ -447,6 +511,11 @@ coroutine_release(pcintr_coroutine_t co)
         }
 
         loaded_vars_release(co);
+
+        if (co->profiler) {
+            pcintr_profiler_destroy(co->profiler);
+            co->profiler = NULL;
+        }
     }
 }
 
@@ -471,6 +540,20 @@ stack_init(pcintr_stack_t stack)
     stack->mode = STACK_VDOM_BEFORE_HVML;
 }
 
+static unsigned int
+env_to_uint(const char *name, unsigned int def)
+{
+    const char *env = getenv(name);
+    if (env) {
+        char *end;
+        unsigned long v = strtoul(env, &end, 10);
+        if (end != env && *end == '\0' && v <= UINT_MAX)
+            return (unsigned int)v;
+    }
+
+    return def;
+}
+
 static void _cleanup_instance(struct pcinst* inst)
 {
     struct pcintr_heap *heap = inst->intr_heap;
@@ -540,6 +623,12 @@ static int _init_instance(struct pcinst* inst,
     heap->coroutines = RB_ROOT;
     heap->running_coroutine = NULL;
     heap->next_coroutine_id = 1;
+    // zero steps means the default, as purc_set_schedule_budget() does
+    heap->max_steps = env_to_uint(PURC_ENVV_SCHED_MAX_STEPS, 0);
+    if (heap->max_steps == 0)
+        heap->max_steps = PURC_DEF_SCHED_MAX_STEPS;
+    heap->max_usecs = env_to_uint(PURC_ENVV_SCHED_MAX_USECS,
+            PURC_DEF_SCHED_MAX_USECS);
 
     heap->event_timer = pcintr_timer_create(NULL, NULL, event_timer_fire, inst);
     if (!heap->event_timer) {
@@ -658,6 +747,14 @@ pop_stack_frame(pcintr_stack_t stack)
     struct pcintr_stack_frame *frame;
     frame = container_of(tail, struct pcintr_stack_frame, node);
 
+    if (stack->co->profiler) {
+        struct pcintr_stack_frame *parent = NULL;
+        if (!list_empty(&stack->frames))
+            parent = container_of(stack->frames.prev,
+                    struct pcintr_stack_frame, node);
+        pcintr_profiler_frame_popped(stack->co->profiler, frame, parent);
+    }
+
     struct pcintr_stack_frame_normal *frame_normal = NULL;
     struct pcintr_stack_frame_pseudo *frame_pseudo = NULL;
 
@@ -665,7 +762,7 @@ pop_stack_frame(pcintr_stack_t stack)
         case STACK_FRAME_TYPE_NORMAL:
             frame_normal = container_of(frame,
                     struct pcintr_stack_frame_normal, frame);
-            stack_frame_normal_destroy(frame_normal);
+            stack_frame_normal_destroy(stack, frame_normal);
             break;
         case STACK_FRAME_TYPE_PSEUDO:
             frame_pseudo = container_of(frame,
@@ -971,8 +1068,7 @@ static struct pcintr_stack_frame_normal*
 stack_frame_normal_create(pcintr_stack_t stack)
 {
     struct pcintr_stack_frame_normal *frame_normal;
-    frame_normal = (struct pcintr_stack_frame_normal*)calloc(1,
-            sizeof(*frame_normal));
+    frame_normal = frame_arena_alloc(stack);
     if (!frame_normal) {
         purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
         return NULL;
@@ -987,7 +1083,7 @@ stack_frame_normal_create(pcintr_stack_t stack)
     return frame_normal;
 
 fail_init:
-    stack_frame_normal_destroy(frame_normal);
+    stack_frame_normal_destroy(stack, frame_normal);
 
     return NULL;
 }
@@ -1102,9 +1198,8 @@ walk_attr(void *key, void *val, void *ud)
     struct pcvdom_element *element = data->element;
     PC_ASSERT(element);
 
-    purc_atom_t atom = PCHVML_KEYWORD_ATOM(HVML, attr->key);
     // NOTE: we only dispatch those keyworded-attr to caller
-    return data->cb(frame, element, atom, attr, data->ud);
+    return data->cb(frame, element, attr->keyword, attr, data->ud);
 }
 
 int
@@ -1117,13 +1212,6 @@ pcintr_vdom_walk_attrs(struct pcintr_stack_frame *frame,
 
     PC_ASSERT(frame->pos == element);
 
-    if (frame->attr_vars == PURC_VARIANT_INVALID) {
-        frame->attr_vars = purc_variant_make_object(0,
-                PURC_VARIANT_INVALID, PURC_VARIANT_INVALID);
-        if (frame->attr_vars == PURC_VARIANT_INVALID)
-            return -1;
-    }
-
     struct pcintr_walk_attrs_ud data = {
         .frame        = frame,
         .element      = element,
@@ -1527,6 +1615,10 @@ void pcintr_execute_one_step_for_ready_co(pcintr_coroutine_t co)
     if (frame == NULL)
         return;
 
+    struct pcintr_profiler *prof = co->profiler;
+    if (prof)
+        pcintr_profiler_step_begin(prof, frame);
+
     switch (frame->next_step) {
         case NEXT_STEP_AFTER_PUSHED:
             after_pushed(co, frame);
@@ -1544,6 +1636,9 @@ void pcintr_execute_one_step_for_ready_co(pcintr_coroutine_t co)
             PC_ASSERT(0);
             break;
     }
+
+    if (prof)
+        pcintr_profiler_step_end(prof);
 }
 
 static void
@@ -1842,6 +1937,13 @@ coroutine_create(purc_vdom_t vdom, pcintr_coroutine_t parent,
     co->user_data = user_data;
     co->loaded_vars = RB_ROOT;
 
+    if (heap->profiling) {
+        co->profiler = pcintr_profiler_create();
+        if (!co->profiler) {
+            goto fail_variables;
+        }
+    }
+
     int r;
     r = pcutils_rbtree_insert_only(coroutines, &co->cid,
             cmp_by_atom, &co->node);
@@ -1880,6 +1982,8 @@ coroutine_create(purc_vdom_t vdom, pcintr_coroutine_t parent,
     return co;
 
 fail_variables:
+    if (co->profiler)
+        pcintr_profiler_destroy(co->profiler);
     pcinst_msg_queue_destroy(co->mq);
 
 fail_co:
@@ -1964,10 +2068,7 @@ purc_schedule_vdom(purc_vdom_t vdom,
     return co;
 
 failed:
-    if (co == NULL) {
-        pcvdom_document_unref(vdom);
-    }
-    else {
+    if (co) {
         coroutine_destroy(co);
     }
 
@@ -3231,6 +3332,191 @@ pcintr_template_expansion(purc_variant_t val)
     return v;
 }
 
+int
+pcintr_template_expand_parts(purc_variant_t val,
+        struct pcintr_template_parts *parts, bool silently)
+{
+    memset(parts, 0, sizeof(*parts));
+
+    if (val == PURC_VARIANT_INVALID || !purc_variant_is_native(val) ||
+            (struct purc_native_ops*)val->ptr_ptr[1] != &ops_tpl) {
+        purc_set_error(PURC_ERROR_NOT_SUPPORTED);
+        return -1;
+    }
+
+    struct pcvdom_template *tpl;
+    tpl = (struct pcvdom_template*)purc_variant_native_get_entity(val);
+    struct pcvcm_node *vcm = tpl->vcm;
+    if (vcm == NULL || (vcm->type != PCVCM_NODE_TYPE_STRING &&
+                vcm->type != PCVCM_NODE_TYPE_FUNC_CONCAT_STRING)) {
+        purc_set_error(PURC_ERROR_NOT_SUPPORTED);
+        return -1;
+    }
+
+    pcintr_stack_t stack = pcintr_get_stack();
+    PC_ASSERT(stack);
+
+    struct pcvcm_node *node = vcm;
+    size_t nr_nodes = 1;
+    if (vcm->type == PCVCM_NODE_TYPE_FUNC_CONCAT_STRING) {
+        nr_nodes = pctree_node_children_number(&vcm->tree_node);
+        node = (struct pcvcm_node*)pctree_node_child(&vcm->tree_node);
+    }
+
+    struct pcutils_mystring markup;
+    pcutils_mystring_init(&markup);
+    parts->piece_ends = malloc(sizeof(size_t) * (nr_nodes + 1));
+    parts->texts = malloc(sizeof(char *) * nr_nodes);
+    parts->text_lens = malloc(sizeof(size_t) * nr_nodes);
+    if (!parts->piece_ends || !parts->texts || !parts->text_lens) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        goto failed;
+    }
+
+    size_t nr_texts = 0;
+    for (; node; node = (struct pcvcm_node*)pctree_node_next(
+                &node->tree_node)) {
+        if (node->type == PCVCM_NODE_TYPE_STRING) {
+            if (pcutils_mystring_append_mchar(&markup,
+                        (const unsigned char *)node->sz_ptr[1],
+                        node->sz_ptr[0])) {
+                purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+                goto failed;
+            }
+        }
+        else {
+            purc_variant_t v = pcvcm_eval(node, stack, silently);
+            if (v == PURC_VARIANT_INVALID)
+                goto failed;
+
+            char *buf = NULL;
+            ssize_t n = purc_variant_stringify_alloc(&buf, v);
+            purc_variant_unref(v);
+            if (n < 0)
+                goto failed;
+
+            parts->piece_ends[nr_texts] = markup.nr_bytes;
+            parts->texts[nr_texts] = buf;
+            parts->text_lens[nr_texts] = n;
+            parts->tpl.nr_texts = ++nr_texts;
+        }
+
+        if (node == vcm)
+            break;
+    }
+
+    parts->piece_ends[nr_texts] = markup.nr_bytes;
+    if (pcutils_mystring_done(&markup)) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        goto failed;
+    }
+
+    parts->markup = markup.buff;
+    parts->tpl.markup = parts->markup;
+    parts->tpl.piece_ends = parts->piece_ends;
+    parts->tpl.texts = (const char * const *)parts->texts;
+    parts->tpl.text_lens = parts->text_lens;
+    return 0;
+
+failed:
+    pcutils_mystring_free(&markup);
+    pcintr_template_parts_release(parts);
+    return -1;
+}
+
+void
+pcintr_template_parts_release(struct pcintr_template_parts *parts)
+{
+    if (parts->texts) {
+        for (size_t i = 0; i < parts->tpl.nr_texts; i++)
+            free(parts->texts[i]);
+        free(parts->texts);
+    }
+    free(parts->text_lens);
+    free(parts->piece_ends);
+    free(parts->markup);
+    memset(parts, 0, sizeof(*parts));
+}
+
+/* builds the markup, with the special characters of the values escaped
+   if `escape` is true */
+static char *
+template_parts_to_markup(const struct pcintr_template_parts *parts,
+        bool escape, size_t *len)
+{
+    struct pcutils_mystring markup;
+    pcutils_mystring_init(&markup);
+
+    size_t start = 0;
+    for (size_t i = 0; i <= parts->tpl.nr_texts; i++) {
+        size_t end = parts->piece_ends[i];
+        if (pcutils_mystring_append_mchar(&markup,
+                    (const unsigned char *)parts->markup + start, end - start))
+            goto failed;
+        start = end;
+
+        if (i == parts->tpl.nr_texts)
+            break;
+
+        const char *text = parts->texts[i];
+        size_t text_len = parts->text_lens[i];
+        if (!escape) {
+            if (pcutils_mystring_append_mchar(&markup,
+                        (const unsigned char *)text, text_len))
+                goto failed;
+            continue;
+        }
+
+        for (size_t j = 0; j < text_len; j++) {
+            const char *entity;
+            switch (text[j]) {
+            case '&':   entity = "&amp;";   break;
+            case '<':   entity = "&lt;";    break;
+            case '>':   entity = "&gt;";    break;
+            case '"':   entity = "&quot;";  break;
+            case '\'':  entity = "&#39;";   break;
+            default:    entity = NULL;      break;
+            }
+
+            int r = entity ?
+                pcutils_mystring_append_mchar(&markup,
+                        (const unsigned char *)entity, strlen(entity)) :
+                pcutils_mystring_append_mchar(&markup,
+                        (const unsigned char *)text + j, 1);
+            if (r)
+                goto failed;
+        }
+    }
+
+    if (pcutils_mystring_done(&markup))
+        goto failed;
+
+    *len = markup.nr_bytes;
+    return markup.buff;
+
+failed:
+    pcutils_mystring_free(&markup);
+    purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+    return NULL;
+}
+
+purc_variant_t
+pcintr_template_parts_join(const struct pcintr_template_parts *parts)
+{
+    size_t len;
+    /* escaped like the markup built for the parsed template, so that
+       the values are not parsed as markup on the fallback path either */
+    char *markup = template_parts_to_markup(parts, true, &len);
+    if (markup == NULL)
+        return PURC_VARIANT_INVALID;
+
+    purc_variant_t v = purc_variant_make_string_reuse_buff(markup,
+            len + 1, true);
+    if (v == PURC_VARIANT_INVALID)
+        free(markup);
+    return v;
+}
+
 void
 pcintr_coroutine_set_state_with_location(pcintr_coroutine_t co,
         enum pcintr_coroutine_state state,
@@ -3241,6 +3527,21 @@ pcintr_coroutine_set_state_with_location(pcintr_coroutine_t co,
     UNUSED_PARAM(line);
     UNUSED_PARAM(func);
     co->state = state;
+
+    if (UNLIKELY(pctrace_is_enabled())) {
+        /* the names must be literals for the trace buffers */
+        const char *name;
+        switch (state) {
+        case CO_STATE_READY:        name = "co_ready";      break;
+        case CO_STATE_RUNNING:      name = "co_running";    break;
+        case CO_STATE_STOPPED:      name = "co_stopped";    break;
+        case CO_STATE_OBSERVING:    name = "co_observing";  break;
+        case CO_STATE_EXITED:       name = "co_exited";     break;
+        case CO_STATE_TERMINATED:   name = "co_terminated"; break;
+        default:                    name = "co_state";      break;
+        }
+        pctrace_record(PCTRACE_PH_INSTANT, PCTRACE_CAT_SCHED, name, co->cid);
+    }
 }
 
 pcdoc_element_t
@@ -3296,6 +3597,31 @@ pcintr_util_new_content(purc_document_t doc,
     return node;
 }
 
+pcdoc_node
+pcintr_util_new_content_from_template(purc_document_t doc,
+        pcdoc_element_t elem, pcdoc_operation op,
+        const struct pcintr_template_parts *parts)
+{
+    pcdoc_node node;
+    node = pcdoc_element_new_content_from_template(doc, elem, op,
+            &parts->tpl);
+
+    pcintr_stack_t stack = pcintr_get_stack();
+    if (node.type != PCDOC_NODE_VOID &&
+            stack && stack->co->target_page_handle) {
+        // the renderer gets the markup with the values as texts
+        size_t len;
+        char *markup = template_parts_to_markup(parts, true, &len);
+        if (markup) {
+            pcintr_rdr_send_dom_req_simple_raw(stack, op,
+                    elem, NULL, doc->def_text_type, markup, len);
+            free(markup);
+        }
+    }
+
+    return node;
+}
+
 int
 pcintr_util_set_attribute(purc_document_t doc,
         pcdoc_element_t elem, pcdoc_operation op,
@@ -0,0 +1,599 @@
+/*
+ * @file profiler.c
+ * @date 2022/09/20
+ * @brief The profiler of coroutines.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "purc.h"
+
+#include "config.h"
+
+#include "internal.h"
+
+#include "private/errors.h"
+#include "private/instance.h"
+#include "private/rbtree.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NR_STEPS                (NEXT_STEP_SELECT_CHILD + 1)
+
+static const char *step_names[NR_STEPS] = {
+    "afterPushed",
+    "onPopping",
+    "rerun",
+    "selectChild",
+};
+
+/* the statistics of an element */
+struct pcintr_prof_elem {
+    struct rb_node              node;
+    struct pcvdom_element      *elem;
+
+    /* the number of the frames pushed for the element */
+    uint64_t                    nr_frames;
+    /* the time spent in the frames, including the child frames */
+    uint64_t                    ns_total;
+
+    uint64_t                    nr_steps[NR_STEPS];
+    uint64_t                    ns_steps[NR_STEPS];
+
+    uint64_t                    nr_evals;
+    uint64_t                    ns_evals;
+
+    unsigned int                reported:1;
+};
+
+/* the statistics of a method of a dynamic or native variant */
+struct pcintr_prof_method {
+    struct rb_node              node;
+    char                       *name;
+
+    uint64_t                    nr_calls;
+    uint64_t                    ns_calls;
+};
+
+struct pcintr_profiler {
+    struct rb_root              elems;
+    struct rb_root              methods;
+    size_t                      nr_elems;
+    size_t                      nr_methods;
+
+    /* the step being executed */
+    struct pcintr_stack_frame  *step_frame;
+    enum pcintr_stack_frame_next_step step;
+    uint64_t                    step_begin;
+
+    /* the evaluations out of any step are counted here */
+    uint64_t                    nr_evals;
+    uint64_t                    ns_evals;
+    unsigned int                eval_depth;
+};
+
+uint64_t
+pcintr_profiler_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+struct pcintr_profiler *
+pcintr_profiler_create(void)
+{
+    struct pcintr_profiler *prof = calloc(1, sizeof(*prof));
+    if (prof == NULL) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    prof->elems = RB_ROOT;
+    prof->methods = RB_ROOT;
+    return prof;
+}
+
+void
+pcintr_profiler_destroy(struct pcintr_profiler *prof)
+{
+    struct rb_node *node, *next;
+
+    for (node = pcutils_rbtree_first(&prof->elems); node; node = next) {
+        next = pcutils_rbtree_next(node);
+        pcutils_rbtree_erase(node, &prof->elems);
+        free(container_of(node, struct pcintr_prof_elem, node));
+    }
+
+    for (node = pcutils_rbtree_first(&prof->methods); node; node = next) {
+        struct pcintr_prof_method *method;
+        method = container_of(node, struct pcintr_prof_method, node);
+        next = pcutils_rbtree_next(node);
+        pcutils_rbtree_erase(node, &prof->methods);
+        free(method->name);
+        free(method);
+    }
+
+    free(prof);
+}
+
+static int
+cmp_elem(struct rb_node *node, void *ud)
+{
+    struct pcintr_prof_elem *entry;
+    entry = container_of(node, struct pcintr_prof_elem, node);
+
+    uintptr_t l = (uintptr_t)ud;
+    uintptr_t r = (uintptr_t)entry->elem;
+    return (l > r) - (l < r);
+}
+
+static struct pcintr_prof_elem *
+get_elem(struct pcintr_profiler *prof, struct pcvdom_element *elem)
+{
+    struct rb_node *node;
+    node = pcutils_rbtree_find(&prof->elems, elem, cmp_elem);
+    if (node)
+        return container_of(node, struct pcintr_prof_elem, node);
+
+    struct pcintr_prof_elem *entry = calloc(1, sizeof(*entry));
+    if (entry == NULL)
+        return NULL;
+
+    entry->elem = elem;
+    pcutils_rbtree_insert_only(&prof->elems, elem, cmp_elem, &entry->node);
+    prof->nr_elems++;
+    return entry;
+}
+
+static int
+cmp_method(struct rb_node *node, void *ud)
+{
+    struct pcintr_prof_method *method;
+    method = container_of(node, struct pcintr_prof_method, node);
+    return strcmp((const char *)ud, method->name);
+}
+
+void
+pcintr_profiler_step_begin(struct pcintr_profiler *prof,
+        struct pcintr_stack_frame *frame)
+{
+    if (frame->pos == NULL)
+        return;
+
+    if (frame->prof_elem == NULL) {
+        frame->prof_elem = get_elem(prof, frame->pos);
+        if (frame->prof_elem == NULL)
+            return;
+        frame->prof_elem->nr_frames++;
+    }
+
+    prof->step_frame = frame;
+    prof->step = frame->next_step;
+    prof->step_begin = pcintr_profiler_now();
+}
+
+static void
+finish_step(struct pcintr_profiler *prof)
+{
+    struct pcintr_stack_frame *frame = prof->step_frame;
+    uint64_t ns = pcintr_profiler_now() - prof->step_begin;
+
+    frame->prof_elem->nr_steps[prof->step]++;
+    frame->prof_elem->ns_steps[prof->step] += ns;
+    frame->prof_ns += ns;
+    prof->step_frame = NULL;
+}
+
+void
+pcintr_profiler_step_end(struct pcintr_profiler *prof)
+{
+    if (prof->step_frame)
+        finish_step(prof);
+}
+
+void
+pcintr_profiler_frame_popped(struct pcintr_profiler *prof,
+        struct pcintr_stack_frame *frame, struct pcintr_stack_frame *parent)
+{
+    /* the frame is popped by its own `on_popping` step */
+    if (prof->step_frame == frame)
+        finish_step(prof);
+
+    if (frame->prof_elem)
+        frame->prof_elem->ns_total += frame->prof_ns;
+
+    if (parent)
+        parent->prof_ns += frame->prof_ns;
+}
+
+uint64_t
+pcintr_profiler_eval_begin(struct pcintr_profiler *prof)
+{
+    prof->eval_depth++;
+    return pcintr_profiler_now();
+}
+
+void
+pcintr_profiler_eval_end(struct pcintr_profiler *prof, uint64_t begin)
+{
+    /* NOTE: only count the outermost evaluation, the nested ones are
+       triggered by the getters of the expression variables */
+    if (--prof->eval_depth > 0)
+        return;
+
+    uint64_t ns = pcintr_profiler_now() - begin;
+    if (prof->step_frame) {
+        prof->step_frame->prof_elem->nr_evals++;
+        prof->step_frame->prof_elem->ns_evals += ns;
+    }
+    else {
+        prof->nr_evals++;
+        prof->ns_evals += ns;
+    }
+}
+
+void
+pcintr_profiler_add_method(struct pcintr_profiler *prof, const char *name,
+        uint64_t begin)
+{
+    uint64_t ns = pcintr_profiler_now() - begin;
+
+    struct pcintr_prof_method *method;
+    struct rb_node *node;
+    node = pcutils_rbtree_find(&prof->methods, (void *)name, cmp_method);
+    if (node) {
+        method = container_of(node, struct pcintr_prof_method, node);
+    }
+    else {
+        method = calloc(1, sizeof(*method));
+        if (method == NULL)
+            return;
+
+        method->name = strdup(name);
+        if (method->name == NULL) {
+            free(method);
+            return;
+        }
+
+        pcutils_rbtree_insert_only(&prof->methods, method->name, cmp_method,
+                &method->node);
+        prof->nr_methods++;
+    }
+
+    method->nr_calls++;
+    method->ns_calls += ns;
+}
+
+static uint64_t
+self_ns(struct pcintr_prof_elem *entry)
+{
+    uint64_t ns = 0;
+    for (int i = 0; i < NR_STEPS; i++)
+        ns += entry->ns_steps[i];
+    return ns;
+}
+
+static bool
+set_ulongint(purc_variant_t obj, const char *key, uint64_t u)
+{
+    purc_variant_t v = purc_variant_make_ulongint(u);
+    if (v == PURC_VARIANT_INVALID)
+        return false;
+
+    bool ok = purc_variant_object_set_by_static_ckey(obj, key, v);
+    purc_variant_unref(v);
+    return ok;
+}
+
+static bool
+set_counter(purc_variant_t obj, const char *key, uint64_t nr, uint64_t ns)
+{
+    purc_variant_t v = purc_variant_make_object_0();
+    if (v == PURC_VARIANT_INVALID)
+        return false;
+
+    bool ok = set_ulongint(v, "count", nr) && set_ulongint(v, "ns", ns) &&
+        purc_variant_object_set_by_static_ckey(obj, key, v);
+    purc_variant_unref(v);
+    return ok;
+}
+
+static purc_variant_t
+make_elem_object(struct pcintr_prof_elem *entry)
+{
+    purc_variant_t obj = purc_variant_make_object_0();
+    if (obj == PURC_VARIANT_INVALID)
+        return PURC_VARIANT_INVALID;
+
+    purc_variant_t tag = purc_variant_make_string(entry->elem->tag_name,
+            false);
+    if (tag == PURC_VARIANT_INVALID)
+        goto failed;
+    bool ok = purc_variant_object_set_by_static_ckey(obj, "tag", tag);
+    purc_variant_unref(tag);
+    if (!ok)
+        goto failed;
+
+    if (!set_ulongint(obj, "line", entry->elem->line) ||
+            !set_ulongint(obj, "column", entry->elem->col) ||
+            !set_ulongint(obj, "frames", entry->nr_frames) ||
+            !set_ulongint(obj, "totalNs", entry->ns_total) ||
+            !set_ulongint(obj, "selfNs", self_ns(entry)) ||
+            !set_counter(obj, "evals", entry->nr_evals, entry->ns_evals))
+        goto failed;
+
+    for (int i = 0; i < NR_STEPS; i++) {
+        if (!set_counter(obj, step_names[i],
+                    entry->nr_steps[i], entry->ns_steps[i]))
+            goto failed;
+    }
+
+    return obj;
+
+failed:
+    purc_variant_unref(obj);
+    return PURC_VARIANT_INVALID;
+}
+
+purc_variant_t
+pcintr_profiler_make_object(struct pcintr_profiler *prof)
+{
+    purc_variant_t obj = purc_variant_make_object_0();
+    purc_variant_t elems = purc_variant_make_array_0();
+    purc_variant_t methods = purc_variant_make_array_0();
+    if (obj == PURC_VARIANT_INVALID || elems == PURC_VARIANT_INVALID ||
+            methods == PURC_VARIANT_INVALID)
+        goto failed;
+
+    struct rb_node *node;
+    for (node = pcutils_rbtree_first(&prof->elems); node;
+            node = pcutils_rbtree_next(node)) {
+        struct pcintr_prof_elem *entry;
+        entry = container_of(node, struct pcintr_prof_elem, node);
+
+        purc_variant_t v = make_elem_object(entry);
+        if (v == PURC_VARIANT_INVALID)
+            goto failed;
+
+        bool ok = purc_variant_array_append(elems, v);
+        purc_variant_unref(v);
+        if (!ok)
+            goto failed;
+    }
+
+    for (node = pcutils_rbtree_first(&prof->methods); node;
+            node = pcutils_rbtree_next(node)) {
+        struct pcintr_prof_method *method;
+        method = container_of(node, struct pcintr_prof_method, node);
+
+        purc_variant_t v = purc_variant_make_object_0();
+        if (v == PURC_VARIANT_INVALID)
+            goto failed;
+
+        purc_variant_t name = purc_variant_make_string(method->name, false);
+        bool ok = name &&
+            purc_variant_object_set_by_static_ckey(v, "name", name) &&
+            set_ulongint(v, "calls", method->nr_calls) &&
+            set_ulongint(v, "ns", method->ns_calls) &&
+            purc_variant_array_append(methods, v);
+        if (name)
+            purc_variant_unref(name);
+        purc_variant_unref(v);
+        if (!ok)
+            goto failed;
+    }
+
+    if (!purc_variant_object_set_by_static_ckey(obj, "elements", elems) ||
+            !purc_variant_object_set_by_static_ckey(obj, "methods", methods) ||
+            !set_counter(obj, "otherEvals", prof->nr_evals, prof->ns_evals))
+        goto failed;
+
+    purc_variant_unref(elems);
+    purc_variant_unref(methods);
+    return obj;
+
+failed:
+    PURC_VARIANT_SAFE_CLEAR(methods);
+    PURC_VARIANT_SAFE_CLEAR(elems);
+    PURC_VARIANT_SAFE_CLEAR(obj);
+    return PURC_VARIANT_INVALID;
+}
+
+PCA_ATTRIBUTE_PRINTF(2, 3)
+static void
+stm_printf(purc_rwstream_t stm, const char *fmt, ...)
+{
+    char buf[512];
+    va_list ap;
+
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+
+    if (n > 0) {
+        if ((size_t)n >= sizeof(buf))
+            n = sizeof(buf) - 1;
+        purc_rwstream_write(stm, buf, n);
+    }
+}
+
+static int
+cmp_by_self_ns(const void *a, const void *b)
+{
+    uint64_t l = self_ns(*(struct pcintr_prof_elem **)a);
+    uint64_t r = self_ns(*(struct pcintr_prof_elem **)b);
+    return (l < r) - (l > r);
+}
+
+static int
+cmp_by_calls_ns(const void *a, const void *b)
+{
+    uint64_t l = (*(struct pcintr_prof_method **)a)->ns_calls;
+    uint64_t r = (*(struct pcintr_prof_method **)b)->ns_calls;
+    return (l < r) - (l > r);
+}
+
+#define US(ns)      ((double)(ns) / 1000.0)
+
+static void
+dump_elem_line(purc_rwstream_t stm, struct pcintr_prof_elem *entry,
+        unsigned int depth)
+{
+    stm_printf(stm, "%12.1f %12.1f %8llu %8llu %10.1f  %*s<%s> @%d:%d\n",
+            US(entry->ns_total), US(self_ns(entry)),
+            (unsigned long long)entry->nr_frames,
+            (unsigned long long)entry->nr_evals, US(entry->ns_evals),
+            depth * 2, "", entry->elem->tag_name,
+            entry->elem->line, entry->elem->col);
+}
+
+static void
+dump_subtree(struct pcintr_profiler *prof, purc_rwstream_t stm,
+        struct pcvdom_element *elem, unsigned int depth)
+{
+    struct rb_node *node = pcutils_rbtree_find(&prof->elems, elem, cmp_elem);
+    if (node) {
+        struct pcintr_prof_elem *entry;
+        entry = container_of(node, struct pcintr_prof_elem, node);
+        dump_elem_line(stm, entry, depth);
+        entry->reported = 1;
+        depth++;
+    }
+
+    struct pcvdom_element *child;
+    for (child = pcvdom_element_first_child_element(elem); child;
+            child = pcvdom_element_next_sibling_element(child)) {
+        dump_subtree(prof, stm, child, depth);
+    }
+}
+
+static void
+dump_profile(struct pcintr_profiler *prof, purc_vdom_t vdom,
+        const char *uri, purc_rwstream_t stm)
+{
+    static const char *elem_header =
+        "   total(us)     self(us)   frames    evals   eval(us)  element\n";
+
+    struct pcintr_prof_elem **elems = NULL;
+    struct pcintr_prof_method **methods = NULL;
+    size_t i = 0;
+
+    if (prof->nr_elems)
+        elems = malloc(sizeof(*elems) * prof->nr_elems);
+    if (prof->nr_methods)
+        methods = malloc(sizeof(*methods) * prof->nr_methods);
+    if ((prof->nr_elems && elems == NULL) ||
+            (prof->nr_methods && methods == NULL)) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        goto done;
+    }
+
+    struct rb_node *node;
+    for (node = pcutils_rbtree_first(&prof->elems); node;
+            node = pcutils_rbtree_next(node)) {
+        elems[i] = container_of(node, struct pcintr_prof_elem, node);
+        elems[i]->reported = 0;
+        i++;
+    }
+    qsort(elems, prof->nr_elems, sizeof(*elems), cmp_by_self_ns);
+
+    stm_printf(stm, "Profile of coroutine %s\n\n", uri);
+
+    stm_printf(stm, "Flat profile (sorted by self time):\n");
+    stm_printf(stm, "%s", elem_header);
+    for (i = 0; i < prof->nr_elems; i++)
+        dump_elem_line(stm, elems[i], 0);
+    if (prof->nr_evals) {
+        stm_printf(stm, "%12s %12s %8s %8llu %10.1f  (out of elements)\n",
+                "-", "-", "-", (unsigned long long)prof->nr_evals,
+                US(prof->ns_evals));
+    }
+
+    stm_printf(stm, "\nHierarchical profile:\n");
+    stm_printf(stm, "%s", elem_header);
+    struct pcvdom_element *root = pcvdom_document_get_root(vdom);
+    if (root)
+        dump_subtree(prof, stm, root, 0);
+
+    /* the elements out of the main document, e.g., from a fragment */
+    for (i = 0; i < prof->nr_elems; i++) {
+        if (!elems[i]->reported)
+            dump_elem_line(stm, elems[i], 0);
+    }
+
+    stm_printf(stm, "\nMethods (sorted by total time):\n");
+    stm_printf(stm, "   total(us)      avg(us)    calls  name\n");
+    i = 0;
+    for (node = pcutils_rbtree_first(&prof->methods); node;
+            node = pcutils_rbtree_next(node)) {
+        methods[i++] = container_of(node, struct pcintr_prof_method, node);
+    }
+    qsort(methods, prof->nr_methods, sizeof(*methods), cmp_by_calls_ns);
+    for (i = 0; i < prof->nr_methods; i++) {
+        stm_printf(stm, "%12.1f %12.3f %8llu  %s\n",
+                US(methods[i]->ns_calls),
+                US(methods[i]->ns_calls) / methods[i]->nr_calls,
+                (unsigned long long)methods[i]->nr_calls, methods[i]->name);
+    }
+    stm_printf(stm, "\n");
+
+done:
+    free(methods);
+    free(elems);
+}
+
+bool
+purc_enable_profiler(bool enable)
+{
+    struct pcintr_heap *heap = pcintr_get_heap();
+    if (heap == NULL) {
+        purc_set_error(PURC_ERROR_NO_INSTANCE);
+        return false;
+    }
+
+    heap->profiling = enable ? 1 : 0;
+    return true;
+}
+
+purc_variant_t
+purc_coroutine_get_profile(purc_coroutine_t cor)
+{
+    if (cor->profiler == NULL) {
+        purc_set_error(PURC_ERROR_NOT_EXISTS);
+        return PURC_VARIANT_INVALID;
+    }
+
+    return pcintr_profiler_make_object(cor->profiler);
+}
+
+bool
+purc_coroutine_dump_profile(purc_coroutine_t cor, purc_rwstream_t stm)
+{
+    if (cor->profiler == NULL) {
+        purc_set_error(PURC_ERROR_NOT_EXISTS);
+        return false;
+    }
+
+    dump_profile(cor->profiler, cor->vdom, pcintr_coroutine_get_uri(cor),
+            stm);
+    return true;
+}
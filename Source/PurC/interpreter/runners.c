@@ -31,6 +31,7 @@
 #include "private/instance.h"
 #include "private/sorted-array.h"
 #include "private/ports.h"
+#include "private/vdom.h"
 
 #include <assert.h>
 #include <errno.h>
@@ -134,6 +135,8 @@ static void create_coroutine(const pcrdr_msg *msg, pcrdr_msg *response)
     purc_coroutine_t cor = purc_schedule_vdom(vdom, curator,
             request, page_type, target_workspace,
             target_group, page_name, &extra_rdr_info, body_id, NULL);
+    // release the reference held for the request by the sender
+    pcvdom_document_unref(vdom);
     if (request)
         purc_variant_unref(request);
     if (extra_rdr_info.toolkit_style)
@@ -994,10 +997,14 @@ purc_inst_schedule_vdom(purc_atom_t inst, purc_vdom_t vdom,
     request_msg->dataType = PCRDR_MSG_DATA_TYPE_JSON;
     request_msg->data = data;
 
+    // the target instance releases this reference after handling the request
+    pcvdom_document_ref(vdom);
+
     purc_variant_t request_id = purc_variant_ref(request_msg->requestId);
     size_t n = purc_inst_move_message(inst, request_msg);
     pcrdr_release_message(request_msg);
     if (n == 0) {
+        pcvdom_document_unref(vdom);
         purc_log_warn("Failed to send request message\n");
         return 0;
     }
@@ -35,6 +35,7 @@
 #include "private/variant.h"
 #include "private/ports.h"
 #include "private/msg-queue.h"
+#include "private/trace.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -257,17 +258,46 @@ pcintr_check_after_execution_full(struct pcinst *inst, pcintr_coroutine_t co)
     }
 }
 
+// check the elapsed time once every such steps
+#define SCHEDULE_TIME_CHECK_STEPS   8
+
+static inline bool
+time_slice_expired(const struct timespec *start, unsigned int max_usecs)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    int64_t usecs = (now.tv_sec - start->tv_sec) * 1000000 +
+        (now.tv_nsec - start->tv_nsec) / 1000;
+    return usecs >= (int64_t)max_usecs;
+}
+
+// run a ready coroutine until it is not ready or its time slice runs out
 static void
 execute_one_step_for_ready_co(struct pcinst *inst, pcintr_coroutine_t co)
 {
-    UNUSED_PARAM(inst);
-    UNUSED_PARAM(co);
+    struct pcintr_heap *heap = inst->intr_heap;
+    unsigned int max_steps = heap->max_steps;
+    unsigned int nr_steps = 0;
+    struct timespec start;
+
+    if (heap->max_usecs && max_steps > 1)
+        clock_gettime(CLOCK_MONOTONIC, &start);
 
     pcintr_set_current_co(co);
 
-    pcintr_coroutine_set_state(co, CO_STATE_RUNNING);
-    pcintr_execute_one_step_for_ready_co(co);
-    pcintr_check_after_execution_full(inst, co);
+    do {
+        pcintr_coroutine_set_state(co, CO_STATE_RUNNING);
+        pcintr_execute_one_step_for_ready_co(co);
+        pcintr_check_after_execution_full(inst, co);
+
+        if (co->state != CO_STATE_READY || ++nr_steps >= max_steps)
+            break;
+
+        if (heap->max_usecs && nr_steps % SCHEDULE_TIME_CHECK_STEPS == 0 &&
+                time_slice_expired(&start, heap->max_usecs))
+            break;
+    } while (1);
 
     pcintr_set_current_co(NULL);
 }
@@ -442,6 +472,21 @@ dispatch_event(struct pcinst *inst)
     return is_busy;
 }
 
+bool
+purc_set_schedule_budget(unsigned int max_steps, unsigned int max_usecs)
+{
+    struct pcinst *inst = pcinst_current();
+    if (inst == NULL || inst->intr_heap == NULL) {
+        purc_set_error(PURC_ERROR_NO_INSTANCE);
+        return false;
+    }
+
+    inst->intr_heap->max_steps = max_steps ? max_steps :
+        PURC_DEF_SCHED_MAX_STEPS;
+    inst->intr_heap->max_usecs = max_usecs;
+    return true;
+}
+
 void
 pcintr_schedule(void *ctxt)
 {
@@ -456,6 +501,7 @@ pcintr_schedule(void *ctxt)
         goto out_sleep;
     }
 
+    PCTRACE_BEGIN(PCTRACE_CAT_SCHED, "schedule");
 
     // 1. exec one step for all ready coroutines and
     // return whether step is busy
@@ -467,6 +513,7 @@ pcintr_schedule(void *ctxt)
     // 3. its busy, goto next scheduler without sleep
     if (step_is_busy || event_is_busy) {
         pcintr_update_timestamp(inst);
+        PCTRACE_END(PCTRACE_CAT_SCHED, "schedule");
         goto out;
     }
 
@@ -477,6 +524,8 @@ pcintr_schedule(void *ctxt)
         pcintr_update_timestamp(inst);
     }
 
+    PCTRACE_END(PCTRACE_CAT_SCHED, "schedule");
+
 out_sleep:
     pcutils_usleep(SCHEDULE_SLEEP);
 
@@ -29,6 +29,7 @@
 #include "internal.h"
 
 #include "private/errors.h"
+#include "private/list.h"
 #include "private/timer.h"
 #include "private/interpreter.h"
 #include "purc-runloop.h"
@@ -38,56 +39,421 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
-class Timer : public PurCWTF::RunLoop::TimerBase {
+/*
+ * All timers of an instance share one hierarchical timer wheel, which is
+ * driven by a single runloop timer armed for the earliest deadline.
+ *
+ * One tick is one millisecond.  Level 0 has a slot per tick; a slot of
+ * level `l` covers 64^l ticks, and its timers are cascaded to the lower
+ * levels when the wheel reaches the start of the slot.  Starting and
+ * stopping a timer are O(1), and the timers expiring in the same tick are
+ * fired as a batch.
+ */
+#define WHEEL_BITS          6
+#define WHEEL_SLOTS         (1 << WHEEL_BITS)
+#define WHEEL_MASK          (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS        4
+#define WHEEL_MAX_DELTA     ((1ULL << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
+
+// the level of a timer which is not in the wheel
+#define LEVEL_NONE          WHEEL_LEVELS
+// the level of a timer in the batch being fired
+#define LEVEL_BATCH         (WHEEL_LEVELS + 1)
+
+// a timer may expire later by up to 1/32 of its interval, so that the
+// timers with close deadlines share a tick
+#define COALESCE_SHIFT      5
+
+class TimerWheel;
+
+struct Timer {
+    struct list_head        node;
+    TimerWheel             *wheel;
+    char                   *id;
+    pcintr_timer_fire_func  func;
+    void                   *data;
+    uint32_t                interval;
+    bool                    repeating;
+    unsigned                level;
+    unsigned                slot;
+    uint64_t                due;        // the requested deadline
+    uint64_t                expires;    // the coalesced deadline
+};
+
+static inline Timer *
+timer_of(struct list_head *node)
+{
+    return (Timer *)((char *)node - offsetof(Timer, node));
+}
+
+static uint64_t
+now_ticks(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static uint64_t
+coalesce(uint64_t due, uint32_t interval)
+{
+    uint32_t slack = interval >> COALESCE_SHIFT;
+    if (slack < 2) {
+        return due;
+    }
+
+    uint64_t granularity = 1ULL << (31 - __builtin_clz(slack));
+    return (due + granularity - 1) & ~(granularity - 1);
+}
+
+static inline uint64_t
+rotate_right(uint64_t bits, unsigned n)
+{
+    n &= WHEEL_MASK;
+    return n ? (bits >> n) | (bits << (WHEEL_SLOTS - n)) : bits;
+}
+
+class TimerWheel : public PurCWTF::RunLoop::TimerBase {
     public:
-        Timer(const char *id, pcintr_timer_fire_func func, RunLoop& runLoop,
-                void *data)
+        TimerWheel(RunLoop& runLoop)
             : TimerBase(runLoop)
-            , m_id(NULL)
-            , m_func(func)
-            , m_data(data)
+            , m_base(now_ticks())
+            , m_armed(UINT64_MAX)
+            , m_nr_timers(0)
+            , m_dispatching(false)
         {
-            m_id = id ? strdup(id) : NULL;
-        }
-
-        ~Timer()
-        {
-            stop();
-            if (m_id) {
-                free(m_id);
+            memset(m_occupied, 0, sizeof(m_occupied));
+            for (int l = 0; l < WHEEL_LEVELS; l++) {
+                for (int i = 0; i < WHEEL_SLOTS; i++) {
+                    list_head_init(&m_slots[l][i]);
+                }
             }
         }
 
-        void setInterval(uint32_t interval) { m_interval = interval; }
-        uint32_t getInterval() { return m_interval; }
-        const char *getId() { return m_id; }
-        void *getData() { return m_data; }
+        static TimerWheel *current();
 
-        virtual void fired()
-        {
-            m_func(this, m_id, m_data);
-        }
+        void retain() { m_nr_timers++; }
+        void release();
 
+        void add(Timer *timer);
+        void remove(Timer *timer);
+
+        virtual void fired();
         virtual void processed(void) {}
 
     private:
-        char *m_id;
-        pcintr_timer_fire_func m_func;
-        void *m_data;
-        uint32_t m_interval;
+        bool isEmpty() const;
+        void place(Timer *timer);
+        void cascade(unsigned level, unsigned slot);
+        void expire(uint64_t now, struct list_head *batch);
+        uint64_t nextExpiry() const;
+        void arm();
+        void destroy();
+
+        uint64_t m_base;        // the next tick to process
+        uint64_t m_armed;       // the tick the runloop timer is armed for
+        size_t m_nr_timers;
+        bool m_dispatching;
+        uint64_t m_occupied[WHEEL_LEVELS];
+        struct list_head m_slots[WHEEL_LEVELS][WHEEL_SLOTS];
 };
 
+// an instance runs in its own thread
+static thread_local TimerWheel *s_wheel;
+
+TimerWheel *
+TimerWheel::current()
+{
+    if (!s_wheel) {
+        s_wheel = new TimerWheel(RunLoop::current());
+    }
+    return s_wheel;
+}
+
+void
+TimerWheel::destroy()
+{
+    if (s_wheel == this) {
+        s_wheel = NULL;
+    }
+    delete this;
+}
+
+void
+TimerWheel::release()
+{
+    PC_ASSERT(m_nr_timers > 0);
+    // the wheel is destroyed when the batch is done if it is firing
+    if (--m_nr_timers == 0 && !m_dispatching) {
+        destroy();
+    }
+}
+
+bool
+TimerWheel::isEmpty() const
+{
+    for (int l = 0; l < WHEEL_LEVELS; l++) {
+        if (m_occupied[l]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void
+TimerWheel::place(Timer *timer)
+{
+    uint64_t expires = timer->expires;
+    if (expires < m_base) {
+        expires = m_base;
+    }
+    else if (expires - m_base > WHEEL_MAX_DELTA) {
+        // out of the range of the wheel: parked in the last level and
+        // placed again when it comes out
+        expires = m_base + WHEEL_MAX_DELTA;
+    }
+
+    uint64_t delta = expires - m_base;
+    unsigned level = 0;
+    while (delta >> (WHEEL_BITS * (level + 1))) {
+        level++;
+    }
+
+    unsigned slot = (expires >> (WHEEL_BITS * level)) & WHEEL_MASK;
+    list_add_tail(&timer->node, &m_slots[level][slot]);
+    m_occupied[level] |= 1ULL << slot;
+    timer->level = level;
+    timer->slot = slot;
+}
+
+void
+TimerWheel::add(Timer *timer)
+{
+    if (isEmpty() && !m_dispatching) {
+        // nothing to cascade: skip the idle ticks
+        uint64_t now = now_ticks();
+        if (now > m_base) {
+            m_base = now;
+        }
+    }
+
+    place(timer);
+    if (!m_dispatching && timer->expires < m_armed) {
+        arm();
+    }
+}
+
+void
+TimerWheel::remove(Timer *timer)
+{
+    unsigned level = timer->level;
+    if (level == LEVEL_NONE) {
+        return;
+    }
+
+    list_del_init(&timer->node);
+    timer->level = LEVEL_NONE;
+    if (level < WHEEL_LEVELS && list_empty(&m_slots[level][timer->slot])) {
+        m_occupied[level] &= ~(1ULL << timer->slot);
+    }
+
+    // the runloop timer stays armed: a spurious wake-up is cheaper than
+    // looking for the next deadline on every stop
+}
+
+void
+TimerWheel::cascade(unsigned level, unsigned slot)
+{
+    if (!(m_occupied[level] & (1ULL << slot))) {
+        return;
+    }
+
+    LIST_HEAD(timers);
+    list_splice_init(&m_slots[level][slot], &timers);
+    m_occupied[level] &= ~(1ULL << slot);
+
+    while (!list_empty(&timers)) {
+        Timer *timer = timer_of(timers.next);
+        list_del_init(&timer->node);
+        place(timer);
+    }
+}
+
+/* moves the timers expired by the tick `now` to `batch` */
+void
+TimerWheel::expire(uint64_t now, struct list_head *batch)
+{
+    if (isEmpty()) {
+        if (now >= m_base) {
+            m_base = now + 1;
+        }
+        return;
+    }
+
+    while (m_base <= now) {
+        unsigned idx = m_base & WHEEL_MASK;
+        if (idx == 0) {
+            for (unsigned l = 1; l < WHEEL_LEVELS; l++) {
+                unsigned slot = (m_base >> (WHEEL_BITS * l)) & WHEEL_MASK;
+                cascade(l, slot);
+                if (slot) {
+                    break;
+                }
+            }
+        }
+        else {
+            // skip the empty slots up to the next cascade
+            uint64_t pending = m_occupied[0] >> idx;
+            uint64_t next = pending ? m_base + __builtin_ctzll(pending) :
+                (m_base | WHEEL_MASK) + 1;
+            if (next > m_base) {
+                m_base = (next > now) ? now + 1 : next;
+                continue;
+            }
+        }
+
+        if (m_occupied[0] & (1ULL << idx)) {
+            struct list_head *slot = &m_slots[0][idx];
+            for (struct list_head *p = slot->next; p != slot; p = p->next) {
+                timer_of(p)->level = LEVEL_BATCH;
+            }
+            list_splice_tail_init(slot, batch);
+            m_occupied[0] &= ~(1ULL << idx);
+        }
+        m_base++;
+    }
+}
+
+uint64_t
+TimerWheel::nextExpiry() const
+{
+    uint64_t next = UINT64_MAX;
+
+    uint64_t bits = m_occupied[0];
+    if (bits) {
+        uint64_t pending = bits >> (m_base & WHEEL_MASK);
+        next = pending ? m_base + __builtin_ctzll(pending) :
+            (m_base | WHEEL_MASK) + 1 + __builtin_ctzll(bits);
+    }
+
+    // the timers in the upper levels are due after their cascade
+    for (unsigned l = 1; l < WHEEL_LEVELS; l++) {
+        bits = m_occupied[l];
+        if (!bits) {
+            continue;
+        }
+
+        unsigned shift = WHEEL_BITS * l;
+        uint64_t unit = m_base >> shift;
+        unsigned digit = unit & WHEEL_MASK;
+        uint64_t k;
+        if ((m_base & ((1ULL << shift) - 1)) == 0) {
+            k = __builtin_ctzll(rotate_right(bits, digit));
+        }
+        else {
+            k = __builtin_ctzll(rotate_right(bits, digit + 1)) + 1;
+        }
+
+        uint64_t cascade_at = (unit + k) << shift;
+        if (cascade_at < next) {
+            next = cascade_at;
+        }
+    }
+
+    return next;
+}
+
+void
+TimerWheel::arm()
+{
+    uint64_t next = nextExpiry();
+    if (next == UINT64_MAX) {
+        m_armed = UINT64_MAX;
+        stop();
+        return;
+    }
+
+    uint64_t now = now_ticks();
+    m_armed = next;
+    startOneShot(PurCWTF::Seconds::fromMilliseconds(
+                next > now ? next - now : 0));
+}
+
+void
+TimerWheel::fired()
+{
+    uint64_t now = now_ticks();
+    LIST_HEAD(batch);
+
+    m_armed = UINT64_MAX;
+    m_dispatching = true;
+    expire(now, &batch);
+
+    while (!list_empty(&batch)) {
+        Timer *timer = timer_of(batch.next);
+        list_del_init(&timer->node);
+        timer->level = LEVEL_NONE;
+
+        if (timer->expires > now) {
+            // a parked timer which is not due yet
+            place(timer);
+            continue;
+        }
+
+        if (timer->repeating) {
+            // keep the period; skip the periods already missed
+            timer->due += timer->interval;
+            if (timer->due <= now) {
+                timer->due = now + timer->interval;
+            }
+            timer->expires = coalesce(timer->due, timer->interval);
+            place(timer);
+        }
+
+        // the callback may stop or destroy any timer, itself included
+        timer->func(timer, timer->id, timer->data);
+    }
+
+    m_dispatching = false;
+    if (m_nr_timers == 0) {
+        destroy();
+        return;
+    }
+    arm();
+}
+
 pcintr_timer_t
 pcintr_timer_create(purc_runloop_t runloop, const char* id,
         pcintr_timer_fire_func func, void *data)
 {
-    RunLoop* loop = runloop ? (RunLoop*)runloop : &RunLoop::current();
-    Timer* timer = new Timer(id, func, *loop, data);
+    // the timers run in the runloop of the current thread
+    PC_ASSERT(runloop == NULL ||
+            runloop == (purc_runloop_t)&RunLoop::current());
+    UNUSED_PARAM(runloop);
+
+    Timer* timer = (Timer*)calloc(1, sizeof(Timer));
     if (!timer) {
         purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
         return NULL;
     }
+
+    if (id) {
+        timer->id = strdup(id);
+        if (!timer->id) {
+            free(timer);
+            purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return NULL;
+        }
+    }
+
+    list_head_init(&timer->node);
+    timer->func = func;
+    timer->data = data;
+    timer->level = LEVEL_NONE;
+    timer->wheel = TimerWheel::current();
+    timer->wheel->retain();
     return timer;
 }
 
@@ -95,7 +461,7 @@ void
 pcintr_timer_set_interval(pcintr_timer_t timer, uint32_t interval)
 {
     if (timer) {
-        ((Timer*)timer)->setInterval(interval);
+        ((Timer*)timer)->interval = interval;
     }
 }
 
@@ -103,18 +469,26 @@ uint32_t
 pcintr_timer_get_interval(pcintr_timer_t timer)
 {
     if (timer) {
-        return ((Timer*)timer)->getInterval();
+        return ((Timer*)timer)->interval;
     }
     return 0;
 }
 
+static void
+timer_start(Timer *timer, bool repeating)
+{
+    timer->wheel->remove(timer);
+    timer->repeating = repeating;
+    timer->due = now_ticks() + timer->interval;
+    timer->expires = coalesce(timer->due, timer->interval);
+    timer->wheel->add(timer);
+}
+
 void
 pcintr_timer_start(pcintr_timer_t timer)
 {
     if (timer) {
-        Timer* tm = (Timer*)timer;
-        tm->startRepeating(
-                PurCWTF::Seconds::fromMilliseconds(tm->getInterval()));
+        timer_start((Timer*)timer, true);
     }
 }
 
@@ -122,9 +496,7 @@ void
 pcintr_timer_start_oneshot(pcintr_timer_t timer)
 {
     if (timer) {
-        Timer* tm = (Timer*)timer;
-        tm->startOneShot(
-                PurCWTF::Seconds::fromMilliseconds(tm->getInterval()));
+        timer_start((Timer*)timer, false);
     }
 }
 
@@ -132,14 +504,15 @@ void
 pcintr_timer_stop(pcintr_timer_t timer)
 {
     if (timer) {
-        ((Timer*)timer)->stop();
+        Timer* tm = (Timer*)timer;
+        tm->wheel->remove(tm);
     }
 }
 
 bool
 pcintr_timer_is_active(pcintr_timer_t timer)
 {
-    return timer ? ((Timer*)timer)->isActive() : false;
+    return timer ? ((Timer*)timer)->level != LEVEL_NONE : false;
 }
 
 void
@@ -147,7 +520,12 @@ pcintr_timer_destroy(pcintr_timer_t timer)
 {
     if (timer) {
         Timer* tm = (Timer*)timer;
-        delete tm;
+        tm->wheel->remove(tm);
+        tm->wheel->release();
+        if (tm->id) {
+            free(tm->id);
+        }
+        free(tm);
     }
 }
 
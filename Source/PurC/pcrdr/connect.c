@@ -29,6 +29,7 @@
 #include "private/kvlist.h"
 #include "private/debug.h"
 #include "private/utils.h"
+#include "private/trace.h"
 #include "connect.h"
 
 #include <stdio.h>
@@ -583,11 +584,15 @@ int pcrdr_send_request_and_wait_response(pcrdr_conn* conn,
         return -1;
     }
 
-    if (conn->send_message(conn, request_msg) < 0) {
-        return -1;
+    int retval = -1;
+    PCTRACE_BEGIN(PCTRACE_CAT_RDR, "send_request_and_wait_response");
+
+    if (conn->send_message(conn, request_msg) >= 0) {
+        retval = pcrdr_wait_response_for_specific_request(conn,
+                request_msg->requestId, seconds_expected, response_msg);
     }
 
-    return pcrdr_wait_response_for_specific_request(conn,
-            request_msg->requestId, seconds_expected, response_msg);
+    PCTRACE_END(PCTRACE_CAT_RDR, "send_request_and_wait_response");
+    return retval;
 }
 
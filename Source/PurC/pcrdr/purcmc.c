@@ -47,10 +47,93 @@
 #include <sys/fcntl.h>
 #include <sys/un.h>
 #include <sys/time.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#if OS(LINUX)
+#include <sys/random.h>
+#endif
 
 #define CLI_PATH    "/var/tmp/"
 #define CLI_PERM    S_IRWXU
 
+/* The frame operation codes for WebSocket (RFC 6455) */
+#define WS_OPCODE_CONTINUATION  0x00
+#define WS_OPCODE_TEXT          0x01
+#define WS_OPCODE_BIN           0x02
+#define WS_OPCODE_CLOSE         0x08
+#define WS_OPCODE_PING          0x09
+#define WS_OPCODE_PONG          0x0A
+
+#define WS_FIN_BIT              0x80
+#define WS_RSV_BITS             0x70
+#define WS_OPCODE_MASK          0x0F
+#define WS_CONTROL_BIT          0x08
+#define WS_MASK_BIT             0x80
+#define WS_LENGTH_MASK          0x7F
+#define WS_LENGTH_16BIT         126
+#define WS_LENGTH_64BIT         127
+
+/* 2 bytes of header, 8 bytes of extended length, and 4 bytes of mask */
+#define WS_MAX_HEADER_SIZE      14
+#define WS_MAX_CONTROL_PAYLOAD  125
+#define WS_CLOSE_NORMAL         1000
+
+#define WS_KEY_LEN              16
+#define WS_KEY_GUID             "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+#define WS_HANDSHAKE_REQUEST                \
+    "GET %s HTTP/1.1\r\n"                   \
+    "Host: %s%s%s:%s\r\n"                   \
+    "Upgrade: websocket\r\n"                \
+    "Connection: Upgrade\r\n"               \
+    "Sec-WebSocket-Key: %s\r\n"             \
+    "Sec-WebSocket-Version: 13\r\n"         \
+    "\r\n"
+
+/* the random bytes fetched from the system at a time, for 64 masking keys */
+#define WS_RAND_POOL_SIZE       256
+
+/* the size of the receiving buffer; it holds the handshake response too */
+#define WS_RX_BUFF_SIZE         PCRDR_MAX_FRAME_PAYLOAD_SIZE
+
+#ifdef MSG_NOSIGNAL
+#   define WS_SEND_FLAGS        MSG_NOSIGNAL
+#else
+#   define WS_SEND_FLAGS        0
+#endif
+
+/* the data of a WebSocket connection */
+struct pcrdr_prot_data {
+    /* the random bytes for the masking keys, taken from the entropy
+       source of the system as RFC 6455 requires */
+    uint8_t     rand_pool[WS_RAND_POOL_SIZE];
+    size_t      rand_pos;
+
+    /* the last time (in seconds) when data was sent to or read from
+       the peer */
+    time_t      last_sent;
+    time_t      last_recv;
+    /* the last time when a ping was sent, and whether the peer has not
+       sent anything since then */
+    time_t      last_ping;
+    bool        ping_pending;
+
+    /* the bytes read from the socket but not consumed yet */
+    size_t      rx_pos;
+    size_t      rx_len;
+    char        rx_buf[WS_RX_BUFF_SIZE];
+};
+
+struct ws_frame_header {
+    bool        fin;
+    bool        masked;
+    int         opcode;
+    uint64_t    sz_payload;
+    uint8_t     mask[4];
+};
+
 static inline int conn_read (int fd, void *buff, ssize_t sz)
 {
     if (read (fd, buff, sz) == sz) {
@@ -69,21 +152,447 @@ static inline int conn_write (int fd, const void *data, ssize_t sz)
     return PCRDR_ERROR_IO;
 }
 
-static int my_wait_message (pcrdr_conn* conn, int timeout_ms)
+static int wait_for_readable (int fd, int timeout_ms)
 {
     fd_set rfds;
     struct timeval tv;
 
     FD_ZERO (&rfds);
-    FD_SET (conn->fd, &rfds);
+    FD_SET (fd, &rfds);
 
     if (timeout_ms >= 0) {
         tv.tv_sec = timeout_ms / 1000;
         tv.tv_usec = (timeout_ms % 1000) * 1000;
-        return select (conn->fd + 1, &rfds, NULL, NULL, &tv);
+        return select (fd + 1, &rfds, NULL, NULL, &tv);
+    }
+
+    return select (fd + 1, &rfds, NULL, NULL, NULL);
+}
+
+/* fills the buffer with the bytes from the entropy source of the system */
+static int ws_get_entropy (void *buf, size_t len)
+{
+    uint8_t *p = buf;
+
+#if OS(LINUX)
+    while (len > 0) {
+        ssize_t n = getrandom (p, len, 0);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == ENOSYS)
+                break;      /* fall back to /dev/urandom */
+            return PCRDR_ERROR_IO;
+        }
+        p += n;
+        len -= n;
+    }
+
+    if (len == 0)
+        return 0;
+#endif
+
+    int fd = open ("/dev/urandom", O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return PCRDR_ERROR_IO;
+
+    while (len > 0) {
+        ssize_t n = read (fd, p, len);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR)
+                continue;
+            close (fd);
+            return PCRDR_ERROR_IO;
+        }
+        p += n;
+        len -= n;
+    }
+
+    close (fd);
+    return 0;
+}
+
+static int ws_random (struct pcrdr_prot_data *pd, uint32_t *r)
+{
+    if (pd->rand_pos + sizeof (*r) > sizeof (pd->rand_pool)) {
+        int err_code = ws_get_entropy (pd->rand_pool,
+                sizeof (pd->rand_pool));
+        if (err_code)
+            return err_code;
+        pd->rand_pos = 0;
+    }
+
+    memcpy (r, pd->rand_pool + pd->rand_pos, sizeof (*r));
+    pd->rand_pos += sizeof (*r);
+    return 0;
+}
+
+static int ws_write_all (int fd, const void *data, size_t sz)
+{
+    const char *p = data;
+
+    while (sz > 0) {
+        ssize_t n = send (fd, p, sz, WS_SEND_FLAGS);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            PC_DEBUG ("Failed to write to WebSocket: %s\n", strerror (errno));
+            return PCRDR_ERROR_IO;
+        }
+
+        p += n;
+        sz -= n;
+    }
+
+    return 0;
+}
+
+/* reads exactly `sz` bytes; the bytes read ahead are kept in rx_buf */
+static int ws_read (pcrdr_conn* conn, void *buff, size_t sz)
+{
+    struct pcrdr_prot_data *pd = conn->prot_data;
+    char *p = buff;
+
+    while (sz > 0) {
+        size_t avail = pd->rx_len - pd->rx_pos;
+        if (avail > 0) {
+            size_t n = (avail < sz) ? avail : sz;
+            memcpy (p, pd->rx_buf + pd->rx_pos, n);
+            pd->rx_pos += n;
+            p += n;
+            sz -= n;
+            continue;
+        }
+
+        ssize_t n;
+        if (sz >= sizeof (pd->rx_buf)) {
+            /* a large payload goes to the buffer of the caller directly */
+            n = read (conn->fd, p, sz);
+            if (n > 0) {
+                p += n;
+                sz -= n;
+            }
+        }
+        else {
+            n = read (conn->fd, pd->rx_buf, sizeof (pd->rx_buf));
+            if (n > 0) {
+                pd->rx_pos = 0;
+                pd->rx_len = n;
+            }
+        }
+
+        if (n == 0) {
+            PC_DEBUG ("WebSocket closed by peer\n");
+            return PCRDR_ERROR_IO;
+        }
+        else if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            PC_DEBUG ("Failed to read from WebSocket: %s\n", strerror (errno));
+            return PCRDR_ERROR_IO;
+        }
+    }
+
+    pd->last_recv = purc_get_monotoic_time ();
+    pd->ping_pending = false;
+    return 0;
+}
+
+static uint8_t *ws_put_frame (uint8_t *p, int opcode, bool fin,
+        const uint8_t *payload, size_t len, uint32_t mask)
+{
+    uint8_t key[4];
+
+    *p++ = (fin ? WS_FIN_BIT : 0) | opcode;
+    if (len < WS_LENGTH_16BIT) {
+        *p++ = WS_MASK_BIT | len;
+    }
+    else if (len <= 0xFFFF) {
+        *p++ = WS_MASK_BIT | WS_LENGTH_16BIT;
+        *p++ = (len >> 8) & 0xFF;
+        *p++ = len & 0xFF;
+    }
+    else {
+        *p++ = WS_MASK_BIT | WS_LENGTH_64BIT;
+        for (int i = 7; i >= 0; i--)
+            *p++ = ((uint64_t)len >> (i * 8)) & 0xFF;
+    }
+
+    memcpy (key, &mask, sizeof (key));
+    memcpy (p, key, sizeof (key));
+    p += sizeof (key);
+
+    for (size_t i = 0; i < len; i++)
+        p[i] = payload[i] ^ key[i & 3];
+
+    return p + len;
+}
+
+/* sends a message; all frames of the message go in one write */
+static int ws_send_message (pcrdr_conn* conn, int opcode,
+        const void *data, size_t len)
+{
+    struct pcrdr_prot_data *pd = conn->prot_data;
+    uint8_t stack_buf[WS_MAX_HEADER_SIZE + WS_MAX_CONTROL_PAYLOAD];
+    uint8_t *buf = stack_buf;
+    int err_code;
+
+    size_t nr_frames = (len + PCRDR_MAX_FRAME_PAYLOAD_SIZE - 1) /
+        PCRDR_MAX_FRAME_PAYLOAD_SIZE;
+    if (nr_frames == 0)
+        nr_frames = 1;
+
+    size_t sz_buf = len + nr_frames * WS_MAX_HEADER_SIZE;
+    if (sz_buf > sizeof (stack_buf) && (buf = malloc (sz_buf)) == NULL) {
+        return PCRDR_ERROR_NOMEM;
+    }
+
+    const uint8_t *payload = data;
+    size_t left = len;
+    uint8_t *p = buf;
+    do {
+        size_t sz = (left > PCRDR_MAX_FRAME_PAYLOAD_SIZE) ?
+            PCRDR_MAX_FRAME_PAYLOAD_SIZE : left;
+
+        uint32_t mask;
+        if ((err_code = ws_random (pd, &mask)))
+            goto done;
+
+        p = ws_put_frame (p, (left == len) ? opcode : WS_OPCODE_CONTINUATION,
+                sz == left, payload, sz, mask);
+        payload += sz;
+        left -= sz;
+    } while (left > 0);
+
+    err_code = ws_write_all (conn->fd, buf, p - buf);
+
+done:
+    if (buf != stack_buf)
+        free (buf);
+
+    if (err_code == 0)
+        pd->last_sent = purc_get_monotoic_time ();
+    return err_code;
+}
+
+static int ws_read_frame_header (pcrdr_conn* conn,
+        struct ws_frame_header *header)
+{
+    uint8_t buf[8];
+    int err_code;
+
+    if ((err_code = ws_read (conn, buf, 2)))
+        return err_code;
+
+    if (buf[0] & WS_RSV_BITS) {
+        /* no extension was negotiated */
+        PC_DEBUG ("Reserved bits set in WebSocket frame\n");
+        return PCRDR_ERROR_PROTOCOL;
+    }
+
+    header->fin = buf[0] & WS_FIN_BIT;
+    header->opcode = buf[0] & WS_OPCODE_MASK;
+    header->masked = buf[1] & WS_MASK_BIT;
+    header->sz_payload = buf[1] & WS_LENGTH_MASK;
+
+    if (header->sz_payload == WS_LENGTH_16BIT) {
+        if ((err_code = ws_read (conn, buf, 2)))
+            return err_code;
+        header->sz_payload = ((uint64_t)buf[0] << 8) | buf[1];
+    }
+    else if (header->sz_payload == WS_LENGTH_64BIT) {
+        if ((err_code = ws_read (conn, buf, 8)))
+            return err_code;
+        header->sz_payload = 0;
+        for (int i = 0; i < 8; i++)
+            header->sz_payload = (header->sz_payload << 8) | buf[i];
+    }
+
+    if (header->masked &&
+            (err_code = ws_read (conn, header->mask, sizeof (header->mask))))
+        return err_code;
+
+    return 0;
+}
+
+static int ws_handle_control_frame (pcrdr_conn* conn,
+        const struct ws_frame_header *header)
+{
+    uint8_t payload[WS_MAX_CONTROL_PAYLOAD];
+    size_t len = header->sz_payload;
+    int err_code;
+
+    if (!header->fin || len > WS_MAX_CONTROL_PAYLOAD) {
+        PC_DEBUG ("Bad WebSocket control frame\n");
+        return PCRDR_ERROR_PROTOCOL;
     }
 
-    return select (conn->fd + 1, &rfds, NULL, NULL, NULL);
+    if ((err_code = ws_read (conn, payload, len)))
+        return err_code;
+
+    switch (header->opcode) {
+    case WS_OPCODE_PING:
+        return ws_send_message (conn, WS_OPCODE_PONG, payload, len);
+
+    case WS_OPCODE_PONG:
+        /* the peer is alive; nothing else to do */
+        return 0;
+
+    case WS_OPCODE_CLOSE:
+        PC_INFO ("Peer closed\n");
+        /* echo the status code */
+        ws_send_message (conn, WS_OPCODE_CLOSE, payload, len > 2 ? 2 : len);
+        return PCRDR_ERROR_PEER_CLOSED;
+
+    default:
+        PC_DEBUG ("Bad WebSocket opcode: %d\n", header->opcode);
+        return PCRDR_ERROR_PROTOCOL;
+    }
+}
+
+/* Reads a message from WebSocket. The control frames before or among the
+   frames of the message are handled in place; if only a control frame was
+   read, `*packet` is NULL and `*sz_packet` is zero. */
+static int ws_read_message (pcrdr_conn* conn, char **packet, size_t *sz_packet)
+{
+    struct ws_frame_header header;
+    char *buf = NULL;
+    size_t total = 0;
+    int opcode = -1;    /* the opcode of the message being read */
+    int err_code;
+
+    *packet = NULL;
+    *sz_packet = 0;
+
+    while (true) {
+        if ((err_code = ws_read_frame_header (conn, &header)))
+            goto failed;
+
+        if (header.masked) {
+            PC_DEBUG ("Masked WebSocket frame from server\n");
+            err_code = PCRDR_ERROR_PROTOCOL;
+            goto failed;
+        }
+
+        if (header.opcode & WS_CONTROL_BIT) {
+            if ((err_code = ws_handle_control_frame (conn, &header)))
+                goto failed;
+
+            if (opcode < 0)
+                return 0;
+            continue;
+        }
+
+        if (header.opcode == WS_OPCODE_CONTINUATION) {
+            if (opcode < 0) {
+                PC_DEBUG ("Not in a fragmented message\n");
+                err_code = PCRDR_ERROR_PROTOCOL;
+                goto failed;
+            }
+        }
+        else if (header.opcode == WS_OPCODE_TEXT ||
+                header.opcode == WS_OPCODE_BIN) {
+            if (opcode >= 0) {
+                PC_DEBUG ("Not a continuation frame\n");
+                err_code = PCRDR_ERROR_PROTOCOL;
+                goto failed;
+            }
+            opcode = header.opcode;
+        }
+        else {
+            PC_DEBUG ("Bad WebSocket opcode: %d\n", header.opcode);
+            err_code = PCRDR_ERROR_PROTOCOL;
+            goto failed;
+        }
+
+        if (header.sz_payload > PCRDR_MAX_INMEM_PAYLOAD_SIZE - total) {
+            err_code = PCRDR_ERROR_TOO_LARGE;
+            goto failed;
+        }
+
+        char *p = realloc (buf, total + header.sz_payload + 1);
+        if (p == NULL) {
+            err_code = PCRDR_ERROR_NOMEM;
+            goto failed;
+        }
+        buf = p;
+
+        if ((err_code = ws_read (conn, buf + total, header.sz_payload)))
+            goto failed;
+        total += header.sz_payload;
+
+        if (header.fin)
+            break;
+    }
+
+    if (opcode == WS_OPCODE_TEXT) {
+        buf[total] = '\0';
+        *sz_packet = total + 1;
+    }
+    else {
+        *sz_packet = total;
+    }
+
+    *packet = buf;
+    return 0;
+
+failed:
+    if (buf)
+        free (buf);
+    return err_code;
+}
+
+/* pings the peer when idle, and checks whether the peer is alive */
+static int ws_keep_alive (pcrdr_conn* conn)
+{
+    struct pcrdr_prot_data *pd = conn->prot_data;
+    time_t now = purc_get_monotoic_time ();
+    bool ping;
+
+    if (pd->ping_pending) {
+        /* the peer is only taken as dead if it did not reply to a ping;
+           a quiet peer is fine as long as it replies */
+        if (now - pd->last_ping >=
+                PCRDR_MAX_NO_RESPONDING_TIME - PCRDR_MAX_PING_TIME / 2) {
+            PC_WARN ("No reply from the renderer for %d seconds\n",
+                    (int)(now - pd->last_ping));
+            return PCRDR_ERROR_PEER_CLOSED;
+        }
+
+        ping = (now - pd->last_ping >= PCRDR_MAX_PING_TIME / 2);
+    }
+    else {
+        ping = (now - pd->last_recv >= PCRDR_MAX_PING_TIME / 2);
+    }
+
+    /* also keep the connection alive in the view of the peer */
+    if (ping || now - pd->last_sent >= PCRDR_MAX_PING_TIME / 2) {
+        int err_code = ws_send_message (conn, WS_OPCODE_PING, NULL, 0);
+        if (err_code)
+            return err_code;
+
+        pd->last_ping = now;
+        pd->ping_pending = true;
+    }
+
+    return 0;
+}
+
+static int my_wait_message (pcrdr_conn* conn, int timeout_ms)
+{
+    if (conn->type == CT_WEB_SOCKET) {
+        int err_code = ws_keep_alive (conn);
+        if (err_code) {
+            purc_set_error (err_code);
+            return -1;
+        }
+
+        /* the frames read ahead */
+        if (conn->prot_data->rx_pos < conn->prot_data->rx_len)
+            return 1;
+    }
+
+    return wait_for_readable (conn->fd, timeout_ms);
 }
 
 static pcrdr_msg *my_read_message (pcrdr_conn* conn)
@@ -170,8 +679,7 @@ static int my_ping_peer (pcrdr_conn* conn)
         }
     }
     else if (conn->type == CT_WEB_SOCKET) {
-        /* TODO */
-        err_code = PCRDR_ERROR_NOT_IMPLEMENTED;
+        err_code = ws_send_message (conn, WS_OPCODE_PING, NULL, 0);
     }
     else {
         err_code = PCRDR_ERROR_INVALID_VALUE;
@@ -201,8 +709,12 @@ static int my_disconnect (pcrdr_conn* conn)
         }
     }
     else if (conn->type == CT_WEB_SOCKET) {
-        /* TODO */
-        err_code = PCRDR_ERROR_NOT_IMPLEMENTED;
+        uint8_t status[2] = { WS_CLOSE_NORMAL >> 8, WS_CLOSE_NORMAL & 0xFF };
+
+        err_code = ws_send_message (conn, WS_OPCODE_CLOSE,
+                status, sizeof (status));
+        free (conn->prot_data);
+        conn->prot_data = NULL;
     }
     else {
         err_code = PCRDR_ERROR_INVALID_VALUE;
@@ -316,16 +828,278 @@ error:
     return -1;
 }
 
-int pcrdr_purcmc_connect_via_web_socket (const char* host_name, int port,
+/* computes the value of Sec-WebSocket-Accept for the key */
+static void ws_make_accept (const char *key, char *accept, size_t sz)
+{
+    pcutils_sha1_ctxt ctx;
+    uint8_t digest[SHA1_DIGEST_SIZE];
+
+    pcutils_sha1_begin (&ctx);
+    pcutils_sha1_hash (&ctx, key, strlen (key));
+    pcutils_sha1_hash (&ctx, WS_KEY_GUID, sizeof (WS_KEY_GUID) - 1);
+    pcutils_sha1_end (&ctx, digest);
+    pcutils_b64_encode (digest, sizeof (digest), accept, sz);
+}
+
+static bool ws_header_is (const char *name, size_t len, const char *expected)
+{
+    return len == strlen (expected) &&
+        pcutils_strncasecmp (name, expected, len) == 0;
+}
+
+/* checks whether a comma-separated header value contains the token */
+static bool ws_header_has_token (const char *value, size_t len,
+        const char *token)
+{
+    size_t token_len = strlen (token);
+
+    while (len > 0) {
+        size_t n = 0;
+        while (n < len && value[n] != ',')
+            n++;
+
+        const char *start = value, *end = value + n;
+        while (start < end && (*start == ' ' || *start == '\t'))
+            start++;
+        while (end > start && (end[-1] == ' ' || end[-1] == '\t'))
+            end--;
+
+        if ((size_t)(end - start) == token_len &&
+                pcutils_strncasecmp (start, token, token_len) == 0)
+            return true;
+
+        if (n == len)
+            break;
+        value += n + 1;
+        len -= n + 1;
+    }
+
+    return false;
+}
+
+/* checks the response of the opening handshake in rx_buf */
+static int ws_check_handshake_response (const char *response,
+        const char *end, const char *accept)
+{
+    bool upgraded = false, connection = false, accepted = false;
+    const char *line = response;
+    const char *eol = strstr (line, "\r\n");
+
+    if (strncmp (line, "HTTP/1.1 101", 12)) {
+        PC_DEBUG ("WebSocket handshake refused: %.*s\n",
+                (int)(eol - line), line);
+        return PCRDR_ERROR_SERVER_REFUSED;
+    }
+
+    for (line = eol + 2; line < end; line = eol + 2) {
+        eol = strstr (line, "\r\n");
+
+        const char *colon = memchr (line, ':', eol - line);
+        if (colon == NULL)
+            return PCRDR_ERROR_PROTOCOL;
+
+        const char *value = colon + 1;
+        while (value < eol && (*value == ' ' || *value == '\t'))
+            value++;
+        size_t name_len = colon - line, value_len = eol - value;
+        while (value_len > 0 &&
+                (value[value_len - 1] == ' ' || value[value_len - 1] == '\t'))
+            value_len--;
+
+        if (ws_header_is (line, name_len, "Upgrade")) {
+            upgraded = ws_header_is (value, value_len, "websocket");
+        }
+        else if (ws_header_is (line, name_len, "Connection")) {
+            connection = ws_header_has_token (value, value_len, "upgrade");
+        }
+        else if (ws_header_is (line, name_len, "Sec-WebSocket-Accept")) {
+            accepted = value_len == strlen (accept) &&
+                strncmp (value, accept, value_len) == 0;
+        }
+        else if (ws_header_is (line, name_len, "Sec-WebSocket-Extensions") ||
+                ws_header_is (line, name_len, "Sec-WebSocket-Protocol")) {
+            /* none was requested */
+            PC_DEBUG ("Unexpected header in WebSocket handshake: %.*s\n",
+                    (int)name_len, line);
+            return PCRDR_ERROR_PROTOCOL;
+        }
+    }
+
+    if (!upgraded || !connection || !accepted) {
+        PC_DEBUG ("Bad WebSocket handshake response\n");
+        return PCRDR_ERROR_PROTOCOL;
+    }
+
+    return 0;
+}
+
+static int ws_handshake (pcrdr_conn* conn, const char *host_name,
+        const char *port, const char *path)
+{
+    struct pcrdr_prot_data *pd = conn->prot_data;
+    uint8_t nonce[WS_KEY_LEN];
+    char key[pcutils_b64_encoded_length (WS_KEY_LEN)];
+    char accept[pcutils_b64_encoded_length (SHA1_DIGEST_SIZE)];
+    int err_code;
+
+    if ((err_code = ws_get_entropy (nonce, sizeof (nonce))))
+        return err_code;
+    pcutils_b64_encode (nonce, sizeof (nonce), key, sizeof (key));
+    ws_make_accept (key, accept, sizeof (accept));
+
+    /* an IPv6 address is enclosed in brackets in the Host header */
+    bool ipv6 = strchr (host_name, ':') != NULL;
+    size_t sz_request = sizeof (WS_HANDSHAKE_REQUEST) + strlen (path) +
+        strlen (host_name) + strlen (port) + strlen (key);
+    char *request = malloc (sz_request);
+    if (request == NULL)
+        return PCRDR_ERROR_NOMEM;
+
+    int len = snprintf (request, sz_request, WS_HANDSHAKE_REQUEST,
+            path, ipv6 ? "[" : "", host_name, ipv6 ? "]" : "", port, key);
+    err_code = ws_write_all (conn->fd, request, len);
+    free (request);
+    if (err_code)
+        return err_code;
+
+    /* read the response; the frames following it stay in rx_buf */
+    size_t sz_read = 0;
+    char *end = NULL;
+    while (end == NULL) {
+        if (sz_read == sizeof (pd->rx_buf) - 1) {
+            PC_DEBUG ("Too long WebSocket handshake response\n");
+            return PCRDR_ERROR_PROTOCOL;
+        }
+
+        int ret = wait_for_readable (conn->fd, PCRDR_DEF_TIME_EXPECTED * 1000);
+        if (ret == 0)
+            return PCRDR_ERROR_TIMEOUT;
+        else if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            return PCRDR_ERROR_BAD_SYSTEM_CALL;
+        }
+
+        ssize_t n = read (conn->fd, pd->rx_buf + sz_read,
+                sizeof (pd->rx_buf) - 1 - sz_read);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return PCRDR_ERROR_IO;
+
+        sz_read += n;
+        pd->rx_buf[sz_read] = '\0';
+        end = strstr (pd->rx_buf, "\r\n\r\n");
+    }
+
+    pd->rx_pos = end + 4 - pd->rx_buf;
+    pd->rx_len = sz_read;
+    return ws_check_handshake_response (pd->rx_buf, end + 2, accept);
+}
+
+/* returns fd if all OK, -1 on error */
+static int purcmc_connect_via_web_socket (const char* host_name,
+        const char* port, const char* path,
         const char* app_name, const char* runner_name, pcrdr_conn** conn)
 {
-    UNUSED_PARAM(host_name);
-    UNUSED_PARAM(port);
-    UNUSED_PARAM(app_name);
-    UNUSED_PARAM(runner_name);
-    UNUSED_PARAM(conn);
+    int fd = -1, err_code = PCRDR_ERROR_BAD_CONNECTION;
+    struct addrinfo hints, *addrs = NULL, *ai;
+    char own_host_name[256];
+
+    if (!purc_is_valid_app_name(app_name) ||
+            !purc_is_valid_runner_name(runner_name)) {
+        purc_set_error(PURC_EXCEPT_INVALID_VALUE);
+        return -1;
+    }
+
+    if ((*conn = calloc (1, sizeof (pcrdr_conn))) == NULL ||
+            ((*conn)->prot_data =
+                calloc (1, sizeof (struct pcrdr_prot_data))) == NULL) {
+        PC_DEBUG ("Failed to callocate space for connection: %s\n",
+                strerror (errno));
+        err_code = PCRDR_ERROR_NOMEM;
+        goto error;
+    }
+
+    memset (&hints, 0, sizeof (hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo (host_name, port, &hints, &addrs)) {
+        PC_DEBUG ("Failed to resolve %s:%s\n", host_name, port);
+        goto error;
+    }
+
+    for (ai = addrs; ai; ai = ai->ai_next) {
+        if ((fd = socket (ai->ai_family, ai->ai_socktype,
+                        ai->ai_protocol)) < 0)
+            continue;
+
+        if (connect (fd, ai->ai_addr, ai->ai_addrlen) == 0)
+            break;
+
+        close (fd);
+        fd = -1;
+    }
+    freeaddrinfo (addrs);
 
-    purc_set_error (PCRDR_ERROR_NOT_IMPLEMENTED);
+    if (fd < 0) {
+        PC_DEBUG ("Failed to connect to %s:%s: %s\n", host_name, port,
+                strerror (errno));
+        goto error;
+    }
+
+    /* a message is written in one go; do not wait for more */
+    int on = 1;
+    setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof (on));
+
+    (*conn)->prot = PURC_RDRPROT_PURCMC;
+    (*conn)->type = CT_WEB_SOCKET;
+    (*conn)->fd = fd;
+    (*conn)->timeout_ms = 10;   /* 10 milliseconds */
+    (*conn)->srv_host_name = strdup (host_name);
+    if (gethostname (own_host_name, sizeof (own_host_name)) == 0) {
+        own_host_name[sizeof (own_host_name) - 1] = '\0';
+        (*conn)->own_host_name = strdup (own_host_name);
+    }
+    else {
+        (*conn)->own_host_name = strdup (PCRDR_LOCALHOST);
+    }
+    (*conn)->app_name = app_name;
+    (*conn)->runner_name = runner_name;
+
+    struct pcrdr_prot_data *pd = (*conn)->prot_data;
+    pd->rand_pos = sizeof (pd->rand_pool);      /* fetched on demand */
+    pd->last_sent = pd->last_recv = purc_get_monotoic_time ();
+
+    if ((err_code = ws_handshake (*conn, host_name, port, path)))
+        goto error;
+
+    (*conn)->wait_message = my_wait_message;
+    (*conn)->read_message = my_read_message;
+    (*conn)->send_message = my_send_message;
+    (*conn)->ping_peer = my_ping_peer;
+    (*conn)->disconnect = my_disconnect;
+
+    list_head_init (&(*conn)->pending_requests);
+
+    return fd;
+
+error:
+    if (fd >= 0)
+        close (fd);
+
+    if (*conn) {
+        if ((*conn)->prot_data)
+            free ((*conn)->prot_data);
+        if ((*conn)->srv_host_name)
+            free ((*conn)->srv_host_name);
+        if ((*conn)->own_host_name)
+            free ((*conn)->own_host_name);
+        free (*conn);
+        *conn = NULL;
+    }
+
+    purc_set_error(err_code);
     return -1;
 }
 
@@ -434,8 +1208,24 @@ int pcrdr_purcmc_read_packet (pcrdr_conn* conn, char* packet_buf, size_t *sz_pac
         }
     }
     else if (conn->type == CT_WEB_SOCKET) {
-        /* TODO */
-        err_code = PCRDR_ERROR_NOT_IMPLEMENTED;
+        char *packet;
+        size_t len;
+
+        err_code = ws_read_message (conn, &packet, &len);
+        if (err_code == 0) {
+            /* the length of the buffer is given by `sz_packet` */
+            if (len > *sz_packet) {
+                err_code = PCRDR_ERROR_TOO_SMALL_BUFF;
+            }
+            else {
+                if (len > 0)
+                    memcpy (packet_buf, packet, len);
+                *sz_packet = len;
+            }
+
+            if (packet)
+                free (packet);
+        }
     }
     else {
         err_code = PCRDR_ERROR_INVALID_VALUE;
@@ -571,8 +1361,7 @@ int pcrdr_purcmc_read_packet_alloc (pcrdr_conn* conn, void **packet, size_t *sz_
         }
     }
     else if (conn->type == CT_WEB_SOCKET) {
-        /* TODO */
-        err_code = PCRDR_ERROR_NOT_IMPLEMENTED;
+        err_code = ws_read_message (conn, &packet_buf, sz_packet);
         goto done;
     }
     else {
@@ -641,16 +1430,79 @@ int pcrdr_purcmc_send_text_packet (pcrdr_conn* conn, const char* text, size_t le
         }
     }
     else if (conn->type == CT_WEB_SOCKET) {
-        /* TODO */
-        retv = PCRDR_ERROR_NOT_IMPLEMENTED;
+        retv = ws_send_message (conn, WS_OPCODE_TEXT, text, len);
     }
     else
         retv = PCRDR_ERROR_INVALID_VALUE;
 
+    if (retv) {
+        purc_set_error (retv);
+        retv = -1;
+    }
+
     return retv;
 }
 
 #define SCHEMA_UNIX_SOCKET  "unix://"
+#define SCHEMA_WEB_SOCKET   "ws://"
+
+/* connects to `host[:port][/path]`, or `[ipv6-address][:port][/path]` */
+static int connect_via_web_socket_uri(const char* uri,
+        const char* app_name, const char* runner_name, pcrdr_conn** conn)
+{
+    char *host_name = NULL, *port = NULL, *path = NULL;
+    const char *p = uri;
+    size_t n;
+    int fd = -1;
+
+    if (*p == '[') {
+        const char *end = strchr(p, ']');
+        if (end == NULL)
+            goto bad_uri;
+        host_name = strndup(p + 1, end - p - 1);
+        p = end + 1;
+    }
+    else {
+        n = strcspn(p, ":/");
+        host_name = strndup(p, n);
+        p += n;
+    }
+
+    if (*p == ':') {
+        p++;
+        n = strcspn(p, "/");
+        port = strndup(p, n);
+        p += n;
+    }
+    else {
+        port = strdup(PCRDR_PURCMC_WS_PORT);
+    }
+
+    path = strdup(*p == '/' ? p : "/");
+    if (host_name == NULL || port == NULL || path == NULL) {
+        purc_set_error(PCRDR_ERROR_NOMEM);
+        goto done;
+    }
+
+    if (host_name[0] == '\0' || port[0] == '\0' || (*p && *p != '/'))
+        goto bad_uri;
+
+    fd = purcmc_connect_via_web_socket(host_name, port, path,
+            app_name, runner_name, conn);
+    goto done;
+
+bad_uri:
+    purc_set_error(PURC_ERROR_INVALID_VALUE);
+
+done:
+    if (host_name)
+        free(host_name);
+    if (port)
+        free(port);
+    if (path)
+        free(path);
+    return fd;
+}
 
 pcrdr_msg *pcrdr_purcmc_connect(const char* renderer_uri,
         const char* app_name, const char* runner_name, pcrdr_conn** conn)
@@ -658,23 +1510,37 @@ pcrdr_msg *pcrdr_purcmc_connect(const char* renderer_uri,
     pcrdr_msg *msg = NULL;
 
     if (pcutils_strncasecmp (SCHEMA_UNIX_SOCKET, renderer_uri,
-            sizeof(SCHEMA_UNIX_SOCKET) - 1)) {
-        purc_set_error(PURC_ERROR_NOT_SUPPORTED);
-        return NULL;
+            sizeof(SCHEMA_UNIX_SOCKET) - 1) == 0) {
+        if (purcmc_connect_via_unix_socket(
+                renderer_uri + sizeof(SCHEMA_UNIX_SOCKET) - 1,
+                app_name, runner_name, conn) < 0) {
+            return NULL;
+        }
     }
-
-    if (purcmc_connect_via_unix_socket(
-            renderer_uri + sizeof(SCHEMA_UNIX_SOCKET) - 1,
-            app_name, runner_name, conn) < 0) {
+    else if (pcutils_strncasecmp (SCHEMA_WEB_SOCKET, renderer_uri,
+            sizeof(SCHEMA_WEB_SOCKET) - 1) == 0) {
+        if (connect_via_web_socket_uri(
+                renderer_uri + sizeof(SCHEMA_WEB_SOCKET) - 1,
+                app_name, runner_name, conn) < 0) {
+            return NULL;
+        }
+    }
+    else {
+        /* Secured WebSocket (wss://) needs a TLS library */
+        purc_set_error(PURC_ERROR_NOT_SUPPORTED);
         return NULL;
     }
 
-    /* read the initial response from the server */
+    /* read the initial response from the server; skip the packets
+       carrying no data (ping or pong) */
     char buff[PCRDR_DEF_PACKET_BUFF_SIZE];
-    size_t len = sizeof(buff);
+    size_t len;
 
-    if (pcrdr_purcmc_read_packet(*conn, buff, &len) < 0)
-        goto failed;
+    do {
+        len = sizeof(buff);
+        if (pcrdr_purcmc_read_packet(*conn, buff, &len) < 0)
+            goto failed;
+    } while (len == 0);
 
     if (pcrdr_parse_packet(buff, len, &msg) < 0)
         goto failed;
@@ -38,11 +38,42 @@ align(size_t n)
     return (n + 15) / 16 * 16;
 }
 
+static inline size_t
+gap_size(struct pcutils_array_list *al)
+{
+    return al->sz - al->nr;
+}
+
+static inline size_t
+slot_of(struct pcutils_array_list *al, size_t idx)
+{
+    return idx < al->gap ? idx : idx + gap_size(al);
+}
+
+static void
+move_gap(struct pcutils_array_list *al, size_t idx)
+{
+    struct pcutils_array_list_node **nodes = al->nodes;
+    size_t gs = gap_size(al);
+
+    PC_ASSERT(idx <= al->nr);
+
+    if (gs && idx < al->gap) {
+        memmove(nodes + idx + gs, nodes + idx,
+                (al->gap - idx) * sizeof(*nodes));
+    }
+    else if (gs && idx > al->gap) {
+        memmove(nodes + al->gap, nodes + al->gap + gs,
+                (idx - al->gap) * sizeof(*nodes));
+    }
+
+    al->gap = idx;
+}
+
 void
 pcutils_array_list_init(struct pcutils_array_list *al)
 {
     memset(al, 0, sizeof(*al));
-    INIT_LIST_HEAD(&al->list);
 }
 
 void
@@ -54,9 +85,20 @@ pcutils_array_list_reset(struct pcutils_array_list *al)
         al->nodes = NULL;
         al->sz = 0;
         al->nr = 0;
+        al->gap = 0;
+        al->dirty = 0;
     }
 }
 
+void
+pcutils_array_list_refresh(struct pcutils_array_list *al)
+{
+    for (size_t i = al->dirty; i < al->nr; ++i)
+        al->nodes[slot_of(al, i)]->idx = i;
+
+    al->dirty = al->nr;
+}
+
 int
 pcutils_array_list_expand(struct pcutils_array_list *al, size_t capacity)
 {
@@ -73,6 +115,13 @@ pcutils_array_list_expand(struct pcutils_array_list *al, size_t capacity)
         if (!nodes)
             return -1;
 
+        // keep the trailing nodes at the end of the enlarged buffer
+        size_t tail = al->nr - al->gap;
+        if (tail) {
+            memmove(nodes + n - tail, nodes + al->sz - tail,
+                    tail * sizeof(*nodes));
+        }
+
         al->nodes = nodes;
         al->sz    = n;
     }
@@ -87,8 +136,6 @@ pcutils_array_list_set(struct pcutils_array_list *al,
         struct pcutils_array_list_node **old)
 {
     PC_ASSERT(node);
-    PC_ASSERT(node->node.prev == NULL);
-    PC_ASSERT(node->node.next == NULL);
     PC_ASSERT(node->idx == (size_t)-1);
     PC_ASSERT(old);
 
@@ -96,12 +143,12 @@ pcutils_array_list_set(struct pcutils_array_list *al,
         return -1;
 
     PC_ASSERT(al->nodes);
-    struct pcutils_array_list_node *curr = al->nodes[idx];
-    list_del(&curr->node);
-    list_add_tail(&node->node, &al->list);
+    size_t slot = slot_of(al, idx);
+    *old = al->nodes[slot];
+    (*old)->idx = (size_t)-1;
 
-    *old = al->nodes[idx];
-    al->nodes[idx] = node;
+    al->nodes[slot] = node;
+    node->idx = idx;
 
     return 0;
 }
@@ -112,14 +159,13 @@ pcutils_array_list_insert_before(struct pcutils_array_list *al,
         struct pcutils_array_list_node *node)
 {
     PC_ASSERT(node);
-    PC_ASSERT(node->node.prev == NULL);
-    PC_ASSERT(node->node.next == NULL);
     PC_ASSERT(node->idx == (size_t)-1);
 
     int r;
 
     if (al->nr == al->sz) {
-        r = pcutils_array_list_expand(al, al->sz + 16);
+        // grow geometrically to keep appending amortized O(1)
+        r = pcutils_array_list_expand(al, al->sz < 16 ? 16 : al->sz * 2);
         if (r)
             return -1;
     }
@@ -127,18 +173,18 @@ pcutils_array_list_insert_before(struct pcutils_array_list *al,
     if (idx >= al->nr)
         idx = al->nr;
 
-    if (al->nr > 0) {
-        for (size_t i=al->nr-1; i>=idx; --i) {
-            al->nodes[i+1] = al->nodes[i];
-            al->nodes[i+1]->idx = i+1;
-            if (i==0)
-                break;
-        }
-    }
-    al->nodes[idx] = node;
-    al->nodes[idx]->idx = idx;
+    move_gap(al, idx);
 
-    list_add_tail(&node->node, &al->list);
+    al->nodes[al->gap++] = node;
+    node->idx = idx;
+
+    if (idx == al->nr && al->dirty == al->nr) {
+        // appended, no node was shifted
+        al->dirty = al->nr + 1;
+    }
+    else if (idx < al->dirty) {
+        al->dirty = idx;
+    }
 
     al->nr += 1;
 
@@ -155,32 +201,22 @@ pcutils_array_list_remove(struct pcutils_array_list *al,
         return -1;
     }
 
-    struct pcutils_array_list_node *node = al->nodes[idx];
+    move_gap(al, idx + 1);
 
-    for (size_t i=node->idx; i+1<al->nr; ++i) {
-        al->nodes[i] = al->nodes[i+1];
-        al->nodes[i]->idx = i;
-    }
-    al->nodes[al->nr-1] = NULL;
+    struct pcutils_array_list_node *node = al->nodes[idx];
+    al->nodes[idx] = NULL;
+    al->gap = idx;
 
-    list_del(&node->node);
     node->idx = -1;
 
     *old = node;
 
     al->nr -= 1;
 
-    return 0;
-}
-
-struct pcutils_array_list_node*
-pcutils_array_list_get(struct pcutils_array_list *al,
-        size_t idx)
-{
-    if (idx < al->nr)
-        return al->nodes[idx];
+    if (idx < al->dirty)
+        al->dirty = idx;
 
-    return NULL;
+    return 0;
 }
 
 int
@@ -193,12 +229,15 @@ pcutils_array_list_swap(struct pcutils_array_list *al,
     if (i == j)
         return 0;
 
-    struct pcutils_array_list_node *l = al->nodes[i];
-    struct pcutils_array_list_node *r = al->nodes[j];
+    size_t si = slot_of(al, i);
+    size_t sj = slot_of(al, j);
+
+    struct pcutils_array_list_node *l = al->nodes[si];
+    struct pcutils_array_list_node *r = al->nodes[sj];
 
-    al->nodes[i] = r;
+    al->nodes[si] = r;
     r->idx = i;
-    al->nodes[j] = l;
+    al->nodes[sj] = l;
     l->idx = j;
 
     return 0;
@@ -239,6 +278,9 @@ pcutils_array_list_sort(struct pcutils_array_list *al,
         void *ud, int (*cmp)(struct pcutils_array_list_node *l,
                 struct pcutils_array_list_node *r, void *ud))
 {
+    // make the nodes contiguous
+    move_gap(al, al->nr);
+
     struct pcutils_array_list_node **nodes = al->nodes;
     size_t nr = al->nr;
 
@@ -255,9 +297,7 @@ pcutils_array_list_sort(struct pcutils_array_list *al,
     qsort_s(nodes, nr, sizeof(*nodes), cmp_f, &d);
 #endif
 
-    for (size_t i=0; i<al->nr; ++i) {
-        struct pcutils_array_list_node *l = al->nodes[i];
-        l->idx = i;
-    }
+    al->dirty = 0;
+    pcutils_array_list_refresh(al);
 }
 
@@ -28,6 +28,7 @@
 #include "purc-utils.h"
 #include "private/errors.h"
 #include "private/instance.h"
+#include "private/rwstream.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -651,6 +652,177 @@ void* purc_rwstream_get_mem_buffer_ex (purc_rwstream_t rws,
     return rws->funcs->get_mem_buffer(rws, sz_content, sz_buffer, res_buff);
 }
 
+/* buffered line reader */
+#define LINE_READER_MIN_BUFF    (1024 * 64)
+
+struct pcutils_line_reader
+{
+    purc_rwstream_t stm;
+    size_t max_len;
+
+    char* buf;
+    size_t sz_buf;
+    size_t head;        /* the first byte not consumed */
+    size_t tail;        /* the end of the bytes read */
+    size_t scanned;     /* the bytes after head known to have no LF */
+    bool eof;           /* the last read reached the end of the stream */
+};
+
+struct pcutils_line_reader *
+pcutils_line_reader_new (purc_rwstream_t stm, size_t max_len)
+{
+    struct pcutils_line_reader* reader = calloc(1, sizeof(*reader));
+    if (reader == NULL) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    reader->buf = malloc(LINE_READER_MIN_BUFF);
+    if (reader->buf == NULL) {
+        free(reader);
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    reader->stm = stm;
+    reader->max_len = max_len;
+    reader->sz_buf = LINE_READER_MIN_BUFF;
+    return reader;
+}
+
+void pcutils_line_reader_delete (struct pcutils_line_reader *reader)
+{
+    free(reader->buf);
+    free(reader);
+}
+
+/* Returns 1 if more bytes are read, 0 if no byte is available (at the end
+   of the stream, or for a non-blocking stream), -1 on error. */
+static int line_reader_fill (struct pcutils_line_reader *reader)
+{
+    size_t avail = reader->tail - reader->head;
+
+    if (reader->head > 0) {
+        memmove(reader->buf, reader->buf + reader->head, avail);
+        reader->head = 0;
+        reader->tail = avail;
+    }
+
+    if (reader->tail == reader->sz_buf) {
+        size_t sz = reader->sz_buf * 2;
+        char* buf = realloc(reader->buf, sz);
+        if (buf == NULL) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return -1;
+        }
+        reader->buf = buf;
+        reader->sz_buf = sz;
+    }
+
+    ssize_t nr_read = purc_rwstream_read(reader->stm, reader->buf + reader->tail,
+            reader->sz_buf - reader->tail);
+    reader->eof = (nr_read == 0);
+    if (nr_read > 0) {
+        reader->tail += nr_read;
+        return 1;
+    }
+    else if (nr_read < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            return -1;
+        purc_clr_error();
+    }
+
+    return 0;
+}
+
+int pcutils_line_reader_next (struct pcutils_line_reader *reader,
+        const char **line, size_t *len)
+{
+    for (;;) {
+        char* start = reader->buf + reader->head;
+        size_t avail = reader->tail - reader->head;
+
+        /* memchr() is vectorized by the C library */
+        char* lf = memchr(start + reader->scanned, '\n',
+                avail - reader->scanned);
+        size_t n = lf ? (size_t)(lf - start) : avail;
+        size_t line_len = (lf && n > 0 && start[n - 1] == '\r') ? n - 1 : n;
+
+        if (reader->max_len && line_len > reader->max_len) {
+            /* do not split a UTF-8 character */
+            size_t k = reader->max_len;
+            while (k > 0 && (start[k] & 0xC0) == 0x80)
+                k--;
+            if (k == 0)
+                k = reader->max_len;
+
+            reader->head += k;
+            reader->scanned = n - k;
+            *line = start;
+            *len = k;
+            return 1;
+        }
+
+        if (lf) {
+            reader->head += n + 1;
+            reader->scanned = 0;
+            *line = start;
+            *len = line_len;
+            return 1;
+        }
+        reader->scanned = avail;
+
+        int ret = line_reader_fill(reader);
+        if (ret > 0)
+            continue;
+        else if (ret < 0)
+            return -1;
+
+        /* no more data for now: the bytes left make the last line
+           only at the end of the stream */
+        if (avail == 0 || !reader->eof)
+            return 0;
+
+        start = reader->buf + reader->head;
+        reader->head = reader->tail;
+        reader->scanned = 0;
+        *line = start;
+        *len = avail;
+        return 1;
+    }
+}
+
+ssize_t pcutils_line_reader_read (struct pcutils_line_reader *reader,
+        void *buf, size_t count)
+{
+    size_t avail = reader->tail - reader->head;
+    if (avail == 0)
+        return purc_rwstream_read(reader->stm, buf, count);
+
+    if (count > avail)
+        count = avail;
+    memcpy(buf, reader->buf + reader->head, count);
+    reader->head += count;
+    reader->scanned = (reader->scanned > count) ? reader->scanned - count : 0;
+    return count;
+}
+
+size_t pcutils_line_reader_buffered (struct pcutils_line_reader *reader)
+{
+    return reader->tail - reader->head;
+}
+
+int pcutils_line_reader_sync (struct pcutils_line_reader *reader)
+{
+    size_t avail = reader->tail - reader->head;
+    if (avail > 0 &&
+            purc_rwstream_seek(reader->stm, -(off_t)avail, SEEK_CUR) == -1)
+        return -1;
+
+    reader->head = reader->tail = reader->scanned = 0;
+    return 0;
+}
+
 /* stdio rwstream functions */
 static off_t stdio_seek (purc_rwstream_t rws, off_t offset, int whence)
 {
@@ -44,79 +44,301 @@ do {                                                        \
     goto error;                                             \
 } while (0)
 
-/* see IETF RFC 3629 Section 4 */
+#if (CPU(X86_64) || CPU(X86)) && defined(__SSE2__)
+#include <emmintrin.h>
+#define HAVE_UTF8_SSE2      1
+#endif
 
-static const char *
-fast_validate(const char *str, size_t *nr_chars)
+#if CPU(X86_64) && COMPILER(GCC_COMPATIBLE)
+#include <immintrin.h>
+#define HAVE_UTF8_AVX2      1
+#define AVX2_FUNC           __attribute__((target("avx2,popcnt")))
+#endif
+
+/* a continuation byte (10xxxxxx) is less than -64 when taken as signed */
+#define IS_CONTINUATION(c)  ((int8_t)(c) < -64)
+
+static inline size_t
+lead_seq_len(uint8_t c)
 {
-    size_t n = 0;
-    const char *p;
+    if (c < 0xc0)
+        return 1;
+    if (c < 0xe0)
+        return 2;
+    if (c < 0xf0)
+        return 3;
+    return 4;
+}
 
-    for (p = str; *p; p++) {
-        if (*(uint8_t *)p < 128) {
-            n++;
-        }
-        else {
-            const char *last;
+/*
+ * Moves the end of a validated prefix back to the leading byte of a
+ * character which is not completed in the prefix, if there is one.
+ * Returns the number of characters dropped (0 or 1).
+ */
+static size_t
+drop_partial_char(const char *str, size_t *len)
+{
+    size_t i = *len;
+    size_t j = i;
 
-            last = p;
-            if (*(uint8_t *)p < 0xe0) /* 110xxxxx */
-            {
-                if (UNLIKELY (*(uint8_t *)p < 0xc2))
-                    goto error;
-            }
-            else {
-                if (*(uint8_t *)p < 0xf0) /* 1110xxxx */
-                {
-                    switch (*(uint8_t *)p++ & 0x0f) {
-                    case 0:
-                        VALIDATE_BYTE(0xe0, 0xa0); /* 0xa0 ... 0xbf */
-                        break;
-                    case 0x0d:
-                        VALIDATE_BYTE(0xe0, 0x80); /* 0x80 ... 0x9f */
-                        break;
-                    default:
-                        VALIDATE_BYTE(0xc0, 0x80); /* 10xxxxxx */
-                    }
-                }
-                else if (*(uint8_t *)p < 0xf5) /* 11110xxx excluding out-of-range */
-                {
-                    switch (*(uint8_t *)p++ & 0x07) {
-                    case 0:
-                        VALIDATE_BYTE(0xc0, 0x80); /* 10xxxxxx */
-                        if (UNLIKELY((*(uint8_t *)p & 0x30) == 0))
-                            goto error;
-                        break;
-                    case 4:
-                        VALIDATE_BYTE(0xf0, 0x80); /* 0x80 ... 0x8f */
-                        break;
-                    default:
-                        VALIDATE_BYTE(0xc0, 0x80); /* 10xxxxxx */
-                    }
-                    p++;
-                    VALIDATE_BYTE(0xc0, 0x80); /* 10xxxxxx */
-                }
-                else
-                    goto error;
-            }
+    while (j > 0 && i - j < 3 && IS_CONTINUATION(str[j - 1]))
+        j--;
 
-            p++;
-            VALIDATE_BYTE(0xc0, 0x80); /* 10xxxxxx */
+    if (j > 0 && j + lead_seq_len((uint8_t)str[j - 1]) - 1 > i) {
+        *len = j - 1;
+        return 1;
+    }
 
-            n++;
-            continue;
-error:
-            if (nr_chars)
-                *nr_chars = n;
-            return last;
+    return 0;
+}
+
+#if HAVE(UTF8_AVX2)
+
+/*
+ * The lookup algorithm by John Keiser and Daniel Lemire, see
+ * "Validating UTF-8 In Less Than One Instruction Per Byte".
+ */
+#define TOO_SHORT       (1 << 0)    /* 11______ 0_______, 11______ 11______ */
+#define TOO_LONG        (1 << 1)    /* 0_______ 10______ */
+#define OVERLONG_3      (1 << 2)    /* 11100000 100_____ */
+#define TOO_LARGE       (1 << 3)    /* 11110100 1001____ and more */
+#define SURROGATE       (1 << 4)    /* 11101101 101_____ */
+#define OVERLONG_2      (1 << 5)    /* 1100000_ 10______ */
+#define TOO_LARGE_1000  (1 << 6)    /* 11110101 1000____ and more */
+#define OVERLONG_4      (1 << 6)    /* 11110000 1000____ */
+#define TWO_CONTS       (1 << 7)    /* 10______ 10______ */
+#define CARRY           (TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+#define TABLE_X2(...)   { __VA_ARGS__, __VA_ARGS__ }
+
+/* indexed by the high nibble of the first byte */
+static const uint8_t byte_1_high[32] = TABLE_X2(
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+    TOO_SHORT | OVERLONG_2,
+    TOO_SHORT,
+    TOO_SHORT | OVERLONG_3 | SURROGATE,
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+
+/* indexed by the low nibble of the first byte */
+static const uint8_t byte_1_low[32] = TABLE_X2(
+    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+    CARRY | OVERLONG_2,
+    CARRY,
+    CARRY,
+    CARRY | TOO_LARGE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000);
+
+/* indexed by the high nibble of the second byte */
+static const uint8_t byte_2_high[32] = TABLE_X2(
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE  | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE  | TOO_LARGE,
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);
+
+/* the bytes in the last three positions which start an incomplete char */
+static const uint8_t incomplete_max[32] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xf0 - 1, 0xe0 - 1, 0xc0 - 1,
+};
+
+/* the input shifted right by n bytes, with the tail of prev shifted in */
+#define AVX2_PREV(input, prev, n)                                       \
+    _mm256_alignr_epi8((input),                                         \
+            _mm256_permute2x128_si256((prev), (input), 0x21), 16 - (n))
+
+static inline AVX2_FUNC __m256i
+avx2_check_block(__m256i input, __m256i prev_input)
+{
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    __m256i prev1 = AVX2_PREV(input, prev_input, 1);
+    __m256i prev2 = AVX2_PREV(input, prev_input, 2);
+    __m256i prev3 = AVX2_PREV(input, prev_input, 3);
+
+    __m256i b1h = _mm256_shuffle_epi8(
+            _mm256_loadu_si256((const __m256i *)byte_1_high),
+            _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+    __m256i b1l = _mm256_shuffle_epi8(
+            _mm256_loadu_si256((const __m256i *)byte_1_low),
+            _mm256_and_si256(prev1, nibble));
+    __m256i b2h = _mm256_shuffle_epi8(
+            _mm256_loadu_si256((const __m256i *)byte_2_high),
+            _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+    __m256i special = _mm256_and_si256(_mm256_and_si256(b1h, b1l), b2h);
+
+    /* the bytes which must be the 2nd or 3rd continuation byte */
+    __m256i third = _mm256_subs_epu8(prev2, _mm256_set1_epi8(0xe0 - 0x80));
+    __m256i fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xf0 - 0x80));
+    __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth),
+            _mm256_set1_epi8((char)0x80));
+
+    return _mm256_xor_si256(must23, special);
+}
+
+static AVX2_FUNC size_t
+avx2_validate_prefix(const char *str, size_t len, size_t *nr_chars)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max = _mm256_loadu_si256((const __m256i *)incomplete_max);
+    const __m256i cont = _mm256_set1_epi8(-65);
+    __m256i prev_input = zero;
+    __m256i prev_incomplete = zero;
+    size_t i = 0, n = 0;
+
+    while (i + 32 <= len) {
+        __m256i input = _mm256_loadu_si256((const __m256i *)(str + i));
+        __m256i error;
+
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(input, zero)))
+            break;
+
+        if (_mm256_movemask_epi8(input) == 0)
+            error = prev_incomplete;
+        else
+            error = avx2_check_block(input, prev_input);
+
+        if (!_mm256_testz_si256(error, error))
+            break;
+
+        if (nr_chars) {
+            n += __builtin_popcount((unsigned)_mm256_movemask_epi8(
+                        _mm256_cmpgt_epi8(input, cont)));
         }
+
+        prev_incomplete = _mm256_subs_epu8(input, max);
+        prev_input = input;
+        i += 32;
     }
 
+    n -= drop_partial_char(str, &i);
     if (nr_chars)
         *nr_chars = n;
-    return p;
+    return i;
 }
 
+static AVX2_FUNC size_t
+avx2_count_chars(const char *str, size_t len)
+{
+    const __m256i cont = _mm256_set1_epi8(-65);
+    size_t i = 0, n = 0;
+
+    while (i + 32 <= len) {
+        __m256i input = _mm256_loadu_si256((const __m256i *)(str + i));
+        n += __builtin_popcount((unsigned)_mm256_movemask_epi8(
+                    _mm256_cmpgt_epi8(input, cont)));
+        i += 32;
+    }
+
+    for (; i < len; i++) {
+        if (!IS_CONTINUATION(str[i]))
+            n++;
+    }
+
+    return n;
+}
+
+#undef TOO_SHORT
+#undef TOO_LONG
+#undef OVERLONG_3
+#undef TOO_LARGE
+#undef SURROGATE
+#undef OVERLONG_2
+#undef TOO_LARGE_1000
+#undef OVERLONG_4
+#undef TWO_CONTS
+#undef CARRY
+#undef TABLE_X2
+
+static bool
+has_avx2(void)
+{
+    static int avx2 = -1;
+
+    if (avx2 < 0) {
+        __builtin_cpu_init();
+        avx2 = __builtin_cpu_supports("avx2") &&
+            __builtin_cpu_supports("popcnt");
+    }
+
+    return avx2;
+}
+
+#endif /* HAVE(UTF8_AVX2) */
+
+#if HAVE(UTF8_SSE2)
+
+/* the length of the run of ASCII characters (except for NUL) */
+static size_t
+sse2_ascii_run(const char *str, size_t len)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+
+    while (i + 16 <= len) {
+        __m128i input = _mm_loadu_si128((const __m128i *)(str + i));
+        unsigned mask = _mm_movemask_epi8(input) |
+            _mm_movemask_epi8(_mm_cmpeq_epi8(input, zero));
+        if (mask)
+            return i + __builtin_ctz(mask);
+        i += 16;
+    }
+
+    return i;
+}
+
+static size_t
+sse2_count_chars(const char *str, size_t len)
+{
+    const __m128i cont = _mm_set1_epi8(-65);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0, n = 0;
+
+    while (i + 16 <= len) {
+        /* the per-byte counters overflow after 255 blocks */
+        __m128i acc = zero;
+        size_t end = i + 16 * 255;
+        if (end > len)
+            end = len;
+
+        while (i + 16 <= end) {
+            __m128i input = _mm_loadu_si128((const __m128i *)(str + i));
+            acc = _mm_sub_epi8(acc, _mm_cmpgt_epi8(input, cont));
+            i += 16;
+        }
+
+        acc = _mm_sad_epu8(acc, zero);
+        n += (size_t)_mm_cvtsi128_si32(acc) +
+            (size_t)_mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+    }
+
+    for (; i < len; i++) {
+        if (!IS_CONTINUATION(str[i]))
+            n++;
+    }
+
+    return n;
+}
+
+#endif /* HAVE(UTF8_SSE2) */
+
+/* see IETF RFC 3629 Section 4 */
+
 static const char *
 fast_validate_len(const char *str, ssize_t max_len, size_t *nr_chars)
 {
@@ -128,6 +350,11 @@ fast_validate_len(const char *str, ssize_t max_len, size_t *nr_chars)
     for (p = str; ((p - str) < max_len) && *p; p++) {
         if (*(uint8_t *)p < 128) {
             n++;
+#if HAVE(UTF8_SSE2)
+            size_t run = sse2_ascii_run(p + 1, max_len - (p + 1 - str));
+            n += run;
+            p += run;
+#endif
         }
         else {
             const char *last;
@@ -200,41 +427,76 @@ error:
     return p;
 }
 
-bool pcutils_string_check_utf8_len(const char* str, size_t max_len,
-        size_t *nr_chars, const char **end)
+/*
+ * Returns the length of a valid prefix of the string which ends at
+ * a character boundary and contains no NUL; the rest is left to
+ * fast_validate_len().
+ */
+static size_t
+validate_prefix(const char *str, size_t len, size_t *nr_chars)
 {
-    const char *p;
+#if HAVE(UTF8_AVX2)
+    if (len >= 32 && has_avx2())
+        return avx2_validate_prefix(str, len, nr_chars);
+#else
+    UNUSED_PARAM(str);
+    UNUSED_PARAM(len);
+#endif
 
-    p = fast_validate_len(str, max_len, nr_chars);
+    if (nr_chars)
+        *nr_chars = 0;
+    return 0;
+}
 
-    if (end)
-        *end = p;
+/* counts the bytes which are not continuation bytes */
+static size_t
+count_chars(const char *str, size_t len)
+{
+#if HAVE(UTF8_AVX2)
+    if (len >= 32 && has_avx2())
+        return avx2_count_chars(str, len);
+#endif
 
-    if (p != str + max_len)
-        return false;
-    else
-        return true;
+#if HAVE(UTF8_SSE2)
+    return sse2_count_chars(str, len);
+#else
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (!IS_CONTINUATION(str[i]))
+            n++;
+    }
+    return n;
+#endif
 }
 
-bool pcutils_string_check_utf8(const char *str, ssize_t max_len,
+bool pcutils_string_check_utf8_len(const char* str, size_t max_len,
         size_t *nr_chars, const char **end)
 {
     const char *p;
+    size_t n = 0, prefix;
 
-    if (max_len >= 0)
-        return pcutils_string_check_utf8_len(str, max_len, nr_chars, end);
+    prefix = validate_prefix(str, max_len, nr_chars ? &n : NULL);
+    p = fast_validate_len(str + prefix, max_len - prefix, nr_chars);
 
-    p = fast_validate(str, nr_chars);
+    if (nr_chars)
+        *nr_chars += n;
 
     if (end)
         *end = p;
 
-    if (*p != '\0')
+    if (p != str + max_len)
         return false;
     else
         return true;
 }
 
+bool pcutils_string_check_utf8(const char *str, ssize_t max_len,
+        size_t *nr_chars, const char **end)
+{
+    size_t len = (max_len >= 0) ? (size_t)max_len : strlen(str);
+    return pcutils_string_check_utf8_len(str, len, nr_chars, end);
+}
+
 static const char utf8_skip_data[256] = {
   1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
   1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
@@ -251,34 +513,18 @@ const char * const _pcutils_utf8_skip = utf8_skip_data;
 size_t
 pcutils_string_utf8_chars(const char *p, ssize_t max)
 {
-    size_t nr_chars = 0;
-    const char *start = p;
+    size_t len;
 
     if (p == NULL || max == 0)
         return 0;
 
-    if (max < 0) {
-        while (*p) {
-            p = pcutils_utf8_next_char(p);
-            ++nr_chars;
-        }
-    }
-    else {
-        p = pcutils_utf8_next_char(p);
-
-        while (p - start < max && *p) {
-            ++nr_chars;
-            p = pcutils_utf8_next_char(p);
-        }
-
-        /* only do the last nr_chars increment if we got a complete
-         * char (don't count partial chars)
-         */
-        if (p - start <= max)
-            ++nr_chars;
-    }
+    if (max < 0)
+        len = strlen(p);
+    else
+        len = strnlen(p, max);
 
-    return nr_chars;
+    /* don't count a partial char at the end */
+    return count_chars(p, len) - drop_partial_char(p, &len);
 }
 
 /* copy from MiniGUI */
@@ -98,8 +98,7 @@ purc_variant_t purc_variant_make_exception(purc_atom_t except_atom)
     value->flags = 0;
     value->refc = 1;
     value->atom = except_atom;
-    value->extra_size = pcutils_string_utf8_chars(
-            purc_atom_to_string(except_atom), -1);
+    value->extra_size = PCVARIANT_NR_CHARS_UNKNOWN;
     return value;
 }
 
@@ -205,17 +204,16 @@ purc_variant_make_string_ex(const char* str_utf8, size_t len,
 
     static const size_t sz_bytes = MAX(sizeof(long double), sizeof(void*) * 2);
     purc_variant_t value = NULL;
-    size_t nr_chars;
 
     if (check_encoding) {
-        if (!pcutils_string_check_utf8_len(str_utf8, len, &nr_chars, NULL)) {
+        if (!pcutils_string_check_utf8_len(str_utf8, len, NULL, NULL)) {
             pcinst_set_error(PURC_ERROR_BAD_ENCODING);
             return PURC_VARIANT_INVALID;
         }
     }
     else {
         const char *end;
-        pcutils_string_check_utf8_len(str_utf8, len, &nr_chars, &end);
+        pcutils_string_check_utf8_len(str_utf8, len, NULL, &end);
         len = end - str_utf8;
     }
 
@@ -228,7 +226,7 @@ purc_variant_make_string_ex(const char* str_utf8, size_t len,
     value->type = PURC_VARIANT_TYPE_STRING;
     value->flags = 0;
     value->refc = 1;
-    value->extra_size = nr_chars;
+    value->extra_size = PCVARIANT_NR_CHARS_UNKNOWN;
 
     if (len < sz_bytes) {
         memcpy(value->bytes, str_utf8, len);
@@ -263,18 +261,17 @@ purc_variant_t purc_variant_make_string_reuse_buff(char* str_utf8,
     PCVARIANT_CHECK_FAIL_RET(str_utf8, PURC_VARIANT_INVALID);
 
     purc_variant_t value = NULL;
-    size_t nr_chars;
     size_t len;
     const char *end;
 
     if (check_encoding) {
-        if (!pcutils_string_check_utf8_len(str_utf8, sz_buff, &nr_chars, &end)) {
+        if (!pcutils_string_check_utf8_len(str_utf8, sz_buff, NULL, &end)) {
             pcinst_set_error (PURC_ERROR_BAD_ENCODING);
             return PURC_VARIANT_INVALID;
         }
     }
     else {
-        pcutils_string_check_utf8_len(str_utf8, sz_buff, &nr_chars, &end);
+        pcutils_string_check_utf8_len(str_utf8, sz_buff, NULL, &end);
     }
     len = end - str_utf8;
     str_utf8[len] = '\0'; /* make sure the string is null-terminated */
@@ -295,7 +292,7 @@ purc_variant_t purc_variant_make_string_reuse_buff(char* str_utf8,
     value->type = PURC_VARIANT_TYPE_STRING;
     value->flags = PCVARIANT_FLAG_EXTRA_SIZE;
     value->refc = 1;
-    value->extra_size = nr_chars;
+    value->extra_size = PCVARIANT_NR_CHARS_UNKNOWN;
 
     value->sz_ptr[1] = (uintptr_t)(str_utf8);
     pcvariant_stat_set_extra_size(value, len);
@@ -309,17 +306,19 @@ purc_variant_t purc_variant_make_string_static(const char* str_utf8,
 {
     PCVARIANT_CHECK_FAIL_RET(str_utf8, PURC_VARIANT_INVALID);
 
-    size_t nr_chars;
+    size_t len;
     purc_variant_t value = NULL;
 
     if (check_encoding) {
-        if (!pcutils_string_check_utf8(str_utf8, -1, &nr_chars, NULL)) {
+        const char *end;
+        if (!pcutils_string_check_utf8(str_utf8, -1, NULL, &end)) {
             pcinst_set_error (PURC_ERROR_BAD_ENCODING);
             return PURC_VARIANT_INVALID;
         }
+        len = end - str_utf8;
     }
     else {
-        nr_chars = pcutils_string_utf8_chars(str_utf8, -1);
+        len = strlen(str_utf8);
     }
 
     value = pcvariant_get(PURC_VARIANT_TYPE_STRING);
@@ -332,8 +331,8 @@ purc_variant_t purc_variant_make_string_static(const char* str_utf8,
     value->type = PURC_VARIANT_TYPE_STRING;
     value->flags = PCVARIANT_FLAG_STRING_STATIC;
     value->refc = 1;
-    value->extra_size = nr_chars;
-    value->sz_ptr[0] = (uintptr_t)strlen(str_utf8) + 1;
+    value->extra_size = PCVARIANT_NR_CHARS_UNKNOWN;
+    value->sz_ptr[0] = (uintptr_t)len + 1;
     value->sz_ptr[1] = (uintptr_t)str_utf8;
 
     return value;
@@ -393,7 +392,6 @@ bool purc_variant_string_bytes(purc_variant_t string, size_t *length)
     return false;
 }
 
-// TODO
 bool purc_variant_string_chars(purc_variant_t string, size_t *nr_chars)
 {
     PC_ASSERT(string && nr_chars);
@@ -402,6 +400,13 @@ bool purc_variant_string_chars(purc_variant_t string, size_t *nr_chars)
         IS_TYPE(string, PURC_VARIANT_TYPE_ATOMSTRING) ||
         IS_TYPE(string, PURC_VARIANT_TYPE_EXCEPTION)) {
 
+        // NOTE: the length in characters is calculated on the first call.
+        if (string->extra_size == PCVARIANT_NR_CHARS_UNKNOWN) {
+            size_t len;
+            const char *str = purc_variant_get_string_const_ex(string, &len);
+            string->extra_size = pcutils_string_utf8_chars(str, len);
+        }
+
         *nr_chars = string->extra_size;
         return true;
     }
@@ -431,18 +436,14 @@ purc_variant_make_atom_string (const char* str_utf8, bool check_encoding)
     PCVARIANT_CHECK_FAIL_RET(str_utf8, PURC_VARIANT_INVALID);
 
     purc_variant_t value = NULL;
-    size_t nr_chars;
 
+    // XXX: the string must be enconded in UTF-8 correctly if not checked.
     if (check_encoding) {
-        if (!pcutils_string_check_utf8(str_utf8, -1, &nr_chars, NULL)) {
+        if (!pcutils_string_check_utf8(str_utf8, -1, NULL, NULL)) {
             pcinst_set_error (PURC_ERROR_BAD_ENCODING);
             return PURC_VARIANT_INVALID;
         }
     }
-    else {
-        // XXX: the string must be enconded in UTF-8 correctly.
-        nr_chars = pcutils_string_utf8_chars(str_utf8, -1);
-    }
 
     purc_atom_t atom = purc_atom_from_string(str_utf8);
     if (atom == 0) {
@@ -462,7 +463,7 @@ purc_variant_make_atom_string (const char* str_utf8, bool check_encoding)
     value->flags = 0;
     value->refc = 1;
     value->atom = atom;
-    value->extra_size = nr_chars;
+    value->extra_size = PCVARIANT_NR_CHARS_UNKNOWN;
 
     return value;
 }
@@ -474,18 +475,14 @@ purc_variant_make_atom_string_static(const char* str_utf8,
     PCVARIANT_CHECK_FAIL_RET(str_utf8, PURC_VARIANT_INVALID);
 
     purc_variant_t value = NULL;
-    size_t nr_chars;
 
+    // XXX: the string must be enconded in UTF-8 correctly if not checked.
     if (check_encoding) {
-        if (!pcutils_string_check_utf8(str_utf8, -1, &nr_chars, NULL)) {
+        if (!pcutils_string_check_utf8(str_utf8, -1, NULL, NULL)) {
             pcinst_set_error (PURC_ERROR_BAD_ENCODING);
             return PURC_VARIANT_INVALID;
         }
     }
-    else {
-        // XXX: the string must be enconded in UTF-8 correctly.
-        nr_chars = pcutils_string_utf8_chars(str_utf8, -1);
-    }
 
     purc_atom_t atom = purc_atom_from_static_string(str_utf8);
     if (atom == 0) {
@@ -506,7 +503,7 @@ purc_variant_make_atom_string_static(const char* str_utf8,
     value->flags = PCVARIANT_FLAG_STRING_STATIC;
     value->refc = 1;
     value->atom = atom;
-    value->extra_size = nr_chars;
+    value->extra_size = PCVARIANT_NR_CHARS_UNKNOWN;
 
     return value;
 }
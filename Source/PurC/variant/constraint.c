@@ -28,6 +28,7 @@
 #include "variant-internals.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 static int
 key_comp(const void *key1, const void *key2)
@@ -225,8 +226,18 @@ rebuild_ex(purc_variant_t val, pcutils_map *cache)
     }
 }
 
+static bool
+is_top_set(purc_variant_t set)
+{
+    variant_set_t data = pcvar_set_get_data(set);
+    pcutils_map *chain = data->rev_update_chain;
+
+    return chain == NULL || pcutils_map_get_size(chain) == 0;
+}
+
 static int
-reverse_check_chain(pcutils_map *chain, struct reverse_checker *checker)
+reverse_check_chain(pcutils_map *chain, purc_variant_t _new,
+        struct reverse_checker *checker)
 {
     int r = 0;
     do {
@@ -244,6 +255,18 @@ reverse_check_chain(pcutils_map *chain, struct reverse_checker *checker)
             purc_variant_t parent;
             parent = (purc_variant_t)entry->val;
 
+            if (purc_variant_is_set(parent) && is_top_set(parent)) {
+                // check the changed member against the set in place,
+                // instead of rebuilding the whole set
+                struct set_node *node = (struct set_node*)entry->key;
+                r = pcvar_set_check_member(parent, node, _new);
+                if (r)
+                    break;
+
+                pcutils_map_it_next(&it);
+                continue;
+            }
+
             // rebuild _new value for edge parent
             purc_variant_t _new = rebuild_ex(parent, checker->cache);
             if (_new == PURC_VARIANT_INVALID) {
@@ -310,15 +333,18 @@ again:
         switch (_old->type) {
             case PURC_VARIANT_TYPE_ARRAY:
                 arr_data = pcvar_arr_get_data(_old);
-                r = reverse_check_chain(arr_data->rev_update_chain, checker);
+                r = reverse_check_chain(arr_data->rev_update_chain, _new,
+                        checker);
                 break;
             case PURC_VARIANT_TYPE_OBJECT:
                 obj_data = pcvar_obj_get_data(_old);
-                r = reverse_check_chain(obj_data->rev_update_chain, checker);
+                r = reverse_check_chain(obj_data->rev_update_chain, _new,
+                        checker);
                 break;
             case PURC_VARIANT_TYPE_SET:
                 set_data = pcvar_set_get_data(_old);
-                r = reverse_check_chain(set_data->rev_update_chain, checker);
+                r = reverse_check_chain(set_data->rev_update_chain, _new,
+                        checker);
                 break;
             default:
                 PC_ASSERT(0);
@@ -435,8 +461,54 @@ get_chain(purc_variant_t val)
     return NULL;
 }
 
+// `via` is the key of `member` through which the change came in,
+// or `member` itself if it is unknown
+static bool
+touches_unique_keys(purc_variant_t set, purc_variant_t member,
+        purc_variant_t via)
+{
+    variant_set_t data = pcvar_set_get_data(set);
+
+    // generic set: the whole member is the unique key
+    if (data->unique_key == NULL)
+        return true;
+
+    // members other than objects are always indexed as `undefined`
+    if (!purc_variant_is_object(member))
+        return false;
+
+    if (via == member)
+        return true;
+
+    const char *name = purc_variant_get_string_const(via);
+    if (!name)
+        return true;
+
+    for (size_t i = 0; i < data->nr_keynames; ++i) {
+        if (strcmp(name, data->keynames[i]) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+static int
+merge_into_output(pcutils_map *output, purc_variant_t parent,
+        purc_variant_t via)
+{
+    struct pcutils_map_entry *entry;
+    entry = pcutils_map_find(output, parent);
+    if (entry && (purc_variant_t)entry->val != via) {
+        // changed through more than one key
+        via = parent;
+    }
+
+    return pcutils_map_find_replace_or_insert(output, parent, via, NULL);
+}
+
 static int
-wind_up_val(purc_variant_t val, struct reverse_checker *checker)
+wind_up_val(purc_variant_t val, purc_variant_t via,
+        struct reverse_checker *checker)
 {
     int r = 0;
 
@@ -459,11 +531,16 @@ wind_up_val(purc_variant_t val, struct reverse_checker *checker)
         if (purc_variant_is_set(parent)) {
             struct set_node *node;
             node = (struct set_node*)entry->key;
-            r = pcvar_readjust_set(parent, node);
+            if (touches_unique_keys(parent, val, via))
+                r = pcvar_readjust_set(parent, node);
+        }
+        else if (purc_variant_is_object(parent)) {
+            struct obj_node *node;
+            node = (struct obj_node*)entry->key;
+            r = merge_into_output(checker->output, parent, node->key);
         }
         else {
-            r = pcutils_map_find_replace_or_insert(checker->output,
-                    parent, parent, NULL);
+            r = merge_into_output(checker->output, parent, parent);
         }
         if (r)
             break;
@@ -491,7 +568,8 @@ wind_up(struct reverse_checker *checker)
     it = pcutils_map_it_begin_first(checker->input);
     while ((entry = pcutils_map_it_value(&it))) {
         purc_variant_t val = (purc_variant_t)entry->key;
-        r = wind_up_val(val, checker);
+        purc_variant_t via = (purc_variant_t)entry->val;
+        r = wind_up_val(val, via, checker);
         if (r)
             break;
         r = pcutils_map_erase(checker->input, val);
@@ -504,7 +582,7 @@ wind_up(struct reverse_checker *checker)
 }
 
 void
-pcvar_adjust_set_by_descendant(purc_variant_t val)
+pcvar_adjust_set_by_descendant(purc_variant_t val, purc_variant_t key)
 {
     copy_key_fn copy_key = ref;
     free_key_fn free_key = unref;
@@ -527,7 +605,8 @@ pcvar_adjust_set_by_descendant(purc_variant_t val)
         if (checker.output == NULL)
             break;
 
-        r = pcutils_map_insert(checker.input, val, val);
+        // only changes touching the unique keys re-index the set members
+        r = pcutils_map_insert(checker.input, val, key ? key : val);
         if (r)
             break;
 
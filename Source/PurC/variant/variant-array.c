@@ -157,7 +157,8 @@ arr_node_release(purc_variant_t arr, struct arr_node *node)
         PC_ASSERT(al);
 
         struct pcutils_array_list_node *p;
-        int r = pcutils_array_list_remove(al, node->node.idx, &p);
+        size_t idx = pcutils_array_list_node_idx(al, &node->node);
+        int r = pcutils_array_list_remove(al, idx, &p);
         PC_ASSERT(r == 0);
         PC_ASSERT(&node->node == p);
         PC_ASSERT(node->node.idx == (size_t)-1);
@@ -318,7 +319,7 @@ variant_arr_insert_before(purc_variant_t arr, size_t idx, purc_variant_t val,
             if (build_rev_update_chain(arr, node))
                 break;
 
-            pcvar_adjust_set_by_descendant(arr);
+            pcvar_adjust_set_by_descendant(arr, PURC_VARIANT_INVALID);
             grown(arr, pos, val, check);
         }
 
@@ -390,16 +391,19 @@ check_change(purc_variant_t arr, struct arr_node *node, purc_variant_t val)
     if (_new == PURC_VARIANT_INVALID)
         return -1;
 
+    variant_arr_t data = pcvar_arr_get_data(arr);
+    size_t idx = pcutils_array_list_node_idx(&data->al, &node->node);
+
     int r = 0;
     do {
         bool found = false;
         size_t i;
         purc_variant_t v;
         foreach_value_in_variant_array(arr, v, i) {
-            if (i == node->node.idx) {
+            if (i == idx) {
                 found = true;
             }
-            r = pcvar_arr_append(_new, i == node->node.idx ? val : v);
+            r = pcvar_arr_append(_new, i == idx ? val : v);
             if (r)
                 break;
         } end_foreach;
@@ -479,7 +483,7 @@ variant_arr_set(purc_variant_t arr, size_t idx, purc_variant_t val,
         old_node->val = purc_variant_ref(val);
 
         if (check) {
-            pcvar_adjust_set_by_descendant(arr);
+            pcvar_adjust_set_by_descendant(arr, PURC_VARIANT_INVALID);
 
             changed(arr, pos, old, val, check);
         }
@@ -505,13 +509,16 @@ check_shrink(purc_variant_t arr, struct arr_node *node)
     if (_new == PURC_VARIANT_INVALID)
         return -1;
 
+    variant_arr_t data = pcvar_arr_get_data(arr);
+    size_t idx = pcutils_array_list_node_idx(&data->al, &node->node);
+
     int r = 0;
     do {
         bool found = false;
         size_t i;
         purc_variant_t v;
         foreach_value_in_variant_array(arr, v, i) {
-            if (i == node->node.idx) {
+            if (i == idx) {
                 PC_ASSERT(!found);
                 found = true;
                 continue;
@@ -585,7 +592,7 @@ variant_arr_remove(purc_variant_t arr, size_t idx,
         PC_ASSERT(node->node.idx == (size_t)-1);
 
         if (check) {
-            pcvar_adjust_set_by_descendant(arr);
+            pcvar_adjust_set_by_descendant(arr, PURC_VARIANT_INVALID);
 
             shrunk(arr, pos, node->val, check);
         }
@@ -1045,12 +1052,8 @@ next_node(struct pcutils_array_list *al, struct pcutils_array_list_node *node)
 {
     if (!node)
         return NULL;
-    size_t count = pcutils_array_list_length(al);
-    size_t idx = node->idx + 1;
-    if (idx >= count)
-        return NULL;
 
-    return pcutils_array_list_get(al, idx);
+    return pcutils_array_list_next(al, node);
 }
 
 static struct pcutils_array_list_node*
@@ -1058,15 +1061,8 @@ prev_node(struct pcutils_array_list *al, struct pcutils_array_list_node *node)
 {
     if (!node)
         return NULL;
-    if (node->idx == 0)
-        return NULL;
-
-    size_t count = pcutils_array_list_length(al);
-    size_t idx = node->idx - 1;
-    if (idx >= count)
-        return NULL;
 
-    return pcutils_array_list_get(al, idx);
+    return pcutils_array_list_prev(al, node);
 }
 
 static void
@@ -78,8 +78,11 @@ variant_obj_t
 pcvar_obj_get_data(purc_variant_t obj) WTF_INTERNAL;
 variant_set_t
 pcvar_set_get_data(purc_variant_t set) WTF_INTERNAL;
+// `key` is the key of the object `val` which was changed,
+// or PURC_VARIANT_INVALID if unknown
 void
-pcvar_adjust_set_by_descendant(purc_variant_t val) WTF_INTERNAL;
+pcvar_adjust_set_by_descendant(purc_variant_t val,
+        purc_variant_t key) WTF_INTERNAL;
 
 pcutils_map*
 pcvar_create_rev_update_chain(void) WTF_INTERNAL;
@@ -270,6 +273,12 @@ pcvar_set_add(purc_variant_t set, purc_variant_t val);
 int
 pcvar_readjust_set(purc_variant_t set, struct set_node *node);
 
+// check if `node` of `set` can be replaced by `_new` without breaking
+// the uniqueness of the set
+int
+pcvar_set_check_member(purc_variant_t set, struct set_node *node,
+        purc_variant_t _new);
+
 // compare both variant-type and variant-value
 // recursive-implementation, thus caller's responsible for enough stack space
 // except stack space, no extra memory is required
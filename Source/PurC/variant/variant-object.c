@@ -27,6 +27,7 @@
 #include "private/variant.h"
 #include "private/errors.h"
 #include "purc-errors.h"
+#include "private/hashtable.h"
 #include "variant-internals.h"
 
 
@@ -36,7 +37,23 @@
 #include <string.h>
 
 #define OBJ_EXTRA_SIZE(data) (sizeof(*data) + \
-        (data->size) * sizeof(struct obj_node))
+        obj_size(data) * sizeof(struct obj_node) + \
+        (pcutils_array_list_capacity(&data->kvs) + data->index_sz) * \
+        sizeof(struct obj_node*))
+
+static inline size_t
+obj_size(variant_obj_t data)
+{
+    return pcutils_array_list_length(&data->kvs);
+}
+
+static inline struct obj_node*
+obj_node_at(variant_obj_t data, size_t idx)
+{
+    struct pcutils_array_list_node *p;
+    p = pcutils_array_list_get(&data->kvs, idx);
+    return p ? container_of(p, struct obj_node, alnode) : NULL;
+}
 
 static inline bool
 grow(purc_variant_t obj, purc_variant_t key, purc_variant_t val,
@@ -127,6 +144,202 @@ pcvar_obj_get_data(purc_variant_t obj)
     return data;
 }
 
+static inline uint32_t
+key_hash(const char *key)
+{
+    return (uint32_t)pchash_perllike_str_hash(key);
+}
+
+static inline bool
+key_equal(struct obj_node *node, const char *key, uint32_t hash,
+        purc_atom_t atom)
+{
+    if (node->hash != hash)
+        return false;
+
+    // NOTE: the same atom means the same string
+    if (atom && node->atom == atom)
+        return true;
+
+    return strcmp(key, purc_variant_get_string_const(node->key)) == 0;
+}
+
+static struct obj_node*
+find_node_ex(variant_obj_t data, const char *key, uint32_t hash,
+        purc_atom_t atom)
+{
+    if (data->index) {
+        size_t mask = data->index_sz - 1;
+        for (size_t i = hash & mask; data->index[i]; i = (i + 1) & mask) {
+            if (key_equal(data->index[i], key, hash, atom))
+                return data->index[i];
+        }
+
+        return NULL;
+    }
+
+    struct pcutils_array_list_node *p;
+    array_list_for_each(&data->kvs, p) {
+        struct obj_node *node = container_of(p, struct obj_node, alnode);
+        if (key_equal(node, key, hash, atom))
+            return node;
+    }
+
+    return NULL;
+}
+
+static inline struct obj_node*
+find_node(variant_obj_t data, const char *key, uint32_t hash)
+{
+    return find_node_ex(data, key, hash, 0);
+}
+
+// the position where the node of `key` shall be inserted before
+static size_t
+sorted_position(variant_obj_t data, const char *key)
+{
+    size_t lo = 0;
+    size_t hi = obj_size(data);
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        // NOTE: do not renumber the cached indices on every probe
+        struct pcutils_array_list_node *p;
+        p = pcutils_array_list_peek(&data->kvs, mid);
+        struct obj_node *node = container_of(p, struct obj_node, alnode);
+        if (strcmp(key, purc_variant_get_string_const(node->key)) > 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+static void
+index_put(struct obj_node **index, size_t index_sz, struct obj_node *node)
+{
+    size_t mask = index_sz - 1;
+    size_t i = node->hash & mask;
+    while (index[i])
+        i = (i + 1) & mask;
+
+    index[i] = node;
+}
+
+static int
+index_rebuild(variant_obj_t data, size_t index_sz)
+{
+    struct obj_node **index = NULL;
+    if (index_sz) {
+        index = (struct obj_node**)calloc(index_sz, sizeof(*index));
+        if (!index) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return -1;
+        }
+
+        struct pcutils_array_list_node *p;
+        array_list_for_each(&data->kvs, p) {
+            index_put(index, index_sz,
+                    container_of(p, struct obj_node, alnode));
+        }
+    }
+
+    free(data->index);
+    data->index = index;
+    data->index_sz = index_sz;
+
+    return 0;
+}
+
+// make room in the index for `nr` properties
+static int
+index_reserve(variant_obj_t data, size_t nr)
+{
+    if (nr <= PCVAR_OBJ_LINEAR_MAX)
+        return 0;
+
+    // NOTE: keep the load factor no more than 1/2
+    if (data->index && nr * 2 <= data->index_sz)
+        return 0;
+
+    size_t index_sz = 32;
+    while (index_sz < nr * 2)
+        index_sz *= 2;
+
+    return index_rebuild(data, index_sz);
+}
+
+static void
+index_erase(variant_obj_t data, struct obj_node *node)
+{
+    if (!data->index)
+        return;
+
+    struct obj_node **index = data->index;
+    size_t mask = data->index_sz - 1;
+    size_t i = node->hash & mask;
+    while (index[i] != node) {
+        PC_ASSERT(index[i]);
+        i = (i + 1) & mask;
+    }
+    index[i] = NULL;
+
+    // shift back the following entries of the cluster, no tombstone needed
+    for (size_t j = (i + 1) & mask; index[j]; j = (j + 1) & mask) {
+        size_t home = index[j]->hash & mask;
+        bool movable = (i <= j) ? (home <= i || home > j)
+                                : (home <= i && home > j);
+        if (movable) {
+            index[i] = index[j];
+            index[j] = NULL;
+            i = j;
+        }
+    }
+}
+
+static int
+obj_node_link(variant_obj_t data, struct obj_node *node)
+{
+    if (index_reserve(data, obj_size(data) + 1))
+        return -1;
+
+    const char *sk = purc_variant_get_string_const(node->key);
+    size_t idx = sorted_position(data, sk);
+    if (pcutils_array_list_insert_before(&data->kvs, idx, &node->alnode)) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+
+    if (data->index)
+        index_put(data->index, data->index_sz, node);
+
+    return 0;
+}
+
+static void
+obj_node_unlink(variant_obj_t data, struct obj_node *node)
+{
+    if (node->alnode.idx == (size_t)-1)
+        return;
+
+    // the keys are unique and sorted, so locate the node by its key
+    // instead of the cached index which might need renumbering
+    const char *sk = purc_variant_get_string_const(node->key);
+    size_t idx = sorted_position(data, sk);
+    PC_ASSERT(pcutils_array_list_peek(&data->kvs, idx) == &node->alnode);
+
+    index_erase(data, node);
+
+    struct pcutils_array_list_node *old;
+    int r = pcutils_array_list_remove(&data->kvs, idx, &old);
+    PC_ASSERT(r == 0 && old == &node->alnode);
+    UNUSED_PARAM(r);
+
+    // NOTE: fall back to the linear lookup for small objects
+    if (data->index && obj_size(data) <= PCVAR_OBJ_LINEAR_MAX / 2)
+        index_rebuild(data, 0);
+}
+
 static purc_variant_t v_object_new_with_capacity(void)
 {
     purc_variant_t var = pcvariant_get(PVT(_OBJECT));
@@ -147,7 +360,7 @@ static purc_variant_t v_object_new_with_capacity(void)
         return PURC_VARIANT_INVALID;
     }
 
-    data->kvs = RB_ROOT;
+    pcutils_array_list_init(&data->kvs);
 
     var->sz_ptr[1]     = (uintptr_t)data;
     var->refc          = 1;
@@ -181,12 +394,7 @@ obj_node_release(purc_variant_t obj, struct obj_node *node)
     variant_obj_t data = pcvar_obj_get_data(obj);
     PC_ASSERT(data);
 
-    struct rb_root *root = &data->kvs;
-    if (&node->node == root->rb_node || node->node.rb_parent) {
-        --data->size;
-        pcutils_rbtree_erase(&node->node, root);
-        node->node.rb_parent = NULL;
-    }
+    obj_node_unlink(data, node);
 
     PURC_VARIANT_SAFE_CLEAR(node->key);
     PURC_VARIANT_SAFE_CLEAR(node->val);
@@ -218,6 +426,8 @@ obj_node_create(purc_variant_t k, purc_variant_t v)
         return NULL;
     }
 
+    node->alnode.idx = (size_t)-1;
+    node->hash = key_hash(purc_variant_get_string_const(k));
     node->key = purc_variant_ref(k);
     node->val = purc_variant_ref(v);
 
@@ -295,29 +505,8 @@ v_object_remove(purc_variant_t obj, const char *key, bool silently,
         bool check)
 {
     variant_obj_t data = pcvar_obj_get_data(obj);
-    struct rb_root *root = &data->kvs;
-    struct rb_node **pnode = &root->rb_node;
-    struct rb_node *parent = NULL;
-    struct rb_node *entry = NULL;
-    while (*pnode) {
-        struct obj_node *node;
-        node = container_of(*pnode, struct obj_node, node);
-        const char *sk = purc_variant_get_string_const(node->key);
-        int ret = strcmp(key, sk);
-
-        parent = *pnode;
-
-        if (ret < 0)
-            pnode = &parent->rb_left;
-        else if (ret > 0)
-            pnode = &parent->rb_right;
-        else{
-            entry = *pnode;
-            break;
-        }
-    }
-
-    if (!entry) {
+    struct obj_node *node = find_node(data, key, key_hash(key));
+    if (!node) {
         if (silently)
             return 0;
 
@@ -325,8 +514,6 @@ v_object_remove(purc_variant_t obj, const char *key, bool silently,
         return -1;
     }
 
-    struct obj_node *node;
-    node = container_of(entry, struct obj_node, node);
     purc_variant_t k = node->key;
     purc_variant_t v = node->val;
 
@@ -341,13 +528,10 @@ v_object_remove(purc_variant_t obj, const char *key, bool silently,
             break_rev_update_chain(obj, node);
         }
 
-        --data->size;
-        PC_ASSERT(entry == root->rb_node || entry->rb_parent);
-        pcutils_rbtree_erase(entry, root);
-        entry->rb_parent = NULL;
+        obj_node_unlink(data, node);
 
         if (check) {
-            pcvar_adjust_set_by_descendant(obj);
+            pcvar_adjust_set_by_descendant(obj, k);
 
             shrunk(obj, k, v, check);
         }
@@ -449,8 +633,8 @@ check_change(purc_variant_t obj, struct obj_node *node,
 }
 
 static int
-v_object_set(purc_variant_t obj, purc_variant_t key, purc_variant_t val,
-        bool check)
+v_object_set_ex(purc_variant_t obj, purc_variant_t key, purc_atom_t atom,
+        purc_variant_t val, bool check)
 {
     if (!key || !val) {
         pcinst_set_error(PURC_ERROR_INVALID_VALUE);
@@ -473,33 +657,15 @@ v_object_set(purc_variant_t obj, purc_variant_t key, purc_variant_t val,
     variant_obj_t data = pcvar_obj_get_data(obj);
     PC_ASSERT(data);
 
-    struct rb_root *root = &data->kvs;
-    struct rb_node **pnode = &root->rb_node;
-    struct rb_node *parent = NULL;
-    struct rb_node *entry = NULL;
-    while (*pnode) {
-        struct obj_node *node;
-        node = container_of(*pnode, struct obj_node, node);
-        const char *sko = purc_variant_get_string_const(node->key);
-        int ret = strcmp(sk, sko);
-
-        parent = *pnode;
-
-        if (ret < 0)
-            pnode = &parent->rb_left;
-        else if (ret > 0)
-            pnode = &parent->rb_right;
-        else{
-            entry = *pnode;
-            break;
-        }
-    }
+    struct obj_node *node = find_node(data, sk, key_hash(sk));
 
-    if (!entry) { //new the entry
-        struct obj_node *node = obj_node_create(key, val);
+    if (!node) { //new the entry
+        node = obj_node_create(key, val);
         if (!node)
             return -1;
 
+        node->atom = atom;
+
         do {
             if (check) {
                 if (!grow(obj, key, val, check))
@@ -509,18 +675,14 @@ v_object_set(purc_variant_t obj, purc_variant_t key, purc_variant_t val,
                     break;
             }
 
-            entry = &node->node;
-
-            pcutils_rbtree_link_node(entry, parent, pnode);
-            pcutils_rbtree_insert_color(entry, root);
-
-            ++data->size;
+            if (obj_node_link(data, node))
+                break;
 
             if (check) {
                 if (build_rev_update_chain(obj, node))
                     break;
 
-                pcvar_adjust_set_by_descendant(obj);
+                pcvar_adjust_set_by_descendant(obj, key);
 
                 grown(obj, key, val, check);
             }
@@ -536,8 +698,9 @@ v_object_set(purc_variant_t obj, purc_variant_t key, purc_variant_t val,
         return -1;
     }
 
-    struct obj_node *node;
-    node = container_of(entry, struct obj_node, node);
+    if (atom)
+        node->atom = atom;
+
     if (node->val == val) {
         // NOTE: keep refc intact
         return 0;
@@ -572,7 +735,7 @@ v_object_set(purc_variant_t obj, purc_variant_t key, purc_variant_t val,
         node->val = purc_variant_ref(val);
 
         if (check) {
-            pcvar_adjust_set_by_descendant(obj);
+            pcvar_adjust_set_by_descendant(obj, key);
 
             changed(obj, ko, vo, key, val, check);
         }
@@ -589,6 +752,13 @@ v_object_set(purc_variant_t obj, purc_variant_t key, purc_variant_t val,
     return -1;
 }
 
+static inline int
+v_object_set(purc_variant_t obj, purc_variant_t key, purc_variant_t val,
+        bool check)
+{
+    return v_object_set_ex(obj, key, 0, val, check);
+}
+
 purc_variant_t
 pcvar_make_obj(void)
 {
@@ -752,16 +922,19 @@ void pcvariant_object_release (purc_variant_t value)
 {
     variant_obj_t data = pcvar_obj_get_data(value);
 
-    struct rb_root *root = &data->kvs;
+    // NOTE: no need to maintain the index while destroying all nodes
+    index_rebuild(data, 0);
 
-    struct rb_node *p, *n;
-    pcutils_rbtree_for_each_safe(pcutils_rbtree_first(root), p, n) {
+    struct pcutils_array_list_node *p, *n;
+    array_list_for_each_reverse_safe(&data->kvs, p, n) {
         struct obj_node *node;
-        node = container_of(p, struct obj_node, node);
+        node = container_of(p, struct obj_node, alnode);
 
         obj_node_destroy(value, node);
     }
 
+    pcutils_array_list_reset(&data->kvs);
+
     if (data->rev_update_chain) {
         pcvar_destroy_rev_update_chain(data->rev_update_chain);
         data->rev_update_chain = NULL;
@@ -804,41 +977,67 @@ purc_variant_object_get_by_ckey(purc_variant_t obj, const char* key)
         PURC_VARIANT_INVALID);
 
     variant_obj_t data = pcvar_obj_get_data(obj);
-    struct rb_root *root = &data->kvs;
+    struct obj_node *node = find_node(data, key, key_hash(key));
+    if (!node) {
+        pcinst_set_error(PCVARIANT_ERROR_NOT_FOUND);
 
-    struct rb_node **pnode = &root->rb_node;
-    struct rb_node *parent = NULL;
-    struct rb_node *entry = NULL;
-    while (*pnode) {
-        struct obj_node *node;
-        node = container_of(*pnode, struct obj_node, node);
-        const char *sk = purc_variant_get_string_const(node->key);
+        return PURC_VARIANT_INVALID;
+    }
 
-        int ret = strcmp(key, sk);
+    return node->val;
+}
 
-        parent = *pnode;
+uint32_t
+pcvariant_object_key_hash(const char *key)
+{
+    return key_hash(key);
+}
 
-        if (ret < 0)
-            pnode = &parent->rb_left;
-        else if (ret > 0)
-            pnode = &parent->rb_right;
-        else{
-            entry = *pnode;
-            break;
-        }
-    }
+purc_variant_t
+pcvariant_object_get_by_atom(purc_variant_t obj, purc_atom_t atom,
+        const char *key, uint32_t hash)
+{
+    PCVARIANT_CHECK_FAIL_RET((obj && obj->type==PVT(_OBJECT) &&
+        obj->sz_ptr[1] && atom && key),
+        PURC_VARIANT_INVALID);
 
-    if (!entry) {
+    variant_obj_t data = pcvar_obj_get_data(obj);
+    struct obj_node *node = find_node_ex(data, key, hash, atom);
+    if (!node) {
         pcinst_set_error(PCVARIANT_ERROR_NOT_FOUND);
 
         return PURC_VARIANT_INVALID;
     }
 
-    struct obj_node *node;
-    node = container_of(entry, struct obj_node, node);
     return node->val;
 }
 
+bool
+pcvariant_object_set_by_atom(purc_variant_t obj, purc_atom_t atom,
+        purc_variant_t value)
+{
+    PCVARIANT_CHECK_FAIL_RET(obj && obj->type==PVT(_OBJECT) &&
+        obj->sz_ptr[1] && atom && value,
+        false);
+
+    const char *sk = purc_atom_to_string(atom);
+    if (!sk) {
+        pcinst_set_error(PURC_ERROR_INVALID_VALUE);
+        return false;
+    }
+
+    // NOTE: the string of an atom lives as long as the atom
+    purc_variant_t key = purc_variant_make_string_static(sk, false);
+    if (key == PURC_VARIANT_INVALID)
+        return false;
+
+    bool check = true;
+    int r = v_object_set_ex(obj, key, atom, value, check);
+    purc_variant_unref(key);
+
+    return r ? false : true;
+}
+
 bool purc_variant_object_set (purc_variant_t obj,
     purc_variant_t key, purc_variant_t value)
 {
@@ -875,7 +1074,7 @@ bool purc_variant_object_size (purc_variant_t obj, size_t *sz)
         false);
 
     variant_obj_t data = pcvar_obj_get_data(obj);
-    *sz = (size_t)data->size;
+    *sz = obj_size(data);
 
     return true;
 }
@@ -892,7 +1091,7 @@ purc_variant_object_make_iterator_begin (purc_variant_t object)
         NULL);
 
     variant_obj_t data = pcvar_obj_get_data(object);
-    if (data->size==0) {
+    if (obj_size(data) == 0) {
         pcinst_set_error(PCVARIANT_ERROR_NOT_FOUND);
         return NULL;
     }
@@ -916,7 +1115,7 @@ purc_variant_object_make_iterator_end (purc_variant_t object) {
         NULL);
 
     variant_obj_t data = pcvar_obj_get_data(object);
-    if (data->size==0) {
+    if (obj_size(data) == 0) {
         pcinst_set_error(PCVARIANT_ERROR_NOT_FOUND);
         return NULL;
     }
@@ -1039,11 +1238,10 @@ pcvar_object_break_rue_downward(purc_variant_t obj)
     if (!data)
         return;
 
-    struct rb_root *root = &data->kvs;
-    struct rb_node *p = pcutils_rbtree_first(root);
-    for (; p; p = pcutils_rbtree_next(p)) {
+    struct pcutils_array_list_node *p;
+    array_list_for_each(&data->kvs, p) {
         struct obj_node *node;
-        node = container_of(p, struct obj_node, node);
+        node = container_of(p, struct obj_node, alnode);
         struct pcvar_rev_update_edge edge = {
             .parent         = obj,
             .obj_me         = node,
@@ -1076,11 +1274,10 @@ pcvar_object_build_rue_downward(purc_variant_t obj)
     if (!data)
         return 0;
 
-    struct rb_root *root = &data->kvs;
-    struct rb_node *p = pcutils_rbtree_first(root);
-    for (; p; p = pcutils_rbtree_next(p)) {
+    struct pcutils_array_list_node *p;
+    array_list_for_each(&data->kvs, p) {
         struct obj_node *node;
-        node = container_of(p, struct obj_node, node);
+        node = container_of(p, struct obj_node, alnode);
         struct pcvar_rev_update_edge edge = {
             .parent         = obj,
             .obj_me         = node,
@@ -1124,34 +1321,24 @@ pcvar_object_build_edge_to_parent(purc_variant_t obj,
 }
 
 static void
-it_refresh(struct obj_iterator *it, struct rb_node *curr)
+it_refresh(struct obj_iterator *it, struct obj_node *curr)
 {
-    struct rb_node *next  = NULL;
-    struct rb_node *prev  = NULL;
-    if (curr) {
-        next  = pcutils_rbtree_next(curr);
-        prev  = pcutils_rbtree_prev(curr);
-    }
+    it->curr = curr;
+    it->next = NULL;
+    it->prev = NULL;
 
     if (curr) {
-        it->curr = container_of(curr, struct obj_node, node);
-    }
-    else {
-        it->curr = NULL;
-    }
+        variant_obj_t data = pcvar_obj_get_data(it->obj);
+        struct pcutils_array_list *al = &data->kvs;
+        struct pcutils_array_list_node *p;
 
-    if (next) {
-        it->next = container_of(next, struct obj_node, node);
-    }
-    else {
-        it->next = NULL;
-    }
+        p = pcutils_array_list_next(al, &curr->alnode);
+        if (p)
+            it->next = container_of(p, struct obj_node, alnode);
 
-    if (prev) {
-        it->prev = container_of(prev, struct obj_node, node);
-    }
-    else {
-        it->prev = NULL;
+        p = pcutils_array_list_prev(al, &curr->alnode);
+        if (p)
+            it->prev = container_of(p, struct obj_node, alnode);
     }
 }
 
@@ -1165,13 +1352,10 @@ pcvar_obj_it_first(purc_variant_t obj)
         return it;
 
     variant_obj_t data = pcvar_obj_get_data(obj);
-    if (data->size==0)
+    if (obj_size(data) == 0)
         return it;
 
-    struct rb_root *root = &data->kvs;
-
-    struct rb_node *first = pcutils_rbtree_first(root);
-    it_refresh(&it, first);
+    it_refresh(&it, obj_node_at(data, 0));
 
     return it;
 }
@@ -1186,13 +1370,10 @@ pcvar_obj_it_last(purc_variant_t obj)
         return it;
 
     variant_obj_t data = pcvar_obj_get_data(obj);
-    if (data->size==0)
+    if (obj_size(data) == 0)
         return it;
 
-    struct rb_root *root = &data->kvs;
-
-    struct rb_node *last = pcutils_rbtree_last(root);
-    it_refresh(&it, last);
+    it_refresh(&it, obj_node_at(data, obj_size(data) - 1));
 
     return it;
 }
@@ -1204,8 +1385,7 @@ pcvar_obj_it_next(struct obj_iterator *it)
         return;
 
     if (it->next) {
-        struct rb_node *next = &it->next->node;
-        it_refresh(it, next);
+        it_refresh(it, it->next);
     }
     else {
         it->curr = NULL;
@@ -1221,8 +1401,7 @@ pcvar_obj_it_prev(struct obj_iterator *it)
         return;
 
     if (it->prev) {
-        struct rb_node *prev = &it->prev->node;
-        it_refresh(it, prev);
+        it_refresh(it, it->prev);
     }
     else {
         it->curr = NULL;
@@ -1230,4 +1409,3 @@ pcvar_obj_it_prev(struct obj_iterator *it)
         it->prev = NULL;
     }
 }
-
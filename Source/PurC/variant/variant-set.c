@@ -444,8 +444,6 @@ find_element_rb_node(struct element_rb_node *node,
     struct rb_node **pnode = &root->rb_node;
     struct rb_node *parent = NULL;
     struct rb_node *entry = NULL;
-    char md5[33];
-    pcvariant_md5_by_set(md5, kvs, set);
 
     while (*pnode) {
         struct set_node *on;
@@ -454,9 +452,6 @@ find_element_rb_node(struct element_rb_node *node,
         if (0) {
             diff = variant_set_compare_by_set_keys(set, kvs, on->val);
         }
-        else if (0) {
-            diff = pcvariant_diff_by_set(md5, kvs, on->md5, on->val, set);
-        }
         else {
             diff = _compare(kvs, on->val, data);
         }
@@ -578,7 +573,8 @@ elem_node_remove(purc_variant_t set, struct set_node *node)
     int r;
     struct pcutils_array_list_node *old;
     struct pcutils_array_list *al = &data->al;
-    r = pcutils_array_list_remove(al, node->alnode.idx, &old);
+    size_t idx = pcutils_array_list_node_idx(al, &node->alnode);
+    r = pcutils_array_list_remove(al, idx, &old);
     PC_ASSERT(r == 0);
     PC_ASSERT(old == &node->alnode);
     PC_ASSERT(node->alnode.idx == (size_t)-1);
@@ -636,7 +632,7 @@ variant_set_release_elems(purc_variant_t set, variant_set_t data)
     struct pcutils_array_list *al = &data->al;
     struct pcutils_array_list_node *p, *n;
     for (p = pcutils_array_list_get_last(al);
-            ({ n = p ? pcutils_array_list_get(al,  p->idx-1) : NULL;
+            ({ n = p ? pcutils_array_list_prev(al, p) : NULL;
              p; });
             p = n)
     {
@@ -715,8 +711,6 @@ variant_set_create_elem_node(purc_variant_t set, purc_variant_t val)
         return NULL;
     }
 
-    pcvariant_md5_by_set(_new->md5, val, set);
-
     _new->alnode.idx = (size_t)-1;
     _new->val = val;
     purc_variant_ref(val);
@@ -786,7 +780,7 @@ set_remove(purc_variant_t set, struct set_node *node,
         elem_node_remove(set, node);
 
         if (check) {
-            pcvar_adjust_set_by_descendant(set);
+            pcvar_adjust_set_by_descendant(set, PURC_VARIANT_INVALID);
 
             shrunk(set, node->val, check);
         }
@@ -877,7 +871,7 @@ insert(purc_variant_t set, variant_set_t data,
             if (!elem_node_setup_constraints(set, node))
                 break;
 
-            pcvar_adjust_set_by_descendant(set);
+            pcvar_adjust_set_by_descendant(set, PURC_VARIANT_INVALID);
 
             grown(set, node->val, check);
         }
@@ -996,7 +990,7 @@ insert_or_replace(purc_variant_t set,
             break;
 
         if (check) {
-            pcvar_adjust_set_by_descendant(set);
+            pcvar_adjust_set_by_descendant(set, PURC_VARIANT_INVALID);
 
             changed(set, _old, val, check);
         }
@@ -1705,14 +1699,11 @@ next_node(struct set_iterator *it, struct set_node *curr)
     if (it->it_type == SET_IT_ARRAY) {
         struct pcutils_array_list *arr = &data->al;
         PC_ASSERT(arr);
-        size_t count = pcutils_array_list_length(arr);
-        size_t idx = curr->alnode.idx + 1;
-        if (idx >= count)
+        struct pcutils_array_list_node *alnode;
+        alnode = pcutils_array_list_next(arr, &curr->alnode);
+        if (!alnode)
             return NULL;
 
-        struct pcutils_array_list_node *alnode;
-        alnode = pcutils_array_list_get(arr, idx);
-        PC_ASSERT(alnode);
         return container_of(alnode, struct set_node, alnode);
     }
 
@@ -1734,19 +1725,14 @@ prev_node(struct set_iterator *it, struct set_node *curr)
     PC_ASSERT(data);
 
     if (it->it_type == SET_IT_ARRAY) {
-        if (curr->alnode.idx == 0)
-            return NULL;
-
         struct pcutils_array_list *arr = &data->al;
         PC_ASSERT(arr);
-        size_t count = pcutils_array_list_length(arr);
-        size_t idx = curr->alnode.idx - 1;
-        if (idx >= count)
-            return NULL;
 
         struct pcutils_array_list_node *alnode;
-        alnode = pcutils_array_list_get(arr, idx);
-        PC_ASSERT(alnode);
+        alnode = pcutils_array_list_prev(arr, &curr->alnode);
+        if (!alnode)
+            return NULL;
+
         return container_of(alnode, struct set_node, alnode);
     }
 
@@ -2083,6 +2069,30 @@ pcvar_adjust_set_by_edge(purc_variant_t set,
     PC_ASSERT(0);
 }
 
+int
+pcvar_set_check_member(purc_variant_t set, struct set_node *node,
+        purc_variant_t _new)
+{
+    PC_ASSERT(set != PURC_VARIANT_INVALID);
+    PC_ASSERT(purc_variant_is_set(set));
+    variant_set_t data = pcvar_set_get_data(set);
+
+    // the unique keys are untouched
+    if (_compare(_new, node->val, data) == 0)
+        return 0;
+
+    struct element_rb_node rbn;
+    find_element_rb_node(&rbn, set, _new);
+    if (rbn.entry && rbn.entry != &node->rbnode) {
+        purc_set_error(PURC_ERROR_DUPLICATED);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* re-links the node in the rb-tree, which is searched by comparing
+   the unique keys; no digest of the member is involved */
 int
 pcvar_readjust_set(purc_variant_t set, struct set_node *node)
 {
@@ -2101,6 +2111,8 @@ pcvar_readjust_set(purc_variant_t set, struct set_node *node)
     pcutils_rbtree_link_node(entry, rbn.parent, rbn.pnode);
     pcutils_rbtree_insert_color(entry, &data->elems);
 
+    data->nr_reindexes++;
+
     return 0;
 }
 
@@ -31,6 +31,7 @@
 #include "private/debug.h"
 #include "private/dvobjs.h"
 #include "private/utils.h"
+#include "private/trace.h"
 #include "variant-internals.h"
 
 #include <stdlib.h>
@@ -501,6 +502,7 @@ void pcvariant_put(purc_variant_t value)
         stat->sz_mem[value->type] -= sizeof(purc_variant);
         stat->sz_total_mem -= sizeof(purc_variant);
 
+        PCTRACE_INSTANT(PCTRACE_CAT_VARIANT, "variant_free", value->type);
         pcvariant_free(value);
     }
     else {
@@ -515,6 +517,7 @@ void pcvariant_put(purc_variant_t value)
         stat->sz_mem[value->type] -= sizeof(purc_variant);
         stat->sz_total_mem -= sizeof(purc_variant);
 
+        PCTRACE_INSTANT(PCTRACE_CAT_VARIANT, "variant_free", value->type);
         pcvariant_free(value);
     }
     else {
@@ -2848,17 +2851,18 @@ cmp_by_obj(purc_variant_t l, purc_variant_t r,
     rd = (variant_obj_t)r->sz_ptr[1];
     PC_ASSERT(ld);
     PC_ASSERT(rd);
-    struct rb_root *lroot = &ld->kvs;
-    struct rb_root *rroot = &rd->kvs;
-    struct rb_node *lnode = pcutils_rbtree_first(lroot);
-    struct rb_node *rnode = pcutils_rbtree_first(rroot);
+    struct pcutils_array_list *lal = &ld->kvs;
+    struct pcutils_array_list *ral = &rd->kvs;
+    struct pcutils_array_list_node *lnode = pcutils_array_list_get_first(lal);
+    struct pcutils_array_list_node *rnode = pcutils_array_list_get_first(ral);
     for (;
         lnode && rnode;
-        lnode = pcutils_rbtree_next(lnode), rnode = pcutils_rbtree_next(rnode))
+        lnode = pcutils_array_list_next(lal, lnode),
+        rnode = pcutils_array_list_next(ral, rnode))
     {
         struct obj_node *lo, *ro;
-        lo = container_of(lnode, struct obj_node, node);
-        ro = container_of(rnode, struct obj_node, node);
+        lo = container_of(lnode, struct obj_node, alnode);
+        ro = container_of(rnode, struct obj_node, alnode);
         PC_ASSERT(lo->key);
         PC_ASSERT(ro->key);
         const char *lk = purc_variant_get_string_const(lo->key);
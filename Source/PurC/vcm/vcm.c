@@ -36,6 +36,7 @@
 #include "private/stack.h"
 #include "private/interpreter.h"
 #include "private/utils.h"
+#include "private/atom-buckets.h"
 
 #define TREE_NODE(node)              ((struct pctree_node*)(node))
 #define VCM_NODE(node)               ((struct pcvcm_node*)(node))
@@ -71,6 +72,8 @@ void pcvcm_node_serialize_to_rwstream(purc_rwstream_t rws,
 struct pcvcm_node_op {
     cb_find_var find_var;
     void *find_var_ctxt;
+    // not NULL if the coroutine is being profiled
+    struct pcintr_profiler *prof;
 };
 
 // expression variable
@@ -149,6 +152,10 @@ struct pcvcm_node *pcvcm_node_new_string(const char *str_utf8)
     n->sz_ptr[0] = nr_bytes;
     n->sz_ptr[1] = (uintptr_t)buf;
 
+    // NOTE: only the names interned by DVObjs might be matched by atom
+    n->atom = purc_atom_try_string_ex(ATOM_BUCKET_DVOBJ, (const char*)buf);
+    n->hash = pcvariant_object_key_hash((const char*)buf);
+
     return n;
 }
 
@@ -1187,22 +1194,105 @@ enum method_type {
     SETTER_METHOD
 };
 
+#define MAX_LEN_METHOD_NAME         128
+
+/* composes the name of a method for the profiler, e.g., `$SYSTEM.time` */
+static size_t
+compose_method_name(struct pcvcm_node *node, char *buf, size_t sz)
+{
+    struct pcvcm_node *child;
+    size_t n = 0;
+    int r = 0;
+
+    switch (node->type) {
+    case PCVCM_NODE_TYPE_STRING:
+        r = snprintf(buf, sz, "%s", (const char*)node->sz_ptr[1]);
+        break;
+
+    case PCVCM_NODE_TYPE_FUNC_GET_VARIABLE:
+        child = FIRST_CHILD(node);
+        if (child && child->type == PCVCM_NODE_TYPE_STRING)
+            r = snprintf(buf, sz, "$%s", (const char*)child->sz_ptr[1]);
+        else
+            r = snprintf(buf, sz, "$?");
+        break;
+
+    case PCVCM_NODE_TYPE_FUNC_GET_ELEMENT:
+        child = FIRST_CHILD(node);
+        if (child) {
+            n = compose_method_name(child, buf, sz);
+            child = NEXT_CHILD(child);
+        }
+        if (child && n + 1 < sz) {
+            buf[n++] = '.';
+            buf[n] = 0;
+            n += compose_method_name(child, buf + n, sz - n);
+        }
+        return n;
+
+    case PCVCM_NODE_TYPE_FUNC_CALL_GETTER:
+    case PCVCM_NODE_TYPE_FUNC_CALL_SETTER:
+        child = FIRST_CHILD(node);
+        if (child)
+            n = compose_method_name(child, buf, sz);
+        r = snprintf(buf + n, sz - n, "()");
+        break;
+
+    default:
+        r = snprintf(buf, sz, "?");
+        break;
+    }
+
+    if (r < 0)
+        return n;
+    n += r;
+    return (n < sz) ? n : sz - 1;
+}
+
+static void
+profile_method(struct pcvcm_node_op *ops, struct pcvcm_node *name_node,
+        enum method_type type, uint64_t begin)
+{
+    char name[MAX_LEN_METHOD_NAME];
+    size_t n = compose_method_name(name_node, name, sizeof(name) - 1);
+    if (type == SETTER_METHOD) {
+        name[n++] = '!';
+        name[n] = 0;
+    }
+
+    pcintr_profiler_add_method(ops->prof, name, begin);
+}
+
+static inline bool
+is_profiling(struct pcvcm_node_op *ops)
+{
+    return ops && ops->prof;
+}
+
 static
-purc_variant_t call_dvariant_method(purc_variant_t root, purc_variant_t var,
-        size_t nr_args, purc_variant_t *argv, enum method_type type,
-        bool silently)
+purc_variant_t call_dvariant_method(struct pcvcm_node_op *ops,
+        struct pcvcm_node *name_node, purc_variant_t root,
+        purc_variant_t var, size_t nr_args, purc_variant_t *argv,
+        enum method_type type, bool silently)
 {
     purc_dvariant_method func = (type == GETTER_METHOD) ?
          purc_variant_dynamic_get_getter(var) :
          purc_variant_dynamic_get_setter(var);
     if (func) {
-        return func(root, nr_args, argv, silently);
+        if (!is_profiling(ops))
+            return func(root, nr_args, argv, silently);
+
+        uint64_t begin = pcintr_profiler_now();
+        purc_variant_t ret = func(root, nr_args, argv, silently);
+        profile_method(ops, name_node, type, begin);
+        return ret;
     }
     return PURC_VARIANT_INVALID;
 }
 
 static
-purc_variant_t call_nvariant_method(purc_variant_t var,
+purc_variant_t call_nvariant_method(struct pcvcm_node_op *node_ops,
+        struct pcvcm_node *name_node, purc_variant_t var,
         const char *key_name, size_t nr_args, purc_variant_t *argv,
         enum method_type type, bool silently)
 {
@@ -1212,13 +1302,27 @@ purc_variant_t call_nvariant_method(purc_variant_t var,
             ops->property_getter(key_name) :
             ops->property_setter(key_name);
         if (native_func) {
-            return  native_func(purc_variant_native_get_entity(var),
+            if (!is_profiling(node_ops))
+                return native_func(purc_variant_native_get_entity(var),
+                        nr_args, argv, silently);
+
+            uint64_t begin = pcintr_profiler_now();
+            purc_variant_t ret = native_func(
+                    purc_variant_native_get_entity(var),
                     nr_args, argv, silently);
+            profile_method(node_ops, name_node, type, begin);
+            return ret;
         }
     }
     return PURC_VARIANT_INVALID;
 }
 
+static inline purc_atom_t
+key_atom(struct pcvcm_node *node)
+{
+    return node->type == PCVCM_NODE_TYPE_STRING ? node->atom : 0;
+}
+
 static purc_variant_t get_attach_variant(struct pcvcm_node *node)
 {
     return node ? (purc_variant_t)node->attach : PURC_VARIANT_INVALID;
@@ -1316,7 +1420,8 @@ purc_variant_t pcvcm_node_get_element_to_variant(struct pcvcm_node *node,
     if (is_inner_native_wrapper(caller_var)) {
         purc_variant_t inner_caller = inner_native_wrapper_get_caller(caller_var);
         purc_variant_t inner_param = inner_native_wrapper_get_param(caller_var);
-        purc_variant_t inner_ret = call_nvariant_method(inner_caller,
+        purc_variant_t inner_ret = call_nvariant_method(ops, caller_node,
+                inner_caller,
                 purc_variant_get_string_const(inner_param), 0, NULL,
                 GETTER_METHOD, silently);
         if (inner_ret) {
@@ -1326,7 +1431,11 @@ purc_variant_t pcvcm_node_get_element_to_variant(struct pcvcm_node *node,
     }
 
     if (purc_variant_is_object(caller_var)) {
-        purc_variant_t val = purc_variant_object_get(caller_var, param_var);
+        purc_atom_t atom = key_atom(param_node);
+        purc_variant_t val = atom ?
+            pcvariant_object_get_by_atom(caller_var, atom,
+                    (const char*)param_node->sz_ptr[1], param_node->hash) :
+            purc_variant_object_get(caller_var, param_var);
         if (val == PURC_VARIANT_INVALID) {
             goto out_unref_param_var;
         }
@@ -1342,8 +1451,8 @@ purc_variant_t pcvcm_node_get_element_to_variant(struct pcvcm_node *node,
             goto out_unref_param_var;
         }
 
-        ret_var = call_dvariant_method(caller_var, val, 0, NULL, GETTER_METHOD,
-                silently);
+        ret_var = call_dvariant_method(ops, node, caller_var, val, 0, NULL,
+                GETTER_METHOD, silently);
         purc_variant_unref(val);
     }
     else if (purc_variant_is_array(caller_var)) {
@@ -1373,8 +1482,8 @@ purc_variant_t pcvcm_node_get_element_to_variant(struct pcvcm_node *node,
             ret_var = val;
             goto out_unref_param_var;
         }
-        ret_var = call_dvariant_method(caller_var, val, 0, NULL, GETTER_METHOD,
-                silently);
+        ret_var = call_dvariant_method(ops, node, caller_var, val, 0, NULL,
+                GETTER_METHOD, silently);
         purc_variant_unref(val);
     }
     else if (purc_variant_is_set(caller_var)) {
@@ -1404,12 +1513,12 @@ purc_variant_t pcvcm_node_get_element_to_variant(struct pcvcm_node *node,
             ret_var = val;
             goto out_unref_param_var;
         }
-        ret_var = call_dvariant_method(caller_var, val, 0, NULL, GETTER_METHOD,
-                silently);
+        ret_var = call_dvariant_method(ops, node, caller_var, val, 0, NULL,
+                GETTER_METHOD, silently);
         purc_variant_unref(val);
     }
     else if (purc_variant_is_dynamic(caller_var)) {
-        ret_var = call_dvariant_method(
+        ret_var = call_dvariant_method(ops, caller_node,
                 get_attach_variant(FIRST_CHILD(caller_node)),
                 caller_var, 1, &param_var, GETTER_METHOD,
                 silently);
@@ -1420,7 +1529,7 @@ purc_variant_t pcvcm_node_get_element_to_variant(struct pcvcm_node *node,
             ret_var = inner_native_wrapper_create(caller_var, param_var);
             goto out_unref_param_var;
         }
-        ret_var = call_nvariant_method(caller_var,
+        ret_var = call_nvariant_method(ops, node, caller_var,
                 purc_variant_get_string_const(param_var), 0, NULL,
                 GETTER_METHOD, silently);
         goto out_unref_param_var;
@@ -1477,7 +1586,7 @@ purc_variant_t pcvcm_node_call_method_to_variant(struct pcvcm_node *node,
     }
 
     if (purc_variant_is_dynamic(caller_var)) {
-        ret_var = call_dvariant_method(
+        ret_var = call_dvariant_method(ops, caller_node,
                 get_attach_variant(FIRST_CHILD(caller_node)),
                 caller_var, nr_params, params, type, silently);
     }
@@ -1486,7 +1595,7 @@ purc_variant_t pcvcm_node_call_method_to_variant(struct pcvcm_node *node,
         if (purc_variant_is_native(nv)) {
             purc_variant_t name = inner_native_wrapper_get_param(caller_var);
             if (name) {
-                ret_var = call_nvariant_method(nv,
+                ret_var = call_nvariant_method(ops, caller_node, nv,
                         purc_variant_get_string_const(name), nr_params,
                         params, type, silently);
             }
@@ -1746,17 +1855,36 @@ purc_variant_t find_stack_var(void *ctxt, const char *name)
     return pcintr_find_named_var(ctxt, name);
 }
 
+static purc_variant_t
+eval_full(struct pcvcm_node *tree, cb_find_var find_var, void *ctxt,
+        struct pcintr_profiler *prof, bool silently);
+
 purc_variant_t pcvcm_eval(struct pcvcm_node *tree, struct pcintr_stack *stack,
         bool silently)
 {
     if (stack) {
-        return pcvcm_eval_ex(tree, find_stack_var, stack, silently);
+        struct pcintr_profiler *prof = stack->co ? stack->co->profiler : NULL;
+        if (prof == NULL)
+            return eval_full(tree, find_stack_var, stack, NULL, silently);
+
+        uint64_t begin = pcintr_profiler_eval_begin(prof);
+        purc_variant_t ret = eval_full(tree, find_stack_var, stack, prof,
+                silently);
+        pcintr_profiler_eval_end(prof, begin);
+        return ret;
     }
-    return pcvcm_eval_ex(tree, NULL, NULL, silently);
+    return eval_full(tree, NULL, NULL, NULL, silently);
 }
 
 purc_variant_t pcvcm_eval_ex(struct pcvcm_node *tree,
         cb_find_var find_var, void *ctxt, bool silently)
+{
+    return eval_full(tree, find_var, ctxt, NULL, silently);
+}
+
+static purc_variant_t
+eval_full(struct pcvcm_node *tree, cb_find_var find_var, void *ctxt,
+        struct pcintr_profiler *prof, bool silently)
 {
     const char *env_value;
     if ((env_value = getenv(PURC_ENV_VCM_LOG_ENABLE))) {
@@ -1773,6 +1901,7 @@ purc_variant_t pcvcm_eval_ex(struct pcvcm_node *tree,
     struct pcvcm_node_op ops = {
         .find_var = find_var,
         .find_var_ctxt = ctxt,
+        .prof = prof,
     };
 
     if (tree) {
@@ -81,7 +81,17 @@ struct pcvdom_document {
 
     atomic_ulong            refc;
 
+    // static id -> the set of the elements having the id; built once the
+    // document has been generated, and read-only afterwards.
+    struct pcutils_map     *id_index;
+
+    // (element, name) -> the document derived from the element, e.g., the
+    // one generated for a concurrent call; shared by the threads.
+    struct pcutils_map     *derived;
+
     unsigned int            quirks:1;
+    // whether there is an element whose id is an expression
+    unsigned int            dynamic_ids:1;
 };
 
 struct pcvdom_attr {
@@ -93,6 +103,10 @@ struct pcvdom_attr {
     const struct pchvml_attr_entry  *pre_defined;
     char                     *key;
 
+    // the atom of the key in the HVML keyword bucket, resolved on creation;
+    // 0 if the key is not a keyword.
+    purc_atom_t               keyword;
+
     // operator
     enum pchvml_attr_operator       op;
 
@@ -113,6 +127,10 @@ struct pcvdom_element {
     struct pcutils_map     *attrs;
 
     unsigned int            self_closing:1;
+
+    // the position of the start tag in the source; 0 if unknown
+    int                     line;
+    int                     col;
 };
 
 struct pcvdom_content {
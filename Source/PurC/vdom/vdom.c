@@ -31,6 +31,7 @@
 #include "private/stringbuilder.h"
 
 #include "hvml-attr.h"
+#include "keywords.h"
 
 #include "vdom-internal.h"
 
@@ -254,6 +255,7 @@ pcvdom_attr_create(const char *key, enum pchvml_attr_operator op,
         }
     }
 
+    attr->keyword = PCHVML_KEYWORD_ATOM(HVML, attr->key);
     attr->val = vcm;
 
     return attr;
@@ -677,6 +679,269 @@ pcvdom_element_traverse(struct pcvdom_element *elem, void *ctx,
     return arg.abortion;
 }
 
+const char*
+pcvdom_element_get_static_id(struct pcvdom_element *element, bool *dynamic)
+{
+    struct pcvdom_attr *attr = pcvdom_element_find_attr(element, "id");
+
+    *dynamic = false;
+    if (!attr || !attr->val)
+        return NULL;
+
+    if (attr->op != PCHVML_ATTRIBUTE_OPERATOR ||
+            attr->val->type != PCVCM_NODE_TYPE_STRING) {
+        *dynamic = true;
+        return NULL;
+    }
+
+    return (const char*)attr->val->sz_ptr[1];
+}
+
+static int
+comp_elem(const void *key1, const void *key2)
+{
+    uintptr_t a = (uintptr_t)key1;
+    uintptr_t b = (uintptr_t)key2;
+    return (a < b) ? -1 : (a > b);
+}
+
+static void
+free_elem_set(void *val)
+{
+    pcutils_map_destroy((pcutils_map*)val);
+}
+
+static int
+index_element_id(struct pcvdom_element *top, struct pcvdom_element *elem,
+        void *ctx)
+{
+    UNUSED_PARAM(top);
+
+    struct pcvdom_document *doc = (struct pcvdom_document*)ctx;
+    bool dynamic;
+    const char *id = pcvdom_element_get_static_id(elem, &dynamic);
+    if (!id) {
+        if (dynamic)
+            doc->dynamic_ids = 1;
+        return 0;
+    }
+
+    pcutils_map_entry *entry = pcutils_map_find(doc->id_index, id);
+    if (!entry) {
+        pcutils_map *set = pcutils_map_create(NULL, NULL, NULL, NULL,
+                comp_elem, false);
+        if (!set)
+            return -1;
+        if (pcutils_map_insert(doc->id_index, id, set)) {
+            pcutils_map_destroy(set);
+            return -1;
+        }
+        entry = pcutils_map_find(doc->id_index, id);
+    }
+
+    return pcutils_map_insert((pcutils_map*)entry->val, elem, NULL);
+}
+
+int
+pcvdom_document_build_id_index(struct pcvdom_document *doc)
+{
+    if (doc->id_index)
+        return 0;
+
+    doc->id_index = pcutils_map_create(copy_key_string, free_key_string,
+            NULL, free_elem_set, comp_key_string, false);
+    if (!doc->id_index) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+
+    doc->dynamic_ids = 0;
+    if (doc->root && pcvdom_element_traverse(doc->root, doc,
+                index_element_id)) {
+        pcutils_map_destroy(doc->id_index);
+        doc->id_index = NULL;
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+
+    return 0;
+}
+
+struct pcvdom_element*
+pcvdom_document_find_ancestor_by_id(struct pcvdom_document *doc,
+        struct pcvdom_element *elem, const char *id,
+        pcvdom_match_id_f match_dynamic, void *ctxt)
+{
+    pcutils_map *set = NULL;
+    bool indexed = doc && doc->id_index;
+
+    if (indexed) {
+        pcutils_map_entry *entry = pcutils_map_find(doc->id_index, id);
+        if (entry)
+            set = (pcutils_map*)entry->val;
+        else if (!doc->dynamic_ids)
+            return NULL;
+    }
+
+    struct pcvdom_node *node = elem ? &elem->node : NULL;
+    for (; PCVDOM_NODE_IS_ELEMENT(node); node = pcvdom_node_parent(node)) {
+        struct pcvdom_element *p;
+        p = container_of(node, struct pcvdom_element, node);
+
+        if (indexed) {
+            if (set && pcutils_map_find(set, p))
+                return p;
+            if (!doc->dynamic_ids)
+                continue;
+        }
+
+        bool dynamic;
+        const char *sid = pcvdom_element_get_static_id(p, &dynamic);
+        if (sid) {
+            if (!indexed && strcmp(sid, id) == 0)
+                return p;
+        }
+        else if (dynamic && match_dynamic && match_dynamic(p, id, ctxt)) {
+            return p;
+        }
+    }
+
+    return NULL;
+}
+
+struct derived_key {
+    struct pcvdom_element  *elem;
+    char                    name[];
+};
+
+static struct derived_key*
+make_derived_key(struct pcvdom_element *elem, const char *name)
+{
+    size_t len = strlen(name);
+    struct derived_key *key = malloc(sizeof(*key) + len + 1);
+    if (key) {
+        key->elem = elem;
+        memcpy(key->name, name, len + 1);
+    }
+    return key;
+}
+
+static void*
+copy_derived_key(const void *key)
+{
+    const struct derived_key *k = key;
+    return make_derived_key(k->elem, k->name);
+}
+
+static int
+comp_derived_key(const void *key1, const void *key2)
+{
+    const struct derived_key *k1 = key1;
+    const struct derived_key *k2 = key2;
+
+    if (k1->elem != k2->elem)
+        return ((uintptr_t)k1->elem < (uintptr_t)k2->elem) ? -1 : 1;
+    return strcmp(k1->name, k2->name);
+}
+
+static void
+free_derived(void *val)
+{
+    pcvdom_document_unref((struct pcvdom_document*)val);
+}
+
+/* the derived documents which are not used by anyone else are dropped
+   once there are so many, e.g. for the names given by expressions */
+#define NR_DERIVED_TO_SWEEP     16
+
+/* the reference held by `derived` of the owner is the only one */
+static inline bool
+is_derived_unused(struct pcvdom_document *derived)
+{
+    return atomic_load(&derived->refc) <= 2;
+}
+
+static void
+drop_unused_derived(pcutils_map *map)
+{
+    pcutils_map_lock(map);
+
+    struct pcutils_map_iterator it = pcutils_map_it_begin_first(map);
+    while (pcutils_map_it_value(&it)) {
+        pcutils_map_entry *entry = pcutils_map_it_value(&it);
+        pcutils_map_it_next(&it);
+        if (is_derived_unused((struct pcvdom_document*)entry->val))
+            pcutils_map_erase_entry_nolock(map, entry);
+    }
+    pcutils_map_it_end(&it);
+
+    pcutils_map_unlock(map);
+}
+
+struct pcvdom_document*
+pcvdom_document_find_derived(struct pcvdom_document *doc,
+        struct pcvdom_element *elem, const char *name)
+{
+    if (!doc->derived)
+        return NULL;
+
+    struct derived_key *key = make_derived_key(elem, name);
+    if (!key)
+        return NULL;
+
+    // the reference is taken under the lock, before the document might
+    // be dropped as an unused one by another thread
+    struct pcvdom_document *derived = NULL;
+    pcutils_map_entry *entry = pcutils_map_find_and_lock(doc->derived, key);
+    if (entry) {
+        derived = pcvdom_document_ref((struct pcvdom_document*)entry->val);
+        pcutils_map_unlock(doc->derived);
+    }
+
+    free(key);
+    return derived;
+}
+
+struct pcvdom_document*
+pcvdom_document_add_derived(struct pcvdom_document *doc,
+        struct pcvdom_element *elem, const char *name,
+        struct pcvdom_document *derived)
+{
+    if (!doc->derived)
+        return NULL;
+
+    struct derived_key *key = make_derived_key(elem, name);
+    if (!key) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    if (pcutils_map_get_size(doc->derived) >= NR_DERIVED_TO_SWEEP)
+        drop_unused_derived(doc->derived);
+
+    // one reference for the map, and the other for the caller; both are
+    // taken before `derived` is visible to the other threads
+    pcvdom_document_ref(derived);
+    struct pcvdom_document *owned = pcvdom_document_ref(derived);
+    if (pcutils_map_insert(doc->derived, key, derived)) {
+        pcvdom_document_unref(derived);
+
+        pcutils_map_entry *entry;
+        entry = pcutils_map_find_and_lock(doc->derived, key);
+        if (entry) {
+            owned = pcvdom_document_ref((struct pcvdom_document*)entry->val);
+            pcutils_map_unlock(doc->derived);
+            pcvdom_document_unref(derived);
+        }
+        else {
+            owned = NULL;
+        }
+    }
+
+    free(key);
+    return owned;
+}
+
 struct serialize_data {
     struct pcvdom_node                 *top;
     int                                 is_doc;
@@ -935,6 +1200,16 @@ document_reset(struct pcvdom_document *doc)
     pcutils_arrlist_free(doc->bodies);
     doc->bodies = NULL;
 
+    if (doc->id_index) {
+        pcutils_map_destroy(doc->id_index);
+        doc->id_index = NULL;
+    }
+
+    if (doc->derived) {
+        pcutils_map_destroy(doc->derived);
+        doc->derived = NULL;
+    }
+
     while (doc->node.node.first_child) {
         struct pcvdom_node *node;
         node = container_of(doc->node.node.first_child, struct pcvdom_node, node);
@@ -981,6 +1256,15 @@ document_create(void)
         return NULL;
     }
 
+    doc->derived = pcutils_map_create(copy_derived_key, free,
+            NULL, free_derived, comp_derived_key, true);
+    if (!doc->derived) {
+        pcutils_arrlist_free(doc->bodies);
+        free(doc);
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
     doc->node.type = VDT(DOCUMENT);
     doc->node.remove_child = document_remove_child;
 
@@ -33,6 +33,7 @@
 #include <getopt.h>
 #include <limits.h>
 #include <assert.h>
+#include <errno.h>
 #include <unistd.h>
 
 #define KEY_APP_NAME            "app"
@@ -63,6 +64,13 @@ struct run_info {
     purc_variant_t opts;
     purc_variant_t app_info;
     purc_rwstream_t dump_stm;
+
+    /* the stream to write the profile reports to */
+    FILE *fp_profile;
+    purc_rwstream_t profile_stm;
+
+    /* the file to dump the trace events to */
+    char *trace_file;
 };
 
 static struct run_info run_info;
@@ -154,6 +162,14 @@ static void print_usage(FILE *fp)
         "  -l --parallel\n"
         "        Execute multiple programs in parallel.\n"
         "\n"
+        "  -P --profile=< file >\n"
+        "        Profile the coroutines running in the main runner and write\n"
+        "        the flat and hierarchical reports to the specified file.\n"
+        "\n"
+        "  -T --trace=< file >\n"
+        "        Record the trace events of all threads and write them to\n"
+        "        the specified file in Chrome trace event format on exit.\n"
+        "\n"
         "  -b --verbose\n"
         "        Execute the program(s) with verbose output.\n"
         "\n"
@@ -175,6 +191,8 @@ struct my_opts {
     const char *rdr_prot;
     char *rdr_uri;
     char *request;
+    char *profile;
+    char *trace;
 
     pcutils_array_t *urls;
     pcutils_array_t *body_ids;
@@ -272,6 +290,11 @@ static void my_opts_delete(struct my_opts *opts, bool deep)
     if (opts->request)
         free(opts->request);
 
+    if (opts->profile)
+        free(opts->profile);
+    if (opts->trace)
+        free(opts->trace);
+
     if (opts->app_info)
         free(opts->app_info);
 
@@ -361,7 +384,7 @@ static bool validate_url(struct my_opts *opts, const char *url)
 
 static int read_option_args(struct my_opts *opts, int argc, char **argv)
 {
-    static const char short_options[] = "a:r:d:p:u:t:lbcvh";
+    static const char short_options[] = "a:r:d:p:u:t:P:T:lbcvh";
     static const struct option long_opts[] = {
         { "app"            , required_argument , NULL , 'a' },
         { "runner"         , required_argument , NULL , 'r' },
@@ -369,6 +392,8 @@ static int read_option_args(struct my_opts *opts, int argc, char **argv)
         { "rdr-prot"       , required_argument , NULL , 'p' },
         { "rdr-uri"        , required_argument , NULL , 'u' },
         { "request"        , required_argument , NULL , 't' },
+        { "profile"        , required_argument , NULL , 'P' },
+        { "trace"          , required_argument , NULL , 'T' },
         { "parallel"       , no_argument       , NULL , 'l' },
         { "verbose"        , no_argument       , NULL , 'b' },
         { "copying"        , no_argument       , NULL , 'c' },
@@ -467,6 +492,14 @@ static int read_option_args(struct my_opts *opts, int argc, char **argv)
             break;
 
 
+        case 'P':
+            opts->profile = strdup(optarg);
+            break;
+
+        case 'T':
+            opts->trace = strdup(optarg);
+            break;
+
         case 'l':
             opts->parallel = true;
             break;
@@ -995,14 +1028,24 @@ schedule_coroutines_for_runner(struct my_opts *opts,
 #define MY_VRT_OPTS \
     (PCVARIANT_SERIALIZE_OPT_SPACED | PCVARIANT_SERIALIZE_OPT_NOSLASHESCAPE)
 
+static void dump_profile(purc_coroutine_t cor)
+{
+    if (run_info.profile_stm) {
+        purc_coroutine_dump_profile(cor, run_info.profile_stm);
+        fflush(run_info.fp_profile);
+    }
+}
+
 static int app_cond_handler(purc_cond_t event, void *arg, void *data)
 {
-    (void)arg;
     (void)data;
 
     if (event == PURC_COND_SHUTDOWN_ASKED) {
         return 0;
     }
+    else if (event == PURC_COND_COR_EXITED) {
+        dump_profile((purc_coroutine_t)arg);
+    }
 
     return 0;
 }
@@ -1112,6 +1155,8 @@ static int prog_cond_handler(purc_cond_t event, purc_coroutine_t cor,
         void *data)
 {
     if (event == PURC_COND_COR_EXITED) {
+        dump_profile(cor);
+
         struct runr_info *runr_info = NULL;
         purc_get_local_data(RUNR_INFO_NAME,
                 (uintptr_t *)(void *)&runr_info, NULL);
@@ -1274,6 +1319,13 @@ int main(int argc, char** argv)
         return EXIT_FAILURE;
     }
 
+    if (opts->trace) {
+        /* enable tracing before the runners are created */
+        run_info.trace_file = opts->trace;
+        opts->trace = NULL;
+        purc_enable_trace(true);
+    }
+
     purc_variant_t request = PURC_VARIANT_INVALID;
     if (opts->request) {
         if ((request = get_request_data(opts)) == PURC_VARIANT_INVALID) {
@@ -1287,6 +1339,21 @@ int main(int argc, char** argv)
 
     run_info.dump_stm = purc_rwstream_new_for_dump(stdout, cb_stdio_write);
 
+    if (opts->profile) {
+        run_info.fp_profile = fopen(opts->profile, "w");
+        if (run_info.fp_profile == NULL) {
+            if (opts->verbose)
+                fprintf(stderr, "Failed to open the profile file %s: %s\n",
+                    opts->profile, strerror(errno));
+            my_opts_delete(opts, true);
+            goto failed;
+        }
+
+        run_info.profile_stm = purc_rwstream_new_for_dump(
+                run_info.fp_profile, cb_stdio_write);
+        purc_enable_profiler(true);
+    }
+
     if (opts->app_info == NULL && opts->parallel) {
         if (!construct_app_info(opts)) {
             my_opts_delete(opts, true);
@@ -1327,9 +1394,20 @@ failed:
         purc_variant_unref(run_info.app_info);
     if (run_info.dump_stm)
         purc_rwstream_destroy(run_info.dump_stm);
+    if (run_info.profile_stm)
+        purc_rwstream_destroy(run_info.profile_stm);
+    if (run_info.fp_profile)
+        fclose(run_info.fp_profile);
 
     purc_cleanup();
 
+    if (run_info.trace_file) {
+        if (!purc_dump_trace(run_info.trace_file))
+            fprintf(stderr, "Failed to dump the trace events to %s\n",
+                    run_info.trace_file);
+        free(run_info.trace_file);
+    }
+
     return success ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
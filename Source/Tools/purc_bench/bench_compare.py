@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+#
+# bench_compare.py - compare two result files of purc_bench.
+#
+# Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+#
+# This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+"""Compare two result files of purc_bench.
+
+Usage: bench_compare.py [--threshold=PERCENT] [--stat=median|min|mean] BASE NEW
+
+The exit status is 1 if any benchmark regresses more than the threshold
+(5% by default), so the script can be used in scripts.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        doc = json.load(f)
+    return {b['name']: b for b in doc['benchmarks']}
+
+
+def main():
+    parser = argparse.ArgumentParser(
+            description='Compare two result files of purc_bench.')
+    parser.add_argument('base', help='the result file of the baseline build')
+    parser.add_argument('new', help='the result file of the new build')
+    parser.add_argument('--stat', default='median',
+            choices=['min', 'median', 'mean', 'max'],
+            help='the statistic to compare (default: median)')
+    parser.add_argument('--threshold', type=float, default=5.0,
+            help='the change in percent reported as a regression')
+    args = parser.parse_args()
+
+    base = load(args.base)
+    new = load(args.new)
+
+    print('%-24s %14s %14s %9s' % ('benchmark', 'base ns/op', 'new ns/op',
+            'change'))
+    regressed = False
+    for name in base:
+        if name not in new:
+            print('%-24s %14.1f %14s %9s' % (name,
+                    base[name]['ns_per_op'][args.stat], '-', 'removed'))
+            continue
+
+        b = base[name]['ns_per_op'][args.stat]
+        n = new[name]['ns_per_op'][args.stat]
+        change = (n - b) * 100.0 / b if b > 0 else 0.0
+        mark = ''
+        if change > args.threshold:
+            mark = '  <- slower'
+            regressed = True
+        elif change < -args.threshold:
+            mark = '  <- faster'
+        print('%-24s %14.1f %14.1f %+8.1f%%%s' % (name, b, n, change, mark))
+
+    for name in new:
+        if name not in base:
+            print('%-24s %14s %14.1f %9s' % (name, '-',
+                    new[name]['ns_per_op'][args.stat], 'added'))
+
+    return 1 if regressed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
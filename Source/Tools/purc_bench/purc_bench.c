@@ -0,0 +1,726 @@
+/*
+ * @file purc_bench.c
+ * @date 2022/10/18
+ * @brief The micro-benchmarks of the hot paths of PurC.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "purc.h"
+
+#include "private/ejson.h"
+#include "private/vcm.h"
+
+#include <assert.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEF_APP_NAME        "cn.fmsoft.hvml.bench"
+#define DEF_RUN_NAME        "main"
+
+#define DEF_REPEAT          5
+#define MAX_REPEAT          100
+
+/* the number of coroutines scheduled by `sched.coroutines` */
+#define NR_COROUTINES       32
+/* the number of members of the containers operated by one iteration */
+#define NR_MEMBERS          64
+
+struct bench_info {
+    const char *name;
+    const char *desc;
+    /* the number of iterations of one repetition (scale = 1.0) */
+    size_t      nr_iters;
+
+    /* prepares the data; returns false if the benchmark can not run */
+    bool (*setup)(void);
+    /* runs the specified number of iterations */
+    void (*run)(size_t nr_iters);
+    /* releases the data; also called if setup fails, thus it has to
+       cope with a partial setup */
+    void (*teardown)(void);
+};
+
+struct bench_opts {
+    const char *filter;
+    const char *output;
+    double      scale;
+    int         repeat;
+    bool        list;
+};
+
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* prevents the compiler from optimizing the results away */
+static volatile uintptr_t sink;
+
+static const char *json_sample =
+    "{"
+    "  \"name\": \"PurC\","
+    "  \"version\": [0, 9, 2],"
+    "  \"os\": [\"Linux\", \"macOS\", \"HybridOS\", \"Windows\"],"
+    "  \"darkMode\": true,"
+    "  \"backgroundColor\": { \"r\": 0, \"g\": 0, \"b\": 0, \"a\": 0.75 },"
+    "  \"users\": ["
+    "    { \"id\": 1, \"name\": \"Alice\", \"tags\": [\"admin\", \"dev\"] },"
+    "    { \"id\": 2, \"name\": \"Bob\", \"tags\": [\"dev\"] },"
+    "    { \"id\": 3, \"name\": \"Carol\", \"tags\": [] },"
+    "    { \"id\": 4, \"name\": \"Dave\", \"tags\": [\"qa\", \"ops\"] }"
+    "  ],"
+    "  \"emptyObject\": {},"
+    "  \"emptyArray\": []"
+    "}";
+
+static const char *html_sample_item =
+    "<li class=\"item\" id=\"item-%d\">"
+    "<a href=\"/items/%d\" title=\"Item %d\">Item <b>%d</b></a>"
+    "<span data-value=\"%d\">&lt;value&gt; &amp; text</span>"
+    "</li>\n";
+
+static char *html_sample;
+
+/* variant.* */
+
+static void run_make_number(size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        purc_variant_t v = purc_variant_make_number((double)i);
+        purc_variant_unref(v);
+    }
+}
+
+static void run_make_string(size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        purc_variant_t v = purc_variant_make_string(
+                "a string longer than the inline buffer", false);
+        purc_variant_unref(v);
+    }
+}
+
+static purc_variant_t shared_value;
+
+static bool setup_ref_unref(void)
+{
+    shared_value = purc_variant_make_string("shared", false);
+    return shared_value != PURC_VARIANT_INVALID;
+}
+
+static void run_ref_unref(size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        purc_variant_ref(shared_value);
+        purc_variant_unref(shared_value);
+    }
+}
+
+static void teardown_shared_value(void)
+{
+    PURC_VARIANT_SAFE_CLEAR(shared_value);
+}
+
+/* object.*, array.*, and set.* */
+
+static char member_keys[NR_MEMBERS][16];
+
+static bool setup_keys(void)
+{
+    for (int i = 0; i < NR_MEMBERS; i++)
+        snprintf(member_keys[i], sizeof(member_keys[i]), "key%d", i);
+    return true;
+}
+
+static void run_object_set_get(size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        purc_variant_t obj = purc_variant_make_object_0();
+        for (int j = 0; j < NR_MEMBERS; j++) {
+            purc_variant_t v = purc_variant_make_longint(j);
+            purc_variant_object_set_by_static_ckey(obj, member_keys[j], v);
+            purc_variant_unref(v);
+        }
+
+        for (int j = 0; j < NR_MEMBERS; j++) {
+            sink += (uintptr_t)purc_variant_object_get_by_ckey(obj,
+                    member_keys[j]);
+        }
+        purc_variant_unref(obj);
+    }
+}
+
+static void run_array_append_get(size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        purc_variant_t arr = purc_variant_make_array_0();
+        for (int j = 0; j < NR_MEMBERS; j++) {
+            purc_variant_t v = purc_variant_make_longint(j);
+            purc_variant_array_append(arr, v);
+            purc_variant_unref(v);
+        }
+
+        for (int j = 0; j < NR_MEMBERS; j++) {
+            sink += (uintptr_t)purc_variant_array_get(arr, j);
+        }
+        purc_variant_unref(arr);
+    }
+}
+
+static void run_set_add_unique(size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        purc_variant_t set = purc_variant_make_set_by_ckey(0, "id",
+                PURC_VARIANT_INVALID);
+
+        /* every member is added twice to hit the uniqueness checks */
+        for (int j = 0; j < NR_MEMBERS * 2; j++) {
+            purc_variant_t id = purc_variant_make_longint(j % NR_MEMBERS);
+            purc_variant_t name = purc_variant_make_string_static(
+                    member_keys[j % NR_MEMBERS], false);
+            purc_variant_t obj = purc_variant_make_object_by_static_ckey(2,
+                    "id", id, "name", name);
+            purc_variant_set_add(set, obj, true);
+            purc_variant_unref(obj);
+            purc_variant_unref(name);
+            purc_variant_unref(id);
+        }
+
+        assert(purc_variant_set_get_size(set) == NR_MEMBERS);
+        purc_variant_unref(set);
+    }
+}
+
+/* variant.serialize, ejson.parse, and vcm.eval */
+
+static purc_variant_t sample_value;
+static char serialize_buf[4096];
+
+static bool setup_sample_value(void)
+{
+    sample_value = purc_variant_make_from_json_string(json_sample,
+            strlen(json_sample));
+    return sample_value != PURC_VARIANT_INVALID;
+}
+
+static void run_serialize(size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        purc_rwstream_t rws = purc_rwstream_new_from_mem(serialize_buf,
+                sizeof(serialize_buf));
+        size_t len_expected = 0;
+        sink += purc_variant_serialize(sample_value, rws, 0,
+                PCVARIANT_SERIALIZE_OPT_PLAIN, &len_expected);
+        purc_rwstream_destroy(rws);
+    }
+}
+
+static void teardown_sample_value(void)
+{
+    PURC_VARIANT_SAFE_CLEAR(sample_value);
+}
+
+static struct pcvcm_node *parse_sample(struct pcejson **parser)
+{
+    struct pcvcm_node *root = NULL;
+
+    /* read the end of string as EOF */
+    purc_rwstream_t rws = purc_rwstream_new_from_mem((void *)json_sample,
+            strlen(json_sample) + 1);
+    pcejson_parse(&root, parser, rws, 32);
+    purc_rwstream_destroy(rws);
+
+    return root;
+}
+
+static void run_ejson_parse(size_t n)
+{
+    struct pcejson *parser = NULL;
+
+    for (size_t i = 0; i < n; i++) {
+        struct pcvcm_node *root = parse_sample(&parser);
+        assert(root);
+        pcvcm_node_destroy(root);
+    }
+
+    pcejson_destroy(parser);
+}
+
+static struct pcvcm_node *sample_tree;
+static struct pcejson *sample_parser;
+
+static bool setup_vcm_eval(void)
+{
+    sample_tree = parse_sample(&sample_parser);
+    return sample_tree != NULL;
+}
+
+static void run_vcm_eval(size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        purc_variant_t v = pcvcm_eval(sample_tree, NULL, false);
+        assert(v);
+        purc_variant_unref(v);
+    }
+}
+
+static void teardown_vcm_eval(void)
+{
+    if (sample_tree) {
+        pcvcm_node_destroy(sample_tree);
+        sample_tree = NULL;
+    }
+
+    if (sample_parser) {
+        pcejson_destroy(sample_parser);
+        sample_parser = NULL;
+    }
+}
+
+/* html.* */
+
+static bool setup_html_sample(void)
+{
+    static const char *head =
+        "<!DOCTYPE html>\n<html><head><title>Bench</title></head>"
+        "<body><ul>\n";
+    static const char *tail = "</ul></body></html>\n";
+    const int nr_items = 200;
+
+    size_t sz = strlen(head) + strlen(tail) +
+        (strlen(html_sample_item) + 64) * nr_items;
+    if ((html_sample = malloc(sz)) == NULL)
+        return false;
+
+    char *p = html_sample;
+    p += sprintf(p, "%s", head);
+    for (int i = 0; i < nr_items; i++)
+        p += sprintf(p, html_sample_item, i, i, i, i, i);
+    strcpy(p, tail);
+    return true;
+}
+
+static void teardown_html_sample(void)
+{
+    free(html_sample);
+    html_sample = NULL;
+}
+
+static void run_html_parse(size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML,
+                html_sample, strlen(html_sample));
+        assert(doc);
+        purc_document_delete(doc);
+    }
+}
+
+static purc_document_t html_doc;
+
+static bool setup_html_serialize(void)
+{
+    if (!setup_html_sample())
+        return false;
+
+    html_doc = purc_document_load(PCDOC_K_TYPE_HTML,
+            html_sample, strlen(html_sample));
+    return html_doc != NULL;
+}
+
+static void run_html_serialize(size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        purc_rwstream_t rws = purc_rwstream_new_buffer(4096, 0);
+        purc_document_serialize_contents_to_stream(html_doc,
+                PCDOC_SERIALIZE_OPT_UNDEF, rws);
+        purc_rwstream_destroy(rws);
+    }
+}
+
+static void teardown_html_serialize(void)
+{
+    if (html_doc) {
+        purc_document_delete(html_doc);
+        html_doc = NULL;
+    }
+
+    teardown_html_sample();
+}
+
+/* sched.coroutines */
+
+static const char *hvml_counter =
+    "<hvml><body>"
+    "<iterate on 0 onlyif $L.lt($0<, 100) "
+    "    with $EJSON.arith_calc('+', $0<, 1) nosetotail >"
+    "  <p>$?</p>"
+    "</iterate>"
+    "</body></hvml>";
+
+static void run_sched_coroutines(size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        for (int j = 0; j < NR_COROUTINES; j++) {
+            purc_vdom_t vdom = purc_load_hvml_from_string(hvml_counter);
+            assert(vdom);
+            purc_schedule_vdom_null(vdom);
+        }
+
+        purc_run(NULL);
+    }
+}
+
+/* inst.move_message */
+
+static purc_atom_t main_inst;
+static purc_atom_t echo_inst;
+static pthread_t echo_thread;
+static bool echo_started;
+static sem_t echo_ready;
+
+/* moves every message back to the main instance until a `quit` event */
+static void *echo_entry(void *arg)
+{
+    (void)arg;
+
+    int ret = purc_init_ex(PURC_MODULE_EJSON, DEF_APP_NAME, "echo", NULL);
+    if (ret == PURC_ERROR_OK) {
+        echo_inst = purc_inst_create_move_buffer(
+                PCINST_MOVE_BUFFER_BROADCAST, 16);
+    }
+    sem_post(&echo_ready);
+    if (echo_inst == 0)
+        return NULL;
+
+    for (;;) {
+        size_t n;
+        if (purc_inst_holding_messages_count(&n) || n == 0) {
+            continue;
+        }
+
+        pcrdr_msg *msg = purc_inst_take_away_message(0);
+        bool quit = strcmp(purc_variant_get_string_const(msg->eventName),
+                "quit") == 0;
+        if (!quit)
+            purc_inst_move_message(main_inst, msg);
+        pcrdr_release_message(msg);
+        if (quit)
+            break;
+    }
+
+    purc_inst_destroy_move_buffer();
+    purc_cleanup();
+    return NULL;
+}
+
+static pcrdr_msg *make_event(const char *name)
+{
+    return pcrdr_make_event_message(PCRDR_MSG_TARGET_INSTANCE, 1,
+            name, NULL, PCRDR_MSG_ELEMENT_TYPE_VOID, NULL, NULL,
+            PCRDR_MSG_DATA_TYPE_VOID, NULL, 0);
+}
+
+static bool setup_move_message(void)
+{
+    main_inst = purc_inst_create_move_buffer(PCINST_MOVE_BUFFER_BROADCAST,
+            16);
+    if (main_inst == 0)
+        return false;
+
+    sem_init(&echo_ready, 0, 0);
+    if (pthread_create(&echo_thread, NULL, echo_entry, NULL))
+        return false;
+
+    echo_started = true;
+    sem_wait(&echo_ready);
+    return echo_inst != 0;
+}
+
+/* one iteration is a round trip between two instances */
+static void run_move_message(size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        pcrdr_msg *msg = make_event("ping");
+        purc_inst_move_message(echo_inst, msg);
+        pcrdr_release_message(msg);
+
+        size_t nr;
+        do {
+            if (purc_inst_holding_messages_count(&nr))
+                return;
+        } while (nr == 0);
+
+        pcrdr_release_message(purc_inst_take_away_message(0));
+    }
+}
+
+static void teardown_move_message(void)
+{
+    if (echo_inst) {
+        pcrdr_msg *msg = make_event("quit");
+        purc_inst_move_message(echo_inst, msg);
+        pcrdr_release_message(msg);
+        echo_inst = 0;
+    }
+
+    if (echo_started) {
+        pthread_join(echo_thread, NULL);
+        echo_started = false;
+    }
+
+    if (main_inst) {
+        purc_inst_destroy_move_buffer();
+        sem_destroy(&echo_ready);
+        main_inst = 0;
+    }
+}
+
+static const struct bench_info benchmarks[] = {
+    { "variant.make_number", "make and unref a number",
+        1000000, NULL, run_make_number, NULL },
+    { "variant.make_string", "make and unref a non-static string",
+        1000000, NULL, run_make_string, NULL },
+    { "variant.ref_unref", "ref and unref a string",
+        2000000, setup_ref_unref, run_ref_unref, teardown_shared_value },
+    { "object.set_get", "set and get 64 properties of a new object",
+        10000, setup_keys, run_object_set_get, NULL },
+    { "array.append_get", "append and get 64 members of a new array",
+        10000, NULL, run_array_append_get, NULL },
+    { "set.add_unique", "add 128 objects with 64 unique ids to a set",
+        2000, setup_keys, run_set_add_unique, NULL },
+    { "variant.serialize", "serialize a 0.5KB object to memory",
+        50000, setup_sample_value, run_serialize, teardown_sample_value },
+    { "ejson.parse", "parse a 0.5KB JSON text to a VCM tree",
+        20000, NULL, run_ejson_parse, NULL },
+    { "vcm.eval", "evaluate the VCM tree of a 0.5KB JSON text",
+        20000, setup_vcm_eval, run_vcm_eval, teardown_vcm_eval },
+    { "html.parse", "parse a 30KB HTML document",
+        200, setup_html_sample, run_html_parse, teardown_html_sample },
+    { "html.serialize", "serialize a 30KB HTML document to memory",
+        200, setup_html_serialize, run_html_serialize,
+        teardown_html_serialize },
+    { "sched.coroutines", "run 32 coroutines of 100 iterations each",
+        5, NULL, run_sched_coroutines, NULL },
+    { "inst.move_message", "move an event to another instance and back",
+        20000, setup_move_message, run_move_message, teardown_move_message },
+};
+
+static int cmp_double(const void *a, const void *b)
+{
+    double l = *(const double *)a, r = *(const double *)b;
+    return (l > r) - (l < r);
+}
+
+static bool run_benchmark(const struct bench_info *bench,
+        const struct bench_opts *opts, FILE *fp, bool first)
+{
+    size_t nr_iters = (size_t)(bench->nr_iters * opts->scale);
+    if (nr_iters == 0)
+        nr_iters = 1;
+
+    if (bench->setup && !bench->setup()) {
+        fprintf(stderr, "%-24s skipped: failed to setup\n", bench->name);
+        if (bench->teardown)
+            bench->teardown();
+        return false;
+    }
+
+    /* the first round warms up the caches and the reserved variants */
+    bench->run(nr_iters);
+
+    double ns_per_op[MAX_REPEAT];
+    for (int i = 0; i < opts->repeat; i++) {
+        uint64_t t0 = now_ns();
+        bench->run(nr_iters);
+        ns_per_op[i] = (double)(now_ns() - t0) / nr_iters;
+    }
+
+    if (bench->teardown)
+        bench->teardown();
+
+    qsort(ns_per_op, opts->repeat, sizeof(double), cmp_double);
+
+    double sum = 0;
+    for (int i = 0; i < opts->repeat; i++)
+        sum += ns_per_op[i];
+
+    double min = ns_per_op[0];
+    double max = ns_per_op[opts->repeat - 1];
+    double median = (opts->repeat % 2) ? ns_per_op[opts->repeat / 2] :
+        (ns_per_op[opts->repeat / 2 - 1] + ns_per_op[opts->repeat / 2]) / 2;
+
+    fprintf(stderr, "%-24s %12.1f ns/op (min %.1f, max %.1f, %zu iters)\n",
+            bench->name, median, min, max, nr_iters);
+
+    fprintf(fp, "%s\n    { \"name\": \"%s\", \"desc\": \"%s\", "
+            "\"iterations\": %zu, \"repeat\": %d, "
+            "\"ns_per_op\": { \"min\": %.3f, \"median\": %.3f, "
+            "\"mean\": %.3f, \"max\": %.3f } }",
+            first ? "" : ",", bench->name, bench->desc, nr_iters,
+            opts->repeat, min, median, sum / opts->repeat, max);
+    return true;
+}
+
+static void print_usage(FILE *fp)
+{
+    fputs(
+        "purc_bench (" PURC_VERSION_STRING "): the micro-benchmarks of PurC.\n"
+        "\n"
+        "Usage: purc_bench [ options ... ]\n"
+        "\n"
+        "The following options can be supplied to the command:\n"
+        "\n"
+        "  -f --filter=< substring >\n"
+        "        Run the benchmarks whose names contain the substring only.\n"
+        "\n"
+        "  -r --repeat=< number >\n"
+        "        The number of the timed repetitions of every benchmark;\n"
+        "        default value is 5.\n"
+        "\n"
+        "  -s --scale=< factor >\n"
+        "        Multiply the number of iterations by the factor.\n"
+        "\n"
+        "  -o --output=< file >\n"
+        "        Write the results in JSON to the file instead of stdout.\n"
+        "        Use `bench_compare.py` to compare two result files.\n"
+        "\n"
+        "  -l --list\n"
+        "        List the benchmarks and exit.\n"
+        "\n"
+        "  -h --help\n"
+        "        This help.\n",
+        fp);
+}
+
+static int read_option_args(struct bench_opts *opts, int argc, char **argv)
+{
+    static const char short_options[] = "f:r:s:o:lh";
+    static const struct option long_opts[] = {
+        { "filter"  , required_argument , NULL , 'f' },
+        { "repeat"  , required_argument , NULL , 'r' },
+        { "scale"   , required_argument , NULL , 's' },
+        { "output"  , required_argument , NULL , 'o' },
+        { "list"    , no_argument       , NULL , 'l' },
+        { "help"    , no_argument       , NULL , 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    int o, idx = 0;
+    while ((o = getopt_long(argc, argv, short_options, long_opts, &idx)) >= 0) {
+        switch (o) {
+        case 'f':
+            opts->filter = optarg;
+            break;
+
+        case 'r':
+            opts->repeat = atoi(optarg);
+            if (opts->repeat <= 0 || opts->repeat > MAX_REPEAT)
+                goto bad_arg;
+            break;
+
+        case 's':
+            opts->scale = atof(optarg);
+            if (opts->scale <= 0)
+                goto bad_arg;
+            break;
+
+        case 'o':
+            opts->output = optarg;
+            break;
+
+        case 'l':
+            opts->list = true;
+            break;
+
+        case 'h':
+            print_usage(stdout);
+            return 1;
+
+        default:
+            goto bad_arg;
+        }
+    }
+
+    return 0;
+
+bad_arg:
+    print_usage(stderr);
+    return -1;
+}
+
+int main(int argc, char **argv)
+{
+    struct bench_opts opts = { NULL, NULL, 1.0, DEF_REPEAT, false };
+
+    int ret = read_option_args(&opts, argc, argv);
+    if (ret)
+        return ret > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    if (opts.list) {
+        for (size_t i = 0; i < PCA_TABLESIZE(benchmarks); i++)
+            printf("%-24s %s\n", benchmarks[i].name, benchmarks[i].desc);
+        return EXIT_SUCCESS;
+    }
+
+    ret = purc_init_ex(PURC_MODULE_HVML ^ PURC_HAVE_FETCHER, DEF_APP_NAME,
+            DEF_RUN_NAME, NULL);
+    if (ret != PURC_ERROR_OK) {
+        fprintf(stderr, "Failed to initialize the PurC instance: %s\n",
+                purc_get_error_message(ret));
+        return EXIT_FAILURE;
+    }
+
+    FILE *fp = stdout;
+    if (opts.output && (fp = fopen(opts.output, "w")) == NULL) {
+        perror(opts.output);
+        purc_cleanup();
+        return EXIT_FAILURE;
+    }
+
+    fprintf(fp, "{\n  \"purc_version\": \"%s\",\n  \"scale\": %g,\n"
+            "  \"benchmarks\": [", PURC_VERSION_STRING, opts.scale);
+
+    bool first = true;
+    for (size_t i = 0; i < PCA_TABLESIZE(benchmarks); i++) {
+        if (opts.filter && strstr(benchmarks[i].name, opts.filter) == NULL)
+            continue;
+
+        if (run_benchmark(benchmarks + i, &opts, fp, first))
+            first = false;
+    }
+
+    fputs("\n  ]\n}\n", fp);
+    if (fp != stdout)
+        fclose(fp);
+
+    purc_cleanup();
+    return EXIT_SUCCESS;
+}
+
@@ -32,6 +32,7 @@
 #include <dirent.h>
 #include <errno.h>
 #include <math.h>
+#include <chrono>
 #include <gtest/gtest.h>
 
 extern purc_variant_t get_variant (char *buf, size_t *length);
@@ -287,6 +288,158 @@ TEST(dvobjs, dvobjs_logical_eval)
     purc_cleanup ();
 }
 
+static purc_variant_t
+make_xy(double x, double y)
+{
+    purc_variant_t vx = purc_variant_make_number(x);
+    purc_variant_t vy = purc_variant_make_number(y);
+    purc_variant_t obj = purc_variant_make_object_by_static_ckey(2,
+            "x", vx, "y", vy);
+    purc_variant_unref(vx);
+    purc_variant_unref(vy);
+    return obj;
+}
+
+TEST(dvobjs, dvobjs_logical_eval_variables)
+{
+    purc_variant_t param[MAX_PARAM_NR];
+    purc_variant_t ret_var = NULL;
+
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex (PURC_MODULE_EJSON, "cn.fmsoft.hvml.test",
+            "dvobjs", &info);
+    ASSERT_EQ (ret, PURC_ERROR_OK);
+
+    purc_variant_t logical = purc_dvobj_logical_new();
+    ASSERT_NE(logical, nullptr);
+
+    purc_variant_t dynamic = purc_variant_object_get_by_ckey (logical, "eval");
+    purc_dvariant_method func = purc_variant_dynamic_get_getter (dynamic);
+    ASSERT_NE(func, nullptr);
+
+    param[0] = purc_variant_make_string ("x > 2 && (y < 10 || !(x != 5))",
+            false);
+
+    /* the same compiled expression for different values */
+    struct { double x, y; bool result; } cases[] = {
+        { 1, 1, false },
+        { 3, 9, true },
+        { 3, 11, false },
+        { 5, 11, true },
+    };
+    for (size_t i = 0; i < PCA_TABLESIZE (cases); i++) {
+        param[1] = make_xy(cases[i].x, cases[i].y);
+        ret_var = func (NULL, 2, param, false);
+        ASSERT_NE(ret_var, nullptr);
+        ASSERT_EQ(purc_variant_is_type (ret_var,
+                    PURC_VARIANT_TYPE_BOOLEAN), true);
+        ASSERT_EQ(cases[i].result, ret_var->b) << "case " << i;
+        purc_variant_unref(ret_var);
+        purc_variant_unref(param[1]);
+    }
+
+    /* evaluate for every object in an array */
+    param[1] = purc_variant_make_array(0, PURC_VARIANT_INVALID);
+    for (size_t i = 0; i < PCA_TABLESIZE (cases); i++) {
+        purc_variant_t obj = make_xy(cases[i].x, cases[i].y);
+        purc_variant_array_append(param[1], obj);
+        purc_variant_unref(obj);
+    }
+    ret_var = func (NULL, 2, param, false);
+    ASSERT_NE(ret_var, nullptr);
+    ASSERT_EQ(purc_variant_is_array (ret_var), true);
+    ASSERT_EQ(purc_variant_array_get_size (ret_var), PCA_TABLESIZE (cases));
+    for (size_t i = 0; i < PCA_TABLESIZE (cases); i++) {
+        purc_variant_t v = purc_variant_array_get (ret_var, i);
+        ASSERT_EQ(cases[i].result, v->b) << "item " << i;
+    }
+    purc_variant_unref(ret_var);
+
+    /* an item which is not an object */
+    purc_variant_t num = purc_variant_make_number(1);
+    purc_variant_array_append(param[1], num);
+    purc_variant_unref(num);
+    ret_var = func (NULL, 2, param, false);
+    ASSERT_EQ(ret_var, nullptr);
+    ASSERT_EQ(purc_get_last_error(), PURC_ERROR_WRONG_DATA_TYPE);
+    purc_variant_unref(param[1]);
+
+    /* an undefined variable makes false */
+    param[1] = make_xy(3, 9);
+    purc_variant_unref(param[0]);
+    param[0] = purc_variant_make_string ("z > 0 || x > 2", false);
+    ret_var = func (NULL, 2, param, false);
+    ASSERT_NE(ret_var, nullptr);
+    ASSERT_EQ(ret_var->b, false);
+    purc_variant_unref(ret_var);
+
+    purc_variant_unref(param[0]);
+    purc_variant_unref(param[1]);
+    purc_variant_unref(logical);
+
+    purc_cleanup ();
+}
+
+/* Compares evaluating one expression over and over (compiled once) with
+   evaluating distinct expressions (compiled every time). Set the number of
+   the evaluations with LOGICAL_EVAL_TIMES. */
+TEST(dvobjs, dvobjs_logical_eval_perf)
+{
+    size_t times = 20000;
+    const char *env = getenv("LOGICAL_EVAL_TIMES");
+    if (env)
+        times = strtoul(env, NULL, 10);
+
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex (PURC_MODULE_EJSON, "cn.fmsoft.hvml.test",
+            "dvobjs", &info);
+    ASSERT_EQ (ret, PURC_ERROR_OK);
+
+    purc_variant_t logical = purc_dvobj_logical_new();
+    ASSERT_NE(logical, nullptr);
+
+    purc_variant_t dynamic = purc_variant_object_get_by_ckey (logical, "eval");
+    purc_dvariant_method func = purc_variant_dynamic_get_getter (dynamic);
+    ASSERT_NE(func, nullptr);
+
+    purc_variant_t param[2];
+    param[1] = make_xy(3, 9);
+
+    /* more distinct expressions than the cache can hold */
+    const size_t nr_exps = 100;
+    purc_variant_t exps[nr_exps];
+    std::string exp = "(x > 2 && y < 10) || (x == 5 && y >= 1)";
+    for (size_t i = 0; i < nr_exps; i++) {
+        exps[i] = purc_variant_make_string (exp.c_str(), false);
+        exp += " ";
+    }
+
+    double elapsed[2];
+    for (int round = 0; round < 2; round++) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < times; i++) {
+            param[0] = exps[round ? i % nr_exps : 0];
+            purc_variant_t ret_var = func (NULL, 2, param, false);
+            ASSERT_NE(ret_var, nullptr);
+            ASSERT_EQ(ret_var->b, true);
+            purc_variant_unref(ret_var);
+        }
+        std::chrono::duration<double> d =
+            std::chrono::steady_clock::now() - start;
+        elapsed[round] = d.count();
+    }
+
+    fprintf(stderr, "$L.eval %zu times: the same expression %.3f s, "
+            "distinct expressions %.3f s\n", times, elapsed[0], elapsed[1]);
+
+    for (size_t i = 0; i < nr_exps; i++)
+        purc_variant_unref(exps[i]);
+    purc_variant_unref(param[1]);
+    purc_variant_unref(logical);
+
+    purc_cleanup ();
+}
+
 static void
 _trim_tail_spaces(char *dest, size_t n)
 {
@@ -34,8 +34,13 @@
 
 #include <stdio.h>
 #include <errno.h>
+#include <unistd.h>
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <string>
+#include <vector>
+
 extern purc_variant_t get_variant (char *buf, size_t *length);
 extern void get_variant_total_info (size_t *mem, size_t *value, size_t *resv);
 #define MAX_PARAM_NR    20
@@ -232,6 +237,215 @@ TEST(dvobjs, dvobjs_file_text_tail)
     purc_cleanup ();
 }
 
+static void check_lines (purc_dvariant_method func, const char *filename,
+        int64_t line_num, const std::vector<std::string> &expected)
+{
+    purc_variant_t param[2];
+    param[0] = purc_variant_make_string (filename, false);
+    param[1] = purc_variant_make_longint (line_num);
+
+    purc_variant_t ret_var = func (NULL, 2, param, false);
+    ASSERT_NE(ret_var, nullptr);
+
+    size_t nr_lines;
+    ASSERT_TRUE(purc_variant_array_size (ret_var, &nr_lines));
+    ASSERT_EQ(nr_lines, expected.size()) << "line_num: " << line_num;
+    for (size_t i = 0; i < nr_lines; i++) {
+        purc_variant_t line = purc_variant_array_get (ret_var, i);
+        ASSERT_STREQ(purc_variant_get_string_const (line),
+                expected[i].c_str()) << "line_num: " << line_num;
+    }
+
+    purc_variant_unref (param[0]);
+    purc_variant_unref (param[1]);
+    purc_variant_unref (ret_var);
+}
+
+static std::string make_text_file (const char *content)
+{
+    char filename[] = "/tmp/purc-file-text-XXXXXX";
+    int fd = mkstemp (filename);
+    if (fd < 0)
+        return std::string();
+
+    size_t len = strlen (content);
+    if (write (fd, content, len) != (ssize_t)len) {
+        close (fd);
+        unlink (filename);
+        return std::string();
+    }
+
+    close (fd);
+    return filename;
+}
+
+TEST(dvobjs, dvobjs_file_text_lines)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex (PURC_MODULE_EJSON, "cn.fmsoft.hvml.test",
+            "dvobjs", &info);
+    ASSERT_EQ (ret, PURC_ERROR_OK);
+
+    setenv(PURC_ENVV_DVOBJS_PATH, SOPATH, 1);
+    purc_variant_t file = purc_variant_load_dvobj_from_so ("FS", "FILE");
+    ASSERT_NE(file, nullptr);
+
+    purc_variant_t text = purc_variant_object_get_by_ckey (file, "text");
+    ASSERT_NE(text, nullptr);
+    purc_dvariant_method head = purc_variant_dynamic_get_getter (
+            purc_variant_object_get_by_ckey (text, "head"));
+    ASSERT_NE(head, nullptr);
+    purc_dvariant_method tail = purc_variant_dynamic_get_getter (
+            purc_variant_object_get_by_ckey (text, "tail"));
+    ASSERT_NE(tail, nullptr);
+
+    // the same lines with and without the trailing newline, and with CRLF.
+    const char *contents[] = {
+        "first\nsecond\n\nfourth\n",
+        "first\nsecond\n\nfourth",
+        "first\r\nsecond\r\n\r\nfourth\r\n",
+    };
+
+    for (size_t i = 0; i < PCA_TABLESIZE(contents); i++) {
+        std::string filename = make_text_file (contents[i]);
+        ASSERT_FALSE(filename.empty());
+
+        const char *name = filename.c_str();
+        check_lines (head, name, 0, { "first", "second", "", "fourth" });
+        check_lines (head, name, 1, { "first" });
+        check_lines (head, name, 3, { "first", "second", "" });
+        check_lines (head, name, 10, { "first", "second", "", "fourth" });
+        check_lines (head, name, -1, { "first", "second", "" });
+        check_lines (head, name, -3, { "first" });
+        check_lines (head, name, -4, { });
+        check_lines (head, name, -10, { });
+
+        check_lines (tail, name, 0, { "first", "second", "", "fourth" });
+        check_lines (tail, name, 1, { "fourth" });
+        check_lines (tail, name, 3, { "second", "", "fourth" });
+        check_lines (tail, name, 4, { "first", "second", "", "fourth" });
+        check_lines (tail, name, 10, { "first", "second", "", "fourth" });
+        check_lines (tail, name, -1, { "second", "", "fourth" });
+        check_lines (tail, name, -3, { "fourth" });
+        check_lines (tail, name, -4, { });
+
+        unlink (name);
+    }
+
+    std::string filename = make_text_file ("");
+    ASSERT_FALSE(filename.empty());
+    check_lines (head, filename.c_str(), 3, { });
+    check_lines (tail, filename.c_str(), 3, { });
+    unlink (filename.c_str());
+
+    filename = make_text_file ("\n");
+    ASSERT_FALSE(filename.empty());
+    check_lines (head, filename.c_str(), 0, { "" });
+    check_lines (tail, filename.c_str(), 1, { "" });
+    check_lines (tail, filename.c_str(), -1, { });
+    unlink (filename.c_str());
+
+    purc_variant_unload_dvobj (file);
+    purc_cleanup ();
+}
+
+// text.tail and text.head on a large file; set the size in MiB with
+// FILE_TEXT_MB
+TEST(dvobjs, dvobjs_file_text_tail_perf)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex (PURC_MODULE_EJSON, "cn.fmsoft.hvml.test",
+            "dvobjs", &info);
+    ASSERT_EQ (ret, PURC_ERROR_OK);
+
+    setenv(PURC_ENVV_DVOBJS_PATH, SOPATH, 1);
+    purc_variant_t file = purc_variant_load_dvobj_from_so ("FS", "FILE");
+    ASSERT_NE(file, nullptr);
+
+    purc_variant_t text = purc_variant_object_get_by_ckey (file, "text");
+    ASSERT_NE(text, nullptr);
+    purc_dvariant_method head = purc_variant_dynamic_get_getter (
+            purc_variant_object_get_by_ckey (text, "head"));
+    ASSERT_NE(head, nullptr);
+    purc_dvariant_method tail = purc_variant_dynamic_get_getter (
+            purc_variant_object_get_by_ckey (text, "tail"));
+    ASSERT_NE(tail, nullptr);
+
+    size_t mb = 16;
+    const char *env = getenv ("FILE_TEXT_MB");
+    if (env)
+        mb = strtoul (env, NULL, 10);
+
+    char filename[] = "/tmp/purc-file-text-XXXXXX";
+    int fd = mkstemp (filename);
+    ASSERT_GE(fd, 0);
+
+    // 64-byte lines
+    char line[65];
+    size_t nr_lines = mb * 1024 * 1024 / 64;
+    std::string chunk;
+    for (size_t i = 0; i < nr_lines; i++) {
+        snprintf (line, sizeof(line), "%-63zu\n", i);
+        chunk += line;
+        if (chunk.size() >= 1024 * 1024 || i == nr_lines - 1) {
+            ASSERT_EQ(write (fd, chunk.data(), chunk.size()),
+                    (ssize_t)chunk.size());
+            chunk.clear();
+        }
+    }
+    close (fd);
+
+    purc_variant_t param[2];
+    param[0] = purc_variant_make_string (filename, false);
+    param[1] = purc_variant_make_number (10);
+
+    auto start = std::chrono::steady_clock::now();
+    purc_variant_t ret_var = tail (NULL, 2, param, false);
+    std::chrono::duration<double> tail_elapsed =
+        std::chrono::steady_clock::now() - start;
+    ASSERT_NE(ret_var, nullptr);
+
+    size_t sz;
+    ASSERT_TRUE(purc_variant_array_size (ret_var, &sz));
+    ASSERT_EQ(sz, 10);
+    snprintf (line, sizeof(line), "%-63zu", nr_lines - 1);
+    ASSERT_STREQ(purc_variant_get_string_const (
+                purc_variant_array_get (ret_var, 9)), line);
+    purc_variant_unref (ret_var);
+
+    start = std::chrono::steady_clock::now();
+    ret_var = head (NULL, 2, param, false);
+    std::chrono::duration<double> head_elapsed =
+        std::chrono::steady_clock::now() - start;
+    ASSERT_NE(ret_var, nullptr);
+    ASSERT_TRUE(purc_variant_array_size (ret_var, &sz));
+    ASSERT_EQ(sz, 10);
+    purc_variant_unref (ret_var);
+    purc_variant_unref (param[1]);
+
+    // all but the last line: the whole file is split into lines.
+    param[1] = purc_variant_make_number (-1);
+    start = std::chrono::steady_clock::now();
+    ret_var = head (NULL, 2, param, false);
+    std::chrono::duration<double> all_elapsed =
+        std::chrono::steady_clock::now() - start;
+    ASSERT_NE(ret_var, nullptr);
+    ASSERT_TRUE(purc_variant_array_size (ret_var, &sz));
+    ASSERT_EQ(sz, nr_lines - 1);
+    purc_variant_unref (ret_var);
+
+    fprintf (stderr, "text of %zu MiB: tail(10) %.6f s, head(10) %.6f s, "
+            "head(-1) %.3f s\n", mb, tail_elapsed.count(),
+            head_elapsed.count(), all_elapsed.count());
+
+    purc_variant_unref (param[0]);
+    purc_variant_unref (param[1]);
+    unlink (filename);
+
+    purc_variant_unload_dvobj (file);
+    purc_cleanup ();
+}
+
 TEST(dvobjs, dvobjs_file_bin_head)
 {
     purc_variant_t param[MAX_PARAM_NR];
@@ -32,6 +32,8 @@
 
 #include <stdio.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <chrono>
 #include <gtest/gtest.h>
 
 extern void get_variant_total_info (size_t *mem, size_t *value, size_t *resv);
@@ -1484,3 +1486,277 @@ TEST(dvobjs, dvobjs_fs_read)
 TEST(dvobjs, dvobjs_fs_rewind)
 {
 }
+
+static purc_variant_t
+call_job_property(purc_variant_t job, const char *name)
+{
+    struct purc_native_ops *ops = purc_variant_native_get_ops (job);
+    purc_nvariant_method method = ops->property_getter (name);
+    if (method == NULL)
+        return PURC_VARIANT_INVALID;
+    return method (purc_variant_native_get_entity (job), 0, NULL, false);
+}
+
+// copy_async; set the size of the file to copy in MiB with FS_COPY_MB
+TEST(dvobjs, dvobjs_fs_copy_async)
+{
+    purc_variant_t param[MAX_PARAM_NR];
+
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex (PURC_MODULE_EJSON, "cn.fmsoft.hvml.test",
+            "dvobjs", &info);
+    ASSERT_EQ (ret, PURC_ERROR_OK);
+
+    setenv(PURC_ENVV_DVOBJS_PATH, SOPATH, 1);
+    purc_variant_t fs = purc_variant_load_dvobj_from_so (NULL, "FS");
+    ASSERT_NE(fs, nullptr);
+
+    purc_dvariant_method copy_async = purc_variant_dynamic_get_getter (
+            purc_variant_object_get_by_ckey (fs, "copy_async"));
+    ASSERT_NE(copy_async, nullptr);
+    purc_dvariant_method copy = purc_variant_dynamic_get_getter (
+            purc_variant_object_get_by_ckey (fs, "copy"));
+    ASSERT_NE(copy, nullptr);
+
+    size_t mb = 16;
+    const char *env = getenv ("FS_COPY_MB");
+    if (env)
+        mb = strtoul (env, NULL, 10);
+
+    char src[] = "/tmp/purc-fs-copy-XXXXXX";
+    int fd = mkstemp (src);
+    ASSERT_GE(fd, 0);
+    char *buf = (char *)malloc (1024 * 1024);
+    for (size_t i = 0; i < 1024 * 1024; i++)
+        buf[i] = (char)(i * 31 + 7);
+    for (size_t i = 0; i < mb; i++)
+        ASSERT_EQ(write (fd, buf, 1024 * 1024), 1024 * 1024);
+    close (fd);
+
+    std::string dst = std::string(src) + ".copy";
+    param[0] = purc_variant_make_string (src, false);
+    param[1] = purc_variant_make_string (dst.c_str(), false);
+
+    auto start = std::chrono::steady_clock::now();
+    purc_variant_t job = copy_async (NULL, 2, param, false);
+    ASSERT_NE(job, nullptr);
+    ASSERT_EQ(purc_variant_is_native (job), true);
+
+    purc_variant_t result = call_job_property (job, "wait");
+    std::chrono::duration<double> async_elapsed =
+        std::chrono::steady_clock::now() - start;
+    ASSERT_NE(result, nullptr);
+    uint64_t copied = 0;
+    ASSERT_EQ(purc_variant_cast_to_ulongint (result, &copied, false), true);
+    ASSERT_EQ(copied, mb * 1024 * 1024);
+    purc_variant_unref (result);
+
+    result = call_job_property (job, "state");
+    ASSERT_STREQ(purc_variant_get_string_const (result), "done");
+    purc_variant_unref (result);
+    purc_variant_unref (job);
+
+    // verify the copy
+    fd = open (dst.c_str(), O_RDONLY);
+    ASSERT_GE(fd, 0);
+    char *copied_buf = (char *)malloc (1024 * 1024);
+    for (size_t i = 0; i < mb; i++) {
+        ASSERT_EQ(read (fd, copied_buf, 1024 * 1024), 1024 * 1024);
+        ASSERT_EQ(memcmp (buf, copied_buf, 1024 * 1024), 0);
+    }
+    ASSERT_EQ(read (fd, copied_buf, 1), 0);
+    close (fd);
+    free (copied_buf);
+    free (buf);
+
+    start = std::chrono::steady_clock::now();
+    result = copy (NULL, 2, param, false);
+    std::chrono::duration<double> sync_elapsed =
+        std::chrono::steady_clock::now() - start;
+    ASSERT_NE(result, nullptr);
+    ASSERT_EQ(purc_variant_booleanize (result), true);
+    purc_variant_unref (result);
+
+    fprintf (stderr, "copy %zu MiB: copy_async %.3f s, copy %.3f s\n",
+            mb, async_elapsed.count(), sync_elapsed.count());
+
+    unlink (dst.c_str());
+    unlink (src);
+    purc_variant_unref (param[0]);
+    purc_variant_unref (param[1]);
+
+    // an error is reported by `wait`
+    param[0] = purc_variant_make_string ("/abcdefg/123", false);
+    param[1] = purc_variant_make_string ("/abcdefg/456", false);
+    job = copy_async (NULL, 2, param, false);
+    ASSERT_NE(job, nullptr);
+    result = call_job_property (job, "wait");
+    ASSERT_NE(result, nullptr);
+    ASSERT_EQ(purc_variant_is_false (result), true);
+    ASSERT_EQ(purc_get_last_error (), PURC_ERROR_ENTITY_NOT_FOUND);
+    purc_variant_unref (result);
+
+    result = call_job_property (job, "state");
+    ASSERT_STREQ(purc_variant_get_string_const (result), "failed");
+    purc_variant_unref (result);
+    purc_variant_unref (job);
+    purc_variant_unref (param[0]);
+    purc_variant_unref (param[1]);
+
+    purc_variant_unload_dvobj (fs);
+    purc_cleanup ();
+}
+
+// list_async
+TEST(dvobjs, dvobjs_fs_list_async)
+{
+    purc_variant_t param[MAX_PARAM_NR];
+
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex (PURC_MODULE_EJSON, "cn.fmsoft.hvml.test",
+            "dvobjs", &info);
+    ASSERT_EQ (ret, PURC_ERROR_OK);
+
+    setenv(PURC_ENVV_DVOBJS_PATH, SOPATH, 1);
+    purc_variant_t fs = purc_variant_load_dvobj_from_so (NULL, "FS");
+    ASSERT_NE(fs, nullptr);
+
+    purc_dvariant_method list_async = purc_variant_dynamic_get_getter (
+            purc_variant_object_get_by_ckey (fs, "list_async"));
+    ASSERT_NE(list_async, nullptr);
+    purc_dvariant_method list = purc_variant_dynamic_get_getter (
+            purc_variant_object_get_by_ckey (fs, "list"));
+    ASSERT_NE(list, nullptr);
+
+    char data_path[PATH_MAX+1];
+    test_getpath_from_env_or_rel(data_path, sizeof(data_path),
+        "DVOBJS_TEST_PATH", "test_files");
+    std::string dir = std::string(data_path) + "/fs";
+
+    const char *filters[] = { NULL, "*.md", "*.test;*.md" };
+    for (size_t i = 0; i < PCA_TABLESIZE(filters); i++) {
+        size_t nr_args = 1;
+        param[0] = purc_variant_make_string (dir.c_str(), false);
+        if (filters[i]) {
+            param[1] = purc_variant_make_string (filters[i], false);
+            nr_args = 2;
+        }
+
+        purc_variant_t expected = list (NULL, nr_args, param, false);
+        ASSERT_NE(expected, nullptr);
+
+        purc_variant_t job = list_async (NULL, nr_args, param, false);
+        ASSERT_NE(job, nullptr);
+        purc_variant_t result = call_job_property (job, "wait");
+        ASSERT_NE(result, nullptr);
+        ASSERT_EQ(purc_variant_is_array (result), true);
+
+        // the same entries, though maybe in a different order
+        size_t sz = purc_variant_array_get_size (expected);
+        ASSERT_EQ(purc_variant_array_get_size (result), sz);
+        for (size_t j = 0; j < sz; j++) {
+            purc_variant_t exp_obj = purc_variant_array_get (expected, j);
+            const char *name = purc_variant_get_string_const (
+                    purc_variant_object_get_by_ckey (exp_obj, "name"));
+
+            bool found = false;
+            for (size_t k = 0; k < sz; k++) {
+                purc_variant_t obj = purc_variant_array_get (result, k);
+                const char *n = purc_variant_get_string_const (
+                        purc_variant_object_get_by_ckey (obj, "name"));
+                if (strcmp (name, n) == 0) {
+                    ASSERT_EQ(purc_variant_is_equal_to (obj, exp_obj), true)
+                        << name;
+                    found = true;
+                    break;
+                }
+            }
+            ASSERT_EQ(found, true) << name;
+        }
+
+        purc_variant_unref (result);
+        purc_variant_unref (job);
+        purc_variant_unref (expected);
+        purc_variant_unref (param[0]);
+        if (filters[i])
+            purc_variant_unref (param[1]);
+    }
+
+    // a job released before finished is cancelled
+    param[0] = purc_variant_make_string (dir.c_str(), false);
+    purc_variant_t job = list_async (NULL, 1, param, false);
+    ASSERT_NE(job, nullptr);
+    purc_variant_unref (job);
+    purc_variant_unref (param[0]);
+
+    purc_variant_unload_dvobj (fs);
+    purc_cleanup ();
+}
+
+static size_t nr_listed_by_coroutine;
+
+static int list_async_cond_handler (purc_cond_t event, purc_coroutine_t cor,
+        void *data)
+{
+    (void)cor;
+
+    if (event == PURC_COND_COR_EXITED) {
+        struct purc_cor_exit_info *info = (struct purc_cor_exit_info *)data;
+        if (info->result && purc_variant_is_array (info->result))
+            nr_listed_by_coroutine = purc_variant_array_get_size (info->result);
+    }
+
+    return 0;
+}
+
+// the completion of list_async is observed by the coroutine
+TEST(dvobjs, dvobjs_fs_list_async_observe)
+{
+    purc_variant_t param[MAX_PARAM_NR];
+
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex (PURC_MODULE_HVML, "cn.fmsoft.hvml.test",
+            "dvobjs", &info);
+    ASSERT_EQ (ret, PURC_ERROR_OK);
+
+    setenv(PURC_ENVV_DVOBJS_PATH, SOPATH, 1);
+
+    char data_path[PATH_MAX+1];
+    test_getpath_from_env_or_rel(data_path, sizeof(data_path),
+        "DVOBJS_TEST_PATH", "test_files");
+    std::string dir = std::string(data_path) + "/fs";
+
+    // the expected number of the entries
+    purc_variant_t fs = purc_variant_load_dvobj_from_so (NULL, "FS");
+    ASSERT_NE(fs, nullptr);
+    purc_dvariant_method list = purc_variant_dynamic_get_getter (
+            purc_variant_object_get_by_ckey (fs, "list"));
+    ASSERT_NE(list, nullptr);
+    param[0] = purc_variant_make_string (dir.c_str(), false);
+    purc_variant_t expected = list (NULL, 1, param, false);
+    ASSERT_NE(expected, nullptr);
+    size_t nr_expected = purc_variant_array_get_size (expected);
+    purc_variant_unref (expected);
+    purc_variant_unref (param[0]);
+    purc_variant_unload_dvobj (fs);
+
+    std::string hvml =
+        "<!DOCTYPE hvml SYSTEM \"v: FS\">"
+        "<hvml target=\"void\">"
+        "    <init as=\"job\" with=$FS.list_async('" + dir + "') />"
+        "    <observe on=$job for=\"job:done\">"
+        "        <exit with=$? />"
+        "    </observe>"
+        "</hvml>";
+
+    nr_listed_by_coroutine = 0;
+    purc_vdom_t vdom = purc_load_hvml_from_string (hvml.c_str());
+    ASSERT_NE(vdom, nullptr);
+    purc_schedule_vdom_null (vdom);
+
+    purc_run ((purc_cond_handler)list_async_cond_handler);
+    ASSERT_EQ(nr_listed_by_coroutine, nr_expected);
+    ASSERT_GT(nr_expected, 0);
+
+    purc_cleanup ();
+}
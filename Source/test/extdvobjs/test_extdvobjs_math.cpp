@@ -38,6 +38,7 @@
 #include "../helpers.h"
 
 #include <stdio.h>
+#include <chrono>
 #include <dirent.h>
 #include <errno.h>
 
@@ -849,6 +850,144 @@ TEST(dvobjs, dvobjs_math_eval)
     purc_cleanup ();
 }
 
+TEST(dvobjs, dvobjs_math_eval_batch)
+{
+    purc_variant_t param[MAX_PARAM_NR];
+    purc_variant_t ret_var = NULL;
+    double number;
+    long double numberl;
+
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_EJSON, "cn.fmsoft.hvml.test",
+            "dvobjs", &info);
+    ASSERT_EQ (ret, PURC_ERROR_OK);
+
+    setenv(PURC_ENVV_DVOBJS_PATH, SOPATH, 1);
+    purc_variant_t math = purc_variant_load_dvobj_from_so (NULL, "MATH");
+    ASSERT_NE(math, nullptr);
+
+    purc_variant_t dynamic = purc_variant_object_get_by_ckey (math, "eval");
+    purc_dvariant_method func = purc_variant_dynamic_get_getter (dynamic);
+    ASSERT_NE(func, nullptr);
+    dynamic = purc_variant_object_get_by_ckey (math, "eval_l");
+    purc_dvariant_method func_l = purc_variant_dynamic_get_getter (dynamic);
+    ASSERT_NE(func_l, nullptr);
+
+    param[0] = purc_variant_make_string ("PI * r * r + 1", false);
+    param[1] = purc_variant_make_array (0, PURC_VARIANT_INVALID);
+    for (int i = 0; i < 4; i++) {
+        purc_variant_t r = purc_variant_make_number(i);
+        purc_variant_t obj = purc_variant_make_object_by_static_ckey (1,
+                "r", r);
+        purc_variant_array_append (param[1], obj);
+        purc_variant_unref(obj);
+        purc_variant_unref(r);
+    }
+
+    /* `PI` is not given: the predefined one is used */
+    ret_var = func (NULL, 2, param, false);
+    ASSERT_NE(ret_var, nullptr);
+    ASSERT_EQ(purc_variant_is_array (ret_var), true);
+    ASSERT_EQ(purc_variant_array_get_size (ret_var), 4);
+    for (int i = 0; i < 4; i++) {
+        purc_variant_cast_to_number (purc_variant_array_get (ret_var, i),
+                &number, false);
+        ASSERT_DOUBLE_EQ(number, M_PI * i * i + 1);
+    }
+    purc_variant_unref(ret_var);
+
+    ret_var = func_l (NULL, 2, param, false);
+    ASSERT_NE(ret_var, nullptr);
+    ASSERT_EQ(purc_variant_is_array (ret_var), true);
+    ASSERT_EQ(purc_variant_array_get_size (ret_var), 4);
+    for (int i = 0; i < 4; i++) {
+        purc_variant_t v = purc_variant_array_get (ret_var, i);
+        ASSERT_EQ(purc_variant_is_type (v, PURC_VARIANT_TYPE_LONGDOUBLE),
+                true);
+        purc_variant_cast_to_longdouble (v, &numberl, false);
+        ASSERT_NEAR((double)numberl, M_PI * i * i + 1, 1e-9);
+    }
+    purc_variant_unref(ret_var);
+    purc_variant_unref(param[0]);
+
+    /* an error for any item fails the whole call */
+    param[0] = purc_variant_make_string ("1 / r", false);
+    ret_var = func (NULL, 2, param, false);
+    ASSERT_EQ(ret_var, nullptr);
+    purc_variant_unref(param[0]);
+    purc_variant_unref(param[1]);
+
+    /* a malformed expression */
+    param[0] = purc_variant_make_string ("1 +", false);
+    ret_var = func (NULL, 1, param, false);
+    ASSERT_EQ(ret_var, nullptr);
+    purc_variant_unref(param[0]);
+
+    purc_variant_unload_dvobj (math);
+    purc_cleanup ();
+}
+
+/* Compares evaluating one expression over and over (compiled once) with
+   evaluating distinct expressions (compiled every time). Set the number of
+   the evaluations with MATH_EVAL_TIMES. */
+TEST(dvobjs, dvobjs_math_eval_perf)
+{
+    size_t times = 20000;
+    const char *env = getenv("MATH_EVAL_TIMES");
+    if (env)
+        times = strtoul(env, NULL, 10);
+
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_EJSON, "cn.fmsoft.hvml.test",
+            "dvobjs", &info);
+    ASSERT_EQ (ret, PURC_ERROR_OK);
+
+    setenv(PURC_ENVV_DVOBJS_PATH, SOPATH, 1);
+    purc_variant_t math = purc_variant_load_dvobj_from_so (NULL, "MATH");
+    ASSERT_NE(math, nullptr);
+
+    purc_variant_t dynamic = purc_variant_object_get_by_ckey (math, "eval");
+    purc_dvariant_method func = purc_variant_dynamic_get_getter (dynamic);
+    ASSERT_NE(func, nullptr);
+
+    purc_variant_t param[2];
+    purc_variant_t x = purc_variant_make_number(2);
+    param[1] = purc_variant_make_object_by_static_ckey (1, "x", x);
+    purc_variant_unref(x);
+
+    /* more distinct expressions than the cache can hold */
+    const size_t nr_exps = 100;
+    purc_variant_t exps[nr_exps];
+    std::string exp = "(x * 3 + sqrt(16)) / 2 - max(x, 1) ^ 2";
+    for (size_t i = 0; i < nr_exps; i++) {
+        exps[i] = purc_variant_make_string (exp.c_str(), false);
+        exp += " ";
+    }
+
+    double elapsed[2];
+    for (int round = 0; round < 2; round++) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < times; i++) {
+            param[0] = exps[round ? i % nr_exps : 0];
+            purc_variant_t ret_var = func (NULL, 2, param, false);
+            ASSERT_NE(ret_var, nullptr);
+            purc_variant_unref(ret_var);
+        }
+        std::chrono::duration<double> d =
+            std::chrono::steady_clock::now() - start;
+        elapsed[round] = d.count();
+    }
+
+    fprintf(stderr, "$MATH.eval %zu times: the same expression %.3f s, "
+            "distinct expressions %.3f s\n", times, elapsed[0], elapsed[1]);
+
+    for (size_t i = 0; i < nr_exps; i++)
+        purc_variant_unref(exps[i]);
+    purc_variant_unref(param[1]);
+    purc_variant_unload_dvobj (math);
+    purc_cleanup ();
+}
+
 TEST(dvobjs, dvobjs_math_assignment)
 {
     size_t sz_total_mem_before = 0;
@@ -24,6 +24,7 @@
 #include "purc-html.h"
 #include "./html/interfaces/document.h"
 #include "private/interpreter.h"
+#include "private/document.h"
 
 #include "html_ops.h"
 
@@ -31,6 +32,11 @@
 
 #include <stdarg.h>
 
+#include <chrono>
+
+#include <string>
+#include <vector>
+
 #define ASSERT_DOC_DOC_EQ(_l, _r) do {                               \
     int _diff = 0;                                                   \
     ASSERT_EQ(html_dom_comp_docs(_l, _r, &_diff), 0);             \
@@ -1035,3 +1041,552 @@ TEST(html, buggy)
     purc_cleanup ();
 }
 
+
+static int
+collect_id(purc_document_t doc, pcdoc_element_t elem, void *ctxt)
+{
+    std::vector<std::string> *ids = (std::vector<std::string> *)ctxt;
+    const char *s;
+    size_t len;
+    if (pcdoc_element_get_attribute(doc, elem, "name", &s, &len) == 0)
+        ids->push_back(std::string(s, len));
+    else
+        ids->push_back("");
+    return 0;
+}
+
+static std::string
+query(purc_document_t doc, pcdoc_element_t scope,
+        pcdoc_special_attr which, const char *value)
+{
+    std::vector<std::string> names;
+    int r = pcdoc_travel_descendant_elements_by_special_attr(doc, scope,
+            which, value, collect_id, &names, NULL);
+    if (r)
+        return "<error>";
+
+    std::string s;
+    for (size_t i = 0; i < names.size(); i++) {
+        if (i)
+            s += ",";
+        s += names[i];
+    }
+    return s;
+}
+
+TEST(html, edom_index)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex (PURC_MODULE_HTML, "cn.fmsoft.hybridos.test",
+            "test_init", &info);
+    ASSERT_EQ (ret, PURC_ERROR_OK);
+
+    const char *html =
+        "<html><body>"
+        "<div name='a' id='x' class='foo bar'>"
+        "  <p name='b' class='bar'></p>"
+        "  <p name='c' class='baz  bar'></p>"
+        "</div>"
+        "<div name='d' id='y' class='foo'></div>"
+        "</body></html>";
+    purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML, html, 0);
+    ASSERT_NE(doc, nullptr);
+
+    ASSERT_EQ(query(doc, NULL, PCDOC_ATTR_ID, "x"), "a");
+    ASSERT_EQ(query(doc, NULL, PCDOC_ATTR_ID, "z"), "");
+    ASSERT_EQ(query(doc, NULL, PCDOC_ATTR_CLASS, "bar"), "a,b,c");
+    ASSERT_EQ(query(doc, NULL, PCDOC_ATTR_CLASS, "foo"), "a,d");
+
+    pcdoc_element_t div = NULL;
+    ASSERT_EQ(pcdoc_travel_descendant_elements_by_special_attr(doc, NULL,
+            PCDOC_ATTR_ID, "x",
+            [](purc_document_t, pcdoc_element_t elem, void *ctxt) {
+                *(pcdoc_element_t *)ctxt = elem;
+                return 0;
+            }, &div, NULL), 0);
+    ASSERT_NE(div, nullptr);
+
+    // the scope includes the ancestor itself
+    ASSERT_EQ(query(doc, div, PCDOC_ATTR_CLASS, "bar"), "a,b,c");
+    ASSERT_EQ(query(doc, div, PCDOC_ATTR_CLASS, "foo"), "a");
+
+    // attributes changed
+    ASSERT_EQ(pcdoc_element_set_attribute(doc, div, PCDOC_OP_DISPLACE,
+            "class", "qux", 0), 0);
+    ASSERT_EQ(query(doc, NULL, PCDOC_ATTR_CLASS, "bar"), "b,c");
+    ASSERT_EQ(query(doc, NULL, PCDOC_ATTR_CLASS, "qux"), "a");
+    ASSERT_EQ(pcdoc_element_set_attribute(doc, div, PCDOC_OP_DISPLACE,
+            "id", "y", 0), 0);
+    ASSERT_EQ(query(doc, NULL, PCDOC_ATTR_ID, "x"), "");
+    ASSERT_EQ(query(doc, NULL, PCDOC_ATTR_ID, "y"), "a,d");
+    ASSERT_EQ(pcdoc_element_set_attribute(doc, div, PCDOC_OP_ERASE,
+            "id", NULL, 0), 0);
+    ASSERT_EQ(query(doc, NULL, PCDOC_ATTR_ID, "y"), "d");
+
+    // subtree inserted
+    pcdoc_element_new_content(doc, div, PCDOC_OP_PREPEND,
+            "<span name='e' class='bar'><i name='f' id='x'></i></span>", 0);
+    ASSERT_EQ(query(doc, NULL, PCDOC_ATTR_CLASS, "bar"), "e,b,c");
+    ASSERT_EQ(query(doc, NULL, PCDOC_ATTR_ID, "x"), "f");
+
+    // subtree displaced and cleared
+    pcdoc_element_new_content(doc, div, PCDOC_OP_DISPLACE,
+            "<b name='g' class='bar'></b>", 0);
+    ASSERT_EQ(query(doc, NULL, PCDOC_ATTR_CLASS, "bar"), "g");
+    ASSERT_EQ(query(doc, NULL, PCDOC_ATTR_ID, "x"), "");
+    pcdoc_element_clear(doc, div);
+    ASSERT_EQ(query(doc, NULL, PCDOC_ATTR_CLASS, "bar"), "");
+
+    // subtree erased
+    pcdoc_element_erase(doc, div);
+    ASSERT_EQ(query(doc, NULL, PCDOC_ATTR_CLASS, "qux"), "");
+    ASSERT_EQ(query(doc, NULL, PCDOC_ATTR_CLASS, "foo"), "d");
+
+    purc_document_unref(doc);
+
+    purc_cleanup ();
+}
+
+static std::string
+serialize_doc(purc_document_t doc)
+{
+    purc_rwstream_t out = purc_rwstream_new_buffer(0, 0);
+    purc_document_serialize_contents_to_stream(doc, 0, out);
+    size_t sz = 0;
+    const char *buf = (const char *)purc_rwstream_get_mem_buffer(out, &sz);
+    std::string result(buf, sz);
+    purc_rwstream_destroy(out);
+    return result;
+}
+
+TEST(html, edom_load_incrementally)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex (PURC_MODULE_HTML, "cn.fmsoft.hybridos.test",
+            "test_init", &info);
+    ASSERT_EQ (ret, PURC_ERROR_OK);
+
+    std::string html = "<!DOCTYPE html><html><head><title>中文 &amp; "
+        "title</title><script>if (a < b) {}</script></head><body>";
+    for (int i = 0; i < 500; i++) {
+        std::string id = "d" + std::to_string(i);
+        html += "<div name='" + id + "' id='" + id + "' class=\"c x\">"
+            "<p>text 我 &lt; more text<br/></p><!-- comment --></div>";
+    }
+    html += "</body></html>";
+
+    purc_document_t whole = purc_document_load(PCDOC_K_TYPE_HTML,
+            html.c_str(), html.size());
+    ASSERT_NE(whole, nullptr);
+    std::string expected = serialize_doc(whole);
+    purc_document_unref(whole);
+
+    static const size_t chunk_sizes[] = { 1, 3, 100, 4096 };
+    for (size_t sz : chunk_sizes) {
+        purc_document_t doc = purc_document_load_begin(PCDOC_K_TYPE_HTML);
+        ASSERT_NE(doc, nullptr);
+
+        bool queried = false;
+        for (size_t off = 0; off < html.size(); off += sz) {
+            size_t len = std::min(sz, html.size() - off);
+            ASSERT_EQ(purc_document_load_feed(doc,
+                        html.c_str() + off, len), 0);
+
+            // the document can be queried between the chunks
+            if (!queried && off >= html.size() / 2) {
+                ASSERT_EQ(query(doc, NULL, PCDOC_ATTR_ID, "d0"), "d0");
+                ASSERT_EQ(query(doc, NULL, PCDOC_ATTR_ID, "d499"), "");
+                queried = true;
+            }
+        }
+
+        ASSERT_EQ(purc_document_load_end(doc), 0);
+        ASSERT_EQ(serialize_doc(doc), expected);
+
+        // the indexes built while loading are not stale
+        ASSERT_EQ(query(doc, NULL, PCDOC_ATTR_ID, "d499"), "d499");
+
+        // not being loaded any more
+        ASSERT_EQ(purc_document_load_feed(doc, "<p>", 3), -1);
+        ASSERT_EQ(purc_get_last_error(), PURC_ERROR_INVALID_OPERAND);
+        ASSERT_EQ(purc_document_load_end(doc), -1);
+
+        purc_document_unref(doc);
+    }
+
+    ASSERT_EQ(purc_document_load_begin(PCDOC_K_TYPE_VOID), nullptr);
+    ASSERT_EQ(purc_get_last_error(), PURC_ERROR_NOT_SUPPORTED);
+
+    purc_cleanup ();
+}
+
+static std::string
+coll_names(purc_document_t doc, pcdoc_elem_coll_t coll)
+{
+    if (coll == NULL)
+        return "<error>";
+
+    std::vector<std::string> names;
+    for (size_t i = 0; i < pcutils_arrlist_length(coll->elems); i++) {
+        pcdoc_element_t elem =
+            (pcdoc_element_t)pcutils_arrlist_get_idx(coll->elems, i);
+        collect_id(doc, elem, &names);
+    }
+
+    std::string s;
+    for (size_t i = 0; i < names.size(); i++) {
+        if (i)
+            s += ",";
+        s += names[i];
+    }
+    return s;
+}
+
+static std::string
+select_names(purc_document_t doc, const char *selector)
+{
+    pcdoc_elem_coll_t coll;
+    coll = pcdoc_elem_coll_new_from_document(doc, selector);
+    std::string s = coll_names(doc, coll);
+    if (coll)
+        pcdoc_elem_coll_delete(doc, coll);
+    return s;
+}
+
+TEST(html, edom_selector)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex (PURC_MODULE_HTML, "cn.fmsoft.hybridos.test",
+            "test_init", &info);
+    ASSERT_EQ (ret, PURC_ERROR_OK);
+
+    static const char html[] =
+        "<html lang='en-US'><body name='body'>"
+        "<div name='main' id='main' class='item a'>"
+            "<span name='s1' data-x='1'>x</span>"
+            "<span name='s2' title='Hello World'></span>"
+            "<p name='p1'></p>"
+        "</div>"
+        "<div name='d2' class='item' lang='fr'>"
+            "<span name='s3' data-x='foo bar'></span><em name='em'></em>"
+        "</div>"
+        "<input name='cb' type='checkbox' checked>"
+        "<input name='dis' disabled>"
+        "<a name='a' href='x.html'></a>"
+        "<ul name='ul'><li name='l1' class='x-y'></li><li name='l2'></li>"
+            "<li name='l3'></li><li name='l4'></li><li name='l5'></li></ul>"
+        "</body></html>";
+
+    purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML,
+            html, sizeof(html) - 1);
+    ASSERT_NE(doc, nullptr);
+
+    // the index of id and class
+    ASSERT_EQ(select_names(doc, "#main"), "main");
+    ASSERT_EQ(select_names(doc, ".item"), "main,d2");
+    ASSERT_EQ(select_names(doc, "DIV#main.item"), "main");
+    ASSERT_EQ(select_names(doc, "div .item"), "");
+
+    // combinators
+    ASSERT_EQ(select_names(doc, "div.item > span[data-x]"), "s1,s3");
+    ASSERT_EQ(select_names(doc, "#main span"), "s1,s2");
+    ASSERT_EQ(select_names(doc, "span + span"), "s2");
+    ASSERT_EQ(select_names(doc, "span ~ p"), "p1");
+    ASSERT_EQ(select_names(doc, "ul>li+li"), "l2,l3,l4,l5");
+
+    // attributes
+    ASSERT_EQ(select_names(doc, "[data-x=foo]"), "");
+    ASSERT_EQ(select_names(doc, "[data-x~=foo]"), "s3");
+    ASSERT_EQ(select_names(doc, "[data-x^=fo][data-x$=bar]"), "s3");
+    ASSERT_EQ(select_names(doc, "[data-x*='o b']"), "s3");
+    ASSERT_EQ(select_names(doc, "[title='hello world' i]"), "s2");
+    ASSERT_EQ(select_names(doc, "[class|=x]"), "l1");
+
+    // structural and other pseudo-classes
+    ASSERT_EQ(select_names(doc, "li:nth-child(2n+1)"), "l1,l3,l5");
+    ASSERT_EQ(select_names(doc, "li:nth-child(even)"), "l2,l4");
+    ASSERT_EQ(select_names(doc, "li:nth-last-child(-n+2)"), "l4,l5");
+    ASSERT_EQ(select_names(doc, "span:last-of-type"), "s2,s3");
+    ASSERT_EQ(select_names(doc, "li:not(:first-child):not(:last-child)"),
+            "l2,l3,l4");
+    ASSERT_EQ(select_names(doc, "p:empty, span:empty"), "s2,p1,s3");
+    ASSERT_EQ(select_names(doc, ":checked"), "cb");
+    ASSERT_EQ(select_names(doc, ":disabled"), "dis");
+    ASSERT_EQ(select_names(doc, ":link"), "a");
+    ASSERT_EQ(select_names(doc, "em:lang(fr)"), "em");
+    ASSERT_EQ(select_names(doc, "a:hover, p::before"), "");
+
+    // malformed or not supported
+    static const char *bad[] = {
+        "", "div,", "div >", "[data-x", ":nth-child(2n+)", ":unknown",
+        "ns|div", ":not(div span)",
+    };
+    for (size_t i = 0; i < PCA_TABLESIZE(bad); i++) {
+        ASSERT_EQ(pcdoc_elem_coll_new_from_document(doc, bad[i]), nullptr);
+        ASSERT_EQ(purc_get_last_error(), PURC_ERROR_INVALID_VALUE);
+    }
+
+    // the first one and filtering
+    pcdoc_element_t elem = pcdoc_find_element_in_document(doc, "li + li");
+    std::vector<std::string> names;
+    collect_id(doc, elem, &names);
+    ASSERT_EQ(names[0], "l2");
+    ASSERT_EQ(pcdoc_find_element_in_document(doc, "li > li"), nullptr);
+
+    pcdoc_elem_coll_t spans = pcdoc_elem_coll_new_from_document(doc, "span");
+    ASSERT_EQ(coll_names(doc, spans), "s1,s2,s3");
+    pcdoc_elem_coll_t some = pcdoc_elem_coll_filter(doc, spans, "[data-x]");
+    ASSERT_EQ(coll_names(doc, some), "s1,s3");
+    pcdoc_elem_coll_delete(doc, some);
+    pcdoc_elem_coll_delete(doc, spans);
+
+    // the scope itself is a candidate
+    pcdoc_element_t scope = pcdoc_find_element_in_document(doc, "#main");
+    pcdoc_elem_coll_t coll = pcdoc_elem_coll_new_from_descendants(doc, scope,
+            ".item, span:first-child");
+    ASSERT_EQ(coll_names(doc, coll), "main,s1");
+    pcdoc_elem_coll_delete(doc, coll);
+
+    purc_document_unref(doc);
+
+    purc_cleanup ();
+}
+
+struct markup_template {
+    std::string                 markup;
+    std::vector<size_t>         piece_ends;
+    std::vector<std::string>    values;
+    std::vector<const char *>   texts;
+    std::vector<size_t>         text_lens;
+    struct pcdoc_template       tpl;
+};
+
+static void
+make_template(markup_template &t, const std::vector<std::string> &pieces,
+        const std::vector<std::string> &values)
+{
+    t.markup.clear();
+    t.piece_ends.clear();
+    for (const std::string &piece : pieces) {
+        t.markup += piece;
+        t.piece_ends.push_back(t.markup.size());
+    }
+
+    t.values = values;
+    t.texts.clear();
+    t.text_lens.clear();
+    for (const std::string &value : t.values) {
+        t.texts.push_back(value.c_str());
+        t.text_lens.push_back(value.size());
+    }
+
+    t.tpl.markup = t.markup.c_str();
+    t.tpl.piece_ends = t.piece_ends.data();
+    t.tpl.nr_texts = t.values.size();
+    t.tpl.texts = t.texts.data();
+    t.tpl.text_lens = t.text_lens.data();
+}
+
+static std::string
+escape_text(const std::string &text)
+{
+    std::string s;
+    for (char c : text) {
+        switch (c) {
+        case '&': s += "&amp;"; break;
+        case '<': s += "&lt;"; break;
+        case '>': s += "&gt;"; break;
+        case '"': s += "&quot;"; break;
+        case '\'': s += "&#39;"; break;
+        default: s += c; break;
+        }
+    }
+    return s;
+}
+
+// the markup which is parsed to the same content as the template gives
+static std::string
+expand_template(const std::vector<std::string> &pieces,
+        const std::vector<std::string> &values)
+{
+    std::string s = pieces[0];
+    for (size_t i = 0; i < values.size(); i++)
+        s += escape_text(values[i]) + pieces[i + 1];
+    return s;
+}
+
+TEST(html, edom_new_content_from_template)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex (PURC_MODULE_HTML, "cn.fmsoft.hybridos.test",
+            "test_init", &info);
+    ASSERT_EQ (ret, PURC_ERROR_OK);
+
+    static const char html[] =
+        "<html><body><ul id='by-markup'><li name='x'>x</li></ul>"
+        "<ul id='by-template'><li name='x'>x</li></ul></body></html>";
+
+    std::vector<std::string> pieces = {
+        "\n  <li class=\"item ", "\" name='", "' title=\"",
+        "\">count: <b>", "</b>, ", "<!-- ", " --></li>",
+    };
+    std::vector<std::string> values[] = {
+        { "a", "n1", "plain", "1", "text", "c" },
+        { "b", "n2", "1 < 2 & \"q\" 'q'", "<i>not markup</i>", "&amp;",
+            "--" },
+        { "", "", "", "", "", "" },
+        { "c", "中文", "&lt;", "\xc2\xa0", "a\nb", "x" },
+    };
+
+    static const pcdoc_operation ops[] = {
+        PCDOC_OP_APPEND, PCDOC_OP_PREPEND, PCDOC_OP_INSERTBEFORE,
+        PCDOC_OP_INSERTAFTER, PCDOC_OP_DISPLACE, PCDOC_OP_APPEND,
+    };
+
+    for (size_t i = 0; i < PCA_TABLESIZE(ops); i++) {
+        for (size_t j = 0; j < PCA_TABLESIZE(values); j++) {
+            purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML,
+                    html, sizeof(html) - 1);
+            ASSERT_NE(doc, nullptr);
+
+            // the operations to insert before or after apply to <li>
+            const char *where = (ops[i] == PCDOC_OP_INSERTBEFORE ||
+                    ops[i] == PCDOC_OP_INSERTAFTER) ? " li" : "";
+            std::string by_markup = std::string("#by-markup") + where;
+            std::string by_template = std::string("#by-template") + where;
+
+            pcdoc_element_t elem;
+            elem = pcdoc_find_element_in_document(doc, by_markup.c_str());
+            ASSERT_NE(elem, nullptr);
+            std::string markup = expand_template(pieces, values[j]);
+            pcdoc_element_new_content(doc, elem, ops[i],
+                    markup.c_str(), markup.size());
+
+            elem = pcdoc_find_element_in_document(doc, by_template.c_str());
+            ASSERT_NE(elem, nullptr);
+            markup_template t;
+            make_template(t, pieces, values[j]);
+            pcdoc_node node = pcdoc_element_new_content_from_template(doc,
+                    elem, ops[i], &t.tpl);
+            ASSERT_NE(node.type, PCDOC_NODE_VOID);
+
+            // both lists have the same contents
+            static const std::string tag1 = "<ul id=\"by-markup\">";
+            static const std::string tag2 = "<ul id=\"by-template\">";
+            std::string s = serialize_doc(doc);
+            size_t pos = s.find(tag2);
+            ASSERT_NE(pos, std::string::npos);
+            std::string first = s.substr(0, pos);
+            std::string second = s.substr(pos + tag2.size());
+            first = first.substr(first.find(tag1) + tag1.size());
+            ASSERT_EQ(first.substr(0, first.find("</ul>")),
+                    second.substr(0, second.find("</ul>"))) << s;
+
+            // the new elements are indexed
+            if (!values[j][0].empty()) {
+                std::string cls = values[j][0];
+                pcdoc_elem_coll_t coll = pcdoc_elem_coll_new_from_document(
+                        doc, ("#by-template ." + cls).c_str());
+                ASSERT_NE(coll, nullptr);
+                ASSERT_EQ(pcutils_arrlist_length(coll->elems), 1u);
+                pcdoc_elem_coll_delete(doc, coll);
+            }
+
+            purc_document_unref(doc);
+        }
+    }
+
+    purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML,
+            html, sizeof(html) - 1);
+    pcdoc_element_t elem = pcdoc_find_element_in_document(doc, "#by-template");
+
+    // a text in a tag name or an attribute name
+    markup_template t;
+    make_template(t, { "<", " class='x'></b>" }, { "b" });
+    pcdoc_node node = pcdoc_element_new_content_from_template(doc, elem,
+            PCDOC_OP_APPEND, &t.tpl);
+    ASSERT_EQ(node.type, PCDOC_NODE_VOID);
+    ASSERT_EQ(purc_get_last_error(), PURC_ERROR_NOT_SUPPORTED);
+
+    make_template(t, { "<b ", "='x'></b>" }, { "class" });
+    node = pcdoc_element_new_content_from_template(doc, elem,
+            PCDOC_OP_APPEND, &t.tpl);
+    ASSERT_EQ(node.type, PCDOC_NODE_VOID);
+    ASSERT_EQ(purc_get_last_error(), PURC_ERROR_NOT_SUPPORTED);
+
+    // no text at all, and the same template used again
+    make_template(t, { "<b name='y'>y</b>" }, { });
+    for (int i = 0; i < 2; i++) {
+        node = pcdoc_element_new_content_from_template(doc, elem,
+                PCDOC_OP_APPEND, &t.tpl);
+        ASSERT_NE(node.type, PCDOC_NODE_VOID);
+    }
+    ASSERT_EQ(select_names(doc, "#by-template > *"), "x,y,y");
+
+    purc_document_unref(doc);
+    purc_cleanup ();
+}
+
+TEST(html, edom_template_throughput)
+{
+    // TEMPLATE_ITEMS=100000 ./test_html_edom --gtest_filter=html.edom_template_throughput
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex (PURC_MODULE_HTML, "cn.fmsoft.hybridos.test",
+            "test_init", &info);
+    ASSERT_EQ (ret, PURC_ERROR_OK);
+
+    const char *env = getenv("TEMPLATE_ITEMS");
+    size_t nr_items = env ? strtoul(env, NULL, 10) : 0;
+    if (nr_items == 0)
+        nr_items = 5000;
+
+    static const char html[] = "<html><body><ul id='list'></ul></body></html>";
+    std::vector<std::string> pieces = {
+        "<li class=\"user-item\" id=\"user-", "\" data-region=\"",
+        "\">\n  <img class=\"avatar\" src=\"", "\" />\n  <span>",
+        "</span>\n</li>",
+    };
+
+    double secs[2];
+    std::string results[2];
+    for (int by_template = 0; by_template < 2; by_template++) {
+        purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML,
+                html, sizeof(html) - 1);
+        ASSERT_NE(doc, nullptr);
+        pcdoc_element_t list = pcdoc_find_element_in_document(doc, "#list");
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < nr_items; i++) {
+            std::string n = std::to_string(i);
+            std::vector<std::string> values = { n, "zh_CN",
+                "/img/avatars/" + n + ".png", "User " + n };
+
+            // the items are refreshed in place, as a live list does
+            pcdoc_operation op = (i % 100) ? PCDOC_OP_APPEND :
+                PCDOC_OP_DISPLACE;
+            if (by_template) {
+                markup_template t;
+                make_template(t, pieces, values);
+                pcdoc_element_new_content_from_template(doc, list, op,
+                        &t.tpl);
+            }
+            else {
+                std::string markup = expand_template(pieces, values);
+                pcdoc_element_new_content(doc, list, op,
+                        markup.c_str(), markup.size());
+            }
+        }
+        auto t1 = std::chrono::steady_clock::now();
+
+        secs[by_template] = std::chrono::duration<double>(t1 - t0).count();
+        results[by_template] = serialize_doc(doc);
+        purc_document_unref(doc);
+    }
+
+    ASSERT_EQ(results[0], results[1]);
+    fprintf(stderr, "%zu items: re-parsing markup %.3f s, "
+            "from template %.3f s (%.1fx)\n", nr_items, secs[0], secs[1],
+            secs[0] / secs[1]);
+
+    purc_cleanup ();
+}
@@ -31,6 +31,9 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 
+#include <chrono>
+#include <string>
+
 // test html parser for whole html file
 TEST(html, html_parser_html_file_x)
 {
@@ -622,3 +625,92 @@ TEST(html, collection)
     purc_cleanup ();
 }
 
+
+static std::string
+make_text_heavy_html(size_t size)
+{
+    static const char *words[] = {
+        "lorem", "ipsum", "dolor", "sit", "amet", "&amp;", "consectetur",
+        "adipiscing", "elit", "&lt;tag&gt;", "sed", "do", "eiusmod",
+    };
+    std::string html = "<!DOCTYPE html><html><head><title>Text</title>"
+        "<style>p { color: red; } /* < & */</style></head><body>";
+
+    unsigned n = 0;
+    while (html.size() < size) {
+        html += "<p class=\"paragraph text-";
+        html += std::to_string(n);
+        html += "\" title='single &amp; quoted'>";
+        for (int i = 0; i < 200; i++) {
+            html += words[(n + i) % (sizeof(words) / sizeof(words[0]))];
+            html += (i % 50 == 49) ? "\r\n" : " ";
+        }
+        html += "</p><textarea>rcdata &lt; < text</textarea>\n";
+        n++;
+    }
+
+    html += "</body></html>";
+    return html;
+}
+
+static std::string
+parse_and_serialize(const std::string &html, size_t chunk)
+{
+    pchtml_html_document_t *doc = pchtml_html_document_create();
+    if (doc == NULL)
+        return "";
+
+    pchtml_html_document_parse_chunk_begin(doc);
+    for (size_t off = 0; off < html.size(); off += chunk) {
+        size_t len = std::min(chunk, html.size() - off);
+        pchtml_html_document_parse_chunk(doc,
+                (const unsigned char *)html.data() + off, len);
+    }
+    pchtml_html_document_parse_chunk_end(doc);
+
+    purc_rwstream_t out = purc_rwstream_new_buffer(0, 0);
+    pchtml_doc_write_to_stream(doc, out);
+    size_t sz = 0;
+    const char *buf = (const char *)purc_rwstream_get_mem_buffer(out, &sz);
+    std::string result(buf, sz);
+    purc_rwstream_destroy(out);
+
+    pchtml_html_document_destroy(doc);
+    return result;
+}
+
+TEST(html, parse_text_throughput)
+{
+    // a small document by default, to check the chunk boundaries; time a
+    // large one with:
+    // HTML_KBYTES=16384 ./test_html_parser --gtest_filter=html.parse_text_throughput
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_HTML, "cn.fmsoft.hybridos.test",
+            "test_init", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    const char *env = getenv("HTML_KBYTES");
+    size_t kb = env ? strtoul(env, NULL, 10) : 0;
+    if (kb == 0)
+        kb = 32;
+
+    std::string html = make_text_heavy_html(kb * 1024);
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::string whole = parse_and_serialize(html, html.size());
+    auto t1 = std::chrono::steady_clock::now();
+
+    ASSERT_FALSE(whole.empty());
+    ASSERT_NE(whole.find("consectetur adipiscing"), std::string::npos);
+    ASSERT_NE(whole.find("title=\"single &amp; quoted\""), std::string::npos);
+
+    /* the chunk boundaries must not change the result */
+    ASSERT_EQ(parse_and_serialize(html, 7), whole);
+    ASSERT_EQ(parse_and_serialize(html, 4093), whole);
+
+    double secs = std::chrono::duration<double>(t1 - t0).count();
+    fprintf(stderr, "parsed and serialized %zu bytes in %.3f s (%.1f MB/s)\n",
+            html.size(), secs, html.size() / secs / (1024 * 1024));
+
+    purc_cleanup();
+}
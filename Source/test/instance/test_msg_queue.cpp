@@ -0,0 +1,178 @@
+/*
+** Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+**
+** This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "purc.h"
+#include "private/msg-queue.h"
+#include "../helpers.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+static pcrdr_msg *
+make_event(const char *name, const char *element,
+        pcrdr_msg_event_reduce_opt opt, size_t round)
+{
+    char data[32];
+    int n = snprintf(data, sizeof(data), "%zu", round);
+
+    pcrdr_msg *msg = pcrdr_make_event_message(
+            PCRDR_MSG_TARGET_COROUTINE, 1,
+            name, NULL,
+            PCRDR_MSG_ELEMENT_TYPE_ID, element, NULL,
+            PCRDR_MSG_DATA_TYPE_JSON, data, n);
+    if (msg)
+        msg->reduceOpt = opt;
+    return msg;
+}
+
+/* The queue takes the message unless it is reduced to a queued one. */
+static void
+post_event(struct pcinst_msg_queue *queue, pcrdr_msg *msg, bool tail = true)
+{
+    size_t nr = pcinst_msg_queue_count(queue);
+    if (tail)
+        pcinst_msg_queue_append(queue, msg);
+    else
+        pcinst_msg_queue_prepend(queue, msg);
+
+    if (pcinst_msg_queue_count(queue) == nr)
+        pcrdr_release_message(msg);
+}
+
+static void
+check_event(pcrdr_msg *msg, const char *name, const char *element,
+        uint64_t round)
+{
+    ASSERT_NE(msg, nullptr);
+    ASSERT_STREQ(purc_variant_get_string_const(msg->eventName), name);
+    ASSERT_STREQ(purc_variant_get_string_const(msg->elementValue), element);
+
+    uint64_t u = 0;
+    ASSERT_TRUE(purc_variant_cast_to_ulongint(msg->data, &u, true));
+    ASSERT_EQ(u, round);
+    pcrdr_release_message(msg);
+}
+
+TEST(msg_queue, reduce)
+{
+    PurCInstance purc(false);
+    ASSERT_TRUE(purc);
+
+    struct pcinst_msg_queue *queue = pcinst_msg_queue_create();
+    ASSERT_NE(queue, nullptr);
+
+    const pcrdr_msg_event_reduce_opt overlay =
+        PCRDR_MSG_EVENT_REDUCE_OPT_OVERLAY;
+    post_event(queue, make_event("change:attached", "a", overlay, 0));
+    post_event(queue, make_event("change:attached", "b", overlay, 0));
+    post_event(queue, make_event("change:displaced", "a", overlay, 0));
+    post_event(queue, make_event("change:attached", "a", overlay, 1));
+    ASSERT_EQ(pcinst_msg_queue_count(queue), 3);
+
+    // the ignored event leaves the queued one as is
+    post_event(queue, make_event("change:attached", "b",
+                PCRDR_MSG_EVENT_REDUCE_OPT_IGNORE, 1));
+    ASSERT_EQ(pcinst_msg_queue_count(queue), 3);
+
+    // the kept events are queued, and reduced to the earliest queued one
+    post_event(queue, make_event("change:displaced", "b",
+                PCRDR_MSG_EVENT_REDUCE_OPT_KEEP, 0), false);
+    post_event(queue, make_event("change:displaced", "b",
+                PCRDR_MSG_EVENT_REDUCE_OPT_KEEP, 1));
+    post_event(queue, make_event("change:displaced", "b", overlay, 2));
+    ASSERT_EQ(pcinst_msg_queue_count(queue), 5);
+
+    pcrdr_msg *msg = pcinst_msg_queue_get_msg(queue);
+    check_event(msg, "change:displaced", "b", 2);
+    msg = pcinst_msg_queue_get_msg(queue);
+    check_event(msg, "change:attached", "a", 1);
+
+    // the dequeued events are not reduced to anymore, the kept one left is
+    post_event(queue, make_event("change:displaced", "b", overlay, 3));
+    post_event(queue, make_event("change:attached", "a", overlay, 2));
+    ASSERT_EQ(pcinst_msg_queue_count(queue), 4);
+
+    msg = pcinst_msg_queue_get_msg(queue);
+    check_event(msg, "change:attached", "b", 0);
+    msg = pcinst_msg_queue_get_msg(queue);
+    check_event(msg, "change:displaced", "a", 0);
+    msg = pcinst_msg_queue_get_msg(queue);
+    check_event(msg, "change:displaced", "b", 3);
+    msg = pcinst_msg_queue_get_msg(queue);
+    check_event(msg, "change:attached", "a", 2);
+    ASSERT_EQ(pcinst_msg_queue_get_msg(queue), nullptr);
+
+    pcinst_msg_queue_destroy(queue);
+}
+
+TEST(msg_queue, reduce_flood)
+{
+    // NR_EVENTS=100000 ./test_msg_queue --gtest_filter=msg_queue.reduce_flood
+    const char *env = getenv("NR_EVENTS");
+    size_t nr = env ? strtoul(env, NULL, 10) : 0;
+    if (nr == 0)
+        nr = 10000;
+    const size_t nr_rounds = 10;
+
+    PurCInstance purc(false);
+    ASSERT_TRUE(purc);
+
+    struct pcinst_msg_queue *queue = pcinst_msg_queue_create();
+    ASSERT_NE(queue, nullptr);
+
+    // every variable changes in every round before any event is handled
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < nr_rounds; round++) {
+        for (size_t i = 0; i < nr; i++) {
+            char element[32];
+            snprintf(element, sizeof(element), "var-%zu", i);
+            pcrdr_msg *msg = make_event("change:attached", element,
+                    PCRDR_MSG_EVENT_REDUCE_OPT_OVERLAY, round);
+            ASSERT_NE(msg, nullptr);
+            post_event(queue, msg);
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    ASSERT_EQ(pcinst_msg_queue_count(queue), nr);
+
+    size_t nr_handled = 0;
+    pcrdr_msg *msg;
+    while ((msg = pcinst_msg_queue_get_msg(queue))) {
+        char element[32];
+        snprintf(element, sizeof(element), "var-%zu", nr_handled);
+        check_event(msg, "change:attached", element, nr_rounds - 1);
+        nr_handled++;
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    ASSERT_EQ(nr_handled, nr);
+    pcinst_msg_queue_destroy(queue);
+
+    auto us = [](std::chrono::steady_clock::duration d) {
+        return (long long)std::chrono::duration_cast<
+            std::chrono::microseconds>(d).count();
+    };
+    fprintf(stderr, "%zu events reduced to %zu: posted in %lldus, "
+            "handled in %lldus\n",
+            nr * nr_rounds, nr, us(t1 - t0), us(t2 - t1));
+}
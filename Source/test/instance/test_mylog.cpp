@@ -21,6 +21,9 @@
 
 #include <stdio.h>
 #include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
 #include <gtest/gtest.h>
 
 #define ATOM_BITS_NR        (sizeof(purc_atom_t) << 3)
@@ -62,3 +65,131 @@ TEST(instance, mylog)
     purc_cleanup();
 }
 
+
+// NR_RECORDS=100000 ./test_mylog --gtest_filter=instance.mylog_async
+TEST(instance, mylog_async)
+{
+    int ret = purc_init_ex(PURC_MODULE_VARIANT, "cn.fmsoft.hvml.purc",
+            "async", NULL);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    size_t nr_records = 10000;
+    const char *env = getenv("NR_RECORDS");
+    if (env)
+        nr_records = strtoul(env, NULL, 10);
+
+    const char *log_file = "/var/tmp/purc-cn.fmsoft.hvml.purc-async.log";
+    unlink(log_file);
+
+    ASSERT_TRUE(purc_log_configure(PURC_LOG_LEVEL_WARN,
+                PURC_LOG_OVERFLOW_DROP));
+    ASSERT_TRUE(purc_enable_log(true, false));
+
+    auto t1 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < nr_records; i++) {
+        purc_log_info("filtered out %zu\n", i);
+        purc_log_warn("record %zu\n", i);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    // an error record is written out before returning, if not dropped
+    purc_log_error("the last record\n");
+
+    // how many records are dropped depends on the pace of the writer,
+    // but every record is either queued or dropped
+    struct purc_log_stats stats;
+    ASSERT_TRUE(purc_log_get_stats(&stats));
+    ASSERT_EQ(stats.nr_filtered, nr_records);
+    ASSERT_EQ(stats.nr_queued + stats.nr_dropped, nr_records + 1);
+    ASSERT_LE(stats.nr_written, stats.nr_queued);
+    ASSERT_EQ(stats.nr_overwritten, 0);
+
+    // the writer writes out all records queued before it stops
+    purc_enable_log(false, false);
+
+    FILE *fp = fopen(log_file, "r");
+    ASSERT_NE(fp, nullptr);
+
+    char line[128];
+    size_t nr_lines = 0;
+    long last = -1;
+    while (fgets(line, sizeof(line), fp)) {
+        long n;
+        if (sscanf(line, "WARN >> record %ld", &n) == 1) {
+            // the records are written in order
+            ASSERT_GT(n, last);
+            last = n;
+        }
+        else {
+            ASSERT_STREQ(line, "ERROR >> the last record\n");
+        }
+        nr_lines++;
+    }
+    fclose(fp);
+    ASSERT_EQ(nr_lines, stats.nr_queued);
+
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1);
+    fprintf(stderr, "%zu records logged in %lld us (%zu dropped)\n",
+            nr_records * 2, (long long)us.count(), stats.nr_dropped);
+
+    purc_log_configure(PURC_LOG_LEVEL_DEBUG, PURC_LOG_OVERFLOW_DROP);
+    purc_cleanup();
+}
+
+// the overflow policy is switched while the writer is running
+TEST(instance, mylog_switch_overflow)
+{
+    int ret = purc_init_ex(PURC_MODULE_VARIANT, "cn.fmsoft.hvml.purc",
+            "switch", NULL);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    size_t nr_records = 10000;
+    const char *env = getenv("NR_RECORDS");
+    if (env)
+        nr_records = strtoul(env, NULL, 10);
+
+    const char *log_file = "/var/tmp/purc-cn.fmsoft.hvml.purc-switch.log";
+    unlink(log_file);
+
+    ASSERT_TRUE(purc_log_configure(PURC_LOG_LEVEL_WARN,
+                PURC_LOG_OVERFLOW_DROP));
+    ASSERT_TRUE(purc_enable_log(true, false));
+
+    for (size_t i = 0; i < nr_records; i++) {
+        if (i % 1000 == 500) {
+            ASSERT_TRUE(purc_log_configure(PURC_LOG_LEVEL_WARN,
+                        (i / 1000) % 2 ? PURC_LOG_OVERFLOW_DROP :
+                        PURC_LOG_OVERFLOW_OVERWRITE));
+        }
+        purc_log_warn("record %zu\n", i);
+    }
+
+    // the counters of the producer are final once it stops logging
+    struct purc_log_stats stats;
+    ASSERT_TRUE(purc_log_get_stats(&stats));
+    ASSERT_EQ(stats.nr_queued + stats.nr_dropped, nr_records);
+    ASSERT_LE(stats.nr_overwritten, stats.nr_queued);
+
+    purc_enable_log(false, false);
+
+    FILE *fp = fopen(log_file, "r");
+    ASSERT_NE(fp, nullptr);
+
+    // no record is torn by an overwrite, and they are in order
+    char line[128];
+    size_t nr_lines = 0;
+    long last = -1;
+    while (fgets(line, sizeof(line), fp)) {
+        long n;
+        ASSERT_EQ(sscanf(line, "WARN >> record %ld", &n), 1) << line;
+        ASSERT_GT(n, last);
+        last = n;
+        nr_lines++;
+    }
+    fclose(fp);
+    ASSERT_EQ(nr_lines, stats.nr_queued - stats.nr_overwritten);
+
+    unlink(log_file);
+    purc_log_configure(PURC_LOG_LEVEL_DEBUG, PURC_LOG_OVERFLOW_DROP);
+    purc_cleanup();
+}
@@ -0,0 +1,419 @@
+/*
+** Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+**
+** This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "purc.h"
+#include "private/utils.h"
+#include "../helpers.h"
+
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+
+#define WS_KEY_GUID         "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+#define NR_DATA_BYTES       10000
+
+#define INITIAL_DATA        "PURCMC:100\nHTML:5.3\nworkspace:0\n"
+#define INITIAL_RESPONSE    \
+    "type:response\n"       \
+    "requestId:0\n"         \
+    "sourceURI:-\n"         \
+    "result:200/0\n"        \
+    "dataType:plain\n"      \
+    "dataLen:32\n"          \
+    " \n"                   \
+    INITIAL_DATA
+
+/* A loopback WebSocket peer playing the role of a PurCMC renderer. */
+struct ws_peer {
+    int             listen_fd;
+    int             fd;
+    int             port;
+    bool            bad_accept;     // answer the handshake with a wrong key
+    std::string     error;
+    std::thread     thread;
+};
+
+struct ws_frame {
+    bool            fin;
+    bool            masked;
+    int             opcode;
+    std::string     payload;
+};
+
+static bool
+peer_read(int fd, void *buf, size_t sz)
+{
+    char *p = (char *)buf;
+    while (sz > 0) {
+        ssize_t n = read(fd, p, sz);
+        if (n <= 0)
+            return false;
+        p += n;
+        sz -= n;
+    }
+    return true;
+}
+
+static bool
+peer_write(int fd, const std::string &data)
+{
+    return write(fd, data.data(), data.size()) == (ssize_t)data.size();
+}
+
+static std::string
+make_frame(int opcode, bool fin, const std::string &payload)
+{
+    std::string frame;
+
+    frame += (char)((fin ? 0x80 : 0) | opcode);
+    if (payload.size() < 126) {
+        frame += (char)payload.size();
+    }
+    else {
+        frame += (char)126;
+        frame += (char)(payload.size() >> 8);
+        frame += (char)(payload.size() & 0xFF);
+    }
+    return frame + payload;
+}
+
+static bool
+read_frame(int fd, struct ws_frame *frame)
+{
+    uint8_t hdr[2], ext[8], mask[4] = { 0, 0, 0, 0 };
+    uint64_t len;
+
+    if (!peer_read(fd, hdr, 2))
+        return false;
+
+    frame->fin = hdr[0] & 0x80;
+    frame->opcode = hdr[0] & 0x0F;
+    frame->masked = hdr[1] & 0x80;
+    len = hdr[1] & 0x7F;
+    if (len == 126) {
+        if (!peer_read(fd, ext, 2))
+            return false;
+        len = (ext[0] << 8) | ext[1];
+    }
+    else if (len == 127) {
+        if (!peer_read(fd, ext, 8))
+            return false;
+        len = 0;
+        for (int i = 0; i < 8; i++)
+            len = (len << 8) | ext[i];
+    }
+
+    if (frame->masked && !peer_read(fd, mask, 4))
+        return false;
+
+    frame->payload.resize(len);
+    if (len > 0 && !peer_read(fd, &frame->payload[0], len))
+        return false;
+    for (size_t i = 0; i < len; i++)
+        frame->payload[i] ^= mask[i & 3];
+    return true;
+}
+
+static std::string
+make_accept(const std::string &key)
+{
+    pcutils_sha1_ctxt ctx;
+    uint8_t digest[SHA1_DIGEST_SIZE];
+    char accept[pcutils_b64_encoded_length(SHA1_DIGEST_SIZE)];
+
+    pcutils_sha1_begin(&ctx);
+    pcutils_sha1_hash(&ctx, key.c_str(), key.size());
+    pcutils_sha1_hash(&ctx, WS_KEY_GUID, sizeof(WS_KEY_GUID) - 1);
+    pcutils_sha1_end(&ctx, digest);
+    pcutils_b64_encode(digest, sizeof(digest), accept, sizeof(accept));
+    return accept;
+}
+
+static std::string
+header_value(const std::string &request, const char *name)
+{
+    std::string key = std::string("\r\n") + name + ": ";
+    size_t pos = request.find(key);
+    if (pos == std::string::npos)
+        return "";
+    pos += key.size();
+    return request.substr(pos, request.find("\r\n", pos) - pos);
+}
+
+/* reads the frames of a text message; all of them must be masked */
+static bool
+read_message(struct ws_peer *peer, std::string *message, int *nr_frames)
+{
+    struct ws_frame frame;
+
+    message->clear();
+    *nr_frames = 0;
+    do {
+        if (!read_frame(peer->fd, &frame)) {
+            peer->error = "failed to read a frame";
+            return false;
+        }
+        if (!frame.masked) {
+            peer->error = "unmasked frame from client";
+            return false;
+        }
+        if (frame.opcode != (*nr_frames ? 0x00 : 0x01)) {
+            peer->error = "unexpected opcode " + std::to_string(frame.opcode);
+            return false;
+        }
+        if (frame.payload.size() > PCRDR_MAX_FRAME_PAYLOAD_SIZE) {
+            peer->error = "too large frame";
+            return false;
+        }
+        *message += frame.payload;
+        (*nr_frames)++;
+    } while (!frame.fin);
+
+    return true;
+}
+
+static bool
+expect_control(struct ws_peer *peer, int opcode, const std::string &payload)
+{
+    struct ws_frame frame;
+
+    if (!read_frame(peer->fd, &frame) || !frame.masked ||
+            frame.opcode != opcode || frame.payload != payload) {
+        peer->error = "expected control frame " + std::to_string(opcode);
+        return false;
+    }
+    return true;
+}
+
+static bool
+peer_handshake(struct ws_peer *peer, const std::string &first_frame)
+{
+    std::string request;
+    char c;
+
+    while (request.find("\r\n\r\n") == std::string::npos) {
+        if (!peer_read(peer->fd, &c, 1)) {
+            peer->error = "failed to read the handshake";
+            return false;
+        }
+        request += c;
+    }
+
+    if (request.compare(0, 19, "GET /purcmc HTTP/1.") ||
+            header_value(request, "Upgrade") != "websocket" ||
+            header_value(request, "Sec-WebSocket-Version") != "13") {
+        peer->error = "bad handshake request: " + request;
+        return false;
+    }
+
+    std::string accept = make_accept(header_value(request, "Sec-WebSocket-Key"));
+    if (peer->bad_accept)
+        accept[0] = (accept[0] == 'A') ? 'B' : 'A';
+
+    // the first frame follows the response in the same segment
+    return peer_write(peer->fd,
+            "HTTP/1.1 101 Switching Protocols\r\n"
+            "Upgrade: websocket\r\n"
+            "Connection: Upgrade\r\n"
+            "Sec-WebSocket-Accept: " + accept + "\r\n"
+            "\r\n" + first_frame);
+}
+
+static void
+run_peer(struct ws_peer *peer)
+{
+    std::string message;
+    int nr_frames;
+
+    peer->fd = accept(peer->listen_fd, NULL, NULL);
+    if (peer->fd < 0) {
+        peer->error = "failed to accept";
+        return;
+    }
+
+    // the initial response is fragmented, with a ping among the fragments
+    std::string initial = INITIAL_RESPONSE;
+    if (!peer_handshake(peer, make_frame(0x01, false, initial.substr(0, 20))))
+        goto done;
+    if (peer->bad_accept)
+        goto done;
+
+    if (!peer_write(peer->fd, make_frame(0x09, true, "keepalive") +
+                make_frame(0x00, true, initial.substr(20))))
+        goto done;
+    if (!expect_control(peer, 0x0A, "keepalive"))
+        goto done;
+
+    // a large request comes in several frames
+    if (!read_message(peer, &message, &nr_frames))
+        goto done;
+    if (nr_frames < 2 ||
+            message.find(std::string(NR_DATA_BYTES, 'x')) == std::string::npos) {
+        peer->error = "bad request in " + std::to_string(nr_frames) +
+            " frames";
+        goto done;
+    }
+
+    {
+        size_t pos = message.find("requestId:") + 10;
+        std::string request_id = message.substr(pos,
+                message.find('\n', pos) - pos);
+        std::string response = "type:response\n"
+            "requestId:" + request_id + "\n"
+            "sourceURI:-\n"
+            "result:200/0\n"
+            "dataType:plain\n"
+            "dataLen:" + std::to_string(NR_DATA_BYTES) + "\n"
+            " \n" + std::string(NR_DATA_BYTES, 'y');
+        if (!peer_write(peer->fd, make_frame(0x01, true, response)))
+            goto done;
+    }
+
+    if (!expect_control(peer, 0x09, ""))
+        goto done;
+    if (!peer_write(peer->fd, make_frame(0x0A, true, "")))
+        goto done;
+
+    // endSession, then the closing handshake
+    if (!read_message(peer, &message, &nr_frames))
+        goto done;
+    if (message.find("operation:" PCRDR_OPERATION_ENDSESSION) ==
+            std::string::npos) {
+        peer->error = "expected endSession: " + message;
+        goto done;
+    }
+    if (!expect_control(peer, 0x08, std::string("\x03\xe8", 2)))
+        goto done;
+    peer_write(peer->fd, make_frame(0x08, true, std::string("\x03\xe8", 2)));
+
+done:
+    close(peer->fd);
+}
+
+static bool
+start_peer(struct ws_peer *peer)
+{
+    struct sockaddr_in addr = {};
+    socklen_t len = sizeof(addr);
+
+    peer->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (peer->listen_fd < 0 ||
+            bind(peer->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+            listen(peer->listen_fd, 1) ||
+            getsockname(peer->listen_fd, (struct sockaddr *)&addr, &len))
+        return false;
+
+    peer->port = ntohs(addr.sin_port);
+    peer->thread = std::thread(run_peer, peer);
+    return true;
+}
+
+static void
+stop_peer(struct ws_peer *peer)
+{
+    peer->thread.join();
+    close(peer->listen_fd);
+}
+
+TEST(purcmc, web_socket)
+{
+    PurCInstance purc(false);
+    ASSERT_TRUE(purc);
+
+    struct ws_peer peer = {};
+    ASSERT_TRUE(start_peer(&peer));
+
+    std::string uri = "ws://127.0.0.1:" + std::to_string(peer.port) +
+        "/purcmc";
+    pcrdr_conn *conn = NULL;
+    pcrdr_msg *msg = pcrdr_purcmc_connect(uri.c_str(), APP_NAME, RUNNER_NAME,
+            &conn);
+    ASSERT_NE(msg, nullptr);
+    ASSERT_NE(conn, nullptr);
+    ASSERT_EQ(pcrdr_conn_socket_type(conn), CT_WEB_SOCKET);
+    ASSERT_EQ(msg->type, PCRDR_MSG_TYPE_RESPONSE);
+    ASSERT_EQ(msg->retCode, PCRDR_SC_OK);
+    ASSERT_STREQ(purc_variant_get_string_const(msg->data), INITIAL_DATA);
+    pcrdr_release_message(msg);
+
+    std::string data(NR_DATA_BYTES, 'x');
+    pcrdr_msg *request = pcrdr_make_request_message(
+            PCRDR_MSG_TARGET_SESSION, 0, "echo", NULL, NULL,
+            PCRDR_MSG_ELEMENT_TYPE_VOID, NULL, NULL,
+            PCRDR_MSG_DATA_TYPE_PLAIN, data.c_str(), data.size());
+    ASSERT_NE(request, nullptr);
+
+    pcrdr_msg *response = NULL;
+    int ret = pcrdr_send_request_and_wait_response(conn, request,
+            PCRDR_DEF_TIME_EXPECTED, &response);
+    pcrdr_release_message(request);
+    ASSERT_EQ(ret, 0);
+    ASSERT_NE(response, nullptr);
+    ASSERT_EQ(response->retCode, PCRDR_SC_OK);
+
+    size_t len = 0;
+    purc_variant_get_string_const_ex(response->data, &len);
+    ASSERT_EQ(len, NR_DATA_BYTES);
+    pcrdr_release_message(response);
+
+    // the pong comes back as a packet without data
+    ASSERT_EQ(pcrdr_ping_renderer(conn), 0);
+    ASSERT_EQ(pcrdr_wait_and_dispatch_message(conn, 1000), 0);
+
+    pcrdr_disconnect(conn);
+    stop_peer(&peer);
+    ASSERT_EQ(peer.error, "");
+}
+
+TEST(purcmc, web_socket_bad_handshake)
+{
+    PurCInstance purc(false);
+    ASSERT_TRUE(purc);
+
+    struct ws_peer peer = {};
+    peer.bad_accept = true;
+    ASSERT_TRUE(start_peer(&peer));
+
+    std::string uri = "ws://127.0.0.1:" + std::to_string(peer.port) +
+        "/purcmc";
+    pcrdr_conn *conn = NULL;
+    pcrdr_msg *msg = pcrdr_purcmc_connect(uri.c_str(), APP_NAME, RUNNER_NAME,
+            &conn);
+    ASSERT_EQ(msg, nullptr);
+    ASSERT_EQ(conn, nullptr);
+    ASSERT_EQ(purc_get_last_error(), PCRDR_ERROR_PROTOCOL);
+
+    stop_peer(&peer);
+    ASSERT_EQ(peer.error, "");
+
+    msg = pcrdr_purcmc_connect("wss://127.0.0.1/purcmc", APP_NAME,
+            RUNNER_NAME, &conn);
+    ASSERT_EQ(msg, nullptr);
+    ASSERT_EQ(purc_get_last_error(), PURC_ERROR_NOT_SUPPORTED);
+}
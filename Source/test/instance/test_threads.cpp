@@ -26,6 +26,8 @@
 #include <semaphore.h>
 #include <unistd.h>
 #include <fcntl.h>           /* For O_* constants */
+#include <fstream>
+#include <sstream>
 #include <gtest/gtest.h>
 #include <wtf/Compiler.h>
 
@@ -288,3 +290,101 @@ TEST(instance, threads)
     purc_cleanup();
 }
 
+
+TEST(instance, trace)
+{
+    int ret;
+
+    ret = purc_init_ex(PURC_MODULE_VARIANT, "cn.fmsoft.purc.test", "trace",
+            NULL);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+    ASSERT_TRUE(purc_enable_trace(true));
+
+    main_inst =
+            purc_inst_create_move_buffer(PCINST_MOVE_BUFFER_BROADCAST, 16);
+    ASSERT_NE(main_inst, 0);
+
+    create_thread(0);
+    ASSERT_NE(other_inst[0], 0);
+
+    pcrdr_msg *event;
+    event = pcrdr_make_event_message(
+            PCRDR_MSG_TARGET_INSTANCE,
+            1,
+            "test", NULL,
+            PCRDR_MSG_ELEMENT_TYPE_VOID, NULL, NULL,
+            PCRDR_MSG_DATA_TYPE_VOID, NULL, 0);
+    ASSERT_NE(purc_inst_move_message(other_inst[0], event), 0);
+    pcrdr_release_message(event);
+
+    size_t n;
+    do {
+        ret = purc_inst_holding_messages_count(&n);
+        ASSERT_EQ(ret, 0);
+        if (n > 0) {
+            pcrdr_release_message(purc_inst_take_away_message(0));
+            break;
+        }
+
+        usleep(10000);  // 10m
+    } while (true);
+
+    purc_inst_destroy_move_buffer();
+    pthread_join(other_threads[0], NULL);
+
+    char file[] = "/tmp/purc-test-trace-XXXXXX";
+    int fd = mkstemp(file);
+    ASSERT_GE(fd, 0);
+    close(fd);
+
+    bool dumped = purc_dump_trace(file);
+    purc_enable_trace(false);
+
+    std::ifstream ifs(file);
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    std::string json = ss.str();
+    unlink(file);
+    ASSERT_TRUE(dumped);
+
+    purc_variant_t trace = purc_variant_make_from_json_string(json.c_str(),
+            json.length());
+    ASSERT_NE(trace, PURC_VARIANT_INVALID);
+
+    purc_variant_t events = purc_variant_object_get_by_ckey(trace,
+            "traceEvents");
+    ASSERT_NE(events, PURC_VARIANT_INVALID);
+
+    // both messages are moved from one thread and taken by the other
+    size_t nr_events = purc_variant_array_get_size(events);
+    int nr_moves = 0, nr_takes = 0;
+    bool named = false;
+    for (size_t i = 0; i < nr_events; i++) {
+        purc_variant_t ev = purc_variant_array_get(events, i);
+        const char *name = purc_variant_get_string_const(
+                purc_variant_object_get_by_ckey(ev, "name"));
+        const char *ph = purc_variant_get_string_const(
+                purc_variant_object_get_by_ckey(ev, "ph"));
+
+        if (strcmp(name, "move_message") == 0) {
+            if (strcmp(ph, "b") == 0)
+                nr_moves++;
+            else if (strcmp(ph, "e") == 0)
+                nr_takes++;
+        }
+        else if (strcmp(name, "thread_name") == 0) {
+            purc_variant_t args = purc_variant_object_get_by_ckey(ev, "args");
+            const char *thread = purc_variant_get_string_const(
+                    purc_variant_object_get_by_ckey(args, "name"));
+            if (strstr(thread, "cn.fmsoft.purc.test/thread0"))
+                named = true;
+        }
+    }
+
+    ASSERT_EQ(nr_moves, 2);
+    ASSERT_EQ(nr_takes, 2);
+    ASSERT_TRUE(named);
+
+    purc_variant_unref(trace);
+    purc_cleanup();
+}
@@ -24,6 +24,9 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <string>
+
 
 static const char *calculator_1 =
     "<!DOCTYPE hvml>"
@@ -895,3 +898,258 @@ TEST(interpreter, basic)
     purc_run(NULL);
 }
 
+
+static long long
+run_iterations(size_t nr, unsigned int max_steps, unsigned int max_usecs)
+{
+    PurCInstance purc("cn.fmsoft.hybridos.test", "interpreter", false);
+    if (!purc)
+        return -1;
+
+    if (!purc_set_schedule_budget(max_steps, max_usecs))
+        return -1;
+
+    std::string hvml =
+        "<hvml><body>"
+        "<iterate on 0 onlyif $L.lt($0<, " + std::to_string(nr) + ") "
+        "    with $EJSON.arith_calc('+', $0<, 1) nosetotail >"
+        "  <p>$?</p>"
+        "</iterate>"
+        "</body></hvml>";
+
+    purc_vdom_t vdom = purc_load_hvml_from_string(hvml.c_str());
+    if (!vdom)
+        return -1;
+    purc_schedule_vdom_null(vdom);
+
+    auto t0 = std::chrono::steady_clock::now();
+    purc_run(NULL);
+    auto t1 = std::chrono::steady_clock::now();
+
+    return (long long)std::chrono::duration_cast<
+        std::chrono::microseconds>(t1 - t0).count();
+}
+
+TEST(interpreter, schedule_budget)
+{
+    // NR_ITERATIONS=100000 ./test_interpreter
+    //      --gtest_filter=interpreter.schedule_budget
+    const char *env = getenv("NR_ITERATIONS");
+    size_t nr = env ? strtoul(env, NULL, 10) : 0;
+    if (nr == 0)
+        nr = 2000;
+
+    // one step per scheduling tick, as the scheduler used to do
+    long long one_step = run_iterations(nr, 1, 0);
+    ASSERT_GT(one_step, 0);
+
+    long long sliced = run_iterations(nr, PURC_DEF_SCHED_MAX_STEPS,
+            PURC_DEF_SCHED_MAX_USECS);
+    ASSERT_GT(sliced, 0);
+
+    fprintf(stderr, "%zu iterations: one step per tick %lldus "
+            "(%.0f iterations/s), time-sliced %lldus (%.0f iterations/s)\n",
+            nr, one_step, nr * 1e6 / one_step,
+            sliced, nr * 1e6 / sliced);
+}
+
+struct profile_result {
+    purc_variant_t  profile;
+    std::string     report;
+};
+
+static int
+profiler_cond_handler(purc_cond_t event, void *arg, void *data)
+{
+    (void)data;
+
+    if (event == PURC_COND_COR_EXITED) {
+        purc_coroutine_t cor = (purc_coroutine_t)arg;
+        struct profile_result *result =
+            (struct profile_result *)purc_coroutine_get_user_data(cor);
+
+        result->profile = purc_coroutine_get_profile(cor);
+
+        purc_rwstream_t stm = purc_rwstream_new_buffer(1024, 1024 * 1024);
+        purc_coroutine_dump_profile(cor, stm);
+        size_t len;
+        const char *buf = (const char *)purc_rwstream_get_mem_buffer(stm,
+                &len);
+        result->report.assign(buf, len);
+        purc_rwstream_destroy(stm);
+    }
+
+    return 0;
+}
+
+TEST(interpreter, profiler)
+{
+    PurCInstance purc("cn.fmsoft.hybridos.test", "interpreter", false);
+    ASSERT_TRUE(purc);
+
+    ASSERT_TRUE(purc_enable_profiler(true));
+
+    const char *hvml =
+        "<hvml><body>\n"
+        "<iterate on 0 onlyif $L.lt($0<, 10) "
+        "    with $EJSON.arith_calc('+', $0<, 1) nosetotail >\n"
+        "  <p>$?</p>\n"
+        "</iterate>\n"
+        "</body></hvml>";
+
+    purc_vdom_t vdom = purc_load_hvml_from_string(hvml);
+    ASSERT_NE(vdom, nullptr);
+
+    struct profile_result result = { PURC_VARIANT_INVALID, "" };
+    purc_coroutine_t cor = purc_schedule_vdom(vdom, 0, PURC_VARIANT_INVALID,
+            PCRDR_PAGE_TYPE_NULL, NULL, NULL, NULL, NULL, NULL, &result);
+    ASSERT_NE(cor, nullptr);
+    purc_run(profiler_cond_handler);
+
+    purc_enable_profiler(false);
+
+    ASSERT_NE(result.profile, PURC_VARIANT_INVALID);
+    purc_variant_t elements = purc_variant_object_get_by_ckey(result.profile,
+            "elements");
+    ASSERT_NE(elements, PURC_VARIANT_INVALID);
+
+    bool found = false;
+    size_t nr = purc_variant_array_get_size(elements);
+    for (size_t i = 0; i < nr; i++) {
+        purc_variant_t elem = purc_variant_array_get(elements, i);
+        purc_variant_t tag = purc_variant_object_get_by_ckey(elem, "tag");
+        if (strcmp(purc_variant_get_string_const(tag), "iterate"))
+            continue;
+
+        found = true;
+        uint64_t u;
+        purc_variant_t v = purc_variant_object_get_by_ckey(elem, "line");
+        ASSERT_TRUE(purc_variant_cast_to_ulongint(v, &u, false));
+        ASSERT_EQ(u, 2);
+        v = purc_variant_object_get_by_ckey(elem, "column");
+        ASSERT_TRUE(purc_variant_cast_to_ulongint(v, &u, false));
+        ASSERT_EQ(u, 1);
+
+        // the expressions of `onlyif` and `with` are evaluated per iteration
+        v = purc_variant_object_get_by_ckey(elem, "evals");
+        v = purc_variant_object_get_by_ckey(v, "count");
+        ASSERT_TRUE(purc_variant_cast_to_ulongint(v, &u, false));
+        ASSERT_GE(u, 10);
+    }
+    ASSERT_TRUE(found);
+
+    purc_variant_t methods = purc_variant_object_get_by_ckey(result.profile,
+            "methods");
+    ASSERT_NE(methods, PURC_VARIANT_INVALID);
+    ASSERT_GT(purc_variant_array_get_size(methods), 0);
+    purc_variant_unref(result.profile);
+
+    ASSERT_NE(result.report.find("Flat profile"), std::string::npos);
+    ASSERT_NE(result.report.find("Hierarchical profile"), std::string::npos);
+    ASSERT_NE(result.report.find("$EJSON.arith_calc"), std::string::npos);
+    ASSERT_NE(result.report.find("<iterate> @2:1"), std::string::npos);
+}
+
+static long long
+run_define_calls(size_t nr, bool dynamic_ids)
+{
+    PurCInstance purc("cn.fmsoft.hybridos.test", "interpreter", false);
+    if (!purc)
+        return -1;
+
+    // the <define> is bound at an ancestor eight levels up by its id.
+    std::string open, close;
+    for (int i = 0; i < 8; i++) {
+        std::string id = "level" + std::to_string(i);
+        if (dynamic_ids)
+            open += "<div id=\"$STR.join('level', '" + std::to_string(i) +
+                "')\">";
+        else
+            open += "<div id=\"" + id + "\">";
+        close += "</div>";
+    }
+
+    std::string hvml =
+        "<hvml><body id=\"anchor\">" + open +
+        "<iterate on 0 onlyif $L.lt($0<, " + std::to_string(nr) + ") "
+        "    with $EJSON.arith_calc('+', $0<, 1) nosetotail >"
+        "  <define as=\"snippet\" at=\"#anchor\">"
+        "    <return with $? />"
+        "  </define>"
+        "  <call on $snippet with $? />"
+        "</iterate>" + close +
+        "</body></hvml>";
+
+    purc_vdom_t vdom = purc_load_hvml_from_string(hvml.c_str());
+    if (!vdom)
+        return -1;
+    purc_schedule_vdom_null(vdom);
+
+    auto t0 = std::chrono::steady_clock::now();
+    purc_run(NULL);
+    auto t1 = std::chrono::steady_clock::now();
+
+    return (long long)std::chrono::duration_cast<
+        std::chrono::microseconds>(t1 - t0).count();
+}
+
+TEST(interpreter, define_at_id)
+{
+    // NR_DEFINE_CALLS=10000 ./test_interpreter
+    //      --gtest_filter=interpreter.define_at_id
+    const char *env = getenv("NR_DEFINE_CALLS");
+    size_t nr = env ? strtoul(env, NULL, 10) : 0;
+    if (nr == 0)
+        nr = 2000;
+
+    // the ids are looked up in the index of the vdom
+    long long indexed = run_define_calls(nr, false);
+    ASSERT_GT(indexed, 0);
+
+    // the ids are expressions evaluated on every lookup
+    long long evaluated = run_define_calls(nr, true);
+    ASSERT_GT(evaluated, 0);
+
+    fprintf(stderr, "%zu define/call: static ids %lldus, "
+            "ids evaluated %lldus\n", nr, indexed, evaluated);
+}
+
+TEST(interpreter, call_concurrently_fan_out)
+{
+    // NR_CONCURRENT_CALLS=1000 ./test_interpreter
+    //      --gtest_filter=interpreter.call_concurrently_fan_out
+    const char *env = getenv("NR_CONCURRENT_CALLS");
+    size_t nr = env ? strtoul(env, NULL, 10) : 0;
+    if (nr == 0)
+        nr = 200;
+
+    PurCInstance purc("cn.fmsoft.hybridos.test", "interpreter", false);
+    ASSERT_TRUE(purc);
+
+    // the vdom of the child coroutines is generated for the first call only
+    std::string hvml =
+        "<!DOCTYPE hvml>"
+        "<hvml target=\"void\">"
+        "<define as \"task\">"
+        "  <return with $? />"
+        "</define>"
+        "<iterate on 0 onlyif $L.lt($0<, " + std::to_string(nr) + ") "
+        "    with $EJSON.arith_calc('+', $0<, 1) nosetotail >"
+        "  <call on $task as \"worker\" with $? "
+        "      concurrently asynchronously />"
+        "</iterate>"
+        "</hvml>";
+
+    purc_vdom_t vdom = purc_load_hvml_from_string(hvml.c_str());
+    ASSERT_NE(vdom, nullptr);
+    purc_schedule_vdom_null(vdom);
+
+    auto t0 = std::chrono::steady_clock::now();
+    purc_run(NULL);
+    auto t1 = std::chrono::steady_clock::now();
+
+    long long usecs = (long long)std::chrono::duration_cast<
+        std::chrono::microseconds>(t1 - t0).count();
+    fprintf(stderr, "%zu concurrent calls: %lldus (%.0f calls/s)\n",
+            nr, usecs, nr * 1e6 / (usecs ? usecs : 1));
+}
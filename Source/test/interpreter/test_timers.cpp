@@ -0,0 +1,198 @@
+/*
+** Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+**
+** This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "purc.h"
+#include "private/timer.h"
+#include "../helpers.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <vector>
+
+struct oneshot {
+    pcintr_timer_t      timer;
+    uint64_t            due;
+    uint64_t            fired;
+    bool                cancelled;
+};
+
+struct oneshot_ctxt {
+    size_t              nr_pending;
+    size_t              nr_fired;
+    size_t              nr_early;
+    size_t              nr_cancelled_fired;
+    uint64_t            max_late;
+};
+
+static struct oneshot_ctxt oneshot_ctxt;
+
+static uint64_t
+now_ms(void)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void
+oneshot_fired(pcintr_timer_t timer, const char *id, void *data)
+{
+    UNUSED_PARAM(timer);
+    UNUSED_PARAM(id);
+
+    struct oneshot *os = (struct oneshot *)data;
+    os->fired = now_ms();
+    oneshot_ctxt.nr_fired++;
+
+    if (os->cancelled) {
+        oneshot_ctxt.nr_cancelled_fired++;
+    }
+    if (os->fired < os->due) {
+        oneshot_ctxt.nr_early++;
+    }
+    else if (os->fired - os->due > oneshot_ctxt.max_late) {
+        oneshot_ctxt.max_late = os->fired - os->due;
+    }
+
+    if (--oneshot_ctxt.nr_pending == 0) {
+        purc_runloop_stop(purc_runloop_get_current());
+    }
+}
+
+TEST(timers, oneshot_flood)
+{
+    // NR_TIMERS=1000000 ./test_timers --gtest_filter=timers.oneshot_flood
+    const char *env = getenv("NR_TIMERS");
+    size_t nr = env ? strtoul(env, NULL, 10) : 0;
+    if (nr == 0)
+        nr = 100000;
+
+    PurCInstance purc(false);
+    ASSERT_TRUE(purc);
+
+    std::vector<struct oneshot> timers(nr);
+    oneshot_ctxt = {};
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < nr; i++) {
+        struct oneshot *os = &timers[i];
+        uint32_t interval = 1 + (i * 7919) % 1000;
+
+        os->timer = pcintr_timer_create(NULL, NULL, oneshot_fired, os);
+        ASSERT_NE(os->timer, nullptr);
+        pcintr_timer_set_interval(os->timer, interval);
+        os->due = now_ms() + interval;
+        pcintr_timer_start_oneshot(os->timer);
+    }
+
+    auto t1 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < nr; i += 3) {
+        timers[i].cancelled = true;
+        pcintr_timer_stop(timers[i].timer);
+    }
+    oneshot_ctxt.nr_pending = nr - (nr + 2) / 3;
+
+    auto t2 = std::chrono::steady_clock::now();
+    purc_runloop_run();
+    auto t3 = std::chrono::steady_clock::now();
+
+    size_t nr_active = 0;
+    for (size_t i = 0; i < nr; i++) {
+        if (pcintr_timer_is_active(timers[i].timer))
+            nr_active++;
+        pcintr_timer_destroy(timers[i].timer);
+    }
+
+    ASSERT_EQ(oneshot_ctxt.nr_fired, nr - (nr + 2) / 3);
+    ASSERT_EQ(oneshot_ctxt.nr_cancelled_fired, 0);
+    ASSERT_EQ(oneshot_ctxt.nr_early, 0);
+    ASSERT_EQ(nr_active, 0);
+
+    auto us = [](std::chrono::steady_clock::duration d) {
+        return (long long)std::chrono::duration_cast<
+            std::chrono::microseconds>(d).count();
+    };
+    fprintf(stderr, "%zu timers: started in %lldus, %zu stopped in %lldus, "
+            "fired in %lldus (latest by %llums)\n",
+            nr, us(t1 - t0), (nr + 2) / 3, us(t2 - t1), us(t3 - t2),
+            (unsigned long long)oneshot_ctxt.max_late);
+}
+
+struct repeating {
+    pcintr_timer_t      timer;
+    size_t              nr_fired;
+    size_t              nr_stop;
+    pcintr_timer_t      oneshot;
+};
+
+static void
+repeating_fired(pcintr_timer_t timer, const char *id, void *data)
+{
+    UNUSED_PARAM(id);
+
+    struct repeating *rp = (struct repeating *)data;
+    if (++rp->nr_fired == rp->nr_stop) {
+        pcintr_timer_stop(timer);
+        purc_runloop_stop(purc_runloop_get_current());
+    }
+}
+
+static void
+never_fired(pcintr_timer_t timer, const char *id, void *data)
+{
+    UNUSED_PARAM(timer);
+    UNUSED_PARAM(id);
+
+    struct repeating *rp = (struct repeating *)data;
+    rp->nr_fired = 0;
+}
+
+TEST(timers, repeating)
+{
+    PurCInstance purc(false);
+    ASSERT_TRUE(purc);
+
+    struct repeating rp = {};
+    rp.nr_stop = 10;
+    rp.timer = pcintr_timer_create(NULL, "repeating", repeating_fired, &rp);
+    ASSERT_NE(rp.timer, nullptr);
+    pcintr_timer_set_interval(rp.timer, 20);
+    ASSERT_EQ(pcintr_timer_get_interval(rp.timer), 20);
+
+    // a timer destroyed while it is pending never fires
+    rp.oneshot = pcintr_timer_create(NULL, NULL, never_fired, &rp);
+    ASSERT_NE(rp.oneshot, nullptr);
+    pcintr_timer_set_interval(rp.oneshot, 30);
+    pcintr_timer_start_oneshot(rp.oneshot);
+    ASSERT_TRUE(pcintr_timer_is_active(rp.oneshot));
+    pcintr_timer_destroy(rp.oneshot);
+
+    auto t0 = std::chrono::steady_clock::now();
+    pcintr_timer_start(rp.timer);
+    ASSERT_TRUE(pcintr_timer_is_active(rp.timer));
+    purc_runloop_run();
+    auto t1 = std::chrono::steady_clock::now();
+
+    ASSERT_EQ(rp.nr_fired, rp.nr_stop);
+    ASSERT_FALSE(pcintr_timer_is_active(rp.timer));
+    ASSERT_GE(t1 - t0, std::chrono::milliseconds(200));
+    pcintr_timer_destroy(rp.timer);
+}
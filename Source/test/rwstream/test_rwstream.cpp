@@ -22,14 +22,20 @@
 #include "purc-rwstream.h"
 #include "purc-utils.h"
 #include "config.h"
+#include "private/rwstream.h"
 
 #include <stdio.h>
 #include <errno.h>
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <string>
+#include <vector>
+
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h>
 
 
 void create_temp_file(const char* file, const char* buf, size_t buf_len)
@@ -1353,3 +1359,210 @@ TEST(dump_rwstream, mem_buffer)
     ret = purc_rwstream_destroy (rws);
     ASSERT_EQ(ret, 0);
 }
+
+/* line reader */
+struct chunked_source {
+    const std::string *data;
+    size_t pos;
+    size_t chunk;       // the maximal bytes returned by a read
+};
+
+static ssize_t read_chunked(void *ctxt, void *buf, size_t count)
+{
+    struct chunked_source *src = (struct chunked_source *)ctxt;
+    size_t n = src->data->size() - src->pos;
+    if (n > count)
+        n = count;
+    if (n > src->chunk)
+        n = src->chunk;
+    memcpy(buf, src->data->data() + src->pos, n);
+    src->pos += n;
+    return n;
+}
+
+static std::vector<std::string>
+read_all_lines(purc_rwstream_t rws, size_t max_len)
+{
+    std::vector<std::string> lines;
+    struct pcutils_line_reader *reader = pcutils_line_reader_new(rws, max_len);
+    const char *line;
+    size_t len;
+
+    while (pcutils_line_reader_next(reader, &line, &len) > 0)
+        lines.push_back(std::string(line, len));
+
+    pcutils_line_reader_delete(reader);
+    return lines;
+}
+
+TEST(line_reader, long_lines)
+{
+    std::vector<std::string> expected = {
+        "", "a", std::string(70000, 'x'), "crlf", "",
+        std::string(200000, 'y') + "\r", "no terminator",
+    };
+    std::string data = "\na\n" + expected[2] + "\ncrlf\r\n\r\n" +
+        expected[5] + "\r\n" + expected[6];
+
+    // lines crossing the buffer boundary and the boundaries of the reads
+    size_t chunks[] = { 1, 7, 1024, 65536, data.size() };
+    for (size_t i = 0; i < PCA_TABLESIZE(chunks); i++) {
+        struct chunked_source src = { &data, 0, chunks[i] };
+        purc_rwstream_t rws = purc_rwstream_new_for_read(&src, read_chunked);
+        ASSERT_NE(rws, nullptr);
+
+        std::vector<std::string> lines = read_all_lines(rws, 0);
+        ASSERT_EQ(lines, expected) << "chunk: " << chunks[i];
+        purc_rwstream_destroy(rws);
+    }
+}
+
+TEST(line_reader, max_length)
+{
+    // "中" takes 3 bytes in UTF-8
+    char buf[] = "abcdefgh\nab\xe4\xb8\xad\xe4\xb8\xad\n";
+    purc_rwstream_t rws = purc_rwstream_new_from_mem(buf, strlen(buf));
+    ASSERT_NE(rws, nullptr);
+
+    std::vector<std::string> lines = read_all_lines(rws, 4);
+    std::vector<std::string> expected = {
+        "abcd", "efgh", "ab", "\xe4\xb8\xad", "\xe4\xb8\xad",
+    };
+    ASSERT_EQ(lines, expected);
+    purc_rwstream_destroy(rws);
+}
+
+TEST(line_reader, nonblock)
+{
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+
+    purc_rwstream_t rws = purc_rwstream_new_from_unix_fd(fds[0]);
+    ASSERT_NE(rws, nullptr);
+    struct pcutils_line_reader *reader = pcutils_line_reader_new(rws, 0);
+    const char *line;
+    size_t len;
+
+    // a partial line is kept until the rest of it comes
+    ASSERT_EQ(write(fds[1], "first\nsec", 9), 9);
+    ASSERT_EQ(pcutils_line_reader_next(reader, &line, &len), 1);
+    ASSERT_EQ(std::string(line, len), "first");
+    ASSERT_EQ(pcutils_line_reader_next(reader, &line, &len), 0);
+    ASSERT_EQ(pcutils_line_reader_buffered(reader), 3);
+
+    // the pipe is not seekable; the bytes buffered are kept
+    ASSERT_EQ(pcutils_line_reader_sync(reader), -1);
+    ASSERT_EQ(pcutils_line_reader_buffered(reader), 3);
+    purc_clr_error();
+
+    ASSERT_EQ(write(fds[1], "ond\nlast", 8), 8);
+    ASSERT_EQ(pcutils_line_reader_next(reader, &line, &len), 1);
+    ASSERT_EQ(std::string(line, len), "second");
+    ASSERT_EQ(pcutils_line_reader_next(reader, &line, &len), 0);
+
+    // the end of the stream
+    close(fds[1]);
+    ASSERT_EQ(pcutils_line_reader_next(reader, &line, &len), 1);
+    ASSERT_EQ(std::string(line, len), "last");
+    ASSERT_EQ(pcutils_line_reader_next(reader, &line, &len), 0);
+
+    pcutils_line_reader_delete(reader);
+    purc_rwstream_destroy(rws);
+    close(fds[0]);
+}
+
+TEST(line_reader, read_and_sync)
+{
+    char buf[] = "line 1\nline 2\nline 3\n";
+    purc_rwstream_t rws = purc_rwstream_new_from_mem(buf, strlen(buf));
+    ASSERT_NE(rws, nullptr);
+    struct pcutils_line_reader *reader = pcutils_line_reader_new(rws, 0);
+    const char *line;
+    size_t len;
+
+    ASSERT_EQ(pcutils_line_reader_next(reader, &line, &len), 1);
+    ASSERT_EQ(std::string(line, len), "line 1");
+
+    char bytes[4];
+    ASSERT_EQ(pcutils_line_reader_read(reader, bytes, 4), 4);
+    ASSERT_EQ(std::string(bytes, 4), "line");
+    ASSERT_EQ(pcutils_line_reader_buffered(reader), 10);
+
+    // give the bytes buffered back to the stream
+    ASSERT_EQ(pcutils_line_reader_sync(reader), 0);
+    ASSERT_EQ(pcutils_line_reader_buffered(reader), 0);
+    ASSERT_EQ(purc_rwstream_tell(rws), 11);
+
+    ASSERT_EQ(pcutils_line_reader_next(reader, &line, &len), 1);
+    ASSERT_EQ(std::string(line, len), " 2");
+
+    pcutils_line_reader_delete(reader);
+    purc_rwstream_destroy(rws);
+}
+
+struct repeated_source {
+    std::string block;
+    size_t left;
+};
+
+static ssize_t read_repeated(void *ctxt, void *buf, size_t count)
+{
+    struct repeated_source *src = (struct repeated_source *)ctxt;
+    size_t n = count < src->left ? count : src->left;
+    size_t done = 0;
+    while (done < n) {
+        size_t off = (src->left - done) % src->block.size();
+        size_t pos = off ? src->block.size() - off : 0;
+        size_t m = src->block.size() - pos;
+        if (m > n - done)
+            m = n - done;
+        memcpy((char *)buf + done, src->block.data() + pos, m);
+        done += m;
+    }
+    src->left -= n;
+    return n;
+}
+
+/* The size of the input in MiB can be given by READLINES_MB, e.g.,
+   READLINES_MB=4096 ./test_rwstream --gtest_filter=line_reader.throughput */
+TEST(line_reader, throughput)
+{
+    size_t nr_mb = 256;
+    const char *env = getenv("READLINES_MB");
+    if (env && atoi(env) > 0)
+        nr_mb = atoi(env);
+
+    // 1 MiB of the lines in different lengths
+    struct repeated_source src;
+    size_t nr_block_lines = 0;
+    while (src.block.size() < 1024 * 1024 - 200) {
+        src.block += std::string(20 + (nr_block_lines * 37) % 150, 'l');
+        src.block += (nr_block_lines % 2) ? "\r\n" : "\n";
+        nr_block_lines++;
+    }
+    src.block += std::string(1024 * 1024 - src.block.size() - 1, 'e');
+    src.block += "\n";
+    nr_block_lines++;
+    src.left = nr_mb * src.block.size();
+
+    purc_rwstream_t rws = purc_rwstream_new_for_read(&src, read_repeated);
+    struct pcutils_line_reader *reader = pcutils_line_reader_new(rws, 0);
+    const char *line;
+    size_t len, nr_lines = 0, nr_bytes = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    while (pcutils_line_reader_next(reader, &line, &len) > 0) {
+        nr_lines++;
+        nr_bytes += len;
+    }
+    auto end = std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(end - start).count();
+
+    ASSERT_EQ(nr_lines, nr_mb * nr_block_lines);
+    fprintf(stderr, "line reader: %zu MiB, %zu lines in %.3f s, %.1f MiB/s\n",
+            nr_mb, nr_lines, secs, nr_mb / (secs > 0 ? secs : 1e-9));
+
+    pcutils_line_reader_delete(reader);
+    purc_rwstream_destroy(rws);
+}
@@ -27,6 +27,7 @@
 #include "private/rbtree.h"
 #include "private/atom-buckets.h"
 #include "private/sorted-array.h"
+#include "private/utf8.h"
 
 #include "../helpers.h"
 
@@ -36,6 +37,9 @@
 #include <errno.h>
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <string>
+
 #define ATOM_BUCKET     1
 
 static struct atom_info {
@@ -1709,3 +1713,153 @@ TEST(utils, url)
     }
 }
 
+
+/* validates one character per RFC 3629, returns its length or 0 */
+static size_t
+utf8_char_ref(const unsigned char *p, size_t left)
+{
+    size_t n;
+    uint32_t uc;
+
+    if (p[0] < 0x80)
+        return p[0] ? 1 : 0;
+    else if (p[0] >= 0xc2 && p[0] < 0xe0) {
+        n = 2; uc = p[0] & 0x1f;
+    }
+    else if (p[0] >= 0xe0 && p[0] < 0xf0) {
+        n = 3; uc = p[0] & 0x0f;
+    }
+    else if (p[0] >= 0xf0 && p[0] < 0xf5) {
+        n = 4; uc = p[0] & 0x07;
+    }
+    else
+        return 0;
+
+    if (left < n)
+        return 0;
+    for (size_t i = 1; i < n; i++) {
+        if ((p[i] & 0xc0) != 0x80)
+            return 0;
+        uc = (uc << 6) | (p[i] & 0x3f);
+    }
+
+    if ((n == 3 && uc < 0x800) || (n == 4 && uc < 0x10000) ||
+            uc > 0x10ffff || (uc >= 0xd800 && uc <= 0xdfff))
+        return 0;
+    return n;
+}
+
+static const char *
+check_utf8_ref(const std::string &str, size_t *nr_chars)
+{
+    const unsigned char *p = (const unsigned char *)str.data();
+    size_t left = str.size();
+
+    *nr_chars = 0;
+    while (left) {
+        size_t n = utf8_char_ref(p, left);
+        if (n == 0)
+            break;
+        p += n;
+        left -= n;
+        (*nr_chars)++;
+    }
+
+    return str.data() + (str.size() - left);
+}
+
+static void
+append_mixed_chars(std::string &str, size_t len, bool broken)
+{
+    static const char *chars[] = {
+        "a", "Z", " ", "0", "\xc3\xa9", "\xd0\xb4", "\xe4\xb8\xad",
+        "\xe6\x96\x87", "\xf0\x9f\x98\x80", "\xed\x9f\xbf",
+    };
+    static const char *bad[] = {
+        "\x80", "\xc0\xaf", "\xe0\x80\xaf", "\xed\xa0\x80", "\xf4\x90\x80\x80",
+        "\xf8", "\xe4\xb8", "\xc3",
+    };
+
+    while (str.size() < len) {
+        if (broken && random() % 64 == 0)
+            str += bad[random() % PCA_TABLESIZE(bad)];
+        else if (random() % 2)
+            str += std::string(random() % 40, 'x');
+        else
+            str += chars[random() % PCA_TABLESIZE(chars)];
+    }
+}
+
+TEST(utils, utf8_check)
+{
+    srandom(1);
+    for (int i = 0; i < 20000; i++) {
+        std::string str;
+        append_mixed_chars(str, random() % 300, i % 2);
+
+        size_t len = str.size();
+        if (i % 5 == 0 && len > 0)
+            len -= random() % 4 % len;     /* cut a char */
+        str.resize(len);
+
+        size_t nr_ref, nr_chars;
+        const char *end_ref = check_utf8_ref(str, &nr_ref), *end;
+        bool valid = pcutils_string_check_utf8_len(str.data(), str.size(),
+                &nr_chars, &end);
+        ASSERT_EQ(end, end_ref) << "case " << i;
+        ASSERT_EQ(nr_chars, nr_ref) << "case " << i;
+        ASSERT_EQ(valid, end_ref == str.data() + str.size());
+        ASSERT_EQ(pcutils_string_utf8_chars(str.data(), end - str.data()),
+                nr_ref);
+
+        valid = pcutils_string_check_utf8(str.c_str(), -1, NULL, &end);
+        ASSERT_EQ(end, end_ref);
+    }
+
+    /* stops at the null character */
+    const char str[] = "\xe4\xb8\xad" "abc\0def";
+    size_t nr_chars;
+    const char *end;
+    ASSERT_FALSE(pcutils_string_check_utf8_len(str, sizeof(str) - 1,
+                &nr_chars, &end));
+    ASSERT_EQ(end, str + 6);
+    ASSERT_EQ(nr_chars, 4);
+    ASSERT_EQ(pcutils_string_utf8_chars(str, sizeof(str) - 1), 4);
+    ASSERT_EQ(pcutils_string_utf8_chars("\xe4\xb8\xad\xe6\x96", 5), 1);
+}
+
+TEST(utils, utf8_perf)
+{
+    // UTF8_MBYTES=64 ./test_utils --gtest_filter=utils.utf8_perf
+    const char *env = getenv("UTF8_MBYTES");
+    size_t mb = env ? strtoul(env, NULL, 10) : 0;
+    if (mb == 0)
+        mb = 4;
+
+    srandom(1);
+    std::string str;
+    append_mixed_chars(str, mb * 1024 * 1024, false);
+
+    size_t nr_ref;
+    auto t0 = std::chrono::steady_clock::now();
+    check_utf8_ref(str, &nr_ref);
+    auto t1 = std::chrono::steady_clock::now();
+
+    size_t nr_chars;
+    ASSERT_TRUE(pcutils_string_check_utf8_len(str.data(), str.size(),
+                &nr_chars, NULL));
+    ASSERT_EQ(nr_chars, nr_ref);
+    auto t2 = std::chrono::steady_clock::now();
+
+    ASSERT_EQ(pcutils_string_utf8_chars(str.data(), str.size()), nr_ref);
+    auto t3 = std::chrono::steady_clock::now();
+
+    auto us = [](std::chrono::steady_clock::time_point a,
+            std::chrono::steady_clock::time_point b) {
+        return (long long)std::chrono::duration_cast<
+            std::chrono::microseconds>(b - a).count();
+    };
+    fprintf(stderr, "%zu bytes, %zu chars: reference %lldus, "
+            "check %lldus, count %lldus\n", str.size(), nr_ref,
+            us(t0, t1), us(t1, t2), us(t2, t3));
+}
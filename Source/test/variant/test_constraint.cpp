@@ -502,6 +502,71 @@ TEST(constraint, set_child_in_different_positions)
     PURC_VARIANT_SAFE_CLEAR(set);
 }
 
+TEST(constraint, set_reindex_only_on_unique_keys)
+{
+    PurCInstance purc;
+
+    const char *s;
+    purc_variant_t set, elem, extra, v, name, found;
+    bool silently = true;
+    bool ok;
+
+    s = "[!name, {name:xu, extra:{n:foo}}, {name:xue, extra:{n:bar}}]";
+    set = pcejson_parser_parse_string(s, 0, 0);
+    ASSERT_NE(set, nullptr);
+
+    variant_set_t data = (variant_set_t)set->sz_ptr[1];
+    size_t nr_reindexes = data->nr_reindexes;
+
+    elem = purc_variant_set_get_by_index(set, 0);
+    ASSERT_NE(elem, nullptr);
+    extra = purc_variant_object_get_by_ckey(elem, "extra");
+    ASSERT_NE(extra, nullptr);
+
+    v = purc_variant_make_string("baz", false);
+    ASSERT_NE(v, nullptr);
+
+    // nested field which is not a part of the unique key
+    ok = purc_variant_object_set_by_static_ckey(extra, "n", v);
+    ASSERT_TRUE(ok);
+    ASSERT_EQ(data->nr_reindexes, nr_reindexes);
+
+    // direct field which is not a part of the unique key
+    ok = purc_variant_object_set_by_static_ckey(elem, "other", v);
+    ASSERT_TRUE(ok);
+    ASSERT_EQ(data->nr_reindexes, nr_reindexes);
+
+    ok = purc_variant_object_remove_by_static_ckey(elem, "other", silently);
+    ASSERT_TRUE(ok);
+    ASSERT_EQ(data->nr_reindexes, nr_reindexes);
+
+    // the unique key
+    name = purc_variant_make_string("xiaohong", false);
+    ASSERT_NE(name, nullptr);
+    ok = purc_variant_object_set_by_static_ckey(elem, "name", name);
+    ASSERT_TRUE(ok);
+    ASSERT_EQ(data->nr_reindexes, nr_reindexes + 1);
+
+    found = purc_variant_set_get_member_by_key_values(set, name, silently);
+    ASSERT_EQ(found, elem);
+
+    ASSERT_EQ(0, var_diff(set, "[!name, {name:xiaohong, extra:{n:baz}}, {name:xue, extra:{n:bar}}]"));
+
+    // duplicated unique key shall be rejected without re-indexing
+    PURC_VARIANT_SAFE_CLEAR(name);
+    name = purc_variant_make_string("xue", false);
+    ASSERT_NE(name, nullptr);
+    ok = purc_variant_object_set_by_static_ckey(elem, "name", name);
+    ASSERT_FALSE(ok);
+    ASSERT_EQ(data->nr_reindexes, nr_reindexes + 1);
+
+    ASSERT_EQ(0, var_diff(set, "[!name, {name:xiaohong, extra:{n:baz}}, {name:xue, extra:{n:bar}}]"));
+
+    PURC_VARIANT_SAFE_CLEAR(name);
+    PURC_VARIANT_SAFE_CLEAR(v);
+    PURC_VARIANT_SAFE_CLEAR(set);
+}
+
 TEST(constraint, perf)
 {
     PurCInstance purc;
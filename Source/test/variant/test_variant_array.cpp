@@ -26,6 +26,8 @@
 
 #include <stdio.h>
 #include <errno.h>
+#include <chrono>
+#include <vector>
 #include <gtest/gtest.h>
 
 TEST(variant_array, init_with_1_str)
@@ -533,3 +535,140 @@ TEST(variant_array, sort)
     ASSERT_STREQ(inbuf, outbuf);
 }
 
+
+TEST(variant_array, prepend_insert_remove)
+{
+    purc_instance_extra_info info = {};
+    int ret = 0;
+    bool cleanup = false;
+
+    ret = purc_init_ex (PURC_MODULE_VARIANT, "cn.fmsoft.hybridos.test",
+            "test_init", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    purc_variant_t arr = purc_variant_make_array(0, PURC_VARIANT_INVALID);
+    ASSERT_NE(arr, nullptr);
+
+    std::vector<int64_t> expected;
+    for (int64_t i = 0; i < 1000; ++i) {
+        purc_variant_t v = purc_variant_make_longint(i);
+        bool ok;
+        switch (i % 4) {
+            case 0:
+                ok = purc_variant_array_prepend(arr, v);
+                expected.insert(expected.begin(), i);
+                break;
+            case 1:
+                ok = purc_variant_array_append(arr, v);
+                expected.push_back(i);
+                break;
+            case 2:
+                ok = purc_variant_array_insert_before(arr,
+                        expected.size() / 2, v);
+                expected.insert(expected.begin() + expected.size() / 2, i);
+                break;
+            default:
+                ok = purc_variant_array_remove(arr, expected.size() / 3);
+                expected.erase(expected.begin() + expected.size() / 3);
+                break;
+        }
+        purc_variant_unref(v);
+        ASSERT_TRUE(ok);
+    }
+
+    ASSERT_EQ(purc_variant_array_get_size(arr), expected.size());
+
+    size_t idx;
+    purc_variant_t v;
+    foreach_value_in_variant_array(arr, v, idx) {
+        int64_t i64;
+        ASSERT_TRUE(purc_variant_cast_to_longint(v, &i64, false));
+        ASSERT_EQ(i64, expected[idx]);
+    } end_foreach;
+
+    foreach_value_in_variant_array_reverse_safe(arr, v, idx) {
+        int64_t i64;
+        ASSERT_TRUE(purc_variant_cast_to_longint(v, &i64, false));
+        ASSERT_EQ(i64, expected[idx]);
+        if (idx % 2) {
+            ASSERT_TRUE(purc_variant_array_remove(arr, idx));
+        }
+    } end_foreach;
+
+    ASSERT_EQ(purc_variant_array_get_size(arr), (expected.size() + 1) / 2);
+    for (size_t i = 0; i < (expected.size() + 1) / 2; ++i) {
+        int64_t i64;
+        v = purc_variant_array_get(arr, i);
+        ASSERT_TRUE(purc_variant_cast_to_longint(v, &i64, false));
+        ASSERT_EQ(i64, expected[i * 2]);
+    }
+
+    purc_variant_unref(arr);
+
+    cleanup = purc_cleanup ();
+    ASSERT_EQ (cleanup, true);
+}
+
+TEST(variant_array, perf)
+{
+    purc_instance_extra_info info = {};
+    int ret = 0;
+    bool cleanup = false;
+
+    ret = purc_init_ex (PURC_MODULE_VARIANT, "cn.fmsoft.hybridos.test",
+            "test_init", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    // NR_ITEMS=100000 ./test_variant_array --gtest_filter=variant_array.perf
+    const char *env = getenv("NR_ITEMS");
+    size_t nr = env ? strtoul(env, NULL, 10) : 0;
+    if (nr == 0)
+        nr = 1024 * 8;
+
+    purc_variant_t arr = purc_variant_make_array(0, PURC_VARIANT_INVALID);
+    ASSERT_NE(arr, nullptr);
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < nr; ++i) {
+        purc_variant_t v = purc_variant_make_ulongint(i);
+        ASSERT_TRUE(purc_variant_array_prepend(arr, v));
+        purc_variant_unref(v);
+    }
+
+    auto t1 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < nr; ++i) {
+        purc_variant_t v = purc_variant_make_ulongint(i);
+        ASSERT_TRUE(purc_variant_array_insert_before(arr, nr / 2, v));
+        purc_variant_unref(v);
+    }
+
+    auto t2 = std::chrono::steady_clock::now();
+    uint64_t sum = 0;
+    size_t idx;
+    purc_variant_t v;
+    foreach_value_in_variant_array(arr, v, idx) {
+        sum += idx + v->u64;
+    } end_foreach;
+    ASSERT_GT(sum, 0);
+
+    auto t3 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < nr; ++i) {
+        ASSERT_TRUE(purc_variant_array_remove(arr, 0));
+    }
+
+    auto t4 = std::chrono::steady_clock::now();
+
+    auto us = [](std::chrono::steady_clock::time_point a,
+            std::chrono::steady_clock::time_point b) {
+        return (long long)std::chrono::duration_cast<
+            std::chrono::microseconds>(b - a).count();
+    };
+    fprintf(stderr, "%zu items: prepend %lldus, insert-middle %lldus, "
+            "iterate %lldus, remove-front %lldus\n", nr,
+            us(t0, t1), us(t1, t2), us(t2, t3), us(t3, t4));
+
+    purc_variant_unref(arr);
+
+    cleanup = purc_cleanup ();
+    ASSERT_EQ (cleanup, true);
+}
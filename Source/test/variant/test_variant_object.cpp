@@ -27,6 +27,9 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <errno.h>
+#include <chrono>
+#include <string>
+#include <vector>
 #include <gtest/gtest.h>
 
 static inline void
@@ -466,3 +469,184 @@ TEST(object, compare)
     purc_variant_unref(obj2);
 }
 
+
+TEST(object, many_keys)
+{
+    PurCInstance purc;
+
+    purc_variant_t obj = purc_variant_make_object(0,
+            PURC_VARIANT_INVALID, PURC_VARIANT_INVALID);
+    ASSERT_NE(obj, PURC_VARIANT_INVALID);
+
+    // cross the threshold of the hash index in both directions
+    const size_t nr = PCVAR_OBJ_LINEAR_MAX * 8;
+    char key[32];
+    for (size_t i = 0; i < nr; ++i) {
+        snprintf(key, sizeof(key), "k%zu", (i * 37) % nr);
+        purc_variant_t v = purc_variant_make_ulongint((i * 37) % nr);
+        ASSERT_TRUE(purc_variant_object_set_by_static_ckey(obj, key, v));
+        purc_variant_unref(v);
+    }
+    ASSERT_EQ(purc_variant_object_get_size(obj), nr);
+
+    for (size_t i = 0; i < nr; ++i) {
+        snprintf(key, sizeof(key), "k%zu", i);
+        purc_variant_t v = purc_variant_object_get_by_ckey(obj, key);
+        ASSERT_NE(v, PURC_VARIANT_INVALID);
+        ASSERT_EQ(v->u64, i);
+    }
+    ASSERT_EQ(purc_variant_object_get_by_ckey(obj, "k"),
+            PURC_VARIANT_INVALID);
+
+    // the properties are iterated in the order of keys
+    const char *prev = "";
+    purc_variant_t k, v;
+    foreach_key_value_in_variant_object(obj, k, v) {
+        const char *sk = purc_variant_get_string_const(k);
+        ASSERT_LT(strcmp(prev, sk), 0);
+        prev = sk;
+        (void)v;
+    } end_foreach;
+
+    for (size_t i = 0; i < nr; i += 2) {
+        snprintf(key, sizeof(key), "k%zu", i);
+        ASSERT_TRUE(purc_variant_object_remove_by_static_ckey(obj, key,
+                    false));
+    }
+    ASSERT_EQ(purc_variant_object_get_size(obj), nr / 2);
+
+    for (size_t i = 0; i < nr; ++i) {
+        snprintf(key, sizeof(key), "k%zu", i);
+        purc_variant_t v = purc_variant_object_get_by_ckey(obj, key);
+        if (i % 2) {
+            ASSERT_NE(v, PURC_VARIANT_INVALID);
+            ASSERT_EQ(v->u64, i);
+        }
+        else {
+            ASSERT_EQ(v, PURC_VARIANT_INVALID);
+        }
+    }
+
+    for (size_t i = 1; i < nr - 2; i += 2) {
+        snprintf(key, sizeof(key), "k%zu", i);
+        ASSERT_TRUE(purc_variant_object_remove_by_static_ckey(obj, key,
+                    false));
+    }
+    ASSERT_EQ(purc_variant_object_get_size(obj), 1);
+    v = purc_variant_object_get_by_ckey(obj, "k63");
+    ASSERT_NE(v, PURC_VARIANT_INVALID);
+    ASSERT_EQ(v->u64, 63);
+
+    purc_variant_unref(obj);
+}
+
+TEST(object, atom_keys)
+{
+    PurCInstance purc;
+
+    purc_variant_t obj = purc_variant_make_object(0,
+            PURC_VARIANT_INVALID, PURC_VARIANT_INVALID);
+    ASSERT_NE(obj, PURC_VARIANT_INVALID);
+
+    purc_atom_t atom = purc_atom_from_static_string("contains");
+    purc_atom_t other = purc_atom_from_static_string("other");
+    purc_variant_t v1 = purc_variant_make_ulongint(1);
+    purc_variant_t v2 = purc_variant_make_ulongint(2);
+
+    ASSERT_TRUE(pcvariant_object_set_by_atom(obj, atom, v1));
+    ASSERT_TRUE(purc_variant_object_set_by_static_ckey(obj, "other", v2));
+
+    // the interned key is also visible by string
+    ASSERT_EQ(purc_variant_object_get_by_ckey(obj, "contains"), v1);
+    ASSERT_EQ(pcvariant_object_get_by_atom(obj, atom, "contains",
+                pcvariant_object_key_hash("contains")), v1);
+
+    // the key which was set by string is compared as string
+    ASSERT_EQ(pcvariant_object_get_by_atom(obj, other, "other",
+                pcvariant_object_key_hash("other")), v2);
+
+    purc_atom_t none = purc_atom_from_static_string("none");
+    ASSERT_EQ(pcvariant_object_get_by_atom(obj, none, "none",
+                pcvariant_object_key_hash("none")),
+            PURC_VARIANT_INVALID);
+
+    purc_variant_unref(v1);
+    purc_variant_unref(v2);
+    purc_variant_unref(obj);
+}
+
+TEST(object, perf)
+{
+    purc_instance_extra_info info = {};
+    int ret = 0;
+    bool cleanup = false;
+
+    ret = purc_init_ex (PURC_MODULE_VARIANT, "cn.fmsoft.hybridos.test",
+            "test_init", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    // NR_OBJECTS=100000 NR_KEYS=12 ./test_variant_object
+    //      --gtest_filter=object.perf
+    const char *env = getenv("NR_OBJECTS");
+    size_t nr = env ? strtoul(env, NULL, 10) : 0;
+    if (nr == 0)
+        nr = 1024 * 8;
+    env = getenv("NR_KEYS");
+    size_t nr_keys = env ? strtoul(env, NULL, 10) : 0;
+    if (nr_keys == 0)
+        nr_keys = 12;
+
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < nr_keys; ++i)
+        keys.push_back("property" + std::to_string(i));
+
+    const struct purc_variant_stat *stat = purc_variant_usage_stat();
+    size_t mem0 = stat->sz_total_mem;
+
+    std::vector<purc_variant_t> objs;
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < nr; ++i) {
+        purc_variant_t obj = purc_variant_make_object(0,
+                PURC_VARIANT_INVALID, PURC_VARIANT_INVALID);
+        ASSERT_NE(obj, PURC_VARIANT_INVALID);
+        for (size_t j = 0; j < nr_keys; ++j) {
+            purc_variant_t v = purc_variant_make_ulongint(j);
+            ASSERT_TRUE(purc_variant_object_set_by_static_ckey(obj,
+                        keys[j].c_str(), v));
+            purc_variant_unref(v);
+        }
+        objs.push_back(obj);
+    }
+
+    auto t1 = std::chrono::steady_clock::now();
+    stat = purc_variant_usage_stat();
+    size_t mem1 = stat->sz_total_mem;
+
+    uint64_t sum = 0;
+    for (size_t i = 0; i < nr; ++i) {
+        for (size_t j = 0; j < nr_keys; ++j) {
+            purc_variant_t v = purc_variant_object_get_by_ckey(objs[i],
+                    keys[j].c_str());
+            sum += v->u64;
+        }
+    }
+    ASSERT_EQ(sum, nr * nr_keys * (nr_keys - 1) / 2);
+
+    auto t2 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < nr; ++i)
+        purc_variant_unref(objs[i]);
+
+    auto t3 = std::chrono::steady_clock::now();
+
+    auto us = [](std::chrono::steady_clock::time_point a,
+            std::chrono::steady_clock::time_point b) {
+        return (long long)std::chrono::duration_cast<
+            std::chrono::microseconds>(b - a).count();
+    };
+    fprintf(stderr, "%zu objects of %zu keys: build %lldus, lookup %lldus, "
+            "release %lldus, %zu bytes per object\n", nr, nr_keys,
+            us(t0, t1), us(t1, t2), us(t2, t3), (mem1 - mem0) / nr);
+
+    cleanup = purc_cleanup ();
+    ASSERT_EQ (cleanup, true);
+}